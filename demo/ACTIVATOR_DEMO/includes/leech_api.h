@@ -17,10 +17,82 @@
 // Custom command definitions (must match device_fpga.c)
 #define LC_CMD_FPGA_CUSTOM_READ         0x0200000000000000
 #define LC_CMD_FPGA_CUSTOM_WRITE        0x0201000000000000
+#define LC_CMD_FPGA_CUSTOM_READ_BULK    0x0202000000000000
+#define LC_CMD_FPGA_CUSTOM_WRITE_VECTOR 0x0203000000000000
+#define LC_CMD_FPGA_CUSTOM_WRITE_VECTOR_BARRIER     0x01
+#define LC_CMD_FPGA_CUSTOM_SHADOW_INVALIDATE    0x0204000000000000
+#define LC_CMD_FPGA_CUSTOM_SHADOW_REFRESH       0x0205000000000000
+#define LC_CMD_FPGA_CUSTOM_SHADOW_POLICY        0x0206000000000000
+#define LC_CMD_FPGA_CUSTOM_WATCH                0x0207000000000000
+#define LC_CMD_FPGA_MAILBOX_READ                0x0208000000000000
+#define LC_CMD_FPGA_MAILBOX_WRITE               0x0209000000000000
+#define LC_CMD_FPGA_PERF_COUNTERS               0x020A000000000000
+#define LC_CMD_FPGA_PERF_COUNTERS_CLEAR         0x01
 
 // Macros for multi-register access
 #define LC_CMD_FPGA_CUSTOM_READ_REG(n)  (LC_CMD_FPGA_CUSTOM_READ | ((n) & 0xFF))
 #define LC_CMD_FPGA_CUSTOM_WRITE_REG(n) (LC_CMD_FPGA_CUSTOM_WRITE | ((n) & 0xFF))
+#define LC_CMD_FPGA_CUSTOM_READ_BULK_RANGE(start, count)  (LC_CMD_FPGA_CUSTOM_READ_BULK | ((start) & 0xFF) | (((count) & 0xFF) << 8))
+#define LC_CMD_FPGA_CUSTOM_SHADOW_POLICY_SET(n, policy)   (LC_CMD_FPGA_CUSTOM_SHADOW_POLICY | ((n) & 0xFF) | (((policy) & 0xFF) << 8))
+#define LC_CMD_FPGA_MAILBOX_READ_RANGE(o, cb)             (LC_CMD_FPGA_MAILBOX_READ | ((o) & 0xFFFF) | (((cb) & 0xFFFF) << 16))
+#define LC_CMD_FPGA_MAILBOX_WRITE_OFFSET(o)               (LC_CMD_FPGA_MAILBOX_WRITE | ((o) & 0xFFFF))
+#define FPGA_MAILBOX_SIZE               0x1000
+
+// Shadow register policies (must match device_fpga.c)
+#define FPGA_CUSTOM_REG_POLICY_VOLATILE     0x00
+#define FPGA_CUSTOM_REG_POLICY_WRITETHROUGH 0x01
+#define FPGA_CUSTOM_REG_POLICY_IMMUTABLE    0x02
+
+// Vectored write entry (must match device_fpga.c)
+typedef struct tdFPGA_CUSTOM_WRITE_ENTRY {
+    DWORD dwReg;            // Register number
+    DWORD dwValue;          // Value to write
+    DWORD dwMask;           // Bits to write (0xFFFFFFFF = whole register)
+} FPGA_CUSTOM_WRITE_ENTRY, *PFPGA_CUSTOM_WRITE_ENTRY;
+
+// Register watch (must match device_fpga.c)
+#define FPGA_CUSTOM_WATCH_VERSION       0xc0fe0001
+
+typedef struct tdFPGA_CUSTOM_WATCH_CHANGE {
+    DWORD dwReg;            // Register number
+    DWORD dwValueOld;       // Previously sampled value (== dwValueNew on the initial sample)
+    DWORD dwValueNew;       // Currently sampled value
+} FPGA_CUSTOM_WATCH_CHANGE, *PFPGA_CUSTOM_WATCH_CHANGE;
+
+// Called from the LeechCore watch thread - must return quickly and must not call LeechCore
+// A failed sample is reported with cChange == 0 and pChanges == NULL
+typedef VOID(*PFPGA_CUSTOM_WATCH_CALLBACK)(PVOID ctxUser, DWORD cChange, PFPGA_CUSTOM_WATCH_CHANGE pChanges);
+
+typedef struct tdFPGA_CUSTOM_WATCH {
+    DWORD dwVersion;        // FPGA_CUSTOM_WATCH_VERSION
+    DWORD dwIntervalMs;     // Sample interval in ms (0 = 1ms)
+    PFPGA_CUSTOM_WATCH_CALLBACK pfnCB;
+    PVOID ctxUser;
+    DWORD cReg;             // Number of registers in pbRegs
+    BYTE pbRegs[128];
+} FPGA_CUSTOM_WATCH, *PFPGA_CUSTOM_WATCH;
+
+// Firmware performance counters (must match device_fpga.c)
+#define FPGA_PERF_COUNTERS_VERSION      0xc0fe0002
+
+typedef struct tdFPGA_PERF_COUNTERS {
+    DWORD dwVersion;        // FPGA_PERF_COUNTERS_VERSION
+    DWORD dwFpgaPerfId;     // Firmware perf block id
+    QWORD qwTicks;          // FPGA clock cycles (100MHz) since last clear
+    DWORD cTlpTx;           // TLPs host -> PCIe
+    DWORD cTlpTxDw;         // TLP dwords host -> PCIe
+    DWORD cTlpTxDrop;       // TLPs host -> PCIe dropped (TLP control disabled)
+    DWORD cTlpRx;           // TLPs PCIe -> host (completions)
+    DWORD cTlpRxDw;         // TLP dwords PCIe -> host
+    DWORD cTlpRxStall;      // Cycles with PCIe rx TLP data waiting for the USB side
+    DWORD cUsbRxQw;         // 64-bit words received from the FT601
+    DWORD cUsbTxDw;         // 32-bit words sent to the FT601
+    DWORD cUsbStall;        // Cycles the FT601 was not ready to accept data
+    DWORD cUsbStallMax;     // Longest continuous FT601 backpressure run (cycles)
+    DWORD cCmdRx;           // Command packets processed
+    DWORD cCmdTxFull;       // Cycles the command reply fifo was almost full
+    DWORD _Reserved;
+} FPGA_PERF_COUNTERS, *PFPGA_PERF_COUNTERS;
 
 // Register function definitions (Simplified Architecture: 24-31)
 #define REG_DNA_LOW         24      // DNA value low 32 bits
@@ -52,7 +124,7 @@
 
 // Timeout settings
 #define DEFAULT_TIMEOUT_MS  5000    // Default timeout (milliseconds)
-#define POLL_INTERVAL_MS    10      // Polling interval (milliseconds)
+#define POLL_INTERVAL_MS    1       // Register watch sample interval (milliseconds)
 
 /**
  * Initialize LeechCore connection
@@ -75,6 +147,16 @@ void cleanup_leechcore(HANDLE hLC);
  */
 uint32_t read_register(HANDLE hLC, int reg_num);
 
+/**
+ * Read a contiguous range of registers in one USB round trip
+ * @param hLC       LeechCore handle
+ * @param reg_start First register number (24-31 for DNA verification)
+ * @param count     Number of registers to read
+ * @param values    Output array receiving count register values
+ * @return true=success, false=failed
+ */
+bool read_registers(HANDLE hLC, int reg_start, int count, uint32_t* values);
+
 /**
  * Write specified register value
  * @param hLC     LeechCore handle
@@ -84,6 +166,38 @@ uint32_t read_register(HANDLE hLC, int reg_num);
  */
 bool write_register(HANDLE hLC, int reg_num, uint32_t value);
 
+/**
+ * Write multiple registers in one USB transfer
+ * @param hLC     LeechCore handle
+ * @param entries Array of (register, value, mask) entries, written in order
+ * @param count   Number of entries
+ * @param barrier true=wait until the FPGA has processed all writes
+ * @return true=success, false=failed
+ */
+bool write_registers(HANDLE hLC, const FPGA_CUSTOM_WRITE_ENTRY* entries, int count, bool barrier);
+
+/**
+ * Start watching a contiguous range of registers. LeechCore samples all
+ * registers in one USB round trip per interval and invokes the callback
+ * (from its own thread) with the registers whose value changed. The initial
+ * sample reports all registers. Replaces any previous watch.
+ * @param hLC         LeechCore handle
+ * @param reg_start   First register number (24-31 for DNA verification)
+ * @param count       Number of registers to watch
+ * @param interval_ms Sample interval in milliseconds
+ * @param callback    Change callback
+ * @param ctx         User context passed to the callback
+ * @return true=success, false=failed
+ */
+bool watch_registers(HANDLE hLC, int reg_start, int count, int interval_ms, PFPGA_CUSTOM_WATCH_CALLBACK callback, void* ctx);
+
+/**
+ * Stop watching registers - no callback is in progress once this returns
+ * @param hLC LeechCore handle
+ * @return true=success, false=failed
+ */
+bool unwatch_registers(HANDLE hLC);
+
 /**
  * Read complete DNA value (register 24+25)
  * @param hLC LeechCore handle
@@ -21,6 +21,7 @@ static char g_last_error[256] = {0};
 // Internal function declarations
 static void set_last_error(const char* format, ...);
 static bool is_valid_register(int reg_num);
+static int wait_for_register(HANDLE hLC, int reg_num, int timeout_ms, const int* stop_values, int stop_count, bool show_progress);
 
 /**
  * Initialize LeechCore connection
@@ -109,6 +110,41 @@ uint32_t read_register(HANDLE hLC, int reg_num)
     return value;
 }
 
+/**
+ * Read a contiguous range of registers in one USB round trip
+ */
+bool read_registers(HANDLE hLC, int reg_start, int count, uint32_t* values)
+{
+    if (!hLC) {
+        set_last_error("LeechCore handle invalid");
+        return false;
+    }
+    
+    if (!values || count <= 0 || !is_valid_register(reg_start) || !is_valid_register(reg_start + count - 1)) {
+        set_last_error("Invalid register range: %d-%d", reg_start, reg_start + count - 1);
+        return false;
+    }
+    
+    PBYTE pbDataOut = NULL;
+    DWORD cbDataOut = 0;
+    
+    // Use bulk register read macro - all registers are fetched in one batch
+    QWORD cmd = LC_CMD_FPGA_CUSTOM_READ_BULK_RANGE(reg_start, count);
+    
+    BOOL result = LcCommand(hLC, cmd, 0, NULL, &pbDataOut, &cbDataOut);
+    
+    if (!result || !pbDataOut || cbDataOut != count * sizeof(DWORD)) {
+        set_last_error("Failed to read registers %d-%d", reg_start, reg_start + count - 1);
+        if (pbDataOut) LocalFree(pbDataOut);
+        return false;
+    }
+    
+    memcpy(values, pbDataOut, cbDataOut);
+    LocalFree(pbDataOut);
+    
+    return true;
+}
+
 /**
  * Write specified register value
  */
@@ -138,6 +174,95 @@ bool write_register(HANDLE hLC, int reg_num, uint32_t value)
     return true;
 }
 
+/**
+ * Write multiple registers in one USB transfer
+ */
+bool write_registers(HANDLE hLC, const FPGA_CUSTOM_WRITE_ENTRY* entries, int count, bool barrier)
+{
+    if (!hLC) {
+        set_last_error("LeechCore handle invalid");
+        return false;
+    }
+    
+    if (!entries || count <= 0) {
+        set_last_error("Invalid register write list");
+        return false;
+    }
+    
+    for (int i = 0; i < count; i++) {
+        if (!is_valid_register((int)entries[i].dwReg)) {
+            set_last_error("Invalid register number: %d", (int)entries[i].dwReg);
+            return false;
+        }
+    }
+    
+    // Use vectored write command - all entries are committed in one transfer
+    QWORD cmd = LC_CMD_FPGA_CUSTOM_WRITE_VECTOR | (barrier ? LC_CMD_FPGA_CUSTOM_WRITE_VECTOR_BARRIER : 0);
+    
+    BOOL result = LcCommand(hLC, cmd, count * sizeof(FPGA_CUSTOM_WRITE_ENTRY), (PBYTE)entries, NULL, NULL);
+    
+    if (!result) {
+        set_last_error("Failed to write %d registers", count);
+        return false;
+    }
+    
+    return true;
+}
+
+/**
+ * Start watching a contiguous range of registers
+ */
+bool watch_registers(HANDLE hLC, int reg_start, int count, int interval_ms, PFPGA_CUSTOM_WATCH_CALLBACK callback, void* ctx)
+{
+    if (!hLC) {
+        set_last_error("LeechCore handle invalid");
+        return false;
+    }
+    
+    if (!callback || count <= 0 || !is_valid_register(reg_start) || !is_valid_register(reg_start + count - 1)) {
+        set_last_error("Invalid register watch: %d-%d", reg_start, reg_start + count - 1);
+        return false;
+    }
+    
+    FPGA_CUSTOM_WATCH watch = {0};
+    watch.dwVersion = FPGA_CUSTOM_WATCH_VERSION;
+    watch.dwIntervalMs = (DWORD)interval_ms;
+    watch.pfnCB = callback;
+    watch.ctxUser = ctx;
+    watch.cReg = (DWORD)count;
+    for (int i = 0; i < count; i++) {
+        watch.pbRegs[i] = (BYTE)(reg_start + i);
+    }
+    
+    // LeechCore samples the whole set in one batch per interval - no polling loop needed here
+    BOOL result = LcCommand(hLC, LC_CMD_FPGA_CUSTOM_WATCH, sizeof(watch), (PBYTE)&watch, NULL, NULL);
+    
+    if (!result) {
+        set_last_error("Failed to watch registers %d-%d", reg_start, reg_start + count - 1);
+        return false;
+    }
+    
+    return true;
+}
+
+/**
+ * Stop watching registers
+ */
+bool unwatch_registers(HANDLE hLC)
+{
+    if (!hLC) {
+        set_last_error("LeechCore handle invalid");
+        return false;
+    }
+    
+    if (!LcCommand(hLC, LC_CMD_FPGA_CUSTOM_WATCH, 0, NULL, NULL, NULL)) {
+        set_last_error("Failed to stop register watch");
+        return false;
+    }
+    
+    return true;
+}
+
 /**
  * Read complete DNA value (register 24+25)
  */
@@ -183,14 +308,15 @@ bool start_verification(HANDLE hLC)
     
     printf("Starting verification process...\n");
     
-    // Clear previous states first
-    write_register(hLC, REG_SYSTEM_STATUS, STATUS_IDLE);
-    write_register(hLC, REG_VERIFY_STATUS, VERIFY_FAILED);
-    write_register(hLC, REG_TLP_CONTROL, TLP_DISABLED);
-    write_register(hLC, REG_DECRYPTED_RESULT, 0);
-    
-    // Send start verification command
-    bool result = write_register(hLC, REG_CONTROL_CMD, CMD_START_VERIFY);
+    // Clear previous states first, then send start verification command
+    FPGA_CUSTOM_WRITE_ENTRY entries[] = {
+        { REG_SYSTEM_STATUS,    STATUS_IDLE,      0xFFFFFFFF },
+        { REG_VERIFY_STATUS,    VERIFY_FAILED,    0xFFFFFFFF },
+        { REG_TLP_CONTROL,      TLP_DISABLED,     0xFFFFFFFF },
+        { REG_DECRYPTED_RESULT, 0,                0xFFFFFFFF },
+        { REG_CONTROL_CMD,      CMD_START_VERIFY, 0xFFFFFFFF },
+    };
+    bool result = write_registers(hLC, entries, sizeof(entries) / sizeof(entries[0]), true);
     
     if (result) {
         printf("Verification process started successfully\n");
@@ -284,35 +410,21 @@ bool wait_for_firmware_ready(HANDLE hLC, int timeout_ms)
     
     printf("Waiting for firmware processing completion (timeout: %d ms)...\n", timeout_ms);
     
-    int elapsed = 0;
-    while (elapsed < timeout_ms) {
-        int status = check_system_status(hLC);
-        
-        if (status == STATUS_COMPLETED) {
-            printf("Firmware processing completed\n");
-            return true;
-        }
-        
-        if (status == STATUS_ERROR) {
-            set_last_error("Firmware processing error");
-            return false;
-        }
-        
-        if (status == -1) {
-            set_last_error("Cannot read firmware status");
-            return false;
-        }
-        
-        Sleep(POLL_INTERVAL_MS);
-        elapsed += POLL_INTERVAL_MS;
-        
-        // Show progress every second
-        if (elapsed % 1000 == 0) {
-            printf("Waiting... (%d/%d seconds)\n", elapsed/1000, timeout_ms/1000);
-        }
+    const int stop_values[] = { STATUS_COMPLETED, STATUS_ERROR };
+    int status = wait_for_register(hLC, REG_SYSTEM_STATUS, timeout_ms, stop_values, 2, true);
+    
+    if (status == STATUS_COMPLETED) {
+        printf("Firmware processing completed\n");
+        return true;
     }
     
-    set_last_error("Firmware processing timeout");
+    if (status == STATUS_ERROR) {
+        set_last_error("Firmware processing error");
+    } else if (status == -1) {
+        set_last_error("Cannot read firmware status");
+    } else if (status == -2) {
+        set_last_error("Firmware processing timeout");
+    }
     return false;
 }
 
@@ -328,25 +440,19 @@ bool wait_for_verification_complete(HANDLE hLC, int timeout_ms)
     
     printf("Waiting for verification completion (timeout: %d ms)...\n", timeout_ms);
     
-    int elapsed = 0;
-    while (elapsed < timeout_ms) {
-        int verify_status = check_verification_status(hLC);
-        
-        if (verify_status == VERIFY_SUCCESS) {
-            printf("Verification successful!\n");
-            return true;
-        }
-        
-        if (verify_status == -1) {
-            set_last_error("Cannot read verification status");
-            return false;
-        }
-        
-        Sleep(POLL_INTERVAL_MS);
-        elapsed += POLL_INTERVAL_MS;
+    const int stop_values[] = { VERIFY_SUCCESS };
+    int verify_status = wait_for_register(hLC, REG_VERIFY_STATUS, timeout_ms, stop_values, 1, false);
+    
+    if (verify_status == VERIFY_SUCCESS) {
+        printf("Verification successful!\n");
+        return true;
     }
     
-    set_last_error("Verification completion timeout");
+    if (verify_status == -1) {
+        set_last_error("Cannot read verification status");
+    } else if (verify_status == -2) {
+        set_last_error("Verification completion timeout");
+    }
     return false;
 }
 
@@ -363,13 +469,15 @@ bool reset_verification(HANDLE hLC)
     printf("Resetting verification process...\n");
     
     // Clear all status registers
-    bool success = true;
-    success &= write_register(hLC, REG_CONTROL_CMD, CMD_IDLE);
-    success &= write_register(hLC, REG_SYSTEM_STATUS, STATUS_IDLE);
-    success &= write_register(hLC, REG_VERIFY_STATUS, VERIFY_FAILED);
-    success &= write_register(hLC, REG_TLP_CONTROL, TLP_DISABLED);
-    success &= write_register(hLC, REG_ENCRYPTED_VALUE, 0);
-    success &= write_register(hLC, REG_DECRYPTED_RESULT, 0);
+    FPGA_CUSTOM_WRITE_ENTRY entries[] = {
+        { REG_CONTROL_CMD,      CMD_IDLE,         0xFFFFFFFF },
+        { REG_SYSTEM_STATUS,    STATUS_IDLE,      0xFFFFFFFF },
+        { REG_VERIFY_STATUS,    VERIFY_FAILED,    0xFFFFFFFF },
+        { REG_TLP_CONTROL,      TLP_DISABLED,     0xFFFFFFFF },
+        { REG_ENCRYPTED_VALUE,  0,                0xFFFFFFFF },
+        { REG_DECRYPTED_RESULT, 0,                0xFFFFFFFF },
+    };
+    bool success = write_registers(hLC, entries, sizeof(entries) / sizeof(entries[0]), true);
     
     if (success) {
         printf("Verification process reset successfully\n");
@@ -398,20 +506,107 @@ void print_register_status(HANDLE hLC)
         return;
     }
     
+    uint32_t regs[8] = {0};
+    if (!read_registers(hLC, REG_DNA_LOW, 8, regs)) {
+        return;
+    }
+    
     printf("\n=== Register Status ===\n");
-    printf("Register %d (DNA low 32 bits): 0x%08X\n", REG_DNA_LOW, read_register(hLC, REG_DNA_LOW));
-    printf("Register %d (DNA high 25 bits): 0x%08X\n", REG_DNA_HIGH, read_register(hLC, REG_DNA_HIGH));
-    printf("Register %d (Encrypted random): 0x%08X\n", REG_ENCRYPTED_VALUE, read_register(hLC, REG_ENCRYPTED_VALUE));
-    printf("Register %d (Decrypted result): 0x%08X\n", REG_DECRYPTED_RESULT, read_register(hLC, REG_DECRYPTED_RESULT));
-    printf("Register %d (Verification status): %d\n", REG_VERIFY_STATUS, read_register(hLC, REG_VERIFY_STATUS));
-    printf("Register %d (TLP control): %d\n", REG_TLP_CONTROL, read_register(hLC, REG_TLP_CONTROL));
-    printf("Register %d (Control command): %d\n", REG_CONTROL_CMD, read_register(hLC, REG_CONTROL_CMD));
-    printf("Register %d (System status): %d\n", REG_SYSTEM_STATUS, read_register(hLC, REG_SYSTEM_STATUS));
+    printf("Register %d (DNA low 32 bits): 0x%08X\n", REG_DNA_LOW, regs[REG_DNA_LOW - REG_DNA_LOW]);
+    printf("Register %d (DNA high 25 bits): 0x%08X\n", REG_DNA_HIGH, regs[REG_DNA_HIGH - REG_DNA_LOW]);
+    printf("Register %d (Encrypted random): 0x%08X\n", REG_ENCRYPTED_VALUE, regs[REG_ENCRYPTED_VALUE - REG_DNA_LOW]);
+    printf("Register %d (Decrypted result): 0x%08X\n", REG_DECRYPTED_RESULT, regs[REG_DECRYPTED_RESULT - REG_DNA_LOW]);
+    printf("Register %d (Verification status): %d\n", REG_VERIFY_STATUS, regs[REG_VERIFY_STATUS - REG_DNA_LOW]);
+    printf("Register %d (TLP control): %d\n", REG_TLP_CONTROL, regs[REG_TLP_CONTROL - REG_DNA_LOW]);
+    printf("Register %d (Control command): %d\n", REG_CONTROL_CMD, regs[REG_CONTROL_CMD - REG_DNA_LOW]);
+    printf("Register %d (System status): %d\n", REG_SYSTEM_STATUS, regs[REG_SYSTEM_STATUS - REG_DNA_LOW]);
     printf("=======================\n\n");
 }
 
 // ==================== Internal Helper Functions ====================
 
+// Register watch state shared with the LeechCore watch thread
+typedef struct tdWAIT_CONTEXT {
+    HANDLE hEvent;
+    volatile LONG value;
+    volatile LONG valid;
+    volatile LONG failed;
+} WAIT_CONTEXT;
+
+/**
+ * Register watch callback - record the latest value (or a failed read) and
+ * wake the waiter
+ */
+static VOID wait_watch_callback(PVOID ctxUser, DWORD cChange, PFPGA_CUSTOM_WATCH_CHANGE pChanges)
+{
+    WAIT_CONTEXT* wait = (WAIT_CONTEXT*)ctxUser;
+    if (!cChange) {
+        InterlockedExchange(&wait->failed, 1);
+        SetEvent(wait->hEvent);
+        return;
+    }
+    InterlockedExchange(&wait->value, (LONG)pChanges[cChange - 1].dwValueNew);
+    InterlockedExchange(&wait->valid, 1);
+    SetEvent(wait->hEvent);
+}
+
+/**
+ * Wait until a register takes one of the given values. The register is
+ * watched by LeechCore and this thread sleeps until its value changes.
+ * @return Matched register value, -1 on error (register read failed), -2 on timeout
+ */
+static int wait_for_register(HANDLE hLC, int reg_num, int timeout_ms, const int* stop_values, int stop_count, bool show_progress)
+{
+    WAIT_CONTEXT wait = {0};
+    int result = -2;
+    
+    if (!(wait.hEvent = CreateEvent(NULL, FALSE, FALSE, NULL))) {
+        set_last_error("Failed to create wait event");
+        return -1;
+    }
+    
+    if (!watch_registers(hLC, reg_num, 1, POLL_INTERVAL_MS, wait_watch_callback, &wait)) {
+        CloseHandle(wait.hEvent);
+        return -1;
+    }
+    
+    ULONGLONG start = GetTickCount64();
+    int elapsed = 0, last_progress = 0;
+    while (elapsed < timeout_ms) {
+        // Wake up on register change, or at least once per second for progress output
+        WaitForSingleObject(wait.hEvent, (DWORD)min(1000, timeout_ms - elapsed));
+        
+        if (wait.failed) {
+            result = -1;
+            break;
+        }
+        
+        if (wait.valid) {
+            for (int i = 0; i < stop_count; i++) {
+                if ((int)wait.value == stop_values[i]) {
+                    result = stop_values[i];
+                }
+            }
+            if (result != -2) {
+                break;
+            }
+        }
+        
+        elapsed = (int)(GetTickCount64() - start);
+        
+        // Show progress every second
+        if (show_progress && elapsed / 1000 > last_progress) {
+            last_progress = elapsed / 1000;
+            printf("Waiting... (%d/%d seconds)\n", last_progress, timeout_ms/1000);
+        }
+    }
+    
+    // Stop the watch before the wait context goes out of scope
+    unwatch_registers(hLC);
+    CloseHandle(wait.hEvent);
+    return result;
+}
+
 /**
  * Set error information
  */
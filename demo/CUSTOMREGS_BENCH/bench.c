@@ -0,0 +1,427 @@
+/**
+ * PCILeech Custom Register Microbenchmark
+ *
+ * Function: Measure custom register I/O through LcCommand
+ *   - read_single   : LC_CMD_FPGA_CUSTOM_READ_REG         (1 register / op)
+ *   - write_single  : LC_CMD_FPGA_CUSTOM_WRITE_REG        (1 register / op)
+ *   - read_bulk     : LC_CMD_FPGA_CUSTOM_READ_BULK_RANGE  (BENCH_REG_COUNT registers / op)
+ *   - write_vector  : LC_CMD_FPGA_CUSTOM_WRITE_VECTOR     (BENCH_REG_COUNT registers / op, barrier)
+ *   - mixed_read    : 75% single reads  \ interleaved, every read is verified
+ *   - mixed_write   : 25% single writes / against the last value written
+ *
+ * Results (throughput, p50/p99/p999/max latency per operation type) are
+ * written as JSON to stdout or to the file given by -o. Progress is printed
+ * to stderr. The exit code is non-zero if any operation failed or returned
+ * an unexpected value, which makes the benchmark usable as a CI check.
+ *
+ * By default the benchmark runs against the software FPGA stand-in built
+ * into LeechCore ("fpga://sim=1") and therefore needs no hardware. Use
+ * -device fpga to measure a real FPGA device (after DNA activation).
+ *
+ * Usage: bench [-device <device>] [-n <iterations>] [-warmup <iterations>] [-o <file.json>] [-shadow]
+ *
+ * Build: Windows - open bench.sln in Visual Studio 2022
+ *        Linux   - make (requires leechcore.so in ../../software/LeechCore-CustomRegs/files)
+ */
+
+#ifdef _WIN32
+#define _CRT_SECURE_NO_WARNINGS
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <leechcore.h>
+
+// Custom command definitions (must match device_fpga.c)
+#define LC_CMD_FPGA_CUSTOM_READ         0x0200000000000000
+#define LC_CMD_FPGA_CUSTOM_WRITE        0x0201000000000000
+#define LC_CMD_FPGA_CUSTOM_READ_BULK    0x0202000000000000
+#define LC_CMD_FPGA_CUSTOM_WRITE_VECTOR 0x0203000000000000
+#define LC_CMD_FPGA_CUSTOM_WRITE_VECTOR_BARRIER     0x01
+#define LC_CMD_FPGA_CUSTOM_SHADOW_POLICY        0x0206000000000000
+
+#define LC_CMD_FPGA_CUSTOM_READ_REG(n)  (LC_CMD_FPGA_CUSTOM_READ | ((n) & 0xFF))
+#define LC_CMD_FPGA_CUSTOM_WRITE_REG(n) (LC_CMD_FPGA_CUSTOM_WRITE | ((n) & 0xFF))
+#define LC_CMD_FPGA_CUSTOM_READ_BULK_RANGE(start, count)  (LC_CMD_FPGA_CUSTOM_READ_BULK | ((start) & 0xFF) | (((count) & 0xFF) << 8))
+#define LC_CMD_FPGA_CUSTOM_SHADOW_POLICY_SET(n, policy)   (LC_CMD_FPGA_CUSTOM_SHADOW_POLICY | ((n) & 0xFF) | (((policy) & 0xFF) << 8))
+
+#define FPGA_CUSTOM_REG_POLICY_VOLATILE     0x00
+
+// Vectored write entry (must match device_fpga.c)
+typedef struct tdFPGA_CUSTOM_WRITE_ENTRY {
+    DWORD dwReg;            // Register number
+    DWORD dwValue;          // Value to write
+    DWORD dwMask;           // Bits to write (0xFFFFFFFF = whole register)
+} FPGA_CUSTOM_WRITE_ENTRY, *PFPGA_CUSTOM_WRITE_ENTRY;
+
+#define BENCH_REG_COUNT         16          // General purpose registers 0-15 are used
+#define BENCH_DEFAULT_DEVICE    "fpga://sim=1"
+#define BENCH_DEFAULT_ITER      10000
+#define BENCH_DEFAULT_WARMUP    100
+#define BENCH_MIXED_READ_PCT    75
+
+typedef enum tdBENCH_OP {
+    BENCH_OP_READ_SINGLE,
+    BENCH_OP_WRITE_SINGLE,
+    BENCH_OP_READ_BULK,
+    BENCH_OP_WRITE_VECTOR,
+    BENCH_OP_MIXED_READ,
+    BENCH_OP_MIXED_WRITE,
+    BENCH_OP_MAX
+} BENCH_OP;
+
+static const char* g_szBenchOp[BENCH_OP_MAX] = {
+    "read_single", "write_single", "read_bulk", "write_vector", "mixed_read", "mixed_write"
+};
+static const DWORD g_cBenchOpRegs[BENCH_OP_MAX] = {
+    1, 1, BENCH_REG_COUNT, BENCH_REG_COUNT, 1, 1
+};
+
+typedef struct tdBENCH_RESULT {
+    uint64_t* pqwLatencyNs;     // Latency of each successful operation
+    DWORD cOp;                  // Successful operations
+    DWORD cError;               // Failed operations
+    DWORD cMismatch;            // Reads returning an unexpected value
+    uint64_t qwTotalNs;         // Wall time spent in the workload
+} BENCH_RESULT, *PBENCH_RESULT;
+
+// ============================================================================
+// Helper functions
+// ============================================================================
+
+/**
+ * Monotonic timestamp in nanoseconds
+ */
+static uint64_t bench_now_ns(void) {
+#ifdef _WIN32
+    static LARGE_INTEGER freq = { 0 };
+    LARGE_INTEGER now;
+    if (!freq.QuadPart) QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (uint64_t)((double)now.QuadPart * 1000000000.0 / (double)freq.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+/**
+ * Small xorshift PRNG - deterministic workload across runs
+ */
+static uint32_t bench_rand(uint32_t* pState) {
+    uint32_t x = *pState;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *pState = x;
+}
+
+static int bench_cmp_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Nearest-rank percentile of a sorted latency array
+ */
+static uint64_t bench_percentile(const uint64_t* pqwSorted, DWORD c, double p) {
+    DWORD i;
+    if (!c) return 0;
+    i = (DWORD)((p * c) + 0.999999);
+    return pqwSorted[(i ? i : 1) - 1];
+}
+
+static void bench_record(PBENCH_RESULT pResult, bool fSuccess, uint64_t qwLatencyNs) {
+    if (fSuccess) {
+        pResult->pqwLatencyNs[pResult->cOp++] = qwLatencyNs;
+    } else {
+        pResult->cError++;
+    }
+}
+
+// ============================================================================
+// Register operations (one LcCommand each)
+// ============================================================================
+
+static bool bench_read_single(HANDLE hLC, BYTE regNum, DWORD* pValue) {
+    PBYTE pbDataOut = NULL;
+    DWORD cbDataOut = 0;
+    bool result = LcCommand(hLC, LC_CMD_FPGA_CUSTOM_READ_REG(regNum), 0, NULL, &pbDataOut, &cbDataOut) && (cbDataOut == sizeof(DWORD));
+    if (result) *pValue = *(PDWORD)pbDataOut;
+    LcMemFree(pbDataOut);
+    return result;
+}
+
+static bool bench_write_single(HANDLE hLC, BYTE regNum, DWORD value) {
+    return LcCommand(hLC, LC_CMD_FPGA_CUSTOM_WRITE_REG(regNum), sizeof(DWORD), (PBYTE)&value, NULL, NULL);
+}
+
+static bool bench_read_bulk(HANDLE hLC, DWORD* pValues) {
+    PBYTE pbDataOut = NULL;
+    DWORD cbDataOut = 0;
+    bool result = LcCommand(hLC, LC_CMD_FPGA_CUSTOM_READ_BULK_RANGE(0, BENCH_REG_COUNT), 0, NULL, &pbDataOut, &cbDataOut) && (cbDataOut == BENCH_REG_COUNT * sizeof(DWORD));
+    if (result) memcpy(pValues, pbDataOut, cbDataOut);
+    LcMemFree(pbDataOut);
+    return result;
+}
+
+static bool bench_write_vector(HANDLE hLC, PFPGA_CUSTOM_WRITE_ENTRY pEntries) {
+    return LcCommand(hLC, LC_CMD_FPGA_CUSTOM_WRITE_VECTOR | LC_CMD_FPGA_CUSTOM_WRITE_VECTOR_BARRIER, BENCH_REG_COUNT * sizeof(FPGA_CUSTOM_WRITE_ENTRY), (PBYTE)pEntries, NULL, NULL);
+}
+
+// ============================================================================
+// Workloads
+// ============================================================================
+
+/**
+ * Run a single operation type workload
+ * @param hLC       LeechCore handle
+ * @param op        Operation type (not mixed)
+ * @param cIter     Number of operations
+ * @param pdwModel  Expected register values (updated on write)
+ * @param pResult   Result to fill in
+ */
+static void bench_run_simple(HANDLE hLC, BENCH_OP op, DWORD cIter, DWORD* pdwModel, PBENCH_RESULT pResult) {
+    DWORD i, j, dwValue, dwValues[BENCH_REG_COUNT];
+    FPGA_CUSTOM_WRITE_ENTRY entries[BENCH_REG_COUNT];
+    uint64_t tmStart, tmOp;
+    bool fSuccess = false;
+    tmStart = bench_now_ns();
+    for (i = 0; i < cIter; i++) {
+        BYTE regNum = (BYTE)(i % BENCH_REG_COUNT);
+        switch (op) {
+            case BENCH_OP_READ_SINGLE:
+                tmOp = bench_now_ns();
+                fSuccess = bench_read_single(hLC, regNum, &dwValue);
+                tmOp = bench_now_ns() - tmOp;
+                if (fSuccess && (dwValue != pdwModel[regNum])) pResult->cMismatch++;
+                break;
+            case BENCH_OP_WRITE_SINGLE:
+                dwValue = 0xbe000000 | (i << 4) | regNum;
+                tmOp = bench_now_ns();
+                fSuccess = bench_write_single(hLC, regNum, dwValue);
+                tmOp = bench_now_ns() - tmOp;
+                if (fSuccess) pdwModel[regNum] = dwValue;
+                break;
+            case BENCH_OP_READ_BULK:
+                tmOp = bench_now_ns();
+                fSuccess = bench_read_bulk(hLC, dwValues);
+                tmOp = bench_now_ns() - tmOp;
+                if (fSuccess && memcmp(dwValues, pdwModel, sizeof(dwValues))) pResult->cMismatch++;
+                break;
+            case BENCH_OP_WRITE_VECTOR:
+                for (j = 0; j < BENCH_REG_COUNT; j++) {
+                    entries[j].dwReg = j;
+                    entries[j].dwValue = 0xec000000 | (i << 4) | j;
+                    entries[j].dwMask = 0xFFFFFFFF;
+                }
+                tmOp = bench_now_ns();
+                fSuccess = bench_write_vector(hLC, entries);
+                tmOp = bench_now_ns() - tmOp;
+                for (j = 0; fSuccess && (j < BENCH_REG_COUNT); j++) {
+                    pdwModel[j] = entries[j].dwValue;
+                }
+                break;
+            default:
+                return;
+        }
+        bench_record(pResult, fSuccess, tmOp);
+    }
+    pResult->qwTotalNs = bench_now_ns() - tmStart;
+}
+
+/**
+ * Run the mixed read/write workload - single register reads and writes to
+ * random registers, every read is verified against the last value written.
+ * @param hLC           LeechCore handle
+ * @param cIter         Number of operations
+ * @param pdwModel      Expected register values (updated on write)
+ * @param pResultRead   Result for reads
+ * @param pResultWrite  Result for writes
+ */
+static void bench_run_mixed(HANDLE hLC, DWORD cIter, DWORD* pdwModel, PBENCH_RESULT pResultRead, PBENCH_RESULT pResultWrite) {
+    DWORD i, dwValue;
+    uint32_t rnd = 0x2545F491;
+    uint64_t tmStart, tmOp;
+    bool fSuccess;
+    tmStart = bench_now_ns();
+    for (i = 0; i < cIter; i++) {
+        BYTE regNum = (BYTE)(bench_rand(&rnd) % BENCH_REG_COUNT);
+        if ((bench_rand(&rnd) % 100) < BENCH_MIXED_READ_PCT) {
+            tmOp = bench_now_ns();
+            fSuccess = bench_read_single(hLC, regNum, &dwValue);
+            tmOp = bench_now_ns() - tmOp;
+            if (fSuccess && (dwValue != pdwModel[regNum])) pResultRead->cMismatch++;
+            bench_record(pResultRead, fSuccess, tmOp);
+        } else {
+            dwValue = bench_rand(&rnd);
+            tmOp = bench_now_ns();
+            fSuccess = bench_write_single(hLC, regNum, dwValue);
+            tmOp = bench_now_ns() - tmOp;
+            if (fSuccess) pdwModel[regNum] = dwValue;
+            bench_record(pResultWrite, fSuccess, tmOp);
+        }
+    }
+    // mixed wall time is shared by both operation types
+    pResultRead->qwTotalNs = pResultWrite->qwTotalNs = bench_now_ns() - tmStart;
+}
+
+// ============================================================================
+// Report
+// ============================================================================
+
+static void bench_report_json(FILE* f, const char* szDevice, DWORD cIter, PBENCH_RESULT pResults) {
+    DWORD op, cOpMixed;
+    PBENCH_RESULT r;
+    double sec, opsPerSec;
+    cOpMixed = pResults[BENCH_OP_MIXED_READ].cOp + pResults[BENCH_OP_MIXED_WRITE].cOp;
+    fprintf(f, "{\n");
+    fprintf(f, "  \"device\": \"%s\",\n", szDevice);
+    fprintf(f, "  \"iterations\": %u,\n", cIter);
+    fprintf(f, "  \"registers\": %u,\n", BENCH_REG_COUNT);
+    fprintf(f, "  \"results\": [\n");
+    for (op = 0; op < BENCH_OP_MAX; op++) {
+        r = &pResults[op];
+        qsort(r->pqwLatencyNs, r->cOp, sizeof(uint64_t), bench_cmp_u64);
+        sec = r->qwTotalNs / 1e9;
+        opsPerSec = sec ? (r->cOp / sec) : 0.0;
+        if ((op == BENCH_OP_MIXED_READ) || (op == BENCH_OP_MIXED_WRITE)) {
+            // share of the mixed workload wall time attributed to this operation type
+            opsPerSec = (sec && cOpMixed) ? (cOpMixed / sec) * ((double)r->cOp / cOpMixed) : 0.0;
+        }
+        fprintf(f, "    {\n");
+        fprintf(f, "      \"op\": \"%s\",\n", g_szBenchOp[op]);
+        fprintf(f, "      \"count\": %u,\n", r->cOp);
+        fprintf(f, "      \"errors\": %u,\n", r->cError);
+        fprintf(f, "      \"mismatches\": %u,\n", r->cMismatch);
+        fprintf(f, "      \"ops_per_sec\": %.1f,\n", opsPerSec);
+        fprintf(f, "      \"regs_per_sec\": %.1f,\n", opsPerSec * g_cBenchOpRegs[op]);
+        fprintf(f, "      \"p50_us\": %.3f,\n", bench_percentile(r->pqwLatencyNs, r->cOp, 0.50) / 1e3);
+        fprintf(f, "      \"p99_us\": %.3f,\n", bench_percentile(r->pqwLatencyNs, r->cOp, 0.99) / 1e3);
+        fprintf(f, "      \"p999_us\": %.3f,\n", bench_percentile(r->pqwLatencyNs, r->cOp, 0.999) / 1e3);
+        fprintf(f, "      \"max_us\": %.3f\n", (r->cOp ? r->pqwLatencyNs[r->cOp - 1] : 0) / 1e3);
+        fprintf(f, "    }%s\n", (op + 1 < BENCH_OP_MAX) ? "," : "");
+    }
+    fprintf(f, "  ]\n");
+    fprintf(f, "}\n");
+}
+
+// ============================================================================
+// Main program
+// ============================================================================
+
+static void bench_usage(void) {
+    fprintf(stderr,
+        "Usage: bench [-device <device>] [-n <iterations>] [-warmup <iterations>] [-o <file.json>] [-shadow]\n"
+        "  -device  LeechCore device string (default: " BENCH_DEFAULT_DEVICE ")\n"
+        "  -n       operations per workload (default: %u)\n"
+        "  -warmup  untimed operations before the workloads (default: %u)\n"
+        "  -o       write the JSON report to file instead of stdout\n"
+        "  -shadow  keep the default shadow register policies (reads may be served from cache)\n",
+        BENCH_DEFAULT_ITER, BENCH_DEFAULT_WARMUP);
+}
+
+int main(int argc, char* argv[]) {
+    HANDLE hLC = NULL;
+    LC_CONFIG cfg = { 0 };
+    BENCH_RESULT results[BENCH_OP_MAX] = { 0 };
+    DWORD i, op, cIter = BENCH_DEFAULT_ITER, cWarmup = BENCH_DEFAULT_WARMUP, dwValue, cFail = 0;
+    DWORD dwModel[BENCH_REG_COUNT] = { 0 };
+    const char* szDevice = BENCH_DEFAULT_DEVICE;
+    const char* szOutput = NULL;
+    bool fShadow = false;
+    FILE* f = stdout;
+    int exit_code = 1;
+
+    for (i = 1; i < (DWORD)argc; i++) {
+        if (!strcmp(argv[i], "-device") && (i + 1 < (DWORD)argc)) {
+            szDevice = argv[++i];
+        } else if (!strcmp(argv[i], "-n") && (i + 1 < (DWORD)argc)) {
+            cIter = (DWORD)strtoul(argv[++i], NULL, 0);
+        } else if (!strcmp(argv[i], "-warmup") && (i + 1 < (DWORD)argc)) {
+            cWarmup = (DWORD)strtoul(argv[++i], NULL, 0);
+        } else if (!strcmp(argv[i], "-o") && (i + 1 < (DWORD)argc)) {
+            szOutput = argv[++i];
+        } else if (!strcmp(argv[i], "-shadow")) {
+            fShadow = true;
+        } else {
+            bench_usage();
+            return 1;
+        }
+    }
+    if (!cIter) {
+        bench_usage();
+        return 1;
+    }
+
+    // Connect
+    cfg.dwVersion = LC_CONFIG_VERSION;
+    strncpy(cfg.szDevice, szDevice, sizeof(cfg.szDevice) - 1);
+    fprintf(stderr, "[INFO] Connecting to '%s' ...\n", szDevice);
+    hLC = LcCreate(&cfg);
+    if (!hLC) {
+        fprintf(stderr, "[FAIL] Unable to connect to '%s'\n", szDevice);
+        return 1;
+    }
+
+    // Measure the register path - not the host side shadow cache
+    for (i = 0; !fShadow && (i < BENCH_REG_COUNT); i++) {
+        LcCommand(hLC, LC_CMD_FPGA_CUSTOM_SHADOW_POLICY_SET(i, FPGA_CUSTOM_REG_POLICY_VOLATILE), 0, NULL, NULL, NULL);
+    }
+
+    // Initialize registers to a known state and warm up
+    for (i = 0; i < BENCH_REG_COUNT; i++) {
+        if (!bench_write_single(hLC, (BYTE)i, 0)) {
+            fprintf(stderr, "[FAIL] Unable to initialize register %u\n", i);
+            goto cleanup;
+        }
+    }
+    for (i = 0; i < cWarmup; i++) {
+        bench_read_single(hLC, (BYTE)(i % BENCH_REG_COUNT), &dwValue);
+    }
+
+    for (op = 0; op < BENCH_OP_MAX; op++) {
+        if (!(results[op].pqwLatencyNs = calloc(cIter, sizeof(uint64_t)))) {
+            fprintf(stderr, "[FAIL] Out of memory\n");
+            goto cleanup;
+        }
+    }
+
+    // Run workloads
+    for (op = BENCH_OP_READ_SINGLE; op <= BENCH_OP_WRITE_VECTOR; op++) {
+        fprintf(stderr, "[INFO] Running %s x %u ...\n", g_szBenchOp[op], cIter);
+        bench_run_simple(hLC, (BENCH_OP)op, cIter, dwModel, &results[op]);
+    }
+    fprintf(stderr, "[INFO] Running mixed (%u%% read) x %u ...\n", BENCH_MIXED_READ_PCT, cIter);
+    bench_run_mixed(hLC, cIter, dwModel, &results[BENCH_OP_MIXED_READ], &results[BENCH_OP_MIXED_WRITE]);
+
+    // Report
+    if (szOutput && !(f = fopen(szOutput, "w"))) {
+        fprintf(stderr, "[FAIL] Unable to open '%s'\n", szOutput);
+        goto cleanup;
+    }
+    bench_report_json(f, szDevice, cIter, results);
+    if (f != stdout) fclose(f);
+    for (op = 0; op < BENCH_OP_MAX; op++) {
+        cFail += results[op].cError + results[op].cMismatch;
+    }
+    if (cFail) {
+        fprintf(stderr, "[FAIL] %u operations failed or returned unexpected values\n", cFail);
+    } else {
+        fprintf(stderr, "[PASS] All operations completed\n");
+        exit_code = 0;
+    }
+
+cleanup:
+    for (op = 0; op < BENCH_OP_MAX; op++) {
+        free(results[op].pqwLatencyNs);
+    }
+    LcClose(hLC);
+    return exit_code;
+}
@@ -0,0 +1,455 @@
+/**
+ * PCILeech FPGA RX Stream Parser Benchmark
+ *
+ * Function: Compare the LeechCore async2 rx stream parser (fpga_rxparse.c,
+ * every implementation supported by the CPU) with the previous per-TLP
+ * parser (reproduced below as "legacy") on the same FT601 rx stream.
+ *
+ * The stream is either recorded from a device with the FPGA device parameter
+ * rxrecord ("fpga://rxrecord=/tmp/rx.bin") or synthesized: completions of
+ * 128-byte payload with interleaved command replies, partially filled blocks
+ * and ftdi workaround fillers.
+ *
+ * The stream is fed to each parser in read-sized chunks through a receive
+ * buffer in the same way as the device. Completion payloads are delivered to
+ * destination buffers (as into MEM_SCATTER buffers by the device): copied from
+ * the assembled TLP, or with "placed" written directly by the parser while
+ * parsing. For each parser the throughput
+ * (MB/s of stream, ns per TLP) is reported as JSON together with the number
+ * of TLPs/replies and a hash of all TLPs. The exit code is non-zero if any
+ * parser disagrees with the legacy parser.
+ *
+ * Usage: rxparse_bench [-f <recorded.bin>] [-mb <synthetic MB>] [-chunk <bytes>] [-n <rounds>] [-o <file.json>]
+ *
+ * Build: Linux - make rxparse_bench (compiles fpga_rxparse.c from LeechCore)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include "fpga_rxparse.h"
+
+#define BENCH_DEFAULT_MB        64
+#define BENCH_DEFAULT_CHUNK     0x00100000  // ASYNC_MAX_READSIZE
+#define BENCH_DEFAULT_ROUNDS    5
+#define BENCH_RXBUF_MAX         0x01000000
+#define LEGACY_TLP_RX_MAX_SIZE  (16+1024)
+#define BENCH_MEM_SLOTS         0x400       // destination buffers (one per TLP payload, reused)
+
+typedef struct tdBENCH_SINK {
+    uint64_t cTlp;
+    uint64_t cReply;
+    uint64_t qwHash;            // Fletcher style checksum over all TLPs (length + data)
+} BENCH_SINK, *PBENCH_SINK;
+
+typedef struct tdBENCH_RESULT {
+    const char* szName;
+    BENCH_SINK Sink;
+    uint64_t qwBestNs;          // fastest round
+    bool fMatch;                // TLPs/replies identical to the legacy parser
+} BENCH_RESULT, *PBENCH_RESULT;
+
+// ============================================================================
+// Helper functions
+// ============================================================================
+
+static uint64_t bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static uint32_t bench_rand(uint32_t* pState) {
+    uint32_t x = *pState;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *pState = x;
+}
+
+static BYTE* g_pbBenchMem;
+static DWORD g_iBenchMem;
+
+static BYTE* bench_mem_next(void) {
+    return g_pbBenchMem + (g_iBenchMem++ % BENCH_MEM_SLOTS) * LEGACY_TLP_RX_MAX_SIZE;
+}
+
+/**
+ * Consume a TLP with its header (3 DWORDs) and payload delivered to pdwPayload.
+ */
+static void bench_sink_tlp_placed(PBENCH_SINK pSink, const DWORD* pdwHdr, const DWORD* pdwPayload, DWORD cdwTlp) {
+    uint64_t s1 = cdwTlp, s2 = pSink->qwHash;
+    DWORD i;
+    for (i = 0; i < 3; i++) {
+        s1 += pdwHdr[i];
+        s2 += s1;
+    }
+    for (i = 0; i < cdwTlp - 3; i++) {
+        s1 += pdwPayload[i];
+        s2 += s1;
+    }
+    pSink->qwHash = (s2 ^ (s1 << 32)) * 0x100000001b3ULL;
+    pSink->cTlp++;
+}
+
+/**
+ * Consume an assembled TLP - the payload is copied to a destination buffer.
+ */
+static void bench_sink_tlp(PBENCH_SINK pSink, const DWORD* pdwTlp, DWORD cdwTlp) {
+    BYTE* pbMem = bench_mem_next();
+    memcpy(pbMem, pdwTlp + 3, (cdwTlp - 3) * sizeof(DWORD));
+    bench_sink_tlp_placed(pSink, pdwTlp, (const DWORD*)pbMem, cdwTlp);
+}
+
+// ============================================================================
+// Stream generation / loading
+// ============================================================================
+
+typedef struct tdBENCH_STREAM_GEN {
+    DWORD* pdw;
+    DWORD cdw;
+    DWORD cdwMax;
+    DWORD dwStatus;             // status of block being built
+    DWORD iSlot;                // next slot in block being built (0-7)
+} BENCH_STREAM_GEN, *PBENCH_STREAM_GEN;
+
+static void bench_gen_flush(PBENCH_STREAM_GEN g) {
+    while (g->iSlot && (g->iSlot < 7)) {
+        g->dwStatus |= 0x0f << (g->iSlot * 4);
+        g->pdw[g->cdw + 1 + g->iSlot] = 0xffffffff;
+        g->iSlot++;
+    }
+    if (g->iSlot) {
+        g->pdw[g->cdw] = g->dwStatus;
+        g->cdw += 8;
+        g->iSlot = 0;
+    }
+}
+
+static void bench_gen_word(PBENCH_STREAM_GEN g, BYTE bSrc, DWORD dw) {
+    if (!g->iSlot) {
+        g->dwStatus = 0xe0000000;
+    }
+    g->dwStatus |= (DWORD)bSrc << (g->iSlot * 4);
+    g->pdw[g->cdw + 1 + g->iSlot] = dw;
+    if (++g->iSlot == 7) {
+        g->pdw[g->cdw] = g->dwStatus;
+        g->cdw += 8;
+        g->iSlot = 0;
+    }
+}
+
+/**
+ * Synthesize a stream of ~cbTarget bytes dominated by 128-byte completions.
+ */
+static DWORD* bench_stream_synthesize(DWORD cbTarget, DWORD* pcdw) {
+    BENCH_STREAM_GEN g = { 0 };
+    uint32_t rnd = 0x1337c0de;
+    DWORD i, cdwTlp, r;
+    g.cdwMax = cbTarget / 4 + 0x1000;
+    if (!(g.pdw = malloc(g.cdwMax * sizeof(DWORD)))) return NULL;
+    while (g.cdw + 0x400 < cbTarget / 4) {
+        r = bench_rand(&rnd) % 100;
+        // TLP: 128-byte CplD (most), Cpl without data, or tiny CplD
+        cdwTlp = (r < 85) ? 3 + 32 : ((r < 90) ? 3 : 3 + 1 + (bench_rand(&rnd) % 8));
+        for (i = 0; i < cdwTlp; i++) {
+            bench_gen_word(&g, (i == cdwTlp - 1) ? 0x04 : 0x00, bench_rand(&rnd));
+        }
+        r = bench_rand(&rnd) % 1000;
+        if (r < 10) {
+            // interleaved command reply (burst header + data)
+            bench_gen_word(&g, 0x03, 0xfffd0004);
+            for (i = 0; i < 4; i++) {
+                bench_gen_word(&g, 0x07, bench_rand(&rnd));
+            }
+        } else if (r < 15) {
+            // FPGA tx timeout -> partially filled block
+            bench_gen_flush(&g);
+        } else if (r < 17) {
+            // ftdi workaround fillers between blocks
+            bench_gen_flush(&g);
+            for (i = 1 + (bench_rand(&rnd) % 4); i; i--) {
+                g.pdw[g.cdw++] = 0x55556666;
+            }
+        }
+    }
+    bench_gen_flush(&g);
+    *pcdw = g.cdw;
+    return g.pdw;
+}
+
+static DWORD* bench_stream_load(const char* szFile, DWORD* pcdw) {
+    FILE* f;
+    long cb;
+    DWORD* pdw = NULL;
+    if (!(f = fopen(szFile, "rb"))) return NULL;
+    fseek(f, 0, SEEK_END);
+    cb = ftell(f) & ~3;
+    fseek(f, 0, SEEK_SET);
+    if ((cb > 0) && (pdw = malloc(cb)) && (fread(pdw, 1, cb, f) == (size_t)cb)) {
+        *pcdw = (DWORD)(cb / 4);
+    } else {
+        free(pdw);
+        pdw = NULL;
+    }
+    fclose(f);
+    return pdw;
+}
+
+// ============================================================================
+// Legacy parser (DeviceFPGA_Async2_Read_RxTlpSingle before fpga_rxparse.c)
+// ============================================================================
+
+static void legacy_rxcmd(PBENCH_SINK pSink, DWORD* pdwData) {
+    DWORD j;
+    BYTE bSrc;
+    for (j = 0; j < 7; j++) {
+        bSrc = (pdwData[0] >> (j << 2)) & 0x0f;
+        if ((bSrc == 0x01) || (bSrc == 0x03) || (bSrc == 0x07)) {
+            pSink->cReply++;
+            pdwData[0] |= 0x0f << (j << 2);
+        }
+    }
+}
+
+static DWORD legacy_rxtlpsingle(PBENCH_SINK pSink, DWORD cdwData, DWORD* pdwData) {
+    BYTE pbTlp[LEGACY_TLP_RX_MAX_SIZE];
+    DWORD* pdwTlp = (DWORD*)pbTlp;
+    DWORD i = 0, j, dwStatus, cdwTlp = 0, iStartWord;
+    while ((i < cdwData) && ((pdwData[i] & 0xf0000000) != 0xe0000000)) {
+        i++;
+    }
+    if (i) { return i; }
+    legacy_rxcmd(pSink, pdwData);
+    dwStatus = pdwData[0];
+    if (((dwStatus | dwStatus >> 1) & 0x01111111) == 0x01111111) {
+        return 8;
+    }
+    while (i <= cdwData - 8) {
+        iStartWord = i;
+        dwStatus = pdwData[i++];
+        if ((dwStatus & 0xf0000000) != 0xe0000000) {
+            continue;
+        }
+        if (iStartWord) {
+            legacy_rxcmd(pSink, pdwData + iStartWord);
+            dwStatus = pdwData[iStartWord];
+        }
+        for (j = 0; j < 7; j++, i++) {
+            if ((dwStatus & 0x03) == 0x00) {
+                if (cdwTlp >= LEGACY_TLP_RX_MAX_SIZE / sizeof(DWORD)) {
+                    pdwData[iStartWord] = pdwData[iStartWord] | (0xffffffff >> (28 - (j << 2)));
+                    return iStartWord | 0x80000000;
+                }
+                pdwTlp[cdwTlp++] = pdwData[i];
+            }
+            if ((dwStatus & 0x07) == 0x04) {
+                if ((cdwTlp >= 3) && (cdwTlp <= LEGACY_TLP_RX_MAX_SIZE / sizeof(DWORD))) {
+                    bench_sink_tlp(pSink, pdwTlp, cdwTlp);
+                }
+                pdwData[iStartWord] = pdwData[iStartWord] | (0xffffffff >> (28 - (j << 2)));
+                return iStartWord | 0x80000000;
+            }
+            dwStatus >>= 4;
+        }
+    }
+    return 0;
+}
+
+// ============================================================================
+// Benchmark runners - emulate the rxbuf handling of device_fpga.c
+// ============================================================================
+
+typedef struct tdBENCH_RXBUF {
+    BYTE* pb;
+    DWORD o;
+    DWORD cb;
+} BENCH_RXBUF, *PBENCH_RXBUF;
+
+static void bench_rxbuf_append(PBENCH_RXBUF pRx, const BYTE* pbStream, DWORD cbStream, DWORD* poStream, DWORD cbChunk) {
+    DWORD cb = cbStream - *poStream;
+    if (cb > cbChunk) cb = cbChunk;
+    if (pRx->cb + cbChunk > BENCH_RXBUF_MAX) {
+        memmove(pRx->pb, pRx->pb + pRx->o, pRx->cb - pRx->o);
+        pRx->cb -= pRx->o;
+        pRx->o = 0;
+    }
+    memcpy(pRx->pb + pRx->cb, pbStream + *poStream, cb);
+    pRx->cb += cb;
+    *poStream += cb;
+}
+
+static uint64_t bench_run_legacy(const DWORD* pdwStream, DWORD cdwStream, DWORD cbChunk, PBENCH_RXBUF pRx, PBENCH_SINK pSink) {
+    DWORD oStream = 0, cdw;
+    uint64_t tmStart = bench_now_ns();
+    memset(pSink, 0, sizeof(BENCH_SINK));
+    pRx->o = pRx->cb = 0;
+    while (oStream < cdwStream * 4) {
+        bench_rxbuf_append(pRx, (const BYTE*)pdwStream, cdwStream * 4, &oStream, cbChunk);
+        cdw = 1;
+        while ((pRx->o + 32 <= pRx->cb) && cdw) {
+            cdw = legacy_rxtlpsingle(pSink, (pRx->cb - pRx->o) >> 2, (DWORD*)(pRx->pb + pRx->o));
+            pRx->o += cdw << 2;
+        }
+    }
+    return bench_now_ns() - tmStart;
+}
+
+static void bench_reply_cb(PVOID ctxReplyCB, BYTE bSrc, DWORD dwData) {
+    ((PBENCH_SINK)ctxReplyCB)->cReply++;
+}
+
+static BOOL bench_place_cb(PVOID ctxPlaceCB, PDWORD pdwHdr, PBYTE* ppb, PDWORD pcb) {
+    *ppb = bench_mem_next();
+    *pcb = LEGACY_TLP_RX_MAX_SIZE;
+    return TRUE;
+}
+
+static uint64_t bench_run_rxparse(const DWORD* pdwStream, DWORD cdwStream, DWORD cbChunk, PBENCH_RXBUF pRx, PFPGA_RXPARSE_CONTEXT pParse, DWORD dwIsa, bool fPlace, PBENCH_SINK pSink) {
+    DWORD oStream = 0, cdw, i;
+    PFPGA_RXPARSE_TLP pTlp;
+    uint64_t tmStart;
+    FpgaRxParse_Initialize(pParse, dwIsa);
+    memset(pSink, 0, sizeof(BENCH_SINK));
+    pRx->o = pRx->cb = 0;
+    tmStart = bench_now_ns();
+    while (oStream < cdwStream * 4) {
+        bench_rxbuf_append(pRx, (const BYTE*)pdwStream, cdwStream * 4, &oStream, cbChunk);
+        while ((cdw = FpgaRxParse_Parse(pParse, (pRx->cb - pRx->o) >> 2, (PDWORD)(pRx->pb + pRx->o), bench_reply_cb, pSink, fPlace ? bench_place_cb : NULL, NULL))) {
+            pRx->o += cdw << 2;
+            for (i = 0; i < pParse->cTlpBatch; i++) {
+                pTlp = pParse->Tlp + i;
+                if (pTlp->pbPlaced) {
+                    bench_sink_tlp_placed(pSink, pParse->dwArena + pTlp->o, (const DWORD*)pTlp->pbPlaced, pTlp->cdw);
+                } else {
+                    bench_sink_tlp(pSink, pParse->dwArena + pTlp->o, pTlp->cdw);
+                }
+            }
+        }
+        // as the device - placement does not outlive a receive buffer update:
+        FpgaRxParse_Unplace(pParse);
+    }
+    return bench_now_ns() - tmStart;
+}
+
+// ============================================================================
+// Main program
+// ============================================================================
+
+static void bench_usage(void) {
+    fprintf(stderr,
+        "Usage: rxparse_bench [-f <recorded.bin>] [-mb <synthetic MB>] [-chunk <bytes>] [-n <rounds>] [-o <file.json>]\n"
+        "  -f      recorded rx stream (fpga://rxrecord=<file>) instead of a synthetic stream\n"
+        "  -mb     size of the synthetic stream (default: %u)\n"
+        "  -chunk  bytes appended to the receive buffer per read (default: 0x%x)\n"
+        "  -n      rounds per parser, the fastest round is reported (default: %u)\n"
+        "  -o      write the JSON report to file instead of stdout\n",
+        BENCH_DEFAULT_MB, BENCH_DEFAULT_CHUNK, BENCH_DEFAULT_ROUNDS);
+}
+
+int main(int argc, char* argv[]) {
+    static const char* szIsa[] = { "rxparse_scalar", "rxparse_ssse3", "rxparse_avx2" };
+    static const char* szIsaPlaced[] = { "rxparse_scalar_placed", "rxparse_ssse3_placed", "rxparse_avx2_placed" };
+    const char* szFile = NULL;
+    const char* szOut = NULL;
+    DWORD i, r, cdwStream = 0, cbMB = BENCH_DEFAULT_MB, cbChunk = BENCH_DEFAULT_CHUNK, cRounds = BENCH_DEFAULT_ROUNDS;
+    DWORD cResult = 0, dwIsaMax;
+    DWORD* pdwStream = NULL;
+    BENCH_RXBUF Rx = { 0 };
+    BENCH_RESULT Results[5] = { 0 };
+    BENCH_SINK Sink;
+    PFPGA_RXPARSE_CONTEXT pParse = NULL;
+    uint64_t qwNs;
+    bool fFail = false;
+    FILE* fOut = stdout;
+    for (i = 1; i < (DWORD)argc; i++) {
+        if (!strcmp(argv[i], "-f") && (i + 1 < (DWORD)argc)) {
+            szFile = argv[++i];
+        } else if (!strcmp(argv[i], "-mb") && (i + 1 < (DWORD)argc)) {
+            cbMB = strtoul(argv[++i], NULL, 0);
+        } else if (!strcmp(argv[i], "-chunk") && (i + 1 < (DWORD)argc)) {
+            cbChunk = strtoul(argv[++i], NULL, 0) & ~3;
+        } else if (!strcmp(argv[i], "-n") && (i + 1 < (DWORD)argc)) {
+            cRounds = strtoul(argv[++i], NULL, 0);
+        } else if (!strcmp(argv[i], "-o") && (i + 1 < (DWORD)argc)) {
+            szOut = argv[++i];
+        } else {
+            bench_usage();
+            return 1;
+        }
+    }
+    if (!cbMB || (cbMB > 1024) || (cbChunk < 32) || (cbChunk > BENCH_RXBUF_MAX / 2) || !cRounds) {
+        bench_usage();
+        return 1;
+    }
+    pdwStream = szFile ? bench_stream_load(szFile, &cdwStream) : bench_stream_synthesize(cbMB << 20, &cdwStream);
+    Rx.pb = malloc(BENCH_RXBUF_MAX);
+    pParse = malloc(sizeof(FPGA_RXPARSE_CONTEXT));
+    g_pbBenchMem = malloc(BENCH_MEM_SLOTS * LEGACY_TLP_RX_MAX_SIZE);
+    if (!pdwStream || !Rx.pb || !pParse || !g_pbBenchMem) {
+        fprintf(stderr, "[FAIL] Unable to %s stream\n", szFile ? "load" : "allocate");
+        return 1;
+    }
+    FpgaRxParse_Initialize(pParse, FPGA_RXPARSE_ISA_AVX2);
+    dwIsaMax = pParse->dwIsa;
+    fprintf(stderr, "[INFO] Stream: %s (%u bytes), chunk 0x%x, %u rounds\n", szFile ? szFile : "synthetic", cdwStream * 4, cbChunk, cRounds);
+    // legacy parser (reference):
+    Results[cResult].szName = "legacy";
+    for (r = 0; r < cRounds; r++) {
+        qwNs = bench_run_legacy(pdwStream, cdwStream, cbChunk, &Rx, &Results[cResult].Sink);
+        if (!r || (qwNs < Results[cResult].qwBestNs)) Results[cResult].qwBestNs = qwNs;
+    }
+    Results[cResult++].fMatch = true;
+    // fpga_rxparse implementations (the fastest also with payload placement):
+    for (i = FPGA_RXPARSE_ISA_SCALAR; i <= dwIsaMax + 1; i++) {
+        Results[cResult].szName = (i <= dwIsaMax) ? szIsa[i] : szIsaPlaced[dwIsaMax];
+        Results[cResult].fMatch = true;
+        for (r = 0; r < cRounds; r++) {
+            qwNs = bench_run_rxparse(pdwStream, cdwStream, cbChunk, &Rx, pParse, min(i, dwIsaMax), (i > dwIsaMax), &Sink);
+            if (!r || (qwNs < Results[cResult].qwBestNs)) Results[cResult].qwBestNs = qwNs;
+            Results[cResult].fMatch = Results[cResult].fMatch && !memcmp(&Sink, &Results[0].Sink, sizeof(BENCH_SINK));
+        }
+        Results[cResult].Sink = Sink;
+        fFail = fFail || !Results[cResult].fMatch;
+        cResult++;
+    }
+    // report:
+    if (szOut && !(fOut = fopen(szOut, "w"))) {
+        fprintf(stderr, "[FAIL] Unable to open %s\n", szOut);
+        return 1;
+    }
+    fprintf(fOut, "{\n  \"stream\": \"%s\",\n  \"bytes\": %u,\n  \"chunk\": %u,\n  \"results\": [\n", szFile ? szFile : "synthetic", cdwStream * 4, cbChunk);
+    for (i = 0; i < cResult; i++) {
+        fprintf(fOut,
+            "    {\n"
+            "      \"parser\": \"%s\",\n"
+            "      \"tlps\": %llu,\n"
+            "      \"replies\": %llu,\n"
+            "      \"hash\": \"%016llx\",\n"
+            "      \"match\": %s,\n"
+            "      \"mb_per_sec\": %.1f,\n"
+            "      \"ns_per_tlp\": %.2f,\n"
+            "      \"speedup\": %.2f\n"
+            "    }%s\n",
+            Results[i].szName,
+            (unsigned long long)Results[i].Sink.cTlp,
+            (unsigned long long)Results[i].Sink.cReply,
+            (unsigned long long)Results[i].Sink.qwHash,
+            Results[i].fMatch ? "true" : "false",
+            (double)cdwStream * 4 * 1000.0 / (double)Results[i].qwBestNs,
+            Results[i].Sink.cTlp ? (double)Results[i].qwBestNs / (double)Results[i].Sink.cTlp : 0.0,
+            (double)Results[0].qwBestNs / (double)Results[i].qwBestNs,
+            (i + 1 < cResult) ? "," : "");
+    }
+    fprintf(fOut, "  ]\n}\n");
+    if (fOut != stdout) fclose(fOut);
+    fprintf(stderr, fFail ? "[FAIL] Parser results differ from the legacy parser\n" : "[PASS] All parsers agree\n");
+    free(g_pbBenchMem);
+    free(pParse);
+    free(Rx.pb);
+    free(pdwStream);
+    return fFail ? 1 : 0;
+}
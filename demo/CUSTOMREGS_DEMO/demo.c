@@ -24,6 +24,7 @@
 #endif
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <leechcore.h>
@@ -35,10 +36,38 @@
  // Custom command definitions (与 device_fpga.c 中的定义保持一致)
 #define LC_CMD_FPGA_CUSTOM_READ         0x0200000000000000
 #define LC_CMD_FPGA_CUSTOM_WRITE        0x0201000000000000
+#define LC_CMD_FPGA_CUSTOM_READ_BULK    0x0202000000000000
+#define LC_CMD_FPGA_CUSTOM_WRITE_VECTOR 0x0203000000000000
+#define LC_CMD_FPGA_CUSTOM_WRITE_VECTOR_BARRIER     0x01
+#define LC_CMD_FPGA_CUSTOM_SHADOW_INVALIDATE    0x0204000000000000
+#define LC_CMD_FPGA_CUSTOM_SHADOW_REFRESH       0x0205000000000000
+#define LC_CMD_FPGA_CUSTOM_SHADOW_POLICY        0x0206000000000000
+#define LC_CMD_FPGA_CUSTOM_WATCH                0x0207000000000000
+#define LC_CMD_FPGA_MAILBOX_READ                0x0208000000000000
+#define LC_CMD_FPGA_MAILBOX_WRITE               0x0209000000000000
+#define LC_CMD_FPGA_PERF_COUNTERS               0x020A000000000000
+#define LC_CMD_FPGA_PERF_COUNTERS_CLEAR         0x01
 
 // Macros for multi-register access
 #define LC_CMD_FPGA_CUSTOM_READ_REG(n)  (LC_CMD_FPGA_CUSTOM_READ | ((n) & 0xFF))
 #define LC_CMD_FPGA_CUSTOM_WRITE_REG(n) (LC_CMD_FPGA_CUSTOM_WRITE | ((n) & 0xFF))
+#define LC_CMD_FPGA_CUSTOM_READ_BULK_RANGE(start, count)  (LC_CMD_FPGA_CUSTOM_READ_BULK | ((start) & 0xFF) | (((count) & 0xFF) << 8))
+#define LC_CMD_FPGA_CUSTOM_SHADOW_POLICY_SET(n, policy)   (LC_CMD_FPGA_CUSTOM_SHADOW_POLICY | ((n) & 0xFF) | (((policy) & 0xFF) << 8))
+#define LC_CMD_FPGA_MAILBOX_READ_RANGE(o, cb)             (LC_CMD_FPGA_MAILBOX_READ | ((o) & 0xFFFF) | (((cb) & 0xFFFF) << 16))
+#define LC_CMD_FPGA_MAILBOX_WRITE_OFFSET(o)               (LC_CMD_FPGA_MAILBOX_WRITE | ((o) & 0xFFFF))
+#define FPGA_MAILBOX_SIZE               0x1000
+
+// Shadow register policies (must match device_fpga.c)
+#define FPGA_CUSTOM_REG_POLICY_VOLATILE     0x00
+#define FPGA_CUSTOM_REG_POLICY_WRITETHROUGH 0x01
+#define FPGA_CUSTOM_REG_POLICY_IMMUTABLE    0x02
+
+// 批量写入条目（与 device_fpga.c 中的 FPGA_CUSTOM_WRITE_ENTRY 保持一致）
+typedef struct tdFPGA_CUSTOM_WRITE_ENTRY {
+    DWORD dwReg;            // 寄存器编号
+    DWORD dwValue;          // 写入值
+    DWORD dwMask;           // 写入位掩码（0xFFFFFFFF = 整个寄存器）
+} FPGA_CUSTOM_WRITE_ENTRY, *PFPGA_CUSTOM_WRITE_ENTRY;
 
 // 寄存器映射常量
 #define REG_DNA_LOW     24  // DNA 值低 32 位（只读）
@@ -102,6 +131,41 @@ bool read_custom_register(HANDLE hLC, BYTE regNum, DWORD* pValue) {
 bool write_custom_register(HANDLE hLC, BYTE regNum, DWORD value) {
     return LcCommand(hLC, LC_CMD_FPGA_CUSTOM_WRITE_REG(regNum), sizeof(DWORD), (PBYTE)&value, NULL, NULL);
 }
+
+/**
+ * 批量写入多个自定义寄存器（一次 USB 传输）
+ * @param hLC       LeechCore 句柄
+ * @param pEntries  写入条目数组（寄存器、值、掩码）
+ * @param cEntries  条目数量
+ * @param barrier   为 true 时等待 FPGA 确认所有写入已完成
+ * @return          成功返回 true，失败返回 false
+ */
+bool write_custom_registers_vector(HANDLE hLC, FPGA_CUSTOM_WRITE_ENTRY* pEntries, DWORD cEntries, bool barrier) {
+    QWORD cmd = LC_CMD_FPGA_CUSTOM_WRITE_VECTOR | (barrier ? LC_CMD_FPGA_CUSTOM_WRITE_VECTOR_BARRIER : 0);
+    return LcCommand(hLC, cmd, cEntries * sizeof(FPGA_CUSTOM_WRITE_ENTRY), (PBYTE)pEntries, NULL, NULL);
+}
+
+/**
+ * 批量读取连续的自定义寄存器（一次 USB 往返）
+ * @param hLC       LeechCore 句柄
+ * @param regStart  起始寄存器编号
+ * @param cReg      寄存器数量
+ * @param pValues   输出寄存器值数组（cReg 个）
+ * @return          成功返回 true，失败返回 false
+ */
+bool read_custom_registers_bulk(HANDLE hLC, BYTE regStart, BYTE cReg, DWORD* pValues) {
+    PBYTE pbDataOut = NULL;
+    DWORD cbDataOut = 0;
+    BOOL result = LcCommand(hLC, LC_CMD_FPGA_CUSTOM_READ_BULK_RANGE(regStart, cReg), 0, NULL, &pbDataOut, &cbDataOut);
+
+    if (result && pbDataOut && cbDataOut == cReg * sizeof(DWORD)) {
+        memcpy(pValues, pbDataOut, cbDataOut);
+        LocalFree(pbDataOut);
+        return true;
+    }
+    if (pbDataOut) LocalFree(pbDataOut);
+    return false;
+}
 // ============================================================================
 // 步骤1: 连接 FPGA
 // ============================================================================
@@ -270,14 +334,18 @@ bool step4_multi_register_test(HANDLE hLC) {
     DWORD test_values[] = { 0xAAAAAAAA, 0x55555555, 0xDEADBEEF, 0xCAFEBABE };
     int test_count = sizeof(test_regs) / sizeof(test_regs[0]);
 
-    // 写入不同的值到各个寄存器
+    // 写入不同的值到各个寄存器（一次批量写入，带回读屏障）
     printf("[INFO] 向多个寄存器写入不同的值...\n");
+    FPGA_CUSTOM_WRITE_ENTRY entries[sizeof(test_regs) / sizeof(test_regs[0])];
     for (int i = 0; i < test_count; i++) {
         printf("       寄存器 %d <- 0x%08X\n", test_regs[i], test_values[i]);
-        if (!write_custom_register(hLC, test_regs[i], test_values[i])) {
-            printf("[FAIL] 写入寄存器 %d 失败\n", test_regs[i]);
-            return false;
-        }
+        entries[i].dwReg = test_regs[i];
+        entries[i].dwValue = test_values[i];
+        entries[i].dwMask = 0xFFFFFFFF;
+    }
+    if (!write_custom_registers_vector(hLC, entries, test_count, true)) {
+        printf("[FAIL] 批量写入寄存器失败\n");
+        return false;
     }
     printf("[PASS] 所有寄存器写入成功\n");
 
@@ -331,35 +399,35 @@ void step5_dna_register_access(HANDLE hLC) {
     print_section_header("步骤5: DNA 验证寄存器访问");
 
     DWORD value;
+    DWORD values[8];
 
-    // 读取 DNA 值寄存器
+    // 批量读取寄存器 24-31（一次 USB 往返）
     printf("[INFO] 读取 DNA 验证相关寄存器...\n");
 
-    if (read_custom_register(hLC, REG_DNA_LOW, &value)) {
-        printf("[INFO] 寄存器 24 (DNA 低32位) = 0x%08X\n", value);
+    if (!read_custom_registers_bulk(hLC, REG_DNA_LOW, 8, values)) {
+        printf("[ERROR] 批量读取寄存器 24-31 失败\n");
+        return;
     }
 
-    if (read_custom_register(hLC, REG_DNA_HIGH, &value)) {
-        printf("[INFO] 寄存器 25 (DNA 高25位) = 0x%08X\n", value);
-    }
+    value = values[REG_DNA_LOW - REG_DNA_LOW];
+    printf("[INFO] 寄存器 24 (DNA 低32位) = 0x%08X\n", value);
 
-    if (read_custom_register(hLC, REG_ENCRYPTED, &value)) {
-        printf("[INFO] 寄存器 26 (加密随机值) = 0x%08X\n", value);
-    }
+    value = values[REG_DNA_HIGH - REG_DNA_LOW];
+    printf("[INFO] 寄存器 25 (DNA 高25位) = 0x%08X\n", value);
 
-    if (read_custom_register(hLC, REG_VERIFY_STATUS, &value)) {
-        printf("[INFO] 寄存器 28 (验证状态)   = 0x%08X %s\n", value,
-            (value & 0x01) ? "(成功)" : "(未验证)");
-    }
+    value = values[REG_ENCRYPTED - REG_DNA_LOW];
+    printf("[INFO] 寄存器 26 (加密随机值) = 0x%08X\n", value);
 
-    if (read_custom_register(hLC, REG_TLP_CONTROL, &value)) {
-        printf("[INFO] 寄存器 29 (TLP控制)    = 0x%08X %s\n", value,
-            (value & 0x01) ? "(已启用)" : "(未启用)");
-    }
+    value = values[REG_VERIFY_STATUS - REG_DNA_LOW];
+    printf("[INFO] 寄存器 28 (验证状态)   = 0x%08X %s\n", value,
+        (value & 0x01) ? "(成功)" : "(未验证)");
 
-    if (read_custom_register(hLC, REG_SYSTEM_STATUS, &value)) {
-        printf("[INFO] 寄存器 31 (系统状态)   = 0x%08X\n", value);
-    }
+    value = values[REG_TLP_CONTROL - REG_DNA_LOW];
+    printf("[INFO] 寄存器 29 (TLP控制)    = 0x%08X %s\n", value,
+        (value & 0x01) ? "(已启用)" : "(未启用)");
+
+    value = values[REG_SYSTEM_STATUS - REG_DNA_LOW];
+    printf("[INFO] 寄存器 31 (系统状态)   = 0x%08X\n", value);
 
     printf("[INFO] DNA 验证寄存器访问演示完成\n");
 }
@@ -250,6 +250,10 @@ module pcileech_fifo #(
     // | 29       | RO   | TLP control status (0=disabled, 1=enabled)          |
     // | 30       | WO   | Control command (write 1 to start verification)     |
     // | 31       | RO   | System state (0=idle, 1=processing, 2=complete)     |
+    // | 32       | R/W  | Perf counter control / ID (write bit0=snapshot,     |
+    // |          |      | bit1=clear)                                         |
+    // | 33-47    | RO   | Perf counter snapshot (see PERFORMANCE COUNTERS)    |
+    // | 48-63    | RO   | Reserved (read as zero)                             |
     // -------------------------------------------------------------------------
     //
     // DNA Verification Workflow:
@@ -267,6 +271,42 @@ module pcileech_fifo #(
     // 32 custom 32-bit registers array
     reg [31:0]  custom_registers [0:31];
 
+    // Custom register burst read state (command 0xC3: start register, count)
+    reg         custom_burst_active;    // Burst response in progress
+    reg [5:0]   custom_burst_reg;       // Next register to send (32-63: perf counters)
+    reg [6:0]   custom_burst_remaining; // Registers left to send
+
+    // Host <-> FPGA mailbox: 4kB block RAM (custom commands with address bit 14 set)
+    //   write      (command 0x83): address[9:0] = dword index, {mask, value} = 32-bit data
+    //   burst read (command 0xC3): address[9:0] = start dword, value[10:0] = dword count
+    localparam  MAILBOX_DWORDS = 1024;
+    (* ram_style = "block" *)
+    reg [31:0]  mailbox_mem [0:MAILBOX_DWORDS-1];
+    reg [31:0]  mailbox_rd_data;        // Registered BRAM read port: mailbox_mem[mailbox_rd_addr] from previous cycle
+    reg         mailbox_burst_active;   // Mailbox burst response in progress
+    reg [9:0]   mailbox_burst_addr;     // Next dword to send
+    reg [10:0]  mailbox_burst_remaining;// Dwords left to send
+
+    // Performance counters: free-running live counters, read by the host as
+    // custom registers 33-47 from a snapshot taken atomically on a write of
+    // bit0 to register 32. Counters wrap at 32 bits.
+    localparam  PERF_ID = 32'h5046010f;         // 'PF', version 1, 15 counters
+    reg [63:0]  perf_tick;                      // cycles (100MHz) since last clear
+    reg [31:0]  perf_tlp_tx;                    // TLPs host -> PCIe
+    reg [31:0]  perf_tlp_tx_dw;                 // TLP dwords host -> PCIe
+    reg [31:0]  perf_tlp_tx_drop;               // TLPs host -> PCIe dropped (TLP control disabled)
+    reg [31:0]  perf_tlp_rx;                    // TLPs PCIe -> host (completions)
+    reg [31:0]  perf_tlp_rx_dw;                 // TLP dwords PCIe -> host
+    reg [31:0]  perf_tlp_rx_stall;              // cycles with PCIe rx TLP data waiting for the USB mux
+    reg [31:0]  perf_usb_rx_qw;                 // 64-bit words received from FT601
+    reg [31:0]  perf_usb_tx_dw;                 // 32-bit words sent to FT601
+    reg [31:0]  perf_usb_stall;                 // cycles FT601 not ready to accept data (USB backpressure)
+    reg [31:0]  perf_usb_stall_run;             // current run of USB backpressure cycles
+    reg [31:0]  perf_usb_stall_max;             // high-water mark: longest USB backpressure run
+    reg [31:0]  perf_cmd_rx;                    // commands processed
+    reg [31:0]  perf_cmd_tx_full;               // cycles command reply fifo almost full
+    reg [31:0]  perf_snap [1:15];               // snapshot read by host as registers 33-47
+
     // -------------------------------------------------------------------------
     // DNA Verification System State Variables
     // -------------------------------------------------------------------------
@@ -336,6 +376,8 @@ module pcileech_fifo #(
     task pcileech_fifo_ctl_initialvalues;               // task is non automatic
         begin
             _cmd_tx_wr_en  <= 1'b0;
+            custom_burst_active <= 1'b0;
+            mailbox_burst_active <= 1'b0;
                
             // MAGIC
             rw[15:0]    <= 16'hefcd;                    // +000: MAGIC
@@ -448,7 +490,8 @@ module pcileech_fifo #(
     wire [63:0] cmd_rx_dout;
     wire        cmd_rx_valid;
     wire        cmd_rx_rd_en_drp = rwi_drp_rd_en | rwi_drp_wr_en | rw[RWPOS_DRP_RD_EN] | rw[RWPOS_DRP_WR_EN];
-    wire        cmd_rx_rd_en = tickcount64[1] & ( ~rw[RWPOS_WAIT_COMPLETE] | ~cmd_rx_rd_en_drp);
+    wire        cmd_rx_burst_hold = custom_burst_active | mailbox_burst_active | (cmd_rx_valid & (cmd_rx_dout[15:12] == 4'b1100));   // no new commands while a burst response is streamed
+    wire        cmd_rx_rd_en = tickcount64[1] & ( ~rw[RWPOS_WAIT_COMPLETE] | ~cmd_rx_rd_en_drp) & ~cmd_rx_burst_hold;
     
     fifo_64_64_clk1_fifocmd i_fifo_cmd_rx(
         .clk            ( clk                       ),
@@ -476,9 +519,119 @@ module pcileech_fifo #(
     // CUSTOM REGISTER READ/WRITE COMMAND PARSER LOGIC
     // -------------------------------------------------------------------------
     wire [4:0]  custom_reg_num      = in_cmd_address_byte[5:1];    // Register number (0-31)
+    wire        custom_reg_perf     = in_cmd_address_byte[6];      // Perf counter register (32-63)
     wire        custom_reg_sel      = in_cmd_address_byte[0];      // Byte offset (0=low16, 1=high16)
-    wire        in_cmd_custom_read  = cmd_rx_valid & cmd_rx_dout[14] & ~cmd_rx_dout[13] & ~cmd_rx_dout[12] & ~f_shadowcfgspace;
+    wire        in_cmd_custom_read  = cmd_rx_valid & ~cmd_rx_dout[15] & cmd_rx_dout[14] & ~cmd_rx_dout[13] & ~cmd_rx_dout[12] & ~f_shadowcfgspace;
     wire        in_cmd_custom_write = cmd_rx_valid & cmd_rx_dout[15] & ~cmd_rx_dout[14] & ~cmd_rx_dout[13] & ~cmd_rx_dout[12] & ~f_shadowcfgspace;
+    // Burst read: address[5:0] = start register (0-63), value[6:0] = count (clamped to register 63)
+    wire        in_cmd_custom_burst = cmd_rx_valid & cmd_rx_dout[15] & cmd_rx_dout[14] & ~cmd_rx_dout[13] & ~cmd_rx_dout[12] & ~f_shadowcfgspace;
+    wire [5:0]  custom_burst_start  = in_cmd_address_byte[5:0];
+    wire [6:0]  custom_burst_limit  = 7'd64 - {1'b0, custom_burst_start};
+    wire [6:0]  custom_burst_count  = (in_cmd_value[6:0] > custom_burst_limit) ? custom_burst_limit : in_cmd_value[6:0];
+
+    // Register read multiplexer: 0-31 custom registers, 32 perf ID, 33-47 perf snapshot, 48-63 zero
+    function [31:0] custom_reg_rd;
+        input [5:0] n;
+        begin
+            if ( ~n[5] )
+                custom_reg_rd = custom_registers[n[4:0]];
+            else if ( n[4] )
+                custom_reg_rd = 32'h00000000;
+            else if ( n[3:0] == 4'h0 )
+                custom_reg_rd = PERF_ID;
+            else
+                custom_reg_rd = perf_snap[n[3:0]];
+        end
+    endfunction
+    wire [31:0] custom_reg_rd_data  = custom_reg_rd({custom_reg_perf, custom_reg_num});
+    // -------------------------------------------------------------------------
+    // MAILBOX COMMAND PARSER LOGIC (custom write/burst commands with address bit 14 set)
+    // -------------------------------------------------------------------------
+    wire        in_cmd_mailbox_write = cmd_rx_valid & cmd_rx_dout[15] & ~cmd_rx_dout[14] & ~cmd_rx_dout[13] & ~cmd_rx_dout[12] & f_shadowcfgspace;
+    wire        in_cmd_mailbox_burst = cmd_rx_valid & cmd_rx_dout[15] & cmd_rx_dout[14] & ~cmd_rx_dout[13] & ~cmd_rx_dout[12] & f_shadowcfgspace;
+    wire [9:0]  mailbox_cmd_addr    = in_cmd_address_byte[9:0];
+    wire [10:0] mailbox_burst_limit = MAILBOX_DWORDS - {1'b0, mailbox_cmd_addr};
+    wire [10:0] mailbox_burst_count = (in_cmd_value[10:0] > mailbox_burst_limit) ? mailbox_burst_limit : in_cmd_value[10:0];
+    // one data word per cycle: BRAM address runs one dword ahead of the word currently sent
+    wire        mailbox_burst_emit  = dna_match & mailbox_burst_active & ~_cmd_tx_almost_full & ~dshadow2fifo.tx_valid;
+    wire [9:0]  mailbox_rd_addr     = in_cmd_mailbox_burst ? mailbox_cmd_addr : (mailbox_burst_emit ? mailbox_burst_addr + 1'b1 : mailbox_burst_addr);
+
+    always @ ( posedge clk )
+        begin
+            if ( ~rst & dna_match & in_cmd_mailbox_write )
+                mailbox_mem[mailbox_cmd_addr] <= {in_cmd_mask, in_cmd_value};
+            mailbox_rd_data <= mailbox_mem[mailbox_rd_addr];
+        end
+
+    // -------------------------------------------------------------------------
+    // PERFORMANCE COUNTERS
+    // -------------------------------------------------------------------------
+    wire        perf_ctrl_wr        = dna_match & in_cmd_custom_write & custom_reg_perf & (custom_reg_num == 5'h00) & ~custom_reg_sel;
+    wire        perf_snapshot       = perf_ctrl_wr & in_cmd_mask[0] & in_cmd_value[0];
+    wire        perf_clear          = perf_ctrl_wr & in_cmd_mask[1] & in_cmd_value[1];
+    wire [3:0]  perf_rx_lane        = dtlp.rx_valid & {4{dtlp.rx_rd_en & tlp_control_enabled}};
+    wire [3:0]  perf_rx_lane_last   = perf_rx_lane & dtlp.rx_last;
+    wire [2:0]  perf_rx_dw          = {2'b00, perf_rx_lane[0]} + perf_rx_lane[1] + perf_rx_lane[2] + perf_rx_lane[3];
+    wire [2:0]  perf_rx_tlp         = {2'b00, perf_rx_lane_last[0]} + perf_rx_lane_last[1] + perf_rx_lane_last[2] + perf_rx_lane_last[3];
+    wire        perf_tx_drop        = dcom.com_dout_valid & `CHECK_MAGIC & `CHECK_TYPE_TLP & ~tlp_control_enabled & dcom.com_dout[10];
+    wire        perf_rx_stall       = (|dtlp.rx_valid) & ~dtlp.rx_rd_en;
+    wire        perf_usb_busy       = ~dcom.com_din_ready;
+
+    always @ ( posedge clk )
+        begin
+            if ( perf_snapshot )
+                begin
+                    perf_snap[1]  <= perf_tick[31:0];
+                    perf_snap[2]  <= perf_tick[63:32];
+                    perf_snap[3]  <= perf_tlp_tx;
+                    perf_snap[4]  <= perf_tlp_tx_dw;
+                    perf_snap[5]  <= perf_tlp_tx_drop;
+                    perf_snap[6]  <= perf_tlp_rx;
+                    perf_snap[7]  <= perf_tlp_rx_dw;
+                    perf_snap[8]  <= perf_tlp_rx_stall;
+                    perf_snap[9]  <= perf_usb_rx_qw;
+                    perf_snap[10] <= perf_usb_tx_dw;
+                    perf_snap[11] <= perf_usb_stall;
+                    perf_snap[12] <= perf_usb_stall_max;
+                    perf_snap[13] <= perf_cmd_rx;
+                    perf_snap[14] <= perf_cmd_tx_full;
+                    perf_snap[15] <= 32'h00000000;
+                end
+            if ( rst | perf_clear )
+                begin
+                    perf_tick           <= 0;
+                    perf_tlp_tx         <= 0;
+                    perf_tlp_tx_dw      <= 0;
+                    perf_tlp_tx_drop    <= 0;
+                    perf_tlp_rx         <= 0;
+                    perf_tlp_rx_dw      <= 0;
+                    perf_tlp_rx_stall   <= 0;
+                    perf_usb_rx_qw      <= 0;
+                    perf_usb_tx_dw      <= 0;
+                    perf_usb_stall      <= 0;
+                    perf_usb_stall_run  <= 0;
+                    perf_usb_stall_max  <= 0;
+                    perf_cmd_rx         <= 0;
+                    perf_cmd_tx_full    <= 0;
+                end
+            else
+                begin
+                    perf_tick           <= perf_tick + 1;
+                    perf_tlp_tx         <= perf_tlp_tx + (dtlp.tx_valid & dtlp.tx_last);
+                    perf_tlp_tx_dw      <= perf_tlp_tx_dw + dtlp.tx_valid;
+                    perf_tlp_tx_drop    <= perf_tlp_tx_drop + perf_tx_drop;
+                    perf_tlp_rx         <= perf_tlp_rx + perf_rx_tlp;
+                    perf_tlp_rx_dw      <= perf_tlp_rx_dw + perf_rx_dw;
+                    perf_tlp_rx_stall   <= perf_tlp_rx_stall + perf_rx_stall;
+                    perf_usb_rx_qw      <= perf_usb_rx_qw + dcom.com_dout_valid;
+                    perf_usb_tx_dw      <= perf_usb_tx_dw + dcom.com_din_wr_en;
+                    perf_usb_stall      <= perf_usb_stall + perf_usb_busy;
+                    perf_usb_stall_run  <= perf_usb_busy ? perf_usb_stall_run + 1 : 0;
+                    perf_usb_stall_max  <= (perf_usb_stall_run > perf_usb_stall_max) ? perf_usb_stall_run : perf_usb_stall_max;
+                    perf_cmd_rx         <= perf_cmd_rx + cmd_rx_valid;
+                    perf_cmd_tx_full    <= perf_cmd_tx_full + _cmd_tx_almost_full;
+                end
+        end
 
     assign dshadow2fifo.rx_rden     = cmd_rx_valid & cmd_rx_dout[12] &  f_shadowcfgspace;
     assign dshadow2fifo.rx_wren     = cmd_rx_valid & cmd_rx_dout[13] &  f_shadowcfgspace & f_rw;
@@ -504,6 +657,7 @@ module pcileech_fifo #(
                 if ( dshadow2fifo.tx_valid )
                     begin
                         _cmd_tx_wr_en       <= 1'b1;
+                        _cmd_tx_din[33:32]  <= 2'b00;
                         _cmd_tx_din[31:16]  <= {4'b1100, dshadow2fifo.tx_addr, dshadow2fifo.tx_addr_lo, 1'b0};
                         _cmd_tx_din[15:0]   <= dshadow2fifo.tx_addr_lo ? dshadow2fifo.tx_data[15:0] : dshadow2fifo.tx_data[31:16];                        
                     end
@@ -511,6 +665,7 @@ module pcileech_fifo #(
                 else if ( in_cmd_read )
                     begin
                         _cmd_tx_wr_en       <= 1'b1;
+                        _cmd_tx_din[33:32]  <= 2'b00;
                         _cmd_tx_din[31:16]  <= in_cmd_address_byte;
                         _cmd_tx_din[15:0]   <= {in_cmd_data_in[7:0], in_cmd_data_in[15:8]};
                     end
@@ -523,15 +678,64 @@ module pcileech_fifo #(
                         _cmd_tx_din[33:32]  <= 2'b00;                  // Route as TLP
                         _cmd_tx_din[31:16]  <= in_cmd_address_byte;    // Echo address
                         case(custom_reg_sel) // Byte offset selection
-                            1'b0: _cmd_tx_din[15:0] <= {custom_registers[custom_reg_num][15:8], custom_registers[custom_reg_num][7:0]};     // Lower 16 bits
-                            1'b1: _cmd_tx_din[15:0] <= {custom_registers[custom_reg_num][31:24], custom_registers[custom_reg_num][23:16]};  // Upper 16 bits
+                            1'b0: _cmd_tx_din[15:0] <= custom_reg_rd_data[15:0];     // Lower 16 bits
+                            1'b1: _cmd_tx_din[15:0] <= custom_reg_rd_data[31:16];    // Upper 16 bits
                         endcase
                     end
+                // -----------------------------------------------------------------
+                // CUSTOM REGISTER BURST READ LOGIC
+                // -----------------------------------------------------------------
+                else if ( in_cmd_custom_burst )
+                    begin
+                        // Header: address 0xfffd, {start register, count}
+                        _cmd_tx_wr_en           <= 1'b1;
+                        _cmd_tx_din[33:32]      <= 2'b00;
+                        _cmd_tx_din[31:16]      <= 16'hfffd;
+                        _cmd_tx_din[15:0]       <= {2'b00, custom_burst_start, 1'b0, custom_burst_count};
+                        custom_burst_reg        <= custom_burst_start;
+                        custom_burst_remaining  <= custom_burst_count;
+                        custom_burst_active     <= (custom_burst_count != 7'h00);
+                    end
+                else if ( custom_burst_active & ~_cmd_tx_almost_full )
+                    begin
+                        // Data: one full 32-bit register value per response word (status nibble 0x7)
+                        _cmd_tx_wr_en           <= 1'b1;
+                        _cmd_tx_din[33:32]      <= 2'b01;
+                        _cmd_tx_din[31:0]       <= custom_reg_rd(custom_burst_reg);
+                        custom_burst_reg        <= custom_burst_reg + 1'b1;
+                        custom_burst_remaining  <= custom_burst_remaining - 1'b1;
+                        custom_burst_active     <= (custom_burst_remaining != 7'h01);
+                    end
+                // -----------------------------------------------------------------
+                // MAILBOX BURST READ LOGIC
+                // -----------------------------------------------------------------
+                else if ( in_cmd_mailbox_burst )
+                    begin
+                        // Header: address 0xfffc, dword count (zero count = write barrier)
+                        _cmd_tx_wr_en           <= 1'b1;
+                        _cmd_tx_din[33:32]      <= 2'b00;
+                        _cmd_tx_din[31:16]      <= 16'hfffc;
+                        _cmd_tx_din[15:0]       <= {5'b00000, mailbox_burst_count};
+                        mailbox_burst_addr      <= mailbox_cmd_addr;
+                        mailbox_burst_remaining <= mailbox_burst_count;
+                        mailbox_burst_active    <= (mailbox_burst_count != 11'h000);
+                    end
+                else if ( mailbox_burst_emit )
+                    begin
+                        // Data: one mailbox dword per response word (status nibble 0x7)
+                        _cmd_tx_wr_en           <= 1'b1;
+                        _cmd_tx_din[33:32]      <= 2'b01;
+                        _cmd_tx_din[31:0]       <= mailbox_rd_data;
+                        mailbox_burst_addr      <= mailbox_burst_addr + 1'b1;
+                        mailbox_burst_remaining <= mailbox_burst_remaining - 1'b1;
+                        mailbox_burst_active    <= (mailbox_burst_remaining != 11'h001);
+                    end
 
                 // SEND COUNT ACTION
                 else if ( ~_cmd_tx_almost_full & ~in_cmd_write & _cmd_send_count_enable )
                     begin
                         _cmd_tx_wr_en       <= 1'b1;
+                        _cmd_tx_din[33:32]  <= 2'b00;
                         _cmd_tx_din[31:16]  <= 16'hfffe;
                         _cmd_tx_din[15:0]   <= _cmd_send_count_dword;
                         rw[63:32]           <= _cmd_send_count_dword - 1;
@@ -540,6 +744,7 @@ module pcileech_fifo #(
                 else if ( ~_cmd_tx_almost_full & ~in_cmd_write & _cmd_timer_inactivity_enable & (_cmd_timer_inactivity_ticks + _cmd_timer_inactivity_base < tickcount64) )
                     begin
                         _cmd_tx_wr_en       <= 1'b1;
+                        _cmd_tx_din[33:32]  <= 2'b00;
                         _cmd_tx_din[31:16]  <= 16'hffff;
                         _cmd_tx_din[15:0]   <= 16'hcede;
                         rw[16]              <= 1'b0;
@@ -560,13 +765,12 @@ module pcileech_fifo #(
                 // -----------------------------------------------------------------
                 // CUSTOM REGISTER WRITE LOGIC
                 // -----------------------------------------------------------------
-                if ( in_cmd_custom_write )
-                    begin
-                        case(custom_reg_sel) // Byte offset selection
-                            1'b0: custom_registers[custom_reg_num][15:0] <= in_cmd_value;    // Write lower 16 bits
-                            1'b1: custom_registers[custom_reg_num][31:16] <= in_cmd_value;   // Write upper 16 bits
-                        endcase
-                    end
+                if ( in_cmd_custom_write & ~custom_reg_perf )
+                    for ( i_write = 0; i_write < 16; i_write = i_write + 1 )
+                        begin
+                            if ( in_cmd_mask[i_write] )                     // Masked write: only bits set in mask are updated
+                                custom_registers[custom_reg_num][{custom_reg_sel, 4'b0000} + i_write] <= in_cmd_value[i_write];
+                        end
                     
                 // -----------------------------------------------------------------
                 // DNA ENCRYPTION CODE AUTO-GENERATION LOGIC
@@ -15,6 +15,7 @@
 #include "leechcore_internal.h"
 #include "oscompatibility.h"
 #include "util.h"
+#include "fpga_rxparse.h"
 #include "ob/ob.h"
 
 // Debug control macro - set to 1 to enable debug, set to 0 to disable debug
@@ -36,13 +37,95 @@
 // 命令字节 = (命令码 << 4) | 0x03, 其中 0x03 为 CFG 配置命令类型
 #define FPGA_CMD_CUSTOM_READ_BYTE       0x43    // (0x04 << 4) | 0x03 = 读命令
 #define FPGA_CMD_CUSTOM_WRITE_BYTE      0x83    // (0x08 << 4) | 0x03 = 写命令
+#define FPGA_CMD_CUSTOM_BURST_BYTE      0xC3    // (0x0C << 4) | 0x03 = 突发读命令（起始寄存器, 数量）
+#define FPGA_CUSTOM_REG_MAX             128     // 软件侧寄存器编号上限（地址 2N/2N+1 为 8 位）
+#define FPGA_CUSTOM_BURST_REG_MAX       64      // 固件寄存器数量（突发读范围, 32-63 为性能计数器）
+#define FPGA_PERF_REG_BASE              32      // 性能计数器寄存器：32 = 控制/ID, 33-47 = 快照
+#define FPGA_PERF_REG_COUNT             16
+#define FPGA_PERF_ID_MAGIC              0x5046  // 寄存器 32 高 16 位 'PF'
+#define FPGA_CUSTOM_BURST_HEADER        0xfffd  // 突发读应答头地址，其后为 32 位数据字（状态半字节 0x7）
+#define FPGA_CMD_MAILBOX_ADDR_FLAG      0x40    // 地址位 14：自定义写/突发读命令访问邮箱 BRAM 而非寄存器
+#define FPGA_MAILBOX_SIZE               0x1000  // 邮箱 BRAM 大小（字节, 1024 个 DWORD）
+#define FPGA_MAILBOX_HEADER             0xfffc  // 邮箱突发读应答头地址，其后为 32 位数据字（状态半字节 0x7）
+
+// Custom register shadow policy
+#define FPGA_CUSTOM_REG_POLICY_VOLATILE     0x00    // always fetched from the FPGA
+#define FPGA_CUSTOM_REG_POLICY_WRITETHROUGH 0x01    // host-owned: cached on read, updated on write
+#define FPGA_CUSTOM_REG_POLICY_IMMUTABLE    0x02    // read once from the FPGA, cached until invalidated
 
 #define LC_CMD_FPGA_CUSTOM_READ         0x0200000000000000
 #define LC_CMD_FPGA_CUSTOM_WRITE        0x0201000000000000
+#define LC_CMD_FPGA_CUSTOM_READ_BULK    0x0202000000000000   // pbDataIn = BYTE[] register list, or range in low bits if pbDataIn = NULL; ppbDataOut = DWORD[]
+#define LC_CMD_FPGA_CUSTOM_WRITE_VECTOR 0x0203000000000000   // pbDataIn = FPGA_CUSTOM_WRITE_ENTRY[]; [lo-dword: LC_CMD_FPGA_CUSTOM_WRITE_VECTOR_BARRIER]
+#define LC_CMD_FPGA_CUSTOM_WRITE_VECTOR_BARRIER     0x01    // wait until all writes have been processed by the FPGA
+#define LC_CMD_FPGA_CUSTOM_SHADOW_INVALIDATE    0x0204000000000000  // pbDataIn = BYTE[] register list, or range in low bits; none = all registers
+#define LC_CMD_FPGA_CUSTOM_SHADOW_REFRESH       0x0205000000000000  // pbDataIn = BYTE[] register list, or range in low bits; none = all cacheable registers
+#define LC_CMD_FPGA_CUSTOM_SHADOW_POLICY        0x0206000000000000  // W: [lo-dword: register | policy << 8]; R: ppbDataOut = BYTE[FPGA_CUSTOM_REG_MAX] policies
+#define LC_CMD_FPGA_CUSTOM_WATCH                0x0207000000000000  // pbDataIn = FPGA_CUSTOM_WATCH to start/replace the register watch; none = stop
+#define LC_CMD_FPGA_MAILBOX_READ                0x0208000000000000  // [lo-dword: offset | cb << 16]; none = whole mailbox; ppbDataOut = BYTE[cb]
+#define LC_CMD_FPGA_MAILBOX_WRITE               0x0209000000000000  // [lo-dword: offset]; pbDataIn = BYTE[cbDataIn]
+#define LC_CMD_FPGA_PERF_COUNTERS               0x020A000000000000  // [lo-dword: LC_CMD_FPGA_PERF_COUNTERS_CLEAR]; ppbDataOut = FPGA_PERF_COUNTERS
+#define LC_CMD_FPGA_PERF_COUNTERS_CLEAR         0x01    // clear the firmware counters in the same cycle as the snapshot
 
 // Macros for multi-register access
 #define LC_CMD_FPGA_CUSTOM_READ_REG(n)  (LC_CMD_FPGA_CUSTOM_READ | ((n) & 0xFF))
 #define LC_CMD_FPGA_CUSTOM_WRITE_REG(n) (LC_CMD_FPGA_CUSTOM_WRITE | ((n) & 0xFF))
+#define LC_CMD_FPGA_CUSTOM_READ_BULK_RANGE(start, count)  (LC_CMD_FPGA_CUSTOM_READ_BULK | ((start) & 0xFF) | (((count) & 0xFF) << 8))
+#define LC_CMD_FPGA_CUSTOM_SHADOW_POLICY_SET(n, policy)   (LC_CMD_FPGA_CUSTOM_SHADOW_POLICY | ((n) & 0xFF) | (((policy) & 0xFF) << 8))
+#define LC_CMD_FPGA_MAILBOX_READ_RANGE(o, cb)             (LC_CMD_FPGA_MAILBOX_READ | ((o) & 0xFFFF) | (((cb) & 0xFFFF) << 16))
+#define LC_CMD_FPGA_MAILBOX_WRITE_OFFSET(o)               (LC_CMD_FPGA_MAILBOX_WRITE | ((o) & 0xFFFF))
+
+typedef struct tdFPGA_CUSTOM_WRITE_ENTRY {
+    DWORD dwReg;            // register number
+    DWORD dwValue;          // value to write
+    DWORD dwMask;           // bits to write (0xffffffff = whole register)
+} FPGA_CUSTOM_WRITE_ENTRY, *PFPGA_CUSTOM_WRITE_ENTRY;
+
+#define FPGA_CUSTOM_WATCH_VERSION       0xc0fe0001
+
+typedef struct tdFPGA_CUSTOM_WATCH_CHANGE {
+    DWORD dwReg;            // register number
+    DWORD dwValueOld;       // previously sampled value (== dwValueNew on the initial sample)
+    DWORD dwValueNew;       // currently sampled value
+} FPGA_CUSTOM_WATCH_CHANGE, *PFPGA_CUSTOM_WATCH_CHANGE;
+
+// Watch callback - invoked from the watch thread with the registers that
+// changed since the previous sample. A failed sample is reported with cChange
+// zero and pChanges NULL. The callback must return quickly and must not call
+// back into LeechCore on the same handle.
+typedef VOID(*PFPGA_CUSTOM_WATCH_CALLBACK)(_In_opt_ PVOID ctxUser, _In_ DWORD cChange, _In_reads_opt_(cChange) PFPGA_CUSTOM_WATCH_CHANGE pChanges);
+
+typedef struct tdFPGA_CUSTOM_WATCH {
+    DWORD dwVersion;        // FPGA_CUSTOM_WATCH_VERSION
+    DWORD dwIntervalMs;     // sample interval in ms (0 = 1ms)
+    PFPGA_CUSTOM_WATCH_CALLBACK pfnCB;
+    PVOID ctxUser;
+    DWORD cReg;             // number of registers in pbRegs (max FPGA_CUSTOM_REG_MAX)
+    BYTE pbRegs[FPGA_CUSTOM_REG_MAX];
+} FPGA_CUSTOM_WATCH, *PFPGA_CUSTOM_WATCH;
+
+#define FPGA_PERF_COUNTERS_VERSION      0xc0fe0002
+
+// Firmware performance counters - snapshot of custom registers 32-47. All
+// counters are free-running since the last clear and wrap at 32 bits.
+typedef struct tdFPGA_PERF_COUNTERS {
+    DWORD dwVersion;        // FPGA_PERF_COUNTERS_VERSION
+    DWORD dwFpgaPerfId;     // firmware perf block id: 'PF' | version << 8 | counter count
+    QWORD qwTicks;          // FPGA clock cycles (100MHz) since last clear
+    DWORD cTlpTx;           // TLPs host -> PCIe
+    DWORD cTlpTxDw;         // TLP dwords host -> PCIe
+    DWORD cTlpTxDrop;       // TLPs host -> PCIe dropped (TLP control disabled)
+    DWORD cTlpRx;           // TLPs PCIe -> host (completions)
+    DWORD cTlpRxDw;         // TLP dwords PCIe -> host
+    DWORD cTlpRxStall;      // cycles with PCIe rx TLP data waiting for the USB side
+    DWORD cUsbRxQw;         // 64-bit words received from the FT601
+    DWORD cUsbTxDw;         // 32-bit words sent to the FT601
+    DWORD cUsbStall;        // cycles the FT601 was not ready to accept data
+    DWORD cUsbStallMax;     // longest continuous FT601 backpressure run (cycles)
+    DWORD cCmdRx;           // command packets processed
+    DWORD cCmdTxFull;       // cycles the command reply fifo was almost full
+    DWORD _Reserved;
+} FPGA_PERF_COUNTERS, *PFPGA_PERF_COUNTERS;
 
 #define FPGA_REG_CORE                 0x0003
 #define FPGA_REG_PCIE                 0x0001
@@ -50,6 +133,20 @@
 #define FPGA_REG_READWRITE            0x8000
 #define FPGA_REG_SHADOWCFGSPACE       0xC000
 
+#define FPGA_CMD_TIMEOUT_DEFAULT_US   25000
+#define FPGA_CMD_TX_CHUNK_SIZE        0x3f0
+#define FPGA_CMD_RX_BUFFER_SIZE       0x20000
+
+#define FPGA_NEWASYNC2_TAG_STALE_US   50000     // read tag without completion for this long is recycled
+#define FPGA_NEWASYNC2_TAG_REISSUE    3         // max reissues of a lost read sub-range (if retry on error)
+#define FPGA_NEWASYNC2_TAG_VALID(w)   (((w) & 3) == 3 ? 0x0000ffff : 0xffffffff)    // valid read tags of bitmap DWORD w
+#define FPGA_NEWASYNC2_MEM_F_TINY     0x0001000000000000ULL     // MEM stack flag: read the MEM with the tiny algorithm
+#define FPGA_NEWASYNC2_MEM_F_LEARN    0x0002000000000000ULL     // MEM stack flag: add the MEM page to the tiny map if read successfully
+#define FPGA_NEWASYNC2_MEM_CB_MASK    0x0000ffffffffffffULL     // MEM stack: bytes read (+0x10000 per failed tiny sub-range)
+#define FPGA_NEWASYNC2_COALESCE_GAP   0x80      // sub-page MEMs in a page less than this apart are read by one covering read
+#define FPGA_TINYMAP_MAX              0x100     // max address ranges in the tiny map (the tiny algorithm is then used for all reads)
+#define FPGA_NEWASYNC2_WAIT_MS        1         // request wait before retrying to take over the device (lock holder may not process requests)
+
 #ifdef _WIN32
 #define DEVICE_FPGA_FT601_LIBRARY          "FTD3XXWU.dll"
 #define DEVICE_FPGA_FT601_OLD_LIBRARY      "FTD3XX.dll"
@@ -186,16 +283,33 @@ const DEVICE_PERFORMANCE PERFORMANCE_PROFILES[DEVICE_ID_MAX + 1] = {
     { .VERSION = DEVICE_PERFORMANCE_VERSION, .SZ_DEVICE_NAME = "DRIVER_SUPPLIED",       .PROBE_MAXPAGES = 0,     .RX_FLUSH_LIMIT = 0,      .MAX_SIZE_RX = 0,       .MAX_SIZE_TX = 0,      .DELAY_PROBE_READ = 0,    .DELAY_PROBE_WRITE = 0,   .DELAY_WRITE = 0 ,  .DELAY_READ = 0,   .RETRY_ON_ERROR = 0, .F_TINY = 0, .ASYNC_MAX_READSIZE = 0,       .ASYNC_DELAY_1 = 0, .ASYNC_DELAY_2 = 0, .FLAGS = 0 },
 };
 
+typedef BOOL(*PFN_FPGA_CMD_REPLY_CB)(_Inout_opt_ PVOID ctxReplyCB, _In_ BYTE bSrc, _In_ DWORD dwData);
+
+/*
+* Command context for FPGA_NEWASYNC2. Command packets are sent in the TLP TX
+* stream and their replies are demultiplexed from the TLP RX stream.
+*/
+typedef struct tdFPGA_NEWASYNC2_CMD_CONTEXT {
+    DWORD cReplyExpected;
+    DWORD cReply;
+    PFN_FPGA_CMD_REPLY_CB pfnReplyCB;
+    PVOID ctxReplyCB;
+} FPGA_NEWASYNC2_CMD_CONTEXT, *PFPGA_NEWASYNC2_CMD_CONTEXT;
+
 /*
-* Per-thread context for FPGA_NEWASYNC2. This may be queued to be processed by other threads.
+* Per-thread request context for FPGA_NEWASYNC2. Requests are submitted to a
+* lock-free queue and processed by whichever thread holds the device lock.
 */
 typedef struct tdFPGA_NEWASYNC2_MEM_CONTEXT {
+    struct tdFPGA_NEWASYNC2_MEM_CONTEXT *FLink;     // submit queue / active list link
     BOOL fWrite;
-    BOOL fQueued;
+    volatile DWORD fDone;               // set when completed - wait with WaitOnAddress()
     DWORD cMEM;
     DWORD iMem;
     DWORD cMemCpl;
     PPMEM_SCATTER ppMEMs;
+    PLC_READCHAIN pChain;               // read chain (single MEM re-armed per node) - or NULL
+    QWORD qwAChain;                     // read chain: address of the node being read (untranslated)
 } FPGA_NEWASYNC2_MEM_CONTEXT, *PFPGA_NEWASYNC2_MEM_CONTEXT;
 
 /*
@@ -214,10 +328,20 @@ typedef struct tdFPGA_NEWASYNC2_TAG_ENTRY {
     FPGA_NEWASYNC2_TAG_TYPE tp;
     WORD oMEM;                          // TINY ONLY
     union { WORD cbTag; WORD cCpl; };   // TINY ONLY
+    QWORD tmIssue;                      // QueryPerformanceCounter() time the read was issued
+    DWORD cReissue;                     // number of times the sub-range has been reissued
     PMEM_SCATTER pMEM;
     PFPGA_NEWASYNC2_MEM_CONTEXT pMemContext;
 } FPGA_NEWASYNC2_TAG_ENTRY, *PFPGA_NEWASYNC2_TAG_ENTRY;
 
+/*
+* Address range requiring the tiny read algorithm (4K reads fail).
+*/
+typedef struct tdFPGA_TINYMAP_RANGE {
+    QWORD pa;
+    QWORD cb;
+} FPGA_TINYMAP_RANGE, *PFPGA_TINYMAP_RANGE;
+
 /*
 * Global context for FPGA_NEWASYNC2
 */
@@ -226,10 +350,26 @@ typedef struct tdFPGA_NEWASYNC2_CONTEXT {
     BOOL fOldAsync;
     OVERLAPPED oOverlapped;
     // below are only used for the new async (algo=0,1) mode:
-    POB_MAP pmQueue;
-    BYTE iTag;
+    BOOL fNewAsync;                                 // new async (algo=0,1) initialized
+    PFPGA_NEWASYNC2_MEM_CONTEXT volatile pSubmit;   // submitted requests (lock-free LIFO, any thread)
+    PFPGA_NEWASYNC2_MEM_CONTEXT pActive;            // requests in progress (FIFO, lock holder only)
+    PFPGA_NEWASYNC2_MEM_CONTEXT pActiveTail;
+    PFPGA_NEWASYNC2_MEM_CONTEXT pTX;                // first active request with MEMs left to transmit
+    QWORD cCombine;                                 // requests processed on behalf of another thread
+    BOOL fCoalesce;                                 // coalesce sub-page MEMs into covering reads
+    QWORD cCoalesce;                                // sub-page MEMs read by covering reads
+    BYTE iTag;                          // last allocated tag
     DWORD cAvailTags;
     DWORD cbAvailCredits;
+    DWORD dwTagFree[8];                 // bitmap of free read tags
+    QWORD tmTx;                         // QueryPerformanceCounter() time of current TX batch
+    QWORD tmTagStale;                   // QueryPerformanceCounter() ticks until a tag is stale
+    QWORD cTagStale;                    // stale tags recycled
+    QWORD cReissue;                     // lost sub-ranges reissued
+    QWORD cbReissue;                    // bytes reissued
+    PFPGA_NEWASYNC2_CMD_CONTEXT pCmd;   // command awaiting replies (if any)
+    PFPGA_RXPARSE_CONTEXT pRxParse;     // rx stream parser
+    FILE *hRxRecord;                    // optional raw rx stream recording
     // valid entries are 0x00-0x6f, 0x80-0xef (for backwards compatibility).
     // tags 0x70-7f, 0xf0-ff are reserved as write tags.
     FPGA_NEWASYNC2_TAG_ENTRY Tags[0x100];
@@ -245,8 +385,11 @@ typedef ULONG(WINAPI *PFN_FT_GetOverlappedResult)(HANDLE ftHandle, LPOVERLAPPED
 typedef ULONG(WINAPI *PFN_FT_InitializeOverlapped)(HANDLE ftHandle, LPOVERLAPPED pOverlapped);
 typedef ULONG(WINAPI *PFN_FT_ReleaseOverlapped)(HANDLE ftHandle, LPOVERLAPPED pOverlapped);
 
+#define FT_IO_PENDING               24
+
 typedef struct tdDEVICE_CONTEXT_FPGA {
     CRITICAL_SECTION Lock;
+    PLC_CONTEXT ctxLC;
     WORD wDeviceId;
     WORD wFpgaVersionMajor;
     WORD wFpgaVersionMinor;
@@ -255,14 +398,15 @@ typedef struct tdDEVICE_CONTEXT_FPGA {
     DEV_CFG_PHY phy;
     DEVICE_PERFORMANCE perf;
     BOOL fAlgorithmReadTiny;
+    struct {
+        BOOL fLearn;                    // learn ranges from failed 4K reads succeeding as tiny reads
+        DWORD c;                        // number of ranges (sorted, non-adjacent)
+        QWORD cPage;                    // number of pages learned
+        PFPGA_TINYMAP_RANGE pRanges;    // FPGA_TINYMAP_MAX entries (allocated once learning is enabled)
+    } tinymap;
     BOOL fRestartDevice;
     QWORD qwDeviceIndex;
-    struct {
-        PBYTE pb;
-        DWORD o;
-        DWORD cb;
-        DWORD cbMax;
-    } rxbuf;
+    UTIL_RINGBUF rxbuf;
     struct {
         PBYTE pb;
         DWORD cb;
@@ -278,6 +422,7 @@ typedef struct tdDEVICE_CONTEXT_FPGA {
         HMODULE hModule;
         BOOL fInitialized;
         BOOL f2232h;
+        BOOL fUDP;
         union {
             HANDLE hFTDI;
             SOCKET SocketUDP;
@@ -293,6 +438,42 @@ typedef struct tdDEVICE_CONTEXT_FPGA {
         PFN_FT_ReleaseOverlapped pfnFT_ReleaseOverlapped;
     } dev;
     FPGA_NEWASYNC2_CONTEXT async2;
+    struct {
+        DWORD dwTimeoutUs;          // command/reply transaction deadline
+        QWORD c;                    // number of command/reply transactions
+        QWORD cTimeout;             // number of transactions with missing replies
+        QWORD qwLatencyTotalUs;
+        QWORD qwLatencyMaxUs;
+        BOOL fCustomBurstProbed;    // custom register burst read support probed
+        BOOL fCustomBurst;          // custom register burst read supported by bitstream
+    } cmd;
+    struct {
+        DWORD cusSpinMax;           // spin limit (uS) - longer waits park the thread
+        DWORD cusSpin;              // adaptive idle spin time (uS)
+        volatile DWORD dwSeq;       // incremented when the idle callback thread is woken
+        DWORD cIdleSpin;            // idle polls since activity (callback thread)
+        DWORD cIdlePark;            // idle parks since activity (callback thread)
+        BOOL fIdleTimeout;          // last idle park timed out (callback thread)
+        QWORD tcIdle;               // tickcount of last activity (callback thread)
+        QWORD cPark;                // number of waits parking the thread
+        BOOL fStatCpu;              // sample cpu time of threads in read calls
+        QWORD cusCpuRead;           // cpu time of threads in read calls (uS)
+        QWORD cbRead;               // bytes successfully read
+    } wait;
+    struct {
+        BYTE bPolicy[FPGA_CUSTOM_REG_MAX];  // FPGA_CUSTOM_REG_POLICY_*
+        BYTE fValid[FPGA_CUSTOM_REG_MAX];
+        DWORD dwValue[FPGA_CUSTOM_REG_MAX];
+    } shadow;
+    struct {
+        BOOL fThread;               // watch thread running (cleared by the thread on exit)
+        BOOL fStop;                 // watch thread exit requested
+        HANDLE hThread;             // watch thread (NULL once taken by the stopping thread)
+        HANDLE hEventFinish;        // set by the watch thread on exit
+        volatile BOOL fCallback;    // watch callback in progress (outside of ctx->Lock)
+        DWORD dwSeq;                // incremented on each watch (re)configuration
+        FPGA_CUSTOM_WATCH Config;   // Config.pfnCB == NULL -> watch stopped
+    } watch;
     PVOID pMRdBufferX; // NULL || PTLP_CALLBACK_BUF_MRd || PTLP_CALLBACK_BUF_MRd_2
     VOID(*hRxTlpCallbackFn)(_Inout_ PVOID pBufferMrd, _In_ PBYTE pb, _In_ DWORD cb);
     BYTE RxEccBit;
@@ -654,6 +835,187 @@ VOID TLP_CallbackMRd_Scatter(_Inout_ PTLP_CALLBACK_BUF_MRd_SCATTER pBufferMrd_Sc
 
 
 
+// Wait functionality below:
+//
+// Short device pacing delays (up to the spin limit) are spun for precise
+// timing while longer delays park the thread. The idle tlp callback thread
+// polls for an adaptive spin time after activity and is then parked until
+// data is received from the device, new TLPs are queued for transmit or a
+// timeout elapses. The spin limit is
+// set by the "waitspin" parameter / LC_OPT_FPGA_WAIT_SPIN and trades cpu
+// time for latency (0 = never spin).
+
+#define FPGA_WAIT_SPIN_DEFAULT_US       50          // default spin limit
+#define FPGA_WAIT_SPIN_STEP_US          5           // idle poll interval while spinning
+#define FPGA_WAIT_SOCKET_SLICE_US       1000        // idle socket wait slice (transmit wakes are checked in between)
+
+/*
+* Wait forward declarations:
+*/
+BOOL DeviceFPGA_Wait_Socket(_In_ SOCKET Sock, _In_ DWORD us);
+BOOL DeviceFPGA_Async2_Read_RxTlpFromBuffer(_In_ PLC_CONTEXT ctxLC, _In_ PDEVICE_CONTEXT_FPGA ctx);
+VOID DeviceFPGA_Async2_Read_Handoff(_In_ PDEVICE_CONTEXT_FPGA ctx);
+
+/*
+* Park the calling thread (without spinning) for a number of microseconds.
+* -- us
+*/
+VOID DeviceFPGA_Wait_Park(_In_ DWORD us)
+{
+#ifdef _WIN32
+    QWORD tmFreq, tmStart, tmNow, tmThreshold;
+    if(us >= 1000) {
+        Sleep(us / 1000);
+        us %= 1000;
+    }
+    // no sub-millisecond sleep - yield the cpu until the deadline:
+    QueryPerformanceFrequency((PLARGE_INTEGER)&tmFreq);
+    tmThreshold = tmFreq * us / (1000 * 1000);
+    QueryPerformanceCounter((PLARGE_INTEGER)&tmStart);
+    while(QueryPerformanceCounter((PLARGE_INTEGER)&tmNow) && ((tmNow - tmStart) < tmThreshold)) {
+        SwitchToThread();
+    }
+#else /* _WIN32 */
+    usleep(us);
+#endif /* _WIN32 */
+}
+
+/*
+* Delay the calling thread. Delays up to the spin limit are spun, longer delays
+* park the thread.
+* -- ctx
+* -- us
+*/
+VOID DeviceFPGA_Wait_Delay(_In_ PDEVICE_CONTEXT_FPGA ctx, _In_ DWORD us)
+{
+    if(!us) { return; }
+    if(us <= ctx->wait.cusSpinMax) {
+        BusySleep(us);
+    } else {
+        ctx->wait.cPark++;
+        DeviceFPGA_Wait_Park(us);
+    }
+}
+
+/*
+* Wake the idle tlp callback thread (new TLPs are queued for transmit).
+* -- ctx
+*/
+VOID DeviceFPGA_Wait_Wake(_In_ PDEVICE_CONTEXT_FPGA ctx)
+{
+    InterlockedIncrement((volatile LONG*)&ctx->wait.dwSeq);
+    WakeByAddressAll((PVOID)&ctx->wait.dwSeq);
+}
+
+/*
+* Park the idle tlp callback thread until the device has data, new TLPs are
+* queued for transmit or the timeout elapses. RawUDP devices wait in select()
+* on the socket. FT601 devices block on an overlapped read - received TLPs are
+* parsed into the callback queue. Devices without overlapped reads (or if the
+* device lock is busy) fall back to a timed park on the transmit wake address.
+* -- ctxLC
+* -- ctx
+* -- dwSeq = ctx->wait.dwSeq before the transmit queue was last checked.
+* -- dwTimeoutMs
+* -- return = TRUE if woken by device data or a transmit wake, FALSE on timeout.
+*/
+BOOL DeviceFPGA_Wait_IdlePark(_In_ PLC_CONTEXT ctxLC, _In_ PDEVICE_CONTEXT_FPGA ctx, _In_ DWORD dwSeq, _In_ DWORD dwTimeoutMs)
+{
+    BOOL fData = FALSE;
+    DWORD status, cbRead = 0, cusRemaining;
+    if(ctx->dev.fUDP) {
+        // select() is not woken by transmit wakes - wait in short slices:
+        for(cusRemaining = dwTimeoutMs * 1000; cusRemaining && (dwSeq == ctx->wait.dwSeq); cusRemaining -= min(cusRemaining, FPGA_WAIT_SOCKET_SLICE_US)) {
+            if(DeviceFPGA_Wait_Socket(ctx->dev.SocketUDP, min(cusRemaining, FPGA_WAIT_SOCKET_SLICE_US))) { return TRUE; }
+        }
+        return dwSeq != ctx->wait.dwSeq;
+    }
+    if(ctx->async2.fEnabled && !ctx->async2.fOldAsync && !ctx->dev.f2232h && (dwSeq == ctx->wait.dwSeq) && TryEnterCriticalSection(&ctx->Lock)) {
+        Util_RingBuf_Realign(&ctx->rxbuf, ctx->perf.ASYNC_MAX_READSIZE);
+        status = ctx->dev.pfnFT_ReadPipe(ctx->dev.hFTDI, 0x82, ctx->rxbuf.pb + ctx->rxbuf.cb, ctx->perf.ASYNC_MAX_READSIZE, &cbRead, &ctx->async2.oOverlapped);
+        if(!status || (status == FT_IO_PENDING)) {
+            status = ctx->dev.pfnFT_GetOverlappedResult(ctx->dev.hFTDI, &ctx->async2.oOverlapped, &cbRead, TRUE);
+        }
+        if(!status && cbRead) {
+            ctx->rxbuf.cb += cbRead;
+            fData = DeviceFPGA_Async2_Read_RxTlpFromBuffer(ctxLC, ctx);
+        }
+        LeaveCriticalSection(&ctx->Lock);
+        DeviceFPGA_Async2_Read_Handoff(ctx);
+        if(fData) { return TRUE; }
+    }
+    return WaitOnAddress(&ctx->wait.dwSeq, &dwSeq, sizeof(DWORD), dwTimeoutMs);
+}
+
+/*
+* Idle wait of the tlp callback thread. After activity the thread polls for the
+* adaptive spin time before it parks. The spin time grows (up to the spin limit)
+* if activity resumed right after the thread parked and shrinks if the thread
+* stayed parked for longer. The park timeout grows with the inactivity time.
+* -- ctxLC
+* -- ctx
+* -- fActive = activity since the last wait.
+* -- dwSeq = ctx->wait.dwSeq before the transmit queue was last checked.
+*/
+VOID DeviceFPGA_Wait_Idle(_In_ PLC_CONTEXT ctxLC, _In_ PDEVICE_CONTEXT_FPGA ctx, _In_ BOOL fActive, _In_ DWORD dwSeq)
+{
+    QWORD tcIdle;
+    if(fActive) {
+        if((ctx->wait.cIdlePark == 1) && ctx->wait.fIdleTimeout) {
+            ctx->wait.cusSpin = min(ctx->wait.cusSpinMax, 2 * ctx->wait.cusSpin + FPGA_WAIT_SPIN_STEP_US);
+        } else if(ctx->wait.cIdlePark > 1) {
+            ctx->wait.cusSpin >>= 1;
+        }
+        ctx->wait.cIdleSpin = 0;
+        ctx->wait.cIdlePark = 0;
+        ctx->wait.tcIdle = GetTickCount64();
+        return;
+    }
+    if(ctx->wait.cIdleSpin * FPGA_WAIT_SPIN_STEP_US < min(ctx->wait.cusSpin, ctx->wait.cusSpinMax)) {
+        ctx->wait.cIdleSpin++;
+        BusySleep(FPGA_WAIT_SPIN_STEP_US);
+        return;
+    }
+    tcIdle = GetTickCount64() - ctx->wait.tcIdle;
+    ctx->wait.cIdlePark++;
+    ctx->wait.cPark++;
+    ctx->wait.fIdleTimeout = !DeviceFPGA_Wait_IdlePark(ctxLC, ctx, dwSeq, (tcIdle < 1000) ? 1 : ((tcIdle < 15000) ? 4 : 16));
+}
+
+/*
+* Retrieve the cpu time of the calling thread.
+* -- return = cpu time in microseconds.
+*/
+QWORD DeviceFPGA_Wait_ThreadCpuTime()
+{
+    FILETIME ftCreation, ftExit, ftKernel, ftUser;
+    if(!GetThreadTimes(GetCurrentThread(), &ftCreation, &ftExit, &ftKernel, &ftUser)) { return 0; }
+#ifdef _WIN32
+    return ((((QWORD)ftKernel.dwHighDateTime << 32) | ftKernel.dwLowDateTime) + (((QWORD)ftUser.dwHighDateTime << 32) | ftUser.dwLowDateTime)) / 10;
+#else
+    return (ftKernel + ftUser) / 10;
+#endif /* _WIN32 */
+}
+
+/*
+* Check if a socket is readable - waiting at most the given timeout.
+* -- Sock
+* -- us = timeout in microseconds.
+* -- return = TRUE if readable.
+*/
+BOOL DeviceFPGA_Wait_Socket(_In_ SOCKET Sock, _In_ DWORD us)
+{
+    fd_set fds;
+    struct timeval tv;
+    FD_ZERO(&fds);
+    FD_SET(Sock, &fds);
+    tv.tv_sec = us / (1000 * 1000);
+    tv.tv_usec = us % (1000 * 1000);
+    return select((int)Sock + 1, &fds, NULL, NULL, &tv) > 0;
+}
+
+
+
 // UDP connectivity implementation below:
 
 /*
@@ -699,7 +1061,7 @@ ULONG WINAPI DeviceFPGA_UDP_FT60x_FT_WritePipe(HANDLE ftHandle, UCHAR ucPipeID,
 ULONG WINAPI DeviceFPGA_UDP_FT60x_FT_ReadPipe(HANDLE ftHandle, UCHAR ucPipeID, PUCHAR pucBuffer, ULONG ulBufferLength, PULONG pulBytesTransferred, PVOID pOverlapped)
 {
     int status;
-    DWORD cbTx, cSleep = 0, cbRead, cbReadTotal = 0;
+    DWORD cbTx, cbRead, cbReadTotal = 0;
     BYTE pbTx[] = { 0x01, 0x00, 0x01, 0x00,  0x80, 0x02, 0x23, 0x77 };                  // cmd msg: inactivity timer enable - 1ms
     FPGA_HANDLESOCKET hs;
     hs.h = ftHandle;
@@ -713,19 +1075,13 @@ ULONG WINAPI DeviceFPGA_UDP_FT60x_FT_ReadPipe(HANDLE ftHandle, UCHAR ucPipeID, P
                 break;
             }
             if(WSAEWOULDBLOCK == WSAGetLastError()) {
-                if(++cSleep < 10 * 50) {    // wait for completion max ~50ms
-                    if(cSleep < 5) {
-                        SwitchToThread();
-                    } else {
-                        BusySleep(100);
-                    }
+                if(DeviceFPGA_Wait_Socket(hs.Socket, 50 * 1000)) {   // wait for completion max ~50ms
                     continue;
                 }
                 break;
             }
             return 1;
         }
-        cSleep = 0;
         cbRead = min(ulBufferLength, (DWORD)status);
         cbReadTotal += cbRead;
         ulBufferLength -= cbRead;
@@ -788,6 +1144,349 @@ LPSTR DeviceFPGA_InitializeUDP(_In_ PDEVICE_CONTEXT_FPGA ctx, _In_ DWORD dwIpv4A
     ctx->dev.pfnFT_Close = DeviceFPGA_UDP_FT60x_FT_Close;
     ctx->dev.pfnFT_ReadPipe = DeviceFPGA_UDP_FT60x_FT_ReadPipe;
     ctx->dev.pfnFT_WritePipe = DeviceFPGA_UDP_FT60x_FT_WritePipe;
+    ctx->dev.fUDP = TRUE;
+    ctx->dev.fInitialized = TRUE;
+    return NULL;
+}
+
+// Software FPGA stand-in implementation below:
+//
+// The stand-in emulates the FT601 pipe functions and the bitstream command
+// protocol in software: core/pcie config registers, custom registers (incl.
+// burst read), the mailbox and the performance counter block. Memory read
+// TLPs are completed from a synthetic 16GB memory (FPGA_SIM_MEM_PATTERN), other
+// TLPs are silently dropped. It allows the register and memory read paths to
+// be used and benchmarked without hardware: "fpga://sim=1".
+
+#define FPGA_SIM_RX_MAX         0x00100000  // max queued reply words
+#define FPGA_SIM_VERSION_MAJOR  4
+#define FPGA_SIM_VERSION_MINOR  14
+#define FPGA_SIM_DEVICE_ID      0x0100      // emulated PCIe bus:dev.fn 01:00.0
+#define FPGA_SIM_FPGA_ID        0x02        // performance profile: AC701 / FT601 (async2 capable)
+#define FPGA_SIM_MEM_MAX        0x400000000 // emulated memory size (16GB), reads above are unsupported requests
+#define FPGA_SIM_MEM_PATTERN(a) ((DWORD)(a) ^ (DWORD)((a) >> 32) ^ 0x5a5a0000)  // content of the DWORD at address a
+
+typedef struct tdFPGA_SIM_CONTEXT {
+    BYTE pbReg[4][0x100];                   // [pcie ro, pcie rw, core ro, core rw]
+    DWORD dwCustomReg[32];
+    DWORD dwPerfSnap[FPGA_PERF_REG_COUNT];
+    DWORD dwMailbox[FPGA_MAILBOX_SIZE / 4];
+    QWORD qwFreq;
+    QWORD tmPerfBase;
+    DWORD cUsbRxQw;
+    DWORD cUsbTxDw;
+    DWORD cCmdRx;
+    DWORD cTlpTxDrop;
+    DWORD cdwTlpTx;                         // TLP currently being received from the host
+    DWORD dwTlpTx[4];
+    DWORD iRx;                              // ring buffer of pending reply words
+    DWORD cRx;
+    DWORD cbOverlapped;                     // result of last "overlapped" read
+    BYTE pbRxSrc[FPGA_SIM_RX_MAX];
+    DWORD pdwRx[FPGA_SIM_RX_MAX];
+} FPGA_SIM_CONTEXT, *PFPGA_SIM_CONTEXT;
+
+/*
+* Queue a reply word as it would be sent by the FPGA. The FT601 stream as seen
+* by the host contains the byte swapped 32-bit firmware word.
+*/
+VOID DeviceFPGA_SIM_RxPush(_In_ PFPGA_SIM_CONTEXT ctxSim, _In_ BYTE bSrc, _In_ DWORD dwWord)
+{
+    DWORD i;
+    if(ctxSim->cRx >= FPGA_SIM_RX_MAX) { return; }
+    i = (ctxSim->iRx + ctxSim->cRx) % FPGA_SIM_RX_MAX;
+    ctxSim->pbRxSrc[i] = bSrc;
+    ctxSim->pdwRx[i] = _byteswap_ulong(dwWord);
+    ctxSim->cRx++;
+}
+
+DWORD DeviceFPGA_SIM_CustomRegRead(_In_ PFPGA_SIM_CONTEXT ctxSim, _In_ DWORD iReg)
+{
+    if(iReg < 32) { return ctxSim->dwCustomReg[iReg]; }
+    if(iReg == FPGA_PERF_REG_BASE) { return ((DWORD)FPGA_PERF_ID_MAGIC << 16) | 0x010f; }
+    if(iReg < FPGA_PERF_REG_BASE + FPGA_PERF_REG_COUNT) { return ctxSim->dwPerfSnap[iReg - FPGA_PERF_REG_BASE]; }
+    return 0;
+}
+
+VOID DeviceFPGA_SIM_PerfControl(_In_ PFPGA_SIM_CONTEXT ctxSim, _In_ WORD wValue, _In_ WORD wMask)
+{
+    QWORD tmNow, qwTicks;
+    wValue &= wMask;
+    if(wValue & 0x01) {
+        QueryPerformanceCounter((PLARGE_INTEGER)&tmNow);
+        qwTicks = (QWORD)((double)(tmNow - ctxSim->tmPerfBase) * 100000000.0 / ctxSim->qwFreq);
+        ZeroMemory(ctxSim->dwPerfSnap, sizeof(ctxSim->dwPerfSnap));
+        ctxSim->dwPerfSnap[1] = (DWORD)qwTicks;
+        ctxSim->dwPerfSnap[2] = (DWORD)(qwTicks >> 32);
+        ctxSim->dwPerfSnap[5] = ctxSim->cTlpTxDrop;
+        ctxSim->dwPerfSnap[9] = ctxSim->cUsbRxQw;
+        ctxSim->dwPerfSnap[10] = ctxSim->cUsbTxDw;
+        ctxSim->dwPerfSnap[13] = ctxSim->cCmdRx;
+    }
+    if(wValue & 0x02) {
+        QueryPerformanceCounter((PLARGE_INTEGER)&ctxSim->tmPerfBase);
+        ctxSim->cUsbRxQw = 0;
+        ctxSim->cUsbTxDw = 0;
+        ctxSim->cCmdRx = 0;
+        ctxSim->cTlpTxDrop = 0;
+    }
+}
+
+/*
+* Complete a memory read TLP received from the host. The emulated memory reads
+* as FPGA_SIM_MEM_PATTERN. Completions are split on 128-byte boundaries.
+* -- ctxSim
+* -- return = TRUE if the TLP was a memory read.
+*/
+BOOL DeviceFPGA_SIM_TlpMRd(_In_ PFPGA_SIM_CONTEXT ctxSim)
+{
+    DWORD i, buf[4] = { 0 }, cb, cbTotal, dwCpl[3] = { 0 };
+    QWORD qwA;
+    TLP_HDR_MRdWr32 hdrRd32;
+    TLP_HDR_MRdWr64 hdrRd64;
+    PTLP_HDR_CplD hdrC = (PTLP_HDR_CplD)dwCpl;
+    for(i = 0; i < 4; i++) {
+        buf[i] = _byteswap_ulong(ctxSim->dwTlpTx[i]);
+    }
+    memcpy(&hdrRd32, buf, sizeof(TLP_HDR_MRdWr32));
+    memcpy(&hdrRd64, buf, sizeof(TLP_HDR_MRdWr64));
+    if((hdrRd32.h.TypeFmt == TLP_MRd32) && (ctxSim->cdwTlpTx == 3)) {
+        qwA = hdrRd32.Address;
+    } else if((hdrRd32.h.TypeFmt == TLP_MRd64) && (ctxSim->cdwTlpTx == 4)) {
+        qwA = ((QWORD)hdrRd64.AddressHigh << 32) | hdrRd64.AddressLow;
+    } else {
+        return FALSE;
+    }
+    qwA &= ~3ULL;
+    cbTotal = (hdrRd32.h.Length ? hdrRd32.h.Length : 0x400) << 2;
+    hdrC->Tag = hdrRd32.Tag;
+    hdrC->RequesterID = hdrRd32.RequesterID;
+    hdrC->CompleterID = FPGA_SIM_DEVICE_ID;
+    if(qwA + cbTotal > FPGA_SIM_MEM_MAX) {
+        hdrC->h.TypeFmt = TLP_Cpl;
+        hdrC->Status = 1;                           // unsupported request
+        hdrC->ByteCount = cbTotal & 0xfff;
+        DeviceFPGA_SIM_RxPush(ctxSim, 0x00, dwCpl[0]);
+        DeviceFPGA_SIM_RxPush(ctxSim, 0x00, dwCpl[1]);
+        DeviceFPGA_SIM_RxPush(ctxSim, 0x04, dwCpl[2]);
+        return TRUE;
+    }
+    hdrC->h.TypeFmt = TLP_CplD;
+    while(cbTotal) {
+        cb = min(cbTotal, 0x80 - (DWORD)(qwA & 0x7f));
+        hdrC->h.Length = cb >> 2;
+        hdrC->ByteCount = cbTotal & 0xfff;
+        hdrC->LowerAddress = qwA & 0x7f;
+        DeviceFPGA_SIM_RxPush(ctxSim, 0x00, dwCpl[0]);
+        DeviceFPGA_SIM_RxPush(ctxSim, 0x00, dwCpl[1]);
+        DeviceFPGA_SIM_RxPush(ctxSim, 0x00, dwCpl[2]);
+        for(i = 0; i < cb; i += 4) {
+            // payload is memory content (byte order preserved) - undo the swap of RxPush:
+            DeviceFPGA_SIM_RxPush(ctxSim, (i + 4 == cb) ? 0x04 : 0x00, _byteswap_ulong(FPGA_SIM_MEM_PATTERN(qwA + i)));
+        }
+        qwA += cb;
+        cbTotal -= cb;
+    }
+    return TRUE;
+}
+
+/*
+* Process a single 8-byte command packet in the same way as pcileech_fifo.sv.
+*/
+VOID DeviceFPGA_SIM_Command(_In_ PFPGA_SIM_CONTEXT ctxSim, _In_reads_(8) PBYTE pb)
+{
+    DWORD i, iReg, iStart, cCount;
+    WORD wValue = pb[0] | (pb[1] << 8);
+    WORD wMask = pb[2] | (pb[3] << 8);
+    WORD wAddr = (pb[4] << 8) | pb[5];
+    BYTE bCmd = pb[6] >> 4, bTarget = pb[6] & 0x03;
+    BOOL fRW = (wAddr & 0x8000) ? TRUE : FALSE, fShadow = (wAddr & 0x4000) ? TRUE : FALSE;
+    PBYTE pbReg;
+    ctxSim->cUsbRxQw++;
+    if(bTarget == 0x00) {                           // TLP - only memory reads emulated
+        if(ctxSim->cdwTlpTx < 4) {
+            ctxSim->dwTlpTx[ctxSim->cdwTlpTx] = *(PDWORD)pb;
+        }
+        ctxSim->cdwTlpTx++;
+        if(pb[6] & 0x04) {                          // last dword of TLP
+            if(!DeviceFPGA_SIM_TlpMRd(ctxSim)) {
+                ctxSim->cTlpTxDrop++;
+            }
+            ctxSim->cdwTlpTx = 0;
+        }
+        return;
+    }
+    if((bTarget == 0x01) || (bTarget == 0x03 && (bCmd & 0x03))) {
+        // config register read/write (pcie or core)
+        if(fShadow) { return; }
+        if(bTarget == 0x03) { ctxSim->cCmdRx++; }
+        pbReg = ctxSim->pbReg[((bTarget == 0x03) ? 2 : 0) + (fRW ? 1 : 0)];
+        i = wAddr & 0xfe;
+        if(bCmd & 0x01) {
+            DeviceFPGA_SIM_RxPush(ctxSim, bTarget, ((DWORD)wAddr << 16) | (pbReg[i] << 8) | pbReg[i + 1]);
+        }
+        if((bCmd & 0x02) && fRW) {
+            pbReg[i] = (pbReg[i] & ~(BYTE)wMask) | ((BYTE)wValue & (BYTE)wMask);
+            pbReg[i + 1] = (pbReg[i + 1] & ~(BYTE)(wMask >> 8)) | ((BYTE)(wValue >> 8) & (BYTE)(wMask >> 8));
+        }
+        return;
+    }
+    if(bTarget != 0x03) { return; }                 // loopback - not emulated
+    ctxSim->cCmdRx++;
+    iReg = ((wAddr >> 1) & 0x1f) | ((wAddr & 0x40) ? 0x20 : 0);
+    switch(bCmd) {
+        case 0x04:                                  // custom register read (16-bit half)
+            if(fShadow) { return; }
+            DeviceFPGA_SIM_RxPush(ctxSim, 0x03, ((DWORD)wAddr << 16) | (WORD)(DeviceFPGA_SIM_CustomRegRead(ctxSim, iReg) >> ((wAddr & 1) ? 16 : 0)));
+            return;
+        case 0x08:                                  // custom register / mailbox write
+            if(fShadow) {
+                ctxSim->dwMailbox[wAddr & 0x3ff] = ((DWORD)wMask << 16) | wValue;
+            } else if(iReg >= 32) {
+                if(iReg == FPGA_PERF_REG_BASE && !(wAddr & 1)) { DeviceFPGA_SIM_PerfControl(ctxSim, wValue, wMask); }
+            } else {
+                i = (wAddr & 1) ? 16 : 0;
+                ctxSim->dwCustomReg[iReg] = (ctxSim->dwCustomReg[iReg] & ~((DWORD)wMask << i)) | ((DWORD)(wValue & wMask) << i);
+            }
+            return;
+        case 0x0C:                                  // custom register / mailbox burst read
+            if(fShadow) {
+                iStart = wAddr & 0x3ff;
+                cCount = min(wValue & 0x7ff, FPGA_MAILBOX_SIZE / 4 - iStart);
+                DeviceFPGA_SIM_RxPush(ctxSim, 0x03, ((DWORD)FPGA_MAILBOX_HEADER << 16) | cCount);
+                for(i = 0; i < cCount; i++) {
+                    DeviceFPGA_SIM_RxPush(ctxSim, 0x07, ctxSim->dwMailbox[iStart + i]);
+                }
+            } else {
+                iStart = wAddr & 0x3f;
+                cCount = min(wValue & 0x7f, FPGA_CUSTOM_BURST_REG_MAX - iStart);
+                DeviceFPGA_SIM_RxPush(ctxSim, 0x03, ((DWORD)FPGA_CUSTOM_BURST_HEADER << 16) | (iStart << 8) | cCount);
+                for(i = 0; i < cCount; i++) {
+                    DeviceFPGA_SIM_RxPush(ctxSim, 0x07, DeviceFPGA_SIM_CustomRegRead(ctxSim, iStart + i));
+                }
+            }
+            return;
+    }
+}
+
+ULONG WINAPI DeviceFPGA_SIM_FT60x_FT_Close(HANDLE ftHandle)
+{
+    LocalFree((PFPGA_SIM_CONTEXT)ftHandle);
+    return 0;
+}
+
+ULONG WINAPI DeviceFPGA_SIM_FT60x_FT_AbortPipe(HANDLE ftHandle, UCHAR ucPipeID)
+{
+    return 0;
+}
+
+/*
+* Emulate the FT601 WritePipe function - split the stream into command packets
+* (skipping dword resynch fillers) and process them synchronously.
+*/
+ULONG WINAPI DeviceFPGA_SIM_FT60x_FT_WritePipe(HANDLE ftHandle, UCHAR ucPipeID, PUCHAR pucBuffer, ULONG ulBufferLength, PULONG pulBytesTransferred, PVOID pOverlapped)
+{
+    PFPGA_SIM_CONTEXT ctxSim = (PFPGA_SIM_CONTEXT)ftHandle;
+    DWORD i = 0;
+    while(i + 8 <= ulBufferLength) {
+        if((*(PDWORD)(pucBuffer + i) == 0x55556666) || (pucBuffer[i + 7] != 0x77)) {
+            i += 4;
+            continue;
+        }
+        DeviceFPGA_SIM_Command(ctxSim, pucBuffer + i);
+        i += 8;
+    }
+    *pulBytesTransferred = ulBufferLength;
+    return 0;
+}
+
+/*
+* Emulate the FT601 ReadPipe function - pack queued reply words into 32-byte
+* status + 7 data dword blocks. Unused slots are marked as filler (0xf).
+* Overlapped reads complete immediately (see GetOverlappedResult below).
+*/
+ULONG WINAPI DeviceFPGA_SIM_FT60x_FT_ReadPipe(HANDLE ftHandle, UCHAR ucPipeID, PUCHAR pucBuffer, ULONG ulBufferLength, PULONG pulBytesTransferred, PVOID pOverlapped)
+{
+    PFPGA_SIM_CONTEXT ctxSim = (PFPGA_SIM_CONTEXT)ftHandle;
+    DWORD j, o = 0, dwStatus;
+    PDWORD pdwData;
+    while(ctxSim->cRx && (o + 32 <= ulBufferLength)) {
+        dwStatus = 0xe0000000;
+        pdwData = (PDWORD)(pucBuffer + o + 4);
+        for(j = 0; j < 7; j++) {
+            if(ctxSim->cRx) {
+                dwStatus |= (DWORD)ctxSim->pbRxSrc[ctxSim->iRx] << (j * 4);
+                pdwData[j] = ctxSim->pdwRx[ctxSim->iRx];
+                ctxSim->iRx = (ctxSim->iRx + 1) % FPGA_SIM_RX_MAX;
+                ctxSim->cRx--;
+            } else {
+                dwStatus |= 0x0f << (j * 4);
+                pdwData[j] = 0xffffffff;
+            }
+        }
+        *(PDWORD)(pucBuffer + o) = dwStatus;
+        ctxSim->cUsbTxDw += 8;
+        o += 32;
+    }
+    if(pOverlapped) {
+        ctxSim->cbOverlapped = o;
+    } else {
+        *pulBytesTransferred = o;
+    }
+    return 0;
+}
+
+/*
+* Emulate overlapped FT601 reads - the read is completed immediately by ReadPipe
+* and the result is returned by GetOverlappedResult. This allows the async2 read
+* path (and its rx stream parser) to be used with the stand-in.
+*/
+ULONG WINAPI DeviceFPGA_SIM_FT60x_FT_GetOverlappedResult(HANDLE ftHandle, PVOID pOverlapped, PULONG pulLengthTransferred, BOOL bWait)
+{
+    PFPGA_SIM_CONTEXT ctxSim = (PFPGA_SIM_CONTEXT)ftHandle;
+    *pulLengthTransferred = ctxSim->cbOverlapped;
+    ctxSim->cbOverlapped = 0;
+    return 0;
+}
+
+ULONG WINAPI DeviceFPGA_SIM_FT60x_FT_Overlapped(HANDLE ftHandle, PVOID pOverlapped)
+{
+    return 0;
+}
+
+/*
+* Initialize the software FPGA stand-in.
+* -- ctx
+* -- return = NULL on success, Error message on fail.
+*/
+LPSTR DeviceFPGA_InitializeSIM(_In_ PDEVICE_CONTEXT_FPGA ctx)
+{
+    PFPGA_SIM_CONTEXT ctxSim;
+    if(!(ctxSim = LocalAlloc(LMEM_ZEROINIT, sizeof(FPGA_SIM_CONTEXT)))) {
+        return "Unable to allocate software FPGA";
+    }
+    QueryPerformanceFrequency((PLARGE_INTEGER)&ctxSim->qwFreq);
+    QueryPerformanceCounter((PLARGE_INTEGER)&ctxSim->tmPerfBase);
+    // core read-only: magic, version, device id (see pcileech_fifo.sv)
+    *(PWORD)(ctxSim->pbReg[2] + 0x00) = 0xab89;
+    ctxSim->pbReg[2][0x04] = 0x28;
+    ctxSim->pbReg[2][0x08] = FPGA_SIM_VERSION_MAJOR;
+    ctxSim->pbReg[2][0x09] = FPGA_SIM_VERSION_MINOR;
+    ctxSim->pbReg[2][0x0a] = FPGA_SIM_FPGA_ID;
+    *(PWORD)(ctxSim->pbReg[3] + 0x00) = 0xefcd;
+    // pcie read-only: device id (big endian)
+    ctxSim->pbReg[0][0x08] = FPGA_SIM_DEVICE_ID >> 8;
+    ctxSim->pbReg[0][0x09] = FPGA_SIM_DEVICE_ID & 0xff;
+    ctx->dev.hFTDI = (HANDLE)ctxSim;
+    ctx->dev.pfnFT_AbortPipe = DeviceFPGA_SIM_FT60x_FT_AbortPipe;
+    ctx->dev.pfnFT_Create = NULL;
+    ctx->dev.pfnFT_Close = DeviceFPGA_SIM_FT60x_FT_Close;
+    ctx->dev.pfnFT_ReadPipe = DeviceFPGA_SIM_FT60x_FT_ReadPipe;
+    ctx->dev.pfnFT_WritePipe = DeviceFPGA_SIM_FT60x_FT_WritePipe;
+    ctx->dev.pfnFT_GetOverlappedResult = (PFN_FT_GetOverlappedResult)DeviceFPGA_SIM_FT60x_FT_GetOverlappedResult;
+    ctx->dev.pfnFT_InitializeOverlapped = (PFN_FT_InitializeOverlapped)DeviceFPGA_SIM_FT60x_FT_Overlapped;
+    ctx->dev.pfnFT_ReleaseOverlapped = (PFN_FT_ReleaseOverlapped)DeviceFPGA_SIM_FT60x_FT_Overlapped;
+    ctx->async2.fEnabled = TRUE;
     ctx->dev.fInitialized = TRUE;
     return NULL;
 }
@@ -1170,6 +1869,9 @@ VOID DeviceFPGA_ReInitializeFTDI(_In_ PDEVICE_CONTEXT_FPGA ctx)
     }
 }
 
+_Success_(return)
+BOOL DeviceFPGA_CustomWatch(_In_ PLC_CONTEXT ctxLC, _In_ PDEVICE_CONTEXT_FPGA ctx, _In_opt_ PFPGA_CUSTOM_WATCH pWatch);
+
 VOID DeviceFPGA_Close(_Inout_ PLC_CONTEXT ctxLC)
 {
     PDEVICE_CONTEXT_FPGA ctx = (PDEVICE_CONTEXT_FPGA)ctxLC->hDevice;
@@ -1178,6 +1880,7 @@ VOID DeviceFPGA_Close(_Inout_ PLC_CONTEXT ctxLC)
     while(!TryEnterCriticalSection(&ctx->Lock)) {
         Sleep(50);
     }
+    DeviceFPGA_CustomWatch(ctxLC, ctx, NULL);
     LeaveCriticalSection(&ctx->Lock);
     if(ctx->async2.fEnabled && ctx->dev.pfnFT_GetOverlappedResult) {
         ctx->dev.pfnFT_GetOverlappedResult(ctx->dev.hFTDI, &ctx->async2.oOverlapped, &cbTMP, TRUE);
@@ -1197,14 +1900,167 @@ VOID DeviceFPGA_Close(_Inout_ PLC_CONTEXT ctxLC)
     } __except(EXCEPTION_EXECUTE_HANDLER) { ; }
 #endif /* WIN32 */
     DeleteCriticalSection(&ctx->Lock);
-    Ob_DECREF(ctx->async2.pmQueue);
-    LocalFree(ctx->rxbuf.pb);
+    LocalFree(ctx->async2.pRxParse);
+    LocalFree(ctx->tinymap.pRanges);
+    if(ctx->async2.hRxRecord) { fclose(ctx->async2.hRxRecord); }
+    Util_RingBuf_Close(&ctx->rxbuf);
     LocalFree(ctx->txbuf.pb);
     LocalFree(ctx->txbuf_fastwrite.pb);
     LocalFree(ctx);
     ctxLC->hDevice = 0;
 }
 
+/*
+* Async2 command forward declarations:
+*/
+_Success_(return)
+BOOL DeviceFPGA_Async2_TxCmd(_In_ PLC_CONTEXT ctxLC, _In_ PDEVICE_CONTEXT_FPGA ctx, _In_reads_(cbTx) PBYTE pbTx, _In_ DWORD cbTx);
+_Success_(return)
+BOOL DeviceFPGA_Async2_CmdTransaction(_In_ PLC_CONTEXT ctxLC, _In_ PDEVICE_CONTEXT_FPGA ctx, _In_reads_(cbTx) PBYTE pbTx, _In_ DWORD cbTx, _In_ DWORD cReplyExpected, _In_ PFN_FPGA_CMD_REPLY_CB pfnReplyCB, _Inout_opt_ PVOID ctxReplyCB, _In_ QWORD tmDeadline);
+
+/*
+* Write a batch of FPGA command packets to the device. Large batches are split
+* into chunks the FPGA command fifo is able to absorb. In async2 mode packets
+* are sent through the shared TLP TX buffer.
+* -- ctx
+* -- pbTx = command packets (8 bytes each).
+* -- cbTx
+* -- return
+*/
+_Success_(return)
+BOOL DeviceFPGA_CmdWrite(_In_ PDEVICE_CONTEXT_FPGA ctx, _In_reads_(cbTx) PBYTE pbTx, _In_ DWORD cbTx)
+{
+    DWORD o, cb, cbWritten, status;
+    if(ctx->async2.fEnabled && ctx->async2.fNewAsync) {
+        return DeviceFPGA_Async2_TxCmd(ctx->ctxLC, ctx, pbTx, cbTx);
+    }
+    for(o = 0; o < cbTx; o += cb) {
+        cb = min(cbTx - o, FPGA_CMD_TX_CHUNK_SIZE);
+        status = ctx->dev.pfnFT_WritePipe(ctx->dev.hFTDI, 0x02, pbTx + o, cb, &cbWritten, NULL);
+        if(status) { return FALSE; }
+    }
+    return TRUE;
+}
+
+/*
+* Send a batch of FPGA command packets and poll the device until all expected
+* command/config replies have been received or the deadline expires. Replies
+* are passed, in the order received, to the caller supplied callback function
+* which decides whether a reply belongs to the transaction or not.
+* Observed round trip latency is accounted in the ctx->cmd statistics.
+* In async2 mode the transaction is interleaved with TLP traffic, see
+* DeviceFPGA_Async2_CmdTransaction().
+* -- ctx
+* -- pbTx = command packets (8 bytes each).
+* -- cbTx
+* -- cReplyExpected = number of replies required to complete the transaction.
+* -- pfnReplyCB = callback function receiving all non-TLP replies.
+* -- ctxReplyCB = user context passed to pfnReplyCB.
+* -- return = TRUE if all expected replies were received before the deadline.
+*/
+_Success_(return)
+BOOL DeviceFPGA_CmdTransaction(
+    _In_ PDEVICE_CONTEXT_FPGA ctx,
+    _In_reads_(cbTx) PBYTE pbTx,
+    _In_ DWORD cbTx,
+    _In_ DWORD cReplyExpected,
+    _In_ PFN_FPGA_CMD_REPLY_CB pfnReplyCB,
+    _Inout_opt_ PVOID ctxReplyCB
+) {
+    BOOL fReturn = FALSE;
+    PBYTE pbRx = NULL;
+    DWORD i = 0, j, cb, status, dwStatus, cbRx = 0, cReply = 0;
+    PDWORD pdwData;
+    QWORD qwFreq, tmStart, tmNow, tmDeadline, qwLatencyUs;
+    QueryPerformanceFrequency((PLARGE_INTEGER)&qwFreq);
+    QueryPerformanceCounter((PLARGE_INTEGER)&tmStart);
+    tmDeadline = tmStart + (qwFreq * ctx->cmd.dwTimeoutUs) / 1000000;
+    if(ctx->async2.fEnabled && ctx->async2.fNewAsync) {
+        fReturn = DeviceFPGA_Async2_CmdTransaction(ctx->ctxLC, ctx, pbTx, cbTx, cReplyExpected, pfnReplyCB, ctxReplyCB, tmDeadline);
+        QueryPerformanceCounter((PLARGE_INTEGER)&tmNow);
+        goto statistics;
+    }
+    if(!(pbRx = LocalAlloc(0, FPGA_CMD_RX_BUFFER_SIZE))) { return FALSE; }
+    // WRITE requests
+    if(!DeviceFPGA_CmdWrite(ctx, pbTx, cbTx)) { goto fail; }
+    // READ and dispatch replies until complete or deadline
+    while(TRUE) {
+        if(cbRx > FPGA_CMD_RX_BUFFER_SIZE - 0x1000) {
+            memmove(pbRx, pbRx + i, cbRx - i);
+            cbRx -= i;
+            i = 0;
+        }
+        status = ctx->dev.pfnFT_ReadPipe(ctx->dev.hFTDI, 0x82, pbRx + cbRx, FPGA_CMD_RX_BUFFER_SIZE - cbRx, &cb, NULL);
+        if(status) { goto fail; }
+        cbRx += cb;
+        while(i + 32 <= cbRx) {
+            if(*(PDWORD)(pbRx + i) == 0x55556666) {     // skip over ftdi workaround dummy fillers
+                i += 4;
+                continue;
+            }
+            dwStatus = *(PDWORD)(pbRx + i);
+            pdwData = (PDWORD)(pbRx + i + 4);
+            if((dwStatus & 0xf0000000) != 0xe0000000) {
+                i += 4;
+                continue;
+            }
+            for(j = 0; j < 7; j++) {
+                if((dwStatus & 0x03) && pfnReplyCB(ctxReplyCB, (BYTE)(dwStatus & 0x0f), *pdwData)) {
+                    cReply++;
+                }
+                pdwData++;
+                dwStatus >>= 4;
+            }
+            i += 32;
+        }
+        QueryPerformanceCounter((PLARGE_INTEGER)&tmNow);
+        if(cReply >= cReplyExpected) {
+            fReturn = TRUE;
+            break;
+        }
+        if(tmNow > tmDeadline) {
+            ctx->cmd.cTimeout++;
+            break;
+        }
+    }
+statistics:
+    qwLatencyUs = ((tmNow - tmStart) * 1000000) / qwFreq;
+    ctx->cmd.c++;
+    ctx->cmd.qwLatencyTotalUs += qwLatencyUs;
+    ctx->cmd.qwLatencyMaxUs = max(ctx->cmd.qwLatencyMaxUs, qwLatencyUs);
+fail:
+    LocalFree(pbRx);
+    return fReturn;
+}
+
+typedef struct tdFPGA_CONFIGREAD_CONTEXT {
+    PBYTE pb;
+    WORD cb;
+    WORD wBaseAddr;
+    WORD flags;
+} FPGA_CONFIGREAD_CONTEXT, *PFPGA_CONFIGREAD_CONTEXT;
+
+BOOL DeviceFPGA_ConfigRead_ReplyCB(_Inout_opt_ PVOID ctxReplyCB, _In_ BYTE bSrc, _In_ DWORD dwData)
+{
+    PFPGA_CONFIGREAD_CONTEXT ctxRd = (PFPGA_CONFIGREAD_CONTEXT)ctxReplyCB;
+    WORD wAddr;
+    if(bSrc != (ctxRd->flags & 0x03)) { return FALSE; }    // status src flags does not match source
+    wAddr = _byteswap_ushort((WORD)dwData);
+    wAddr -= (ctxRd->flags & 0xC000) + ctxRd->wBaseAddr;    // adjust for base address and read-write config memory
+    if(wAddr == 0xffff) {       // 1st unaligned byte
+        if(!(ctxRd->wBaseAddr & 1)) { return FALSE; }
+        *ctxRd->pb = (dwData >> 24) & 0xff;
+        return TRUE;
+    }
+    if(wAddr >= ctxRd->cb) { return FALSE; }                // address read is out of range
+    if(wAddr == ctxRd->cb - 1) {    // last byte
+        *(PBYTE)(ctxRd->pb + wAddr) = (dwData >> 16) & 0xff;
+    } else {                        // normal two-bytes
+        *(PWORD)(ctxRd->pb + wAddr) = (dwData >> 16) & 0xffff;
+    }
+    return TRUE;
+}
+
 /*
 * Read bitstream v4 configuration registers. The bitstream v4 have four register
 * spaces, one read-only and one read-write for each of core and pcie.
@@ -1220,65 +2076,26 @@ VOID DeviceFPGA_Close(_Inout_ PLC_CONTEXT ctxLC)
 _Success_(return)
 BOOL DeviceFPGA_ConfigRead(_In_ PDEVICE_CONTEXT_FPGA ctx, _In_ WORD wBaseAddr, _Out_writes_(cb) PBYTE pb, _In_ WORD cb, _In_ WORD flags)
 {
-    BOOL f, fReturn = FALSE;
-    PBYTE pbRxTx = NULL;
-    DWORD i, j, status, dwStatus, dwData, cbRxTx = 0;
-    PDWORD pdwData;
+    BOOL fReturn = FALSE;
+    PBYTE pbTx = NULL;
+    DWORD cbTx = 0;
     WORD wAddr;
+    FPGA_CONFIGREAD_CONTEXT ctxRd = { .pb = pb, .cb = cb, .wBaseAddr = wBaseAddr, .flags = flags };
     if(!cb || (wBaseAddr + cb > 0x1000)) { goto fail; }
-    if(!(pbRxTx = LocalAlloc(LMEM_ZEROINIT, 0x20000))) { goto fail; }
+    if(!(pbTx = LocalAlloc(LMEM_ZEROINIT, 0x4000))) { goto fail; }
     // WRITE requests
     for(wAddr = wBaseAddr & 0xfffe; wAddr < wBaseAddr + cb; wAddr += 2) {
-        pbRxTx[cbRxTx + 4] = (wAddr | (flags & 0xC000)) >> 8;
-        pbRxTx[cbRxTx + 5] = wAddr & 0xff;
-        pbRxTx[cbRxTx + 6] = 0x10 | (flags & 0x03);
-        pbRxTx[cbRxTx + 7] = 0x77;
-        cbRxTx += 8;
-        if(cbRxTx >= 0x3f0) {
-            status = ctx->dev.pfnFT_WritePipe(ctx->dev.hFTDI, 0x02, pbRxTx, cbRxTx, &cbRxTx, NULL);
-            if(status) { goto fail; }
-            cbRxTx = 0;
-        }
-    }
-    if(cbRxTx) {
-        status = ctx->dev.pfnFT_WritePipe(ctx->dev.hFTDI, 0x02, pbRxTx, cbRxTx, &cbRxTx, NULL);
-        if(status) { goto fail; }
+        pbTx[cbTx + 4] = (wAddr | (flags & 0xC000)) >> 8;
+        pbTx[cbTx + 5] = wAddr & 0xff;
+        pbTx[cbTx + 6] = 0x10 | (flags & 0x03);
+        pbTx[cbTx + 7] = 0x77;
+        cbTx += 8;
     }
-    Sleep(10);
     // READ and interpret result
-    status = ctx->dev.pfnFT_ReadPipe(ctx->dev.hFTDI, 0x82, pbRxTx, 0x20000, &cbRxTx, NULL);
-    if(status) { goto fail; }
     ZeroMemory(pb, cb);
-    for(i = 0; i < cbRxTx; i += 32) {
-        while(*(PDWORD)(pbRxTx + i) == 0x55556666) { // skip over ftdi workaround dummy fillers
-            i += 4;
-            if(i + 32 > cbRxTx) { goto fail; }
-        }
-        dwStatus = *(PDWORD)(pbRxTx + i);
-        pdwData = (PDWORD)(pbRxTx + i + 4);
-        if((dwStatus & 0xf0000000) != 0xe0000000) { continue; }
-        for(j = 0; j < 7; j++) {
-            f = (dwStatus & 0x0f) == (flags & 0x03);
-            dwData = *pdwData;
-            pdwData++;                              // move ptr to next data
-            dwStatus >>= 4;                         // move to next status
-            if(!f) { continue; }                    // status src flags does not match source
-            wAddr = _byteswap_ushort((WORD)dwData);
-            wAddr -= (flags & 0xC000) + wBaseAddr;  // adjust for base address and read-write config memory
-            if(wAddr == 0xffff) {   // 1st unaligned byte
-                *pb = (dwData >> 24) & 0xff;
-            }
-            if(wAddr >= cb) { continue; }           // address read is out of range
-            if(wAddr == cb - 1) {   // last byte
-                *(PBYTE)(pb + wAddr) = (dwData >> 16) & 0xff;
-            } else {                // normal two-bytes
-                *(PWORD)(pb + wAddr) = (dwData >> 16) & 0xffff;
-            }
-        }
-    }
-    fReturn = TRUE;
+    fReturn = DeviceFPGA_CmdTransaction(ctx, pbTx, cbTx, cbTx / 8, DeviceFPGA_ConfigRead_ReplyCB, &ctxRd);
 fail:
-    LocalFree(pbRxTx);
+    LocalFree(pbTx);
     return fReturn;
 }
 
@@ -1364,6 +2181,32 @@ BOOL DeviceFPGA_ConfigWrite(_In_ PDEVICE_CONTEXT_FPGA ctx, _In_ WORD wBaseAddr,
     return TRUE;
 }
 
+typedef struct tdFPGA_PCIECFGSPACEREAD_CONTEXT {
+    PBYTE pb;
+    WORD wAddr;
+} FPGA_PCIECFGSPACEREAD_CONTEXT, *PFPGA_PCIECFGSPACEREAD_CONTEXT;
+
+BOOL DeviceFPGA_PCIeCfgSpaceCoreRead_ReplyCB(_Inout_opt_ PVOID ctxReplyCB, _In_ BYTE bSrc, _In_ DWORD dwData)
+{
+    PFPGA_PCIECFGSPACEREAD_CONTEXT ctxRd = (PFPGA_PCIECFGSPACEREAD_CONTEXT)ctxReplyCB;
+    BYTE oAddr;
+    if(bSrc != 0x01) { return FALSE; }          // status src flags does not match source
+    if((dwData & 0x0000ffff) == 0x00002a00) {
+        if(dwData & 0x08000000) {
+            ctxRd->wAddr = ((dwData >> 16) & 0x03ff) << 2;
+        }
+        return TRUE;
+    }
+    oAddr = (BYTE)(dwData >> 8);
+    if((oAddr != 0x2c) && (oAddr != 0x2e)) { return FALSE; }
+    oAddr -= 0x2c;
+    if(ctxRd->wAddr + oAddr + 1 < 0x200) {
+        *(PBYTE)(ctxRd->pb + ctxRd->wAddr + oAddr + 1) = (dwData >> 24) & 0xff;
+        *(PBYTE)(ctxRd->pb + ctxRd->wAddr + oAddr + 0) = (dwData >> 16) & 0xff;
+    }
+    return TRUE;
+}
+
 /*
 * Read from the device PCIe configuration space. Only the values used by the
 * xilinx ip core itself is read. Custom "shadow" user-provided configuration
@@ -1385,11 +2228,11 @@ BOOL DeviceFPGA_PCIeCfgSpaceCoreRead(_In_ PDEVICE_CONTEXT_FPGA ctx, _Out_writes_
     BYTE pbTxResultMeta[]   = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x2a, 0x11, 0x77 };
     BYTE pbTxResultDataLo[] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x2c, 0x11, 0x77 };
     BYTE pbTxResultDataHi[] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x2e, 0x11, 0x77 };
-    BOOL f;
-    BYTE oAddr, pbRxTx[0x1000];
-    DWORD i, j, status, dwStatus, dwData, cbRxTx;
-    PDWORD pdwData;
-    WORD wDWordAddr, oDWord, wAddr = 0;
+    BYTE pbRxTx[0x1000];
+    DWORD i, cbRxTx;
+    QWORD cTimeout;
+    WORD wDWordAddr, oDWord;
+    FPGA_PCIECFGSPACEREAD_CONTEXT ctxRd = { .pb = pb, .wAddr = 0 };
     ZeroMemory(pb, 0x200);
     for(wDWordAddr = 0; wDWordAddr < 0x80; wDWordAddr += 32) {  // 0x80 * sizeof(DWORD) == 0x200
         cbRxTx = 0;
@@ -1419,38 +2262,12 @@ BOOL DeviceFPGA_PCIeCfgSpaceCoreRead(_In_ PDEVICE_CONTEXT_FPGA ctx, _Out_writes_
             memcpy(pbRxTx + cbRxTx, pbTxLockDisable, 8); cbRxTx += 8;   // disable read/write lock (instruction serialization)
             if(raSingleDW) { break; }
         }
-        // WRITE TxData
-        status = ctx->dev.pfnFT_WritePipe(ctx->dev.hFTDI, 0x02, pbRxTx, cbRxTx, &cbRxTx, NULL);
-        if(status) { return FALSE; }
-        Sleep(10);
-        // READ and interpret result
-        status = ctx->dev.pfnFT_ReadPipe(ctx->dev.hFTDI, 0x82, pbRxTx, 0x1000, &cbRxTx, NULL);
-        if(status) { return FALSE; }
-        for(i = 0; i < cbRxTx; i += 32) {
-            while(*(PDWORD)(pbRxTx + i) == 0x55556666) { // skip over ftdi workaround dummy fillers
-                i += 4;
-                if(i + 32 > cbRxTx) { return FALSE; }
-            }
-            dwStatus = *(PDWORD)(pbRxTx + i);
-            pdwData = (PDWORD)(pbRxTx + i + 4);
-            if((dwStatus & 0xf0000000) != 0xe0000000) { continue; }
-            for(j = 0; j < 7; j++) {
-                f = (dwStatus & 0x0f) == 0x01;
-                dwData = *pdwData;
-                pdwData++;                              // move ptr to next data
-                dwStatus >>= 4;                         // move to next status
-                if(!f) { continue; }                    // status src flags does not match source
-                if((dwData & 0x0800ffff) == 0x08002a00) {
-                    wAddr = ((dwData >> 16) & 0x03ff) << 2;
-                    continue;
-                }
-                oAddr = (BYTE)(dwData >> 8);
-                if((oAddr != 0x2c) && (oAddr != 0x2e)) { continue; }
-                oAddr -= 0x2c;
-                if(wAddr + oAddr + 1 >= 0x200) { continue; }
-                *(PBYTE)(pb + wAddr + oAddr + 1) = (dwData >> 24) & 0xff;
-                *(PBYTE)(pb + wAddr + oAddr + 0) = (dwData >> 16) & 0xff;
-            }
+        // WRITE TxData and READ and interpret result
+        // NB! missing replies (timeout) leave the affected bytes zero and are
+        //     not an error - only a failed device read/write is.
+        cTimeout = ctx->cmd.cTimeout;
+        if(!DeviceFPGA_CmdTransaction(ctx, pbRxTx, cbRxTx, raSingleDW ? 3 : 32 * 3, DeviceFPGA_PCIeCfgSpaceCoreRead_ReplyCB, &ctxRd) && (cTimeout == ctx->cmd.cTimeout)) {
+            return FALSE;
         }
         if(raSingleDW) { break; }
     }
@@ -1475,6 +2292,28 @@ BOOL DeviceFPGA_PCIeCfgSpaceCoreReadDWORD(_In_ PDEVICE_CONTEXT_FPGA ctx, _In_ DW
     return TRUE;
 }
 
+/*
+* Enable or disable learning of address ranges requiring the tiny read
+* algorithm. Only the async2 read algorithm selects the read algorithm per
+* address range. Ranges already learned remain in use if learning is disabled.
+* -- ctxLC
+* -- ctx
+* -- fLearn
+* -- return
+*/
+_Success_(return)
+BOOL DeviceFPGA_TinyMap_SetLearn(_In_ PLC_CONTEXT ctxLC, _In_ PDEVICE_CONTEXT_FPGA ctx, _In_ BOOL fLearn)
+{
+    if(!fLearn) {
+        ctx->tinymap.fLearn = FALSE;
+        return TRUE;
+    }
+    if(!ctx->async2.fEnabled || !ctx->async2.fNewAsync) { return FALSE; }
+    if(!ctx->tinymap.pRanges && !(ctx->tinymap.pRanges = LocalAlloc(LMEM_ZEROINIT, FPGA_TINYMAP_MAX * sizeof(FPGA_TINYMAP_RANGE)))) { return FALSE; }
+    ctx->tinymap.fLearn = TRUE;
+    return TRUE;
+}
+
 /*
 * Write a single DWORD from the device PCIe configuration space controlled by
 * the Xilinx PCIe IP core.
@@ -1899,285 +2738,811 @@ VOID DeviceFPGA_SetPerformanceProfile(_Inout_ PDEVICE_CONTEXT_FPGA ctx)
 
 // Custom Read/Write functionality below:
 
+typedef struct tdFPGA_CUSTOMREAD_CONTEXT {
+    WORD wValues[0x100];
+    BYTE fValid[0x100];
+    BYTE fRequested[0x100];
+} FPGA_CUSTOMREAD_CONTEXT, *PFPGA_CUSTOMREAD_CONTEXT;
+
 /*
-* Read the custom test register value from FPGA.
-* -- ctx
-* -- pdwValue = pointer to receive the register value
-* -- return
+* Receive custom register read replies. Only the first reply for an address
+* requested by this transaction counts - duplicate, unrequested and stale
+* replies (left over from an earlier timed out transaction) are ignored.
 */
-_Success_(return)
-BOOL DeviceFPGA_CustomRead(_In_ PDEVICE_CONTEXT_FPGA ctx, _In_ BYTE regNum, _Out_ PDWORD pdwValue)
+BOOL DeviceFPGA_CustomRead_ReplyCB(_Inout_opt_ PVOID ctxReplyCB, _In_ BYTE bSrc, _In_ DWORD dwData)
 {
-    DWORD status, cbTX, cbRX, i, j;
-    BYTE pbRX[0x1000];
-    BYTE addr_low, addr_high;
-    WORD wAddr, wValueLo = 0, wValueHi = 0;
-    
-    // Parameter validation
-    if(regNum >= 128) { return FALSE; }
-    
-    // Calculate register addresses using unified addressing structure
-    // Register N: Address 2N+0 (low 16 bits), Address 2N+1 (high 16 bits)
-    addr_low = (regNum << 1) | 0;      // Low 16 bits address
-    addr_high = (regNum << 1) | 1;     // High 16 bits address
-    
-    BYTE pbTX[] = {
-        // Read low 16 bits
-        0x00, 0x00, 0x00, 0x00,  0x00, addr_low, FPGA_CMD_CUSTOM_READ_BYTE, 0x77,
-        // Read high 16 bits
-        0x00, 0x00, 0x00, 0x00,  0x00, addr_high, FPGA_CMD_CUSTOM_READ_BYTE, 0x77
-    };
-    DWORD dwStatus, dwData;
-    PDWORD pdwData;
-    
-    *pdwValue = 0;
-    
-    // Write command to device
-    status = ctx->dev.pfnFT_WritePipe(ctx->dev.hFTDI, 0x02, pbTX, sizeof(pbTX), &cbTX, NULL);
-    if(status) { return FALSE; }
-    Sleep(10);
-    
-    // Read response from device
-    status = ctx->dev.pfnFT_ReadPipe(ctx->dev.hFTDI, 0x82, pbRX, sizeof(pbRX), &cbRX, NULL);
-    if(status) { return FALSE; }
-    
-    // Parse response
-    for(i = 0; i < cbRX; i += 32) {
-        while(*(PDWORD)(pbRX + i) == 0x55556666) { // skip over ftdi workaround dummy fillers
-            i += 4;
-            if(i + 32 > cbRX) { return FALSE; }
-        }
-        dwStatus = *(PDWORD)(pbRX + i);
-        pdwData = (PDWORD)(pbRX + i + 4);
-        if((dwStatus & 0xf0000000) != 0xe0000000) { continue; }
-        for(j = 0; j < 7; j++) {
-            dwData = *pdwData;
-            if((dwStatus & 0x03) == 0x03) { // CFG REPLY
-                wAddr = _byteswap_ushort((WORD)dwData);
-                if(wAddr == addr_low) {
-                    wValueLo = _byteswap_ushort((WORD)(dwData >> 16));
-                } else if(wAddr == addr_high) {
-                    wValueHi = _byteswap_ushort((WORD)(dwData >> 16));
-                }
-            }
-            pdwData++;
-            dwStatus >>= 4;
-        }
-    }
-    
-    *pdwValue = ((DWORD)wValueHi << 16) | wValueLo;
+    PFPGA_CUSTOMREAD_CONTEXT ctxRd = (PFPGA_CUSTOMREAD_CONTEXT)ctxReplyCB;
+    WORD wAddr;
+    if(bSrc != 0x03) { return FALSE; }             // CMD REPLY
+    wAddr = _byteswap_ushort((WORD)dwData);
+    if((wAddr >= 0x100) || !ctxRd->fRequested[wAddr] || ctxRd->fValid[wAddr]) { return FALSE; }
+    ctxRd->wValues[wAddr] = _byteswap_ushort((WORD)(dwData >> 16));
+    ctxRd->fValid[wAddr] = 1;
     return TRUE;
 }
 
+typedef struct tdFPGA_CUSTOMBURST_CONTEXT {
+    DWORD dwValues[FPGA_CUSTOM_BURST_REG_MAX];
+    BYTE fValid[FPGA_CUSTOM_BURST_REG_MAX];
+    DWORD iReg;
+    DWORD cRemaining;
+} FPGA_CUSTOMBURST_CONTEXT, *PFPGA_CUSTOMBURST_CONTEXT;
+
+BOOL DeviceFPGA_CustomReadBurst_ReplyCB(_Inout_opt_ PVOID ctxReplyCB, _In_ BYTE bSrc, _In_ DWORD dwData)
+{
+    PFPGA_CUSTOMBURST_CONTEXT ctxRd = (PFPGA_CUSTOMBURST_CONTEXT)ctxReplyCB;
+    WORD wHeader;
+    if(bSrc == 0x03) {                              // BURST HEADER: {start, count}
+        if(_byteswap_ushort((WORD)dwData) != FPGA_CUSTOM_BURST_HEADER) { return FALSE; }
+        wHeader = _byteswap_ushort((WORD)(dwData >> 16));
+        ctxRd->iReg = (wHeader >> 8) & 0x3f;
+        ctxRd->cRemaining = wHeader & 0x7f;
+        return TRUE;
+    }
+    if((bSrc == 0x07) && ctxRd->cRemaining && (ctxRd->iReg < FPGA_CUSTOM_BURST_REG_MAX)) {
+        ctxRd->dwValues[ctxRd->iReg] = _byteswap_ulong(dwData);
+        ctxRd->fValid[ctxRd->iReg] = 1;
+        ctxRd->iReg++;
+        ctxRd->cRemaining--;
+        return TRUE;
+    }
+    return FALSE;
+}
+
 /*
-* Write a value to the custom test register in FPGA.
+* Read custom registers with a single burst read command. The FPGA replies with
+* a header followed by the full 32-bit values of the register range spanned by
+* the requested registers. Only firmware registers (0-63) may be burst read.
 * -- ctx
-* -- dwValue = value to write to the register
-* -- return
+* -- cReg = number of registers to read.
+* -- pbRegs = register numbers to read.
+* -- pdwValues = buffer to receive cReg register values.
+* -- return = TRUE if all requested registers were received.
 */
 _Success_(return)
-BOOL DeviceFPGA_CustomWrite(_In_ PDEVICE_CONTEXT_FPGA ctx, _In_ BYTE regNum, _In_ DWORD dwValue)
+BOOL DeviceFPGA_CustomReadBurst(_In_ PDEVICE_CONTEXT_FPGA ctx, _In_ DWORD cReg, _In_reads_(cReg) PBYTE pbRegs, _Out_writes_(cReg) PDWORD pdwValues)
 {
-    DEBUG_PRINT("CustomWrite: regNum=%d, dwValue=0x%08X\n", regNum, dwValue);
-    
-    DWORD status, cbTX;
-    BYTE addr_low, addr_high;
-    
-    // Parameter validation
-    if(regNum >= 128) { return FALSE; }
-    
-    // Calculate register addresses using unified addressing structure
-    // Register N: Address 2N+0 (low 16 bits), Address 2N+1 (high 16 bits)
-    addr_low = (regNum << 1) | 0;      // Low 16 bits address
-    addr_high = (regNum << 1) | 1;     // High 16 bits address
-    
-    DEBUG_PRINT("CustomWrite: addr_low=0x%02X, addr_high=0x%02X\n", addr_low, addr_high);
-    
-    BYTE pbTX[] = {
-        // Write low 16 bits
-        (BYTE)(dwValue & 0xFF),         // DATA low byte
-        (BYTE)((dwValue >> 8) & 0xFF),  // DATA high byte  
-        0xFF, 0xFF,                     // MASK
-        0x00, addr_low,                 // Address for low 16 bits
-        FPGA_CMD_CUSTOM_WRITE_BYTE, 0x77,  // 写命令: (0x08<<4)|0x03=0x83, 魔数0x77
-        // Write high 16 bits
-        (BYTE)((dwValue >> 16) & 0xFF), // DATA low byte
-        (BYTE)((dwValue >> 24) & 0xFF), // DATA high byte
-        0xFF, 0xFF,                     // MASK
-        0x00, addr_high,                // Address for high 16 bits
-        FPGA_CMD_CUSTOM_WRITE_BYTE, 0x77   // 写命令: (0x08<<4)|0x03=0x83, 魔数0x77
-    };
-    
-#if CUSTOM_REG_DEBUG
-    DEBUG_PRINT("CustomWrite: sending data packets:\n");
-    for(int i = 0; i < 16; i += 8) {
-        DEBUG_PRINT("  packet%d: %02X %02X %02X %02X %02X %02X %02X %02X\n", 
-                   (i/8 + 1), pbTX[i], pbTX[i+1], pbTX[i+2], pbTX[i+3], 
-                   pbTX[i+4], pbTX[i+5], pbTX[i+6], pbTX[i+7]);
+    BYTE pbTx[8] = { 0 };
+    DWORD i, iMin = FPGA_CUSTOM_BURST_REG_MAX, iMax = 0;
+    FPGA_CUSTOMBURST_CONTEXT ctxRd = { 0 };
+    for(i = 0; i < cReg; i++) {
+        if(pbRegs[i] >= FPGA_CUSTOM_BURST_REG_MAX) { return FALSE; }
+        iMin = min(iMin, pbRegs[i]);
+        iMax = max(iMax, pbRegs[i]);
+    }
+    pbTx[0] = (BYTE)(iMax - iMin + 1);              // count
+    pbTx[5] = (BYTE)iMin;                           // start register
+    pbTx[6] = FPGA_CMD_CUSTOM_BURST_BYTE;
+    pbTx[7] = 0x77;
+    if(!DeviceFPGA_CmdTransaction(ctx, pbTx, sizeof(pbTx), 1 + pbTx[0], DeviceFPGA_CustomReadBurst_ReplyCB, &ctxRd)) {
+        return FALSE;
+    }
+    for(i = 0; i < cReg; i++) {
+        if(!ctxRd.fValid[pbRegs[i]]) { return FALSE; }
+        pdwValues[i] = ctxRd.dwValues[pbRegs[i]];
     }
-#endif
-    
-    // Write command to device
-    status = ctx->dev.pfnFT_WritePipe(ctx->dev.hFTDI, 0x02, pbTX, sizeof(pbTX), &cbTX, NULL);
-    return (status == 0);
+    return TRUE;
 }
 
-
-
-// BAR handling functionality below:
-
 /*
-* Initailize BARs from PCIe config space and DRP registers.
-* NB! This is highly Artix-7 specific!
+* Read multiple custom registers from the FPGA in one batch. If supported by
+* the bitstream a single burst read is used. Otherwise all low/high half read
+* requests are packed into a single write and the CMD replies are
+* demultiplexed by register address as they arrive. Burst read support is
+* probed on first use.
+* -- ctx
+* -- cReg = number of registers to read (max FPGA_CUSTOM_REG_MAX).
+* -- pbRegs = register numbers to read.
+* -- pdwValues = buffer to receive cReg register values.
+* -- return = TRUE if replies for all requested registers were received.
 */
 _Success_(return)
-BOOL DeviceFPGA_Bar_Initialize(_In_ PLC_CONTEXT ctxLC, _In_ PDEVICE_CONTEXT_FPGA ctx)
+BOOL DeviceFPGA_CustomReadBulk(_In_ PDEVICE_CONTEXT_FPGA ctx, _In_ DWORD cReg, _In_reads_(cReg) PBYTE pbRegs, _Out_writes_(cReg) PDWORD pdwValues)
 {
-    BOOL fBAR = FALSE;
-    QWORD qwBarSize;
-    DWORD dwBarSize;
-    PWORD pwDrpBar;
-    SIZE_T i;
-    BYTE pbDRP[0x100], pbBAR[24] = { 0 };
-    PLC_BAR pBar;
-    ctx->tlp_callback.fBarInit = FALSE;
-    ZeroMemory(&ctx->tlp_callback.Bar, sizeof(ctx->tlp_callback.Bar));
-    for(i = 0; i < 6; i++) {
-        if(!DeviceFPGA_PCIeCfgSpaceCoreReadDWORD(ctx, (DWORD)(0x10 + i * 4), (PDWORD)(pbBAR + i * 4))) { return FALSE; }
-    }
-    if(!DeviceFPGA_PCIeDrpRead(ctx, pbDRP)) { return FALSE; }
-    for(i = 0; i < 12; i++) {
-        pwDrpBar = (PWORD)(pbDRP + 14 + i * 2);
-        *pwDrpBar = _byteswap_ushort(*pwDrpBar);
-    }
-    if(!memcmp(pbBAR, pbDRP + 14, 24)) { return FALSE; }    // BAR memory addresses are not yet configured.
-    for(i = 0; i < 6; i++) {
-        pBar = &ctx->tlp_callback.Bar[i];
-        pBar->iBar = (DWORD)i;
-        dwBarSize = *(PDWORD)(pbDRP + 14 + i * 4);
-        // IO BAR: IO BARs are not memory mapped and are treated differently here:
-        if(dwBarSize & 1) {
-            pBar->fIO = TRUE;
-            pBar->pa = *(PDWORD)(pbBAR + i * 4) - 1;
-            dwBarSize = ((dwBarSize & ~0x01) ^ 0xFFFFFFFF) + 1;
-            pBar->cb = dwBarSize;
-            if(!pBar->pa || !pBar->cb) { continue; }
-            if((pBar->pa >= 0x10000) || (pBar->cb >= 0x10000)) { return FALSE; }    // IO BARs must be < 64KB in size and address
-            pBar->fValid = TRUE;
-            fBAR = TRUE;
-            continue;
+    BOOL fReturn = FALSE, fBurst = TRUE;
+    BYTE pbTx[FPGA_CUSTOM_REG_MAX * 2 * 8] = { 0 };
+    DWORD i, j, cbTx = 0, cReply = 0;
+    WORD wAddr;
+    PFPGA_CUSTOMREAD_CONTEXT ctxRd = NULL;
+    if(!cReg || (cReg > FPGA_CUSTOM_REG_MAX)) { return FALSE; }
+    ZeroMemory(pdwValues, cReg * sizeof(DWORD));
+    for(i = 0; i < cReg; i++) {
+        if(pbRegs[i] >= FPGA_CUSTOM_REG_MAX) { return FALSE; }
+        fBurst = fBurst && (pbRegs[i] < FPGA_CUSTOM_BURST_REG_MAX);
+    }
+    // BURST read (if supported):
+    if(fBurst && (!ctx->cmd.fCustomBurstProbed || ctx->cmd.fCustomBurst)) {
+        if(DeviceFPGA_CustomReadBurst(ctx, cReg, pbRegs, pdwValues)) {
+            ctx->cmd.fCustomBurstProbed = TRUE;
+            ctx->cmd.fCustomBurst = TRUE;
+            return TRUE;
         }
-        // Memory BAR:
-        if(dwBarSize & 8) {
-            if(i % 2) { return FALSE; }                     // 64-bit prefetchable BARs not allowed in odd BARs
-            pBar->fPrefetchable = TRUE;
+        if(!ctx->cmd.fCustomBurstProbed) {
+            ctx->cmd.fCustomBurstProbed = TRUE;
+            DEBUG_PRINT("CustomReadBulk: burst read not supported by bitstream\n");
         }
-        if(dwBarSize & 4) {
-            if(i % 2) { return FALSE; }                     // 64-bit BARs not allowed in odd BARs
-            pBar->f64Bit = TRUE;
-            qwBarSize = *(PQWORD)(pbDRP + 14 + i * 4) & ~0xF;
-            qwBarSize = (qwBarSize ^ 0xFFFFFFFFFFFFFFFF) + 1;
-            if(qwBarSize >= 0x8000000000000000) { return FALSE; }   // BAR too large.
-            pBar->cb = qwBarSize;
-        } else {
-            dwBarSize = *(PDWORD)(pbDRP + 14 + i * 4) & ~0xF;
-            dwBarSize = (dwBarSize ^ 0xFFFFFFFF) + 1;
-            if(dwBarSize >= 0x80000000) { return FALSE; }           // BAR too large.
-            pBar->cb = dwBarSize;
+    }
+    if(!(ctxRd = LocalAlloc(LMEM_ZEROINIT, sizeof(FPGA_CUSTOMREAD_CONTEXT)))) { goto fail; }
+    // WRITE requests - register N: address 2N (low 16 bits) and 2N+1 (high 16 bits)
+    for(i = 0; i < cReg; i++) {
+        for(j = 0; j < 2; j++) {
+            wAddr = (pbRegs[i] << 1) | j;
+            if(ctxRd->fRequested[wAddr]) { continue; }     // duplicate register
+            ctxRd->fRequested[wAddr] = 1;
+            pbTx[cbTx + 5] = (BYTE)wAddr;
+            pbTx[cbTx + 6] = FPGA_CMD_CUSTOM_READ_BYTE;
+            pbTx[cbTx + 7] = 0x77;
+            cbTx += 8;
+            cReply++;
         }
-        if(!pBar->cb) { continue; }
-        if(pBar->cb & 0x7f) { return FALSE; }               // BAR size must be 128-byte chunked.
-        if(pBar->f64Bit) {
-            pBar->pa = *(PQWORD)(pbBAR + i * 4);
-            if(pBar->fPrefetchable) { pBar->pa -= 8; }
-            pBar->pa -= 4;
-            i++;
-        } else {
-            pBar->pa = *(PDWORD)(pbBAR + i * 4);
+    }
+    // READ and demultiplex CMD replies by register address
+    fReturn = DeviceFPGA_CmdTransaction(ctx, pbTx, cbTx, cReply, DeviceFPGA_CustomRead_ReplyCB, ctxRd);
+    for(i = 0; i < cReg; i++) {
+        wAddr = pbRegs[i] << 1;
+        pdwValues[i] = ((DWORD)ctxRd->wValues[wAddr + 1] << 16) | ctxRd->wValues[wAddr];
+        if(!ctxRd->fValid[wAddr] || !ctxRd->fValid[wAddr + 1]) {
+            DEBUG_PRINT("CustomReadBulk: no reply for register %d\n", pbRegs[i]);
+            fReturn = FALSE;
         }
-        if(!pBar->pa) { continue; }
-        if(pBar->pa & 0x7F) { return FALSE; }               // BARs must be 128-byte aligned.
-        pBar->fValid = TRUE;
-        fBAR = TRUE;
     }
-    for(i = 0; i < 6; i++) {
-        ctx->tlp_callback.Bar[i].iBar = (DWORD)i;
+fail:
+    LocalFree(ctxRd);
+    return fReturn;
+}
+
+/*
+* Initialize the custom register shadow policies according to the firmware
+* register map: 0-23 are general purpose host-owned registers, 24-25 hold the
+* immutable FPGA DNA and 26-31 are updated by the DNA verification logic.
+* Performance counter registers 32-47 are volatile.
+* -- ctx
+*/
+VOID DeviceFPGA_CustomShadow_Initialize(_In_ PDEVICE_CONTEXT_FPGA ctx)
+{
+    DWORD i;
+    ZeroMemory(&ctx->shadow, sizeof(ctx->shadow));
+    for(i = 0; i < 24; i++) {
+        ctx->shadow.bPolicy[i] = FPGA_CUSTOM_REG_POLICY_WRITETHROUGH;
     }
-    ctx->tlp_callback.fBarInit = fBAR;
-    return fBAR;
+    ctx->shadow.bPolicy[24] = FPGA_CUSTOM_REG_POLICY_IMMUTABLE;
+    ctx->shadow.bPolicy[25] = FPGA_CUSTOM_REG_POLICY_IMMUTABLE;
 }
 
 /*
-* Reply with a Cpl/CplD TLP as a reply to a BAR MRd request.
+* Read custom registers through the shadow register file. Valid shadow values
+* of cacheable registers are served from memory; remaining registers are read
+* from the FPGA in one bulk transaction and cacheable values are retained.
+* -- ctx
+* -- cReg = number of registers to read (max FPGA_CUSTOM_REG_MAX).
+* -- pbRegs = register numbers to read.
+* -- pdwValues = buffer to receive cReg register values.
+* -- return
 */
-VOID DeviceFPGA_Bar_TxTlp(_In_ PLC_CONTEXT ctxLC, _In_ PDEVICE_CONTEXT_FPGA ctx, _In_ PTLP_HDR_MRdWr32 pMRd, _In_ PLC_BAR_REQUEST prq)
+_Success_(return)
+BOOL DeviceFPGA_CustomShadow_Read(_In_ PDEVICE_CONTEXT_FPGA ctx, _In_ DWORD cReg, _In_reads_(cReg) PBYTE pbRegs, _Out_writes_(cReg) PDWORD pdwValues)
 {
-    QWORD pa;
-    DWORD cb, cbtx;
-    PBYTE pb;
-    TLP_HDR_CplD_128 cpl = { 0 };
-    // no read reply -> unsupported request (Cpl/UR)
-    if(!prq->fReadReply) {
-        ZeroMemory(&cpl, 12);
-        cpl.h.TypeFmt = TLP_Cpl;
-        cpl.CompleterID = ctx->wDeviceId;
-        cpl.Tag = pMRd->Tag;
-        cpl.RequesterID = pMRd->RequesterID;
-        cpl.ByteCount = 4;
-        cpl.Status = 1; // UR
-        *((PDWORD)&cpl + 0) = _byteswap_ulong(*((PDWORD)&cpl + 0));
-        *((PDWORD)&cpl + 1) = _byteswap_ulong(*((PDWORD)&cpl + 1));
-        *((PDWORD)&cpl + 2) = _byteswap_ulong(*((PDWORD)&cpl + 2));
-        ObByteQueue_Push(ctx->tlp_callback.pBqTx, 0, 12, (PBYTE)&cpl);
-        return;
+    BYTE r, pbMiss[FPGA_CUSTOM_REG_MAX];
+    DWORD i, cMiss = 0, dwMiss[FPGA_CUSTOM_REG_MAX], dwFetched[FPGA_CUSTOM_REG_MAX];
+    BYTE fMiss[FPGA_CUSTOM_REG_MAX] = { 0 };
+    if(!cReg || (cReg > FPGA_CUSTOM_REG_MAX)) { return FALSE; }
+    for(i = 0; i < cReg; i++) {
+        r = pbRegs[i];
+        if(r >= FPGA_CUSTOM_REG_MAX) { return FALSE; }
+        if(ctx->shadow.bPolicy[r] && ctx->shadow.fValid[r]) { continue; }
+        if(fMiss[r]) { continue; }
+        fMiss[r] = 1;
+        pbMiss[cMiss++] = r;
+    }
+    if(cMiss) {
+        if(!DeviceFPGA_CustomReadBulk(ctx, cMiss, pbMiss, dwMiss)) { return FALSE; }
+        for(i = 0; i < cMiss; i++) {
+            r = pbMiss[i];
+            dwFetched[r] = dwMiss[i];
+            if(ctx->shadow.bPolicy[r]) {
+                ctx->shadow.dwValue[r] = dwMiss[i];
+                ctx->shadow.fValid[r] = 1;
+            }
+        }
     }
-    // normal read reply (CplD/SR)
-    pa = prq->pBar->pa + prq->oData;
-    pb = prq->pbData;
-    cb = prq->cbData;
-    // TX as 128-byte packets (aligned to 128-byte boundaries)
-    while(cb) {
-        cbtx = min(128 - (pa & 0x7f), cb);
-        ZeroMemory(&cpl, 12);
-        cpl.h.TypeFmt = TLP_CplD;
-        cpl.CompleterID = ctx->wDeviceId;
-        cpl.Tag = pMRd->Tag;
-        cpl.RequesterID = pMRd->RequesterID;
-        cpl.LowerAddress = (BYTE)pa;
-        cpl.Status = 0; // SC
-        cpl.h.Length = (WORD)(cbtx >> 2);
-        cpl.ByteCount = (WORD)cb;
-        *((PDWORD)&cpl + 0) = _byteswap_ulong(*((PDWORD)&cpl + 0));
-        *((PDWORD)&cpl + 1) = _byteswap_ulong(*((PDWORD)&cpl + 1));
-        *((PDWORD)&cpl + 2) = _byteswap_ulong(*((PDWORD)&cpl + 2));
-        memcpy(cpl.pb128, prq->pbData, cbtx);
-        ObByteQueue_Push(ctx->tlp_callback.pBqTx, 0, (SIZE_T)12 + cbtx, (PBYTE)&cpl);
-        pb += cbtx;
-        cb -= cbtx;
-        pa += cbtx;
+    for(i = 0; i < cReg; i++) {
+        r = pbRegs[i];
+        pdwValues[i] = ctx->shadow.bPolicy[r] ? ctx->shadow.dwValue[r] : dwFetched[r];
     }
+    return TRUE;
 }
 
 /*
-* Receive a TLP that may or may not be a MRd/MWr towards a BAR.
-* If TLP is a BAR access - handle it!
+* Update the shadow register file after custom register writes. Host-owned
+* registers are updated in place; immutable registers are invalidated since
+* a write to them indicates the shadow may no longer be trusted.
+* -- ctx
+* -- cEntries
+* -- pEntries
+* -- fSuccess = TRUE if the writes reached the FPGA.
 */
-VOID DeviceFPGA_Bar_RxTlp(_In_ PLC_CONTEXT ctxLC, _In_ PDEVICE_CONTEXT_FPGA ctx, PBYTE pbTlp, DWORD cbTlp)
+VOID DeviceFPGA_CustomShadow_Write(_In_ PDEVICE_CONTEXT_FPGA ctx, _In_ DWORD cEntries, _In_reads_(cEntries) PFPGA_CUSTOM_WRITE_ENTRY pEntries, _In_ BOOL fSuccess)
 {
-    QWORD qwTlpAddr, qwTlpSize;
-    PLC_BAR pBar;
-    LC_BAR_REQUEST rq;
-    DWORD i, hdrDwBuf[4];
-    PTLP_HDR hdr = (PTLP_HDR)hdrDwBuf;
-    PTLP_HDR_MRdWr32 hdrM32 = (PTLP_HDR_MRdWr32)hdrDwBuf;
-    PTLP_HDR_MRdWr64 hdrM64 = (PTLP_HDR_MRdWr64)hdrDwBuf;
-    // 1: initial checks and header parse:
-    if((cbTlp < 12) || (pbTlp[0] & 0x9c) || (cbTlp & 3)) { return; }   // TLP fast fail if not MRd/MWr/IORd/IOWr
-    hdrDwBuf[0] = _byteswap_ulong(*(PDWORD)(pbTlp + 0));
-    hdrDwBuf[1] = _byteswap_ulong(*(PDWORD)(pbTlp + 4));
-    hdrDwBuf[2] = _byteswap_ulong(*(PDWORD)(pbTlp + 8));
-    if(cbTlp >= 16) {
-        hdrDwBuf[3] = _byteswap_ulong(*(PDWORD)(pbTlp + 12));
+    DWORD i, r;
+    for(i = 0; i < cEntries; i++) {
+        r = pEntries[i].dwReg;
+        if(!fSuccess || (ctx->shadow.bPolicy[r] != FPGA_CUSTOM_REG_POLICY_WRITETHROUGH)) {
+            ctx->shadow.fValid[r] = 0;
+        } else if(ctx->shadow.fValid[r]) {
+            ctx->shadow.dwValue[r] = (ctx->shadow.dwValue[r] & ~pEntries[i].dwMask) | (pEntries[i].dwValue & pEntries[i].dwMask);
+        } else if(pEntries[i].dwMask == 0xffffffff) {
+            ctx->shadow.dwValue[r] = pEntries[i].dwValue;
+            ctx->shadow.fValid[r] = 1;
+        }
+    }
+}
+
+/*
+* Invalidate shadow register values, and optionally re-fetch the cacheable
+* ones from the FPGA.
+* -- ctx
+* -- cReg = number of registers in pbRegs (max FPGA_CUSTOM_REG_MAX), 0 = all registers.
+* -- pbRegs
+* -- fRefresh
+* -- return
+*/
+_Success_(return)
+BOOL DeviceFPGA_CustomShadow_Invalidate(_In_ PDEVICE_CONTEXT_FPGA ctx, _In_ DWORD cReg, _In_reads_opt_(cReg) PBYTE pbRegs, _In_ BOOL fRefresh)
+{
+    BYTE r, pbRefresh[FPGA_CUSTOM_REG_MAX];
+    DWORD i, cRefresh = 0, dwRefresh[FPGA_CUSTOM_REG_MAX];
+    if(cReg > FPGA_CUSTOM_REG_MAX) { return FALSE; }
+    for(i = 0; i < (cReg ? cReg : FPGA_CUSTOM_REG_MAX); i++) {
+        r = cReg ? pbRegs[i] : (BYTE)i;
+        if(r >= FPGA_CUSTOM_REG_MAX) { return FALSE; }
+        ctx->shadow.fValid[r] = 0;
+        if(fRefresh && ctx->shadow.bPolicy[r]) {
+            pbRefresh[cRefresh++] = r;
+        }
+    }
+    return !cRefresh || DeviceFPGA_CustomShadow_Read(ctx, cRefresh, pbRefresh, dwRefresh);
+}
+
+/*
+* Read a custom register value from FPGA.
+* -- ctx
+* -- regNum = register number to read
+* -- pdwValue = pointer to receive the register value
+* -- return
+*/
+_Success_(return)
+BOOL DeviceFPGA_CustomRead(_In_ PDEVICE_CONTEXT_FPGA ctx, _In_ BYTE regNum, _Out_ PDWORD pdwValue)
+{
+    return DeviceFPGA_CustomShadow_Read(ctx, 1, &regNum, pdwValue);
+}
+
+/*
+* Write multiple custom registers in one transfer. Each entry is encoded as a
+* low and a high 16-bit masked write; halves with an all-zero mask are skipped.
+* If fBarrier is set a read of the last written register half is appended and
+* the function waits for its reply - the FPGA processes commands in order so
+* the reply guarantees that all preceding writes have landed. The read back
+* value must match the written bits (except for the perf counter registers
+* whose writes are commands rather than stored values).
+* -- ctx
+* -- cEntries = number of entries (max FPGA_CUSTOM_REG_MAX).
+* -- pEntries
+* -- fBarrier
+* -- return
+*/
+_Success_(return)
+BOOL DeviceFPGA_CustomWriteVector(_In_ PDEVICE_CONTEXT_FPGA ctx, _In_ DWORD cEntries, _In_reads_(cEntries) PFPGA_CUSTOM_WRITE_ENTRY pEntries, _In_ BOOL fBarrier)
+{
+    BOOL fReturn;
+    BYTE pbTx[(FPGA_CUSTOM_REG_MAX * 2 + 1) * 8] = { 0 };
+    DWORD i, j, cbTx = 0;
+    WORD wValue, wMask, wAddrLast = 0, wValueLast = 0, wMaskLast = 0;
+    PFPGA_CUSTOMREAD_CONTEXT ctxRd = NULL;
+    if(!cEntries || (cEntries > FPGA_CUSTOM_REG_MAX)) { return FALSE; }
+    for(i = 0; i < cEntries; i++) {
+        if(pEntries[i].dwReg >= FPGA_CUSTOM_REG_MAX) { return FALSE; }
+    }
+    // WRITE requests - register N: address 2N (low 16 bits) and 2N+1 (high 16 bits)
+    for(i = 0; i < cEntries; i++) {
+        DEBUG_PRINT("CustomWriteVector: reg=%d, value=0x%08X, mask=0x%08X\n", pEntries[i].dwReg, pEntries[i].dwValue, pEntries[i].dwMask);
+        for(j = 0; j < 2; j++) {
+            wValue = (WORD)(pEntries[i].dwValue >> (j * 16));
+            wMask = (WORD)(pEntries[i].dwMask >> (j * 16));
+            if(!wMask) { continue; }
+            pbTx[cbTx + 0] = wValue & 0xff;
+            pbTx[cbTx + 1] = wValue >> 8;
+            pbTx[cbTx + 2] = wMask & 0xff;
+            pbTx[cbTx + 3] = wMask >> 8;
+            pbTx[cbTx + 5] = (BYTE)((pEntries[i].dwReg << 1) | j);
+            pbTx[cbTx + 6] = FPGA_CMD_CUSTOM_WRITE_BYTE;
+            pbTx[cbTx + 7] = 0x77;
+            cbTx += 8;
+            wAddrLast = (WORD)((pEntries[i].dwReg << 1) | j);
+            wValueLast = wValue;
+            wMaskLast = (pEntries[i].dwReg < FPGA_PERF_REG_BASE) ? wMask : 0;
+        }
+    }
+    if(!fBarrier || !cbTx) {
+        fReturn = !cbTx || DeviceFPGA_CmdWrite(ctx, pbTx, cbTx);
+        DeviceFPGA_CustomShadow_Write(ctx, cEntries, pEntries, fReturn);
+        return fReturn;
+    }
+    // READ barrier - read back the last written register half
+    pbTx[cbTx + 5] = (BYTE)wAddrLast;
+    pbTx[cbTx + 6] = FPGA_CMD_CUSTOM_READ_BYTE;
+    pbTx[cbTx + 7] = 0x77;
+    cbTx += 8;
+    if(!(ctxRd = LocalAlloc(LMEM_ZEROINIT, sizeof(FPGA_CUSTOMREAD_CONTEXT)))) {
+        DeviceFPGA_CustomShadow_Write(ctx, cEntries, pEntries, FALSE);
+        return FALSE;
+    }
+    ctxRd->fRequested[wAddrLast] = 1;
+    fReturn = DeviceFPGA_CmdTransaction(ctx, pbTx, cbTx, 1, DeviceFPGA_CustomRead_ReplyCB, ctxRd);
+    fReturn = fReturn && ((ctxRd->wValues[wAddrLast] & wMaskLast) == (wValueLast & wMaskLast));
+    if(!fReturn) {
+        DEBUG_PRINT("CustomWriteVector: barrier failed: addr=0x%02X, read=0x%04X, written=0x%04X, mask=0x%04X\n", wAddrLast, ctxRd->wValues[wAddrLast], wValueLast, wMaskLast);
+    }
+    DeviceFPGA_CustomShadow_Write(ctx, cEntries, pEntries, fReturn);
+    LocalFree(ctxRd);
+    return fReturn;
+}
+
+/*
+* Write a value to a custom register in FPGA.
+* -- ctx
+* -- regNum = register number to write
+* -- dwValue = value to write to the register
+* -- return
+*/
+_Success_(return)
+BOOL DeviceFPGA_CustomWrite(_In_ PDEVICE_CONTEXT_FPGA ctx, _In_ BYTE regNum, _In_ DWORD dwValue)
+{
+    FPGA_CUSTOM_WRITE_ENTRY e = { .dwReg = regNum, .dwValue = dwValue, .dwMask = 0xffffffff };
+    return DeviceFPGA_CustomWriteVector(ctx, 1, &e, FALSE);
+}
+
+/*
+* Register watch thread. All watched registers are sampled from the FPGA in
+* one bulk transaction per interval - bypassing the shadow so that FPGA-side
+* changes of cached registers are seen - and the user callback is invoked with
+* the registers whose values changed, or without registers if the sample read
+* failed. Cached shadow values are refreshed from the sample. The thread exits
+* once the watch is stopped (also on device close) and then sets its finish
+* event - the stopping thread waits for it and closes the thread handle.
+* -- ctxLC
+*/
+DWORD DeviceFPGA_CustomWatch_ThreadProc(_In_ PLC_CONTEXT ctxLC)
+{
+    PDEVICE_CONTEXT_FPGA ctx = (PDEVICE_CONTEXT_FPGA)ctxLC->hDevice;
+    BOOL fRead, fBaseline = FALSE;
+    BYTE r;
+    HANDLE hEventFinish;
+    DWORD i, cChange, dwSeq = 0, dwValue[FPGA_CUSTOM_REG_MAX], dwValuePrev[FPGA_CUSTOM_REG_MAX];
+    FPGA_CUSTOM_WATCH Config = { 0 };
+    FPGA_CUSTOM_WATCH_CHANGE Changes[FPGA_CUSTOM_REG_MAX];
+    QWORD tcNow, tcNext = 0;
+    EnterCriticalSection(&ctx->Lock);
+    hEventFinish = ctx->watch.hEventFinish;
+    LeaveCriticalSection(&ctx->Lock);
+    while(!ctx->watch.fStop) {
+        // Wait for next sample (in short slices to react to stop):
+        tcNow = GetTickCount64();
+        if((dwSeq == ctx->watch.dwSeq) && (tcNow < tcNext)) {
+            Sleep((DWORD)min(16, tcNext - tcNow));
+            continue;
+        }
+        // Sample all watched registers in one transaction:
+        EnterCriticalSection(&ctx->Lock);
+        if(ctx->watch.fStop || !ctx->watch.Config.pfnCB) {
+            LeaveCriticalSection(&ctx->Lock);
+            continue;
+        }
+        if(dwSeq != ctx->watch.dwSeq) {
+            dwSeq = ctx->watch.dwSeq;
+            memcpy(&Config, &ctx->watch.Config, sizeof(FPGA_CUSTOM_WATCH));
+            fBaseline = FALSE;
+            tcNext = tcNow;
+        }
+        if((fRead = DeviceFPGA_CustomReadBulk(ctx, Config.cReg, Config.pbRegs, dwValue))) {
+            for(i = 0; i < Config.cReg; i++) {
+                r = Config.pbRegs[i];
+                if(ctx->shadow.bPolicy[r]) {
+                    ctx->shadow.dwValue[r] = dwValue[i];
+                    ctx->shadow.fValid[r] = 1;
+                }
+            }
+        }
+        ctx->watch.fCallback = TRUE;
+        LeaveCriticalSection(&ctx->Lock);
+        tcNext = max(tcNext + Config.dwIntervalMs, tcNow);
+        // Report failed sample:
+        if(!fRead) {
+            Config.pfnCB(Config.ctxUser, 0, NULL);
+            ctx->watch.fCallback = FALSE;
+            continue;
+        }
+        // Report changed registers (all registers on the initial sample):
+        for(i = 0, cChange = 0; i < Config.cReg; i++) {
+            if(!fBaseline || (dwValue[i] != dwValuePrev[i])) {
+                Changes[cChange].dwReg = Config.pbRegs[i];
+                Changes[cChange].dwValueOld = fBaseline ? dwValuePrev[i] : dwValue[i];
+                Changes[cChange].dwValueNew = dwValue[i];
+                cChange++;
+            }
+        }
+        memcpy(dwValuePrev, dwValue, Config.cReg * sizeof(DWORD));
+        fBaseline = TRUE;
+        if(cChange) {
+            Config.pfnCB(Config.ctxUser, cChange, Changes);
+        }
+        ctx->watch.fCallback = FALSE;
+    }
+    EnterCriticalSection(&ctx->Lock);
+    ctx->watch.fThread = FALSE;
+    LeaveCriticalSection(&ctx->Lock);
+    SetEvent(hEventFinish);
+    return 1;
+}
+
+/*
+* Start, replace or stop the custom register watch. On return no callback of a
+* previous watch configuration is in progress; on stop the watch thread has
+* exited. CALLER must hold ctx->Lock - the lock is temporarily released while
+* waiting for the watch thread.
+* -- ctxLC
+* -- ctx
+* -- pWatch = new watch configuration, NULL to stop.
+* -- return
+*/
+_Success_(return)
+BOOL DeviceFPGA_CustomWatch(_In_ PLC_CONTEXT ctxLC, _In_ PDEVICE_CONTEXT_FPGA ctx, _In_opt_ PFPGA_CUSTOM_WATCH pWatch)
+{
+    DWORD i;
+    HANDLE hThread, hEventFinish;
+    if(pWatch) {
+        if((pWatch->dwVersion != FPGA_CUSTOM_WATCH_VERSION) || !pWatch->pfnCB || !pWatch->cReg || (pWatch->cReg > FPGA_CUSTOM_REG_MAX)) { return FALSE; }
+        for(i = 0; i < pWatch->cReg; i++) {
+            if(pWatch->pbRegs[i] >= FPGA_CUSTOM_REG_MAX) { return FALSE; }
+        }
+    }
+    // Stop current watch and wait for the watch thread to exit:
+    ctx->watch.Config.pfnCB = NULL;
+    if(!pWatch) {
+        if((hThread = ctx->watch.hThread)) {
+            hEventFinish = ctx->watch.hEventFinish;
+            ctx->watch.hThread = NULL;
+            ctx->watch.fStop = TRUE;
+            LeaveCriticalSection(&ctx->Lock);
+            WaitForSingleObject(hEventFinish, INFINITE);
+            CloseHandle(hThread);
+            EnterCriticalSection(&ctx->Lock);
+            if(ctx->watch.hEventFinish == hEventFinish) {
+                ctx->watch.hEventFinish = NULL;     // not yet replaced by a new watch thread
+            }
+            CloseHandle(hEventFinish);
+        }
+        return TRUE;
+    }
+    // Replace current watch - wait for any in-progress callback to complete,
+    // and for a watch thread being stopped by another thread to exit:
+    if(ctx->watch.fCallback || (ctx->watch.fThread && ctx->watch.fStop)) {
+        LeaveCriticalSection(&ctx->Lock);
+        while(ctx->watch.fCallback || (ctx->watch.fThread && ctx->watch.fStop)) {
+            SwitchToThread();
+        }
+        EnterCriticalSection(&ctx->Lock);
+    }
+    // Start new watch:
+    memcpy(&ctx->watch.Config, pWatch, sizeof(FPGA_CUSTOM_WATCH));
+    ctx->watch.Config.dwIntervalMs = max(1, pWatch->dwIntervalMs);
+    ctx->watch.dwSeq++;
+    if(!ctx->watch.fThread) {
+        ctx->watch.fStop = FALSE;
+        if(!(ctx->watch.hEventFinish = CreateEvent(NULL, TRUE, FALSE, NULL))) { goto fail; }
+        if(!(ctx->watch.hThread = CreateThread(NULL, 0, (LPTHREAD_START_ROUTINE)DeviceFPGA_CustomWatch_ThreadProc, ctxLC, 0, NULL))) {
+            CloseHandle(ctx->watch.hEventFinish);
+            ctx->watch.hEventFinish = NULL;
+            goto fail;
+        }
+        ctx->watch.fThread = TRUE;
+    }
+    return TRUE;
+fail:
+    ctx->watch.Config.pfnCB = NULL;
+    return FALSE;
+}
+
+/*
+* Snapshot the firmware performance counters. A write of the snapshot bit to
+* the perf control register (32) latches all live counters into registers
+* 33-47 in a single FPGA clock cycle; the snapshot is then burst read in the
+* same command transaction.
+* -- ctx
+* -- fClear = clear the live counters together with the snapshot.
+* -- pPerf
+* -- return
+*/
+_Success_(return)
+BOOL DeviceFPGA_PerfCounters(_In_ PDEVICE_CONTEXT_FPGA ctx, _In_ BOOL fClear, _Out_ PFPGA_PERF_COUNTERS pPerf)
+{
+    BYTE pbTx[16] = { 0 };
+    DWORD i;
+    FPGA_CUSTOMBURST_CONTEXT ctxRd = { 0 };
+    ZeroMemory(pPerf, sizeof(FPGA_PERF_COUNTERS));
+    // WRITE snapshot (and clear) - register 32 low 16 bits
+    pbTx[0] = fClear ? 0x03 : 0x01;
+    pbTx[2] = 0x03;
+    pbTx[5] = FPGA_PERF_REG_BASE << 1;
+    pbTx[6] = FPGA_CMD_CUSTOM_WRITE_BYTE;
+    pbTx[7] = 0x77;
+    // READ snapshot - burst read registers 32-47
+    pbTx[8] = FPGA_PERF_REG_COUNT;
+    pbTx[13] = FPGA_PERF_REG_BASE;
+    pbTx[14] = FPGA_CMD_CUSTOM_BURST_BYTE;
+    pbTx[15] = 0x77;
+    if(!DeviceFPGA_CmdTransaction(ctx, pbTx, sizeof(pbTx), 1 + FPGA_PERF_REG_COUNT, DeviceFPGA_CustomReadBurst_ReplyCB, &ctxRd)) {
+        return FALSE;
+    }
+    for(i = FPGA_PERF_REG_BASE; i < FPGA_PERF_REG_BASE + FPGA_PERF_REG_COUNT; i++) {
+        if(!ctxRd.fValid[i]) { return FALSE; }
+    }
+    if((ctxRd.dwValues[FPGA_PERF_REG_BASE] >> 16) != FPGA_PERF_ID_MAGIC) {
+        DEBUG_PRINT("PerfCounters: not supported by bitstream\n");
+        return FALSE;
+    }
+    pPerf->dwVersion = FPGA_PERF_COUNTERS_VERSION;
+    pPerf->dwFpgaPerfId = ctxRd.dwValues[FPGA_PERF_REG_BASE];
+    pPerf->qwTicks = ((QWORD)ctxRd.dwValues[FPGA_PERF_REG_BASE + 2] << 32) | ctxRd.dwValues[FPGA_PERF_REG_BASE + 1];
+    memcpy(&pPerf->cTlpTx, ctxRd.dwValues + FPGA_PERF_REG_BASE + 3, (FPGA_PERF_REG_COUNT - 3) * sizeof(DWORD));
+    return TRUE;
+}
+
+typedef struct tdFPGA_MAILBOXREAD_CONTEXT {
+    PDWORD pdw;
+    DWORD cdw;
+    DWORD i;
+    BOOL fHeader;
+} FPGA_MAILBOXREAD_CONTEXT, *PFPGA_MAILBOXREAD_CONTEXT;
+
+BOOL DeviceFPGA_MailboxRead_ReplyCB(_Inout_opt_ PVOID ctxReplyCB, _In_ BYTE bSrc, _In_ DWORD dwData)
+{
+    PFPGA_MAILBOXREAD_CONTEXT ctxRd = (PFPGA_MAILBOXREAD_CONTEXT)ctxReplyCB;
+    if((bSrc == 0x03) && !ctxRd->fHeader) {         // MAILBOX HEADER: dword count
+        if(_byteswap_ushort((WORD)dwData) != FPGA_MAILBOX_HEADER) { return FALSE; }
+        if(_byteswap_ushort((WORD)(dwData >> 16)) != ctxRd->cdw) { return FALSE; }
+        ctxRd->fHeader = TRUE;
+        return TRUE;
+    }
+    if((bSrc == 0x07) && ctxRd->fHeader && (ctxRd->i < ctxRd->cdw)) {
+        ctxRd->pdw[ctxRd->i++] = _byteswap_ulong(dwData);
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/*
+* Read from the FPGA block RAM mailbox. The whole range is requested with a
+* single mailbox burst read command and streamed back by the FPGA as one
+* header followed by one 32-bit data word per mailbox dword.
+* -- ctx
+* -- o = byte offset in the mailbox (dword aligned).
+* -- cb = number of bytes to read (dword aligned).
+* -- pb = buffer to receive the data.
+* -- return
+*/
+_Success_(return)
+BOOL DeviceFPGA_MailboxRead(_In_ PDEVICE_CONTEXT_FPGA ctx, _In_ DWORD o, _In_ DWORD cb, _Out_writes_(cb) PBYTE pb)
+{
+    BYTE pbTx[8] = { 0 };
+    FPGA_MAILBOXREAD_CONTEXT ctxRd = { 0 };
+    if(!cb || (o % 4) || (cb % 4) || (o + cb > FPGA_MAILBOX_SIZE)) { return FALSE; }
+    ctxRd.pdw = (PDWORD)pb;
+    ctxRd.cdw = cb / 4;
+    pbTx[0] = (BYTE)ctxRd.cdw;                      // dword count
+    pbTx[1] = (BYTE)(ctxRd.cdw >> 8);
+    pbTx[4] = FPGA_CMD_MAILBOX_ADDR_FLAG | (BYTE)((o / 4) >> 8);
+    pbTx[5] = (BYTE)(o / 4);                        // start dword
+    pbTx[6] = FPGA_CMD_CUSTOM_BURST_BYTE;
+    pbTx[7] = 0x77;
+    return DeviceFPGA_CmdTransaction(ctx, pbTx, sizeof(pbTx), 1 + ctxRd.cdw, DeviceFPGA_MailboxRead_ReplyCB, &ctxRd);
+}
+
+/*
+* Write to the FPGA block RAM mailbox. One command packet per dword is packed
+* into a single streamed write, followed by a zero length mailbox burst read
+* acting as a barrier - the FPGA processes commands in order so the reply is
+* received only after all mailbox writes have completed.
+* -- ctx
+* -- o = byte offset in the mailbox (dword aligned).
+* -- cb = number of bytes to write (dword aligned).
+* -- pb = data to write.
+* -- return
+*/
+_Success_(return)
+BOOL DeviceFPGA_MailboxWrite(_In_ PDEVICE_CONTEXT_FPGA ctx, _In_ DWORD o, _In_ DWORD cb, _In_reads_(cb) PBYTE pb)
+{
+    BOOL fReturn;
+    PBYTE pbTx;
+    DWORD i, iDW, cbTx = 0;
+    FPGA_MAILBOXREAD_CONTEXT ctxRd = { 0 };
+    if(!cb || (o % 4) || (cb % 4) || (o + cb > FPGA_MAILBOX_SIZE)) { return FALSE; }
+    if(!(pbTx = LocalAlloc(LMEM_ZEROINIT, (cb / 4 + 1) * 8))) { return FALSE; }
+    // WRITE requests - data in value (bits 0-15) and mask (bits 16-31)
+    for(i = 0; i < cb; i += 4) {
+        iDW = (o + i) / 4;
+        memcpy(pbTx + cbTx, pb + i, 4);
+        pbTx[cbTx + 4] = FPGA_CMD_MAILBOX_ADDR_FLAG | (BYTE)(iDW >> 8);
+        pbTx[cbTx + 5] = (BYTE)iDW;
+        pbTx[cbTx + 6] = FPGA_CMD_CUSTOM_WRITE_BYTE;
+        pbTx[cbTx + 7] = 0x77;
+        cbTx += 8;
+    }
+    // READ barrier - zero length mailbox burst read
+    pbTx[cbTx + 4] = FPGA_CMD_MAILBOX_ADDR_FLAG;
+    pbTx[cbTx + 6] = FPGA_CMD_CUSTOM_BURST_BYTE;
+    pbTx[cbTx + 7] = 0x77;
+    cbTx += 8;
+    fReturn = DeviceFPGA_CmdTransaction(ctx, pbTx, cbTx, 1, DeviceFPGA_MailboxRead_ReplyCB, &ctxRd);
+    LocalFree(pbTx);
+    return fReturn;
+}
+
+
+
+// BAR handling functionality below:
+
+/*
+* Initailize BARs from PCIe config space and DRP registers.
+* NB! This is highly Artix-7 specific!
+*/
+_Success_(return)
+BOOL DeviceFPGA_Bar_Initialize(_In_ PLC_CONTEXT ctxLC, _In_ PDEVICE_CONTEXT_FPGA ctx)
+{
+    BOOL fBAR = FALSE;
+    QWORD qwBarSize;
+    DWORD dwBarSize;
+    PWORD pwDrpBar;
+    SIZE_T i;
+    BYTE pbDRP[0x100], pbBAR[24] = { 0 };
+    PLC_BAR pBar;
+    ctx->tlp_callback.fBarInit = FALSE;
+    ZeroMemory(&ctx->tlp_callback.Bar, sizeof(ctx->tlp_callback.Bar));
+    for(i = 0; i < 6; i++) {
+        if(!DeviceFPGA_PCIeCfgSpaceCoreReadDWORD(ctx, (DWORD)(0x10 + i * 4), (PDWORD)(pbBAR + i * 4))) { return FALSE; }
+    }
+    if(!DeviceFPGA_PCIeDrpRead(ctx, pbDRP)) { return FALSE; }
+    for(i = 0; i < 12; i++) {
+        pwDrpBar = (PWORD)(pbDRP + 14 + i * 2);
+        *pwDrpBar = _byteswap_ushort(*pwDrpBar);
+    }
+    if(!memcmp(pbBAR, pbDRP + 14, 24)) { return FALSE; }    // BAR memory addresses are not yet configured.
+    for(i = 0; i < 6; i++) {
+        pBar = &ctx->tlp_callback.Bar[i];
+        pBar->iBar = (DWORD)i;
+        dwBarSize = *(PDWORD)(pbDRP + 14 + i * 4);
+        // IO BAR: IO BARs are not memory mapped and are treated differently here:
+        if(dwBarSize & 1) {
+            pBar->fIO = TRUE;
+            pBar->pa = *(PDWORD)(pbBAR + i * 4) - 1;
+            dwBarSize = ((dwBarSize & ~0x01) ^ 0xFFFFFFFF) + 1;
+            pBar->cb = dwBarSize;
+            if(!pBar->pa || !pBar->cb) { continue; }
+            if((pBar->pa >= 0x10000) || (pBar->cb >= 0x10000)) { return FALSE; }    // IO BARs must be < 64KB in size and address
+            pBar->fValid = TRUE;
+            fBAR = TRUE;
+            continue;
+        }
+        // Memory BAR:
+        if(dwBarSize & 8) {
+            if(i % 2) { return FALSE; }                     // 64-bit prefetchable BARs not allowed in odd BARs
+            pBar->fPrefetchable = TRUE;
+        }
+        if(dwBarSize & 4) {
+            if(i % 2) { return FALSE; }                     // 64-bit BARs not allowed in odd BARs
+            pBar->f64Bit = TRUE;
+            qwBarSize = *(PQWORD)(pbDRP + 14 + i * 4) & ~0xF;
+            qwBarSize = (qwBarSize ^ 0xFFFFFFFFFFFFFFFF) + 1;
+            if(qwBarSize >= 0x8000000000000000) { return FALSE; }   // BAR too large.
+            pBar->cb = qwBarSize;
+        } else {
+            dwBarSize = *(PDWORD)(pbDRP + 14 + i * 4) & ~0xF;
+            dwBarSize = (dwBarSize ^ 0xFFFFFFFF) + 1;
+            if(dwBarSize >= 0x80000000) { return FALSE; }           // BAR too large.
+            pBar->cb = dwBarSize;
+        }
+        if(!pBar->cb) { continue; }
+        if(pBar->cb & 0x7f) { return FALSE; }               // BAR size must be 128-byte chunked.
+        if(pBar->f64Bit) {
+            pBar->pa = *(PQWORD)(pbBAR + i * 4);
+            if(pBar->fPrefetchable) { pBar->pa -= 8; }
+            pBar->pa -= 4;
+            i++;
+        } else {
+            pBar->pa = *(PDWORD)(pbBAR + i * 4);
+        }
+        if(!pBar->pa) { continue; }
+        if(pBar->pa & 0x7F) { return FALSE; }               // BARs must be 128-byte aligned.
+        pBar->fValid = TRUE;
+        fBAR = TRUE;
+    }
+    for(i = 0; i < 6; i++) {
+        ctx->tlp_callback.Bar[i].iBar = (DWORD)i;
+    }
+    ctx->tlp_callback.fBarInit = fBAR;
+    return fBAR;
+}
+
+/*
+* Reply with a Cpl/CplD TLP as a reply to a BAR MRd request.
+*/
+VOID DeviceFPGA_Bar_TxTlp(_In_ PLC_CONTEXT ctxLC, _In_ PDEVICE_CONTEXT_FPGA ctx, _In_ PTLP_HDR_MRdWr32 pMRd, _In_ PLC_BAR_REQUEST prq)
+{
+    QWORD pa;
+    DWORD cb, cbtx;
+    PBYTE pb;
+    TLP_HDR_CplD_128 cpl = { 0 };
+    // no read reply -> unsupported request (Cpl/UR)
+    if(!prq->fReadReply) {
+        ZeroMemory(&cpl, 12);
+        cpl.h.TypeFmt = TLP_Cpl;
+        cpl.CompleterID = ctx->wDeviceId;
+        cpl.Tag = pMRd->Tag;
+        cpl.RequesterID = pMRd->RequesterID;
+        cpl.ByteCount = 4;
+        cpl.Status = 1; // UR
+        *((PDWORD)&cpl + 0) = _byteswap_ulong(*((PDWORD)&cpl + 0));
+        *((PDWORD)&cpl + 1) = _byteswap_ulong(*((PDWORD)&cpl + 1));
+        *((PDWORD)&cpl + 2) = _byteswap_ulong(*((PDWORD)&cpl + 2));
+        ObByteQueue_Push(ctx->tlp_callback.pBqTx, 0, 12, (PBYTE)&cpl);
+        return;
+    }
+    // normal read reply (CplD/SR)
+    pa = prq->pBar->pa + prq->oData;
+    pb = prq->pbData;
+    cb = prq->cbData;
+    // TX as 128-byte packets (aligned to 128-byte boundaries)
+    while(cb) {
+        cbtx = min(128 - (pa & 0x7f), cb);
+        ZeroMemory(&cpl, 12);
+        cpl.h.TypeFmt = TLP_CplD;
+        cpl.CompleterID = ctx->wDeviceId;
+        cpl.Tag = pMRd->Tag;
+        cpl.RequesterID = pMRd->RequesterID;
+        cpl.LowerAddress = (BYTE)pa;
+        cpl.Status = 0; // SC
+        cpl.h.Length = (WORD)(cbtx >> 2);
+        cpl.ByteCount = (WORD)cb;
+        *((PDWORD)&cpl + 0) = _byteswap_ulong(*((PDWORD)&cpl + 0));
+        *((PDWORD)&cpl + 1) = _byteswap_ulong(*((PDWORD)&cpl + 1));
+        *((PDWORD)&cpl + 2) = _byteswap_ulong(*((PDWORD)&cpl + 2));
+        memcpy(cpl.pb128, prq->pbData, cbtx);
+        ObByteQueue_Push(ctx->tlp_callback.pBqTx, 0, (SIZE_T)12 + cbtx, (PBYTE)&cpl);
+        pb += cbtx;
+        cb -= cbtx;
+        pa += cbtx;
+    }
+}
+
+/*
+* Receive a TLP that may or may not be a MRd/MWr towards a BAR.
+* If TLP is a BAR access - handle it!
+*/
+VOID DeviceFPGA_Bar_RxTlp(_In_ PLC_CONTEXT ctxLC, _In_ PDEVICE_CONTEXT_FPGA ctx, PBYTE pbTlp, DWORD cbTlp)
+{
+    QWORD qwTlpAddr, qwTlpSize;
+    PLC_BAR pBar;
+    LC_BAR_REQUEST rq;
+    DWORD i, hdrDwBuf[4];
+    PTLP_HDR hdr = (PTLP_HDR)hdrDwBuf;
+    PTLP_HDR_MRdWr32 hdrM32 = (PTLP_HDR_MRdWr32)hdrDwBuf;
+    PTLP_HDR_MRdWr64 hdrM64 = (PTLP_HDR_MRdWr64)hdrDwBuf;
+    // 1: initial checks and header parse:
+    if((cbTlp < 12) || (pbTlp[0] & 0x9c) || (cbTlp & 3)) { return; }   // TLP fast fail if not MRd/MWr/IORd/IOWr
+    hdrDwBuf[0] = _byteswap_ulong(*(PDWORD)(pbTlp + 0));
+    hdrDwBuf[1] = _byteswap_ulong(*(PDWORD)(pbTlp + 4));
+    hdrDwBuf[2] = _byteswap_ulong(*(PDWORD)(pbTlp + 8));
+    if(cbTlp >= 16) {
+        hdrDwBuf[3] = _byteswap_ulong(*(PDWORD)(pbTlp + 12));
     }
     // 2: fill rq with common info from TLP header:
     rq.ctx = ctx->tlp_callback.ctxBarUser;
@@ -2248,7 +3613,6 @@ VOID DeviceFPGA_Bar_RxTlp(_In_ PLC_CONTEXT ctxLC, _In_ PDEVICE_CONTEXT_FPGA ctx,
 
 // TLP handling functionality below:
 
-#define FT_IO_PENDING               24
 #define TLP_RX_MAX_SIZE             (16+1024)
 #define TLP_RX_MAX_SIZE_IN_DWORDS   (TLP_RX_MAX_SIZE/sizeof(DWORD))
 
@@ -2293,7 +3657,7 @@ BOOL DeviceFPGA_TxTlp(_In_ PLC_CONTEXT ctxLC, _In_ PDEVICE_CONTEXT_FPGA ctx, _In
             status = ctx->dev.pfnFT_WritePipe(ctx->dev.hFTDI, 0x02, ctx->txbuf.pb, ctx->txbuf.cb, &cbTxed, NULL);
         }
         ctx->txbuf.cb = 0;
-        BusySleep(ctx->perf.DELAY_WRITE);
+        DeviceFPGA_Wait_Delay(ctx, ctx->perf.DELAY_WRITE);
         return (0 == status);
     }
     return TRUE;
@@ -2344,7 +3708,7 @@ BOOL DeviceFPGA_TxTlp_FastWrite_NoLock(_In_ PLC_CONTEXT ctxLC, _In_ PDEVICE_CONT
             status = ctx->dev.pfnFT_WritePipe(ctx->dev.hFTDI, 0x02, ctx->txbuf_fastwrite.pb, ctx->txbuf_fastwrite.cb, &cbTxed, NULL);
         }
         ctx->txbuf_fastwrite.cb = 0;
-        BusySleep(ctx->perf.DELAY_WRITE);
+        DeviceFPGA_Wait_Delay(ctx, ctx->perf.DELAY_WRITE);
         ReleaseSRWLockExclusive(&ctx->txbuf_fastwrite.LockSRW);
         return (0 == status);
     }
@@ -2401,6 +3765,10 @@ VOID DeviceFPGA_Synch_RxTlpSynchronous(_In_ PLC_CONTEXT ctxLC, _In_ PDEVICE_CONT
     DWORD dwStatus, *pdwData, cbRx;
     // larger read buffer slows down FT_ReadPipe so set it fairly tight if possible.
     ctx->rxbuf.cb = 0;
+    ctx->rxbuf.o = 0;
+    if(ctx->async2.pRxParse) {
+        FpgaRxParse_Reset(ctx->async2.pRxParse);
+    }
     cbReadRxBuf = ctx->dev.f2232h ? ctx->rxbuf.cbMax :
         min(ctx->rxbuf.cbMax, dwBytesToRead ? max(0x4000, (0x1000 + dwBytesToRead + (dwBytesToRead >> 1))) : (DWORD)-1);
     cbReadRxBuf = min(cbReadRxBuf, 0x00100000);
@@ -2545,7 +3913,7 @@ VOID DeviceFPGA_Synch_ReadScatter_Impl(_In_ PLC_CONTEXT ctxLC, _In_ DWORD cMEMs,
                 if(ctx->perf.RX_FLUSH_LIMIT && (cbFlush >= (ctx->fAlgorithmReadTiny ? 0x1000 : ctx->perf.RX_FLUSH_LIMIT))) {
                     // flush is only used by the SP605.
                     DeviceFPGA_TxTlp(ctxLC, ctx, (PBYTE)tx, is32 ? 12 : 16, FALSE, TRUE);
-                    BusySleep(ctx->perf.DELAY_WRITE);
+                    DeviceFPGA_Wait_Delay(ctx, ctx->perf.DELAY_WRITE);
                     cbFlush = 0;
                 } else {
                     DeviceFPGA_TxTlp(ctxLC, ctx, (PBYTE)tx, is32 ? 12 : 16, FALSE, FALSE);
@@ -2567,7 +3935,7 @@ VOID DeviceFPGA_Synch_ReadScatter_Impl(_In_ PLC_CONTEXT ctxLC, _In_ DWORD cMEMs,
             if(ctx->async2.fOldAsync) {
                 DeviceFPGA_SynchOldAsync_RxTlpAsynchronous(ctxLC, ctx, cbTotalInCycle);
             } else {
-                BusySleep(ctx->perf.DELAY_READ);
+                DeviceFPGA_Wait_Delay(ctx, ctx->perf.DELAY_READ);
                 DeviceFPGA_Synch_RxTlpSynchronous(ctxLC, ctx, cbTotalInCycle);
             }
         }
@@ -2606,57 +3974,31 @@ VOID DeviceFPGA_Synch_ReadScatter(_In_ PLC_CONTEXT ctxLC, _In_ DWORD cMEMs, _Ino
 // TLP ASYNC2 handling functionality below:
 
 /*
-* Generic callback function that may be used by TLP capable devices to aid the
-* collection of memory read completions. Receives single TLP packet.
-* -- ctxLC
+* Retrieve the MEM buffer destination of the payload of a memory read
+* completion with data (CplD) received on a 4K or tiny read tag.
 * -- ctx
-* -- pb
-* -- cb
+* -- hdrC = TLP header (host byte order).
+* -- po = destination offset in pMEM->pb.
+* -- pc = number of payload bytes to copy.
+* -- pcbAdjust = number of leading payload bytes to skip.
+* -- return
 */
-VOID DeviceFPGA_Async2_Read_RxTlpSingle_MRdCpl(_In_ PLC_CONTEXT ctxLC, _In_ PDEVICE_CONTEXT_FPGA ctx, _In_ PBYTE pb, _In_ DWORD cb)
+_Success_(return)
+BOOL DeviceFPGA_Async2_Read_RxTlpSingle_MRdCplTarget(_In_ PDEVICE_CONTEXT_FPGA ctx, _In_ PTLP_HDR_CplD hdrC, _Out_ PWORD po, _Out_ PWORD pc, _Out_ PWORD pcbAdjust)
 {
-    PTLP_HDR_CplD hdrC = (PTLP_HDR_CplD)pb;
-    PTLP_HDR hdr = (PTLP_HDR)pb;
-    PDWORD buf = (PDWORD)pb;
+    PTLP_HDR hdr = (PTLP_HDR)hdrC;
+    PFPGA_NEWASYNC2_TAG_ENTRY pTag = ctx->async2.Tags + hdrC->Tag;
+    PMEM_SCATTER pMEM = pTag->pMEM;
     WORD c, o, cbAdjust = 0;
-    PMEM_SCATTER pMEM;
-    PFPGA_NEWASYNC2_TAG_ENTRY pTag;
-    buf[0] = _byteswap_ulong(buf[0]);
-    buf[1] = _byteswap_ulong(buf[1]);
-    buf[2] = _byteswap_ulong(buf[2]);
-    if(cb < ((DWORD)hdr->Length << 2) + 12) { return; }                         // Insufficient length
-    if((hdr->TypeFmt != TLP_CplD) && (hdr->TypeFmt != TLP_Cpl)) { return; }     // Not a completion
-    pTag = ctx->async2.Tags + hdrC->Tag;
-    pMEM = pTag->pMEM;
     // 4K COMPLETION:
     if(pTag->tp == FPGA_NEWASYNC2_TAG_TYPE_4K) {
-        // Cpl: -> free MEM and tag
-        if(hdr->TypeFmt == TLP_Cpl) {
-            pTag->pMemContext->cMemCpl++;
-            goto free_tag;
-        }
-        // CplD:
         o = 0x1000 - (hdrC->ByteCount ? hdrC->ByteCount : 0x1000);
         c = hdr->Length << 2;
-        if(o + c > (WORD)pMEM->cb) { return; }
-        memcpy(pMEM->pb + o, pb + 12, c);
-        MEM_SCATTER_STACK_ADD(pMEM, 1, c);
-        if(pMEM->cb == MEM_SCATTER_STACK_PEEK(pMEM, 1)) {
-            pTag->pMemContext->cMemCpl++;
-            goto free_tag;
-        }
-        return;
+        if(o + c > (WORD)pMEM->cb) { return FALSE; }
+        goto success;
     }
     // TINY COMPLETION:
     if(pTag->tp == FPGA_NEWASYNC2_TAG_TYPE_TINY) {
-        if(hdr->TypeFmt == TLP_Cpl) {
-            MEM_SCATTER_STACK_ADD(pMEM, 1, 0x10000ULL + pTag->cbTag);
-            if(pMEM->cb == (MEM_SCATTER_STACK_PEEK(pMEM, 1) & 0x1fff)) {
-                pTag->pMemContext->cMemCpl++;
-            }
-            goto free_tag;
-        }
-        // CplD:
         c = (hdr->Length << 2);
         if(pTag->oMEM) {
             o = pTag->oMEM + hdrC->LowerAddress;
@@ -2668,101 +4010,247 @@ VOID DeviceFPGA_Async2_Read_RxTlpSingle_MRdCpl(_In_ PLC_CONTEXT ctxLC, _In_ PDEV
             c -= cbAdjust;
             o = 0;
         }
-        if((c == 0) || (c > 0x80)) { return; }
+        if((c == 0) || (c > 0x80)) { return FALSE; }
         if(o + c > (WORD)pMEM->cb) {
             if(o >= (WORD)pMEM->cb) {
-                return;
+                return FALSE;
             }
             c = (WORD)pMEM->cb - o;
         }
-        memcpy(pMEM->pb + o, pb + 12 + cbAdjust, c);
-        MEM_SCATTER_STACK_ADD(pMEM, 1, c);
-        if(pMEM->cb == (MEM_SCATTER_STACK_PEEK(pMEM, 1) & 0x1fff)) {
-            pTag->pMemContext->cMemCpl++;
+        goto success;
+    }
+    return FALSE;
+success:
+    *po = o;
+    *pc = c;
+    *pcbAdjust = cbAdjust;
+    return TRUE;
+}
+
+/*
+* Payload placement callback for the rx stream parser. The payload of memory
+* read completions with data is written by the parser directly from the rx
+* buffer into the destination MEM buffer (instead of being assembled into a
+* TLP in the parser arena and then copied).
+* -- ctx
+* -- pdwHdr = TLP header as received (big endian).
+* -- ppb
+* -- pcb
+* -- return
+*/
+_Success_(return)
+BOOL DeviceFPGA_Async2_Read_RxTlpPlace(_In_ PDEVICE_CONTEXT_FPGA ctx, _In_reads_(3) PDWORD pdwHdr, _Out_ PBYTE *ppb, _Out_ PDWORD pcb)
+{
+    DWORD buf[3] = { 0 };
+    TLP_HDR_CplD hdrC;
+    WORD o, c, cbAdjust;
+    buf[0] = _byteswap_ulong(pdwHdr[0]);
+    buf[1] = _byteswap_ulong(pdwHdr[1]);
+    buf[2] = _byteswap_ulong(pdwHdr[2]);
+    memcpy(&hdrC, buf, sizeof(TLP_HDR_CplD));
+    if(hdrC.h.TypeFmt != TLP_CplD) { return FALSE; }
+    if(!DeviceFPGA_Async2_Read_RxTlpSingle_MRdCplTarget(ctx, &hdrC, &o, &c, &cbAdjust) || cbAdjust) { return FALSE; }
+    *ppb = ctx->async2.Tags[hdrC.Tag].pMEM->pb + o;
+    *pcb = c;
+    return TRUE;
+}
+
+/*
+* Release a read tag and its byte credits.
+* -- ctx
+* -- pTag
+*/
+__forceinline VOID DeviceFPGA_Async2_Read_TagFree(_In_ PDEVICE_CONTEXT_FPGA ctx, _In_ PFPGA_NEWASYNC2_TAG_ENTRY pTag)
+{
+    DWORD iTag = (DWORD)(pTag - ctx->async2.Tags);
+    ctx->async2.cAvailTags++;
+    ctx->async2.cbAvailCredits += (pTag->tp == FPGA_NEWASYNC2_TAG_TYPE_4K) ? 0x1000 : 0x80;
+    ctx->async2.dwTagFree[iTag >> 5] |= 1U << (iTag & 31);
+    pTag->tp = FPGA_NEWASYNC2_TAG_TYPE_NONE;
+    pTag->oMEM = 0;
+    pTag->pMemContext = NULL;
+    pTag->pMEM = NULL;
+}
+
+/*
+* Check whether an address is in a range of the tiny map.
+* CALLER must hold ctx->Lock.
+* -- ctx
+* -- pa
+* -- return
+*/
+BOOL DeviceFPGA_TinyMap_Contains(_In_ PDEVICE_CONTEXT_FPGA ctx, _In_ QWORD pa)
+{
+    DWORD i, iL = 0, iR = ctx->tinymap.c;
+    PFPGA_TINYMAP_RANGE pe;
+    while(iL < iR) {
+        i = (iL + iR) >> 1;
+        pe = ctx->tinymap.pRanges + i;
+        if(pa < pe->pa) {
+            iR = i;
+        } else if(pa >= pe->pa + pe->cb) {
+            iL = i + 1;
+        } else {
+            return TRUE;
         }
-        pTag->cbTag -= c;
-        if(!pTag->cbTag) {
-            goto free_tag;
+    }
+    return FALSE;
+}
+
+/*
+* Add a page to the tiny map. The page is merged with adjacent ranges. If the
+* map is full the tiny algorithm is used for all reads. CALLER must hold ctx->Lock.
+* -- ctxLC
+* -- ctx
+* -- pa = page address.
+*/
+VOID DeviceFPGA_TinyMap_Add(_In_ PLC_CONTEXT ctxLC, _In_ PDEVICE_CONTEXT_FPGA ctx, _In_ QWORD pa)
+{
+    DWORD i, c = ctx->tinymap.c;
+    PFPGA_TINYMAP_RANGE pe = ctx->tinymap.pRanges;
+    if(!pe || DeviceFPGA_TinyMap_Contains(ctx, pa)) { return; }
+    ctx->tinymap.cPage++;
+    for(i = 0; (i < c) && (pe[i].pa < pa); i++);
+    // extend range below (and merge with range above if adjacent):
+    if(i && (pe[i - 1].pa + pe[i - 1].cb == pa)) {
+        pe[i - 1].cb += 0x1000;
+        if((i < c) && (pe[i].pa == pa + 0x1000)) {
+            pe[i - 1].cb += pe[i].cb;
+            memmove(pe + i, pe + i + 1, (c - i - 1) * sizeof(FPGA_TINYMAP_RANGE));
+            ctx->tinymap.c--;
         }
         return;
     }
-    return;
-free_tag:
-    ctx->async2.cAvailTags++;
+    // extend range above:
+    if((i < c) && (pe[i].pa == pa + 0x1000)) {
+        pe[i].pa = pa;
+        pe[i].cb += 0x1000;
+        return;
+    }
+    // new range:
+    if(c == FPGA_TINYMAP_MAX) {
+        ctx->fAlgorithmReadTiny = TRUE;
+        lcprintfv(ctxLC, "DEVICE: FPGA: TINY PCIe TLP algorithm map full - selected for all reads!\n");
+        return;
+    }
+    memmove(pe + i + 1, pe + i, (c - i) * sizeof(FPGA_TINYMAP_RANGE));
+    pe[i].pa = pa;
+    pe[i].cb = 0x1000;
+    ctx->tinymap.c++;
+    lcprintfvv(ctxLC, "DEVICE: FPGA: TINY PCIe TLP algorithm auto-selected for range at %016llx\n", pa);
+}
+
+/*
+* Fail the outstanding read of a tag (unsuccessful completion or no completion
+* at all) and release the tag. The MEM is completed as failed.
+* -- ctx
+* -- pTag
+*/
+VOID DeviceFPGA_Async2_Read_TagFail(_In_ PDEVICE_CONTEXT_FPGA ctx, _In_ PFPGA_NEWASYNC2_TAG_ENTRY pTag)
+{
+    PMEM_SCATTER pMEM = pTag->pMEM;
     if(pTag->tp == FPGA_NEWASYNC2_TAG_TYPE_4K) {
-        ctx->async2.cbAvailCredits += 0x1000;
+        pTag->pMemContext->cMemCpl++;
     }
     if(pTag->tp == FPGA_NEWASYNC2_TAG_TYPE_TINY) {
-        ctx->async2.cbAvailCredits += 0x80;
+        MEM_SCATTER_STACK_ADD(pMEM, 1, 0x10000ULL + pTag->cbTag);
+        if(pMEM->cb == (MEM_SCATTER_STACK_PEEK(pMEM, 1) & 0x1fff)) {
+            pTag->pMemContext->cMemCpl++;
+        }
     }
-    pTag->tp = FPGA_NEWASYNC2_TAG_TYPE_NONE;
-    pTag->pMemContext = NULL;
-    pTag->pMEM = NULL;
+    DeviceFPGA_Async2_Read_TagFree(ctx, pTag);
 }
 
 /*
-* Extract the first TLP out of a byte buffer received from the FPGA and forward
-* the TLP for processing.
+* Generic callback function that may be used by TLP capable devices to aid the
+* collection of memory read completions. Receives single TLP packet.
 * -- ctxLC
 * -- ctx
-* -- cdwData = number of DWORDs in FPGA data pdwData
-* -- pdwData = FPGA data
-* -- return = The number of DWORDs consumed. bit[31] = 1 TLP was found and processed.
+* -- pb
+* -- cb
+* -- fPlaced = CplD payload already placed in the MEM buffer (pb holds the header only).
 */
-DWORD DeviceFPGA_Async2_Read_RxTlpSingle(_In_ PLC_CONTEXT ctxLC, _In_ PDEVICE_CONTEXT_FPGA ctx, _In_ DWORD cdwData, _In_ PDWORD pdwData)
+VOID DeviceFPGA_Async2_Read_RxTlpSingle_MRdCpl(_In_ PLC_CONTEXT ctxLC, _In_ PDEVICE_CONTEXT_FPGA ctx, _In_ PBYTE pb, _In_ DWORD cb, _In_ BOOL fPlaced)
 {
-    BYTE pbTlp[TLP_RX_MAX_SIZE];
-    PDWORD pdwTlp = (PDWORD)pbTlp;
-    DWORD i = 0, j, dwStatus, cdwTlp = 0, iStartWord;
-    // skip over initial ftdi workaround dummy fillers / non valid octa-dwords
-    while((i < cdwData) && ((pdwData[i] & 0xf0000000) != 0xe0000000)) {
-        i++;
+    PTLP_HDR_CplD hdrC = (PTLP_HDR_CplD)pb;
+    PTLP_HDR hdr = (PTLP_HDR)pb;
+    PDWORD buf = (PDWORD)pb;
+    WORD c, o, cbAdjust;
+    PMEM_SCATTER pMEM;
+    PFPGA_NEWASYNC2_TAG_ENTRY pTag;
+    buf[0] = _byteswap_ulong(buf[0]);
+    buf[1] = _byteswap_ulong(buf[1]);
+    buf[2] = _byteswap_ulong(buf[2]);
+    if(cb < ((DWORD)hdr->Length << 2) + 12) { return; }                         // Insufficient length
+    if((hdr->TypeFmt != TLP_CplD) && (hdr->TypeFmt != TLP_Cpl)) { return; }     // Not a completion
+    pTag = ctx->async2.Tags + hdrC->Tag;
+    pMEM = pTag->pMEM;
+    // Cpl: -> fail MEM and free tag
+    if(hdr->TypeFmt == TLP_Cpl) {
+        if(pTag->tp != FPGA_NEWASYNC2_TAG_TYPE_NONE) {
+            DeviceFPGA_Async2_Read_TagFail(ctx, pTag);
+        }
+        return;
     }
-    if(i) { return i; }
-    // skip over initial non-TLP octa-dwords
-    dwStatus = pdwData[0];
-    if(((dwStatus | dwStatus >> 1) & 0x01111111) == 0x01111111) {
-        return 8;
+    // 4K COMPLETION:
+    if(pTag->tp == FPGA_NEWASYNC2_TAG_TYPE_4K) {
+        if(!DeviceFPGA_Async2_Read_RxTlpSingle_MRdCplTarget(ctx, hdrC, &o, &c, &cbAdjust)) { return; }
+        if(!fPlaced) {
+            memcpy(pMEM->pb + o, pb + 12, c);
+        }
+        MEM_SCATTER_STACK_ADD(pMEM, 1, c);
+        if(pMEM->cb == MEM_SCATTER_STACK_PEEK(pMEM, 1)) {
+            pTag->pMemContext->cMemCpl++;
+            goto free_tag;
+        }
+        return;
     }
-    // fetch and process next complete and valid tlp (if possible)
-    while(i <= cdwData - 8) {
-        iStartWord = i;
-        dwStatus = pdwData[i++];
-        if((dwStatus & 0xf0000000) != 0xe0000000) {
-            continue;
+    // TINY COMPLETION:
+    if(pTag->tp == FPGA_NEWASYNC2_TAG_TYPE_TINY) {
+        if(!DeviceFPGA_Async2_Read_RxTlpSingle_MRdCplTarget(ctx, hdrC, &o, &c, &cbAdjust)) { return; }
+        if(!fPlaced) {
+            memcpy(pMEM->pb + o, pb + 12 + cbAdjust, c);
         }
-        for(j = 0; j < 7; j++, i++) {
-            if((dwStatus & 0x03) == 0x00) { // PCIe TLP
-                if(cdwTlp >= TLP_RX_MAX_SIZE / sizeof(DWORD)) {
-                    // TODO: malformed TLP
-                    pdwData[iStartWord] = pdwData[iStartWord] | (0xffffffff >> (28 - (j << 2)));
-                    return iStartWord | 0x80000000;
-                }
-                pdwTlp[cdwTlp++] = pdwData[i];
-            }
-            if((dwStatus & 0x07) == 0x04) { // PCIe TLP and LAST
-                if((cdwTlp < 3) || (cdwTlp > TLP_RX_MAX_SIZE_IN_DWORDS)) {
-                    printf("Device Info: FPGA: Bad PCIe TLP received! Should not happen!\n");
-                    pdwData[iStartWord] = pdwData[iStartWord] | (0xffffffff >> (28 - (j << 2)));
-                    return iStartWord | 0x80000000;
-                }
-                if(ctxLC->fPrintf[LC_PRINTF_VVV]) {
-                    TLP_Print(ctxLC, pbTlp, cdwTlp << 2, FALSE);
-                }
-                if(ctx->tlp_callback.pBqRx) {
-                    DeviceFPGA_RxTlp_QueueUserCallback(ctx, (SIZE_T)cdwTlp << 2, pbTlp);
-                }
-                DeviceFPGA_Async2_Read_RxTlpSingle_MRdCpl(ctxLC, ctx, pbTlp, cdwTlp << 2);
-                pdwData[iStartWord] = pdwData[iStartWord] | (0xffffffff >> (28 - (j << 2)));
-                return iStartWord | 0x80000000;
+        MEM_SCATTER_STACK_ADD(pMEM, 1, c);
+        if(pMEM->cb == (MEM_SCATTER_STACK_PEEK(pMEM, 1) & 0x1fff)) {
+            pTag->pMemContext->cMemCpl++;
+            if((MEM_SCATTER_STACK_PEEK(pMEM, 1) & FPGA_NEWASYNC2_MEM_F_LEARN) && (pMEM->cb == (MEM_SCATTER_STACK_PEEK(pMEM, 1) & FPGA_NEWASYNC2_MEM_CB_MASK))) {
+                DeviceFPGA_TinyMap_Add(ctxLC, ctx, pMEM->qwA);
             }
-            dwStatus >>= 4;
         }
+        pTag->cbTag -= c;
+        if(!pTag->cbTag) {
+            goto free_tag;
+        }
+        return;
+    }
+    return;
+free_tag:
+    DeviceFPGA_Async2_Read_TagFree(ctx, pTag);
+}
+
+/*
+* Forward a command or config reply (status nibble 0x3, 0x7 and 0x1) to the
+* command currently awaiting replies (if any).
+* -- ctx
+* -- bSrc = status nibble.
+* -- dwData
+*/
+VOID DeviceFPGA_Async2_Read_RxCmd(_In_ PDEVICE_CONTEXT_FPGA ctx, _In_ BYTE bSrc, _In_ DWORD dwData)
+{
+    PFPGA_NEWASYNC2_CMD_CONTEXT pCmd = ctx->async2.pCmd;
+    if(pCmd && pCmd->pfnReplyCB(pCmd->ctxReplyCB, bSrc, dwData)) {
+        pCmd->cReply++;
     }
-    return 0;
 }
 
 /*
+* Parse the receive buffer and forward all complete TLPs for processing. The
+* parser consumes all complete blocks and keeps a TLP spanning the end of the
+* buffer until it is completed by subsequent reads. Command replies are
+* demultiplexed while parsing. The payload of memory read completions is
+* placed by the parser directly in the MEM buffers unless full TLPs are
+* required for printing or user callbacks.
 * -- ctxLC
 * -- ctx
 * -- return = TRUE if any TLPs were read, FALSE otherwise.
@@ -2770,11 +4258,36 @@ DWORD DeviceFPGA_Async2_Read_RxTlpSingle(_In_ PLC_CONTEXT ctxLC, _In_ PDEVICE_CO
 BOOL DeviceFPGA_Async2_Read_RxTlpFromBuffer(_In_ PLC_CONTEXT ctxLC, _In_ PDEVICE_CONTEXT_FPGA ctx)
 {
     BOOL fReadTlp = FALSE;
-    DWORD cdwTlpDataConsumed = 1;
-    while((ctx->rxbuf.o + 32 <= ctx->rxbuf.cb) && cdwTlpDataConsumed) {
-        cdwTlpDataConsumed = DeviceFPGA_Async2_Read_RxTlpSingle(ctxLC, ctx, (ctx->rxbuf.cb - ctx->rxbuf.o) >> 2, (PDWORD)(ctx->rxbuf.pb + ctx->rxbuf.o));
-        fReadTlp = fReadTlp || (cdwTlpDataConsumed & 0x80000000);
-        ctx->rxbuf.o += cdwTlpDataConsumed << 2;
+    DWORD i, cdwConsumed;
+    PBYTE pbTlp;
+    PFPGA_RXPARSE_CONTEXT pRxParse = ctx->async2.pRxParse;
+    PFN_FPGA_RXPARSE_PLACE_CB pfnPlaceCB = NULL;
+    QWORD cTlpBad = pRxParse->cTlpBad;
+    if(!ctxLC->fPrintf[LC_PRINTF_VVV] && !ctx->tlp_callback.pBqRx) {
+        pfnPlaceCB = (PFN_FPGA_RXPARSE_PLACE_CB)DeviceFPGA_Async2_Read_RxTlpPlace;
+    }
+    while((cdwConsumed = FpgaRxParse_Parse(pRxParse, (ctx->rxbuf.cb - ctx->rxbuf.o) >> 2, (PDWORD)(ctx->rxbuf.pb + ctx->rxbuf.o), (PFN_FPGA_RXPARSE_REPLY_CB)DeviceFPGA_Async2_Read_RxCmd, ctx, pfnPlaceCB, ctx))) {
+        if(ctx->async2.hRxRecord) {
+            fwrite(ctx->rxbuf.pb + ctx->rxbuf.o, sizeof(DWORD), cdwConsumed, ctx->async2.hRxRecord);
+        }
+        ctx->rxbuf.o += cdwConsumed << 2;
+        for(i = 0; i < pRxParse->cTlpBatch; i++) {
+            pbTlp = (PBYTE)(pRxParse->dwArena + pRxParse->Tlp[i].o);
+            if(ctxLC->fPrintf[LC_PRINTF_VVV]) {
+                TLP_Print(ctxLC, pbTlp, pRxParse->Tlp[i].cdw << 2, FALSE);
+            }
+            if(ctx->tlp_callback.pBqRx) {
+                DeviceFPGA_RxTlp_QueueUserCallback(ctx, (SIZE_T)pRxParse->Tlp[i].cdw << 2, pbTlp);
+            }
+            DeviceFPGA_Async2_Read_RxTlpSingle_MRdCpl(ctxLC, ctx, pbTlp, pRxParse->Tlp[i].cdw << 2, (pRxParse->Tlp[i].pbPlaced != NULL));
+        }
+        fReadTlp = fReadTlp || pRxParse->cTlpBatch;
+    }
+    // MEM buffers are only guaranteed to remain valid during this call - any
+    // completion spanning the end of the buffer is reverted to the arena:
+    FpgaRxParse_Unplace(pRxParse);
+    if(pRxParse->cTlpBad != cTlpBad) {
+        lcprintf(ctxLC, "Device Info: FPGA: Bad PCIe TLP received! Should not happen!\n");
     }
     return fReadTlp;
 }
@@ -2784,19 +4297,29 @@ BOOL DeviceFPGA_Async2_Read_RxTlpFromBuffer(_In_ PLC_CONTEXT ctxLC, _In_ PDEVICE
 */
 VOID DeviceFPGA_WriteScatter(_In_ PLC_CONTEXT ctxLC, _In_ DWORD cpMEMs, _Inout_ PPMEM_SCATTER ppMEMs);
 
+/*
+* Allocate a free read tag from the free tag bitmap. Tags are allocated round
+* robin after the last allocated tag so that a released tag is not reused
+* right away. CALLER must ensure ctx->async2.cAvailTags > 0.
+* -- ctx
+* -- return
+*/
 __forceinline BYTE DeviceFPGA_Async2_Read_TxTlp_NextTag(_In_ PDEVICE_CONTEXT_FPGA ctx)
 {
-    BYTE iTag = ctx->async2.iTag;
-    while(TRUE) {
-        iTag++;
-        if(iTag == 0xEF) {
-            iTag = 0;
-        }
-        if(ctx->async2.Tags[iTag].tp == FPGA_NEWASYNC2_TAG_TYPE_NONE) {
-            ctx->async2.iTag = iTag;
-            return iTag;
+    DWORD i, iw, iBit, dw;
+    i = (ctx->async2.iTag + 1) & 0xff;
+    iw = i >> 5;
+    dw = ctx->async2.dwTagFree[iw] & (0xffffffff << (i & 31));
+    for(i = 0; i < 9; i++) {
+        if(_BitScanForward(&iBit, dw)) {
+            ctx->async2.dwTagFree[iw] &= ~(1U << iBit);
+            ctx->async2.iTag = (BYTE)((iw << 5) + iBit);
+            return ctx->async2.iTag;
         }
+        iw = (iw + 1) & 7;
+        dw = ctx->async2.dwTagFree[iw];
     }
+    return 0;   // not reached if cAvailTags > 0
 }
 
 VOID DeviceFPGA_Async2_Read_TxTlpSingle_MrdTlp(_In_ PLC_CONTEXT ctxLC, _In_ PDEVICE_CONTEXT_FPGA ctx, _In_ WORD wTlpDwLength, _In_ BYTE iTag, _In_ QWORD qwA)
@@ -2830,60 +4353,329 @@ VOID DeviceFPGA_Async2_Read_TxTlpSingle_MrdTlp(_In_ PLC_CONTEXT ctxLC, _In_ PDEV
     DeviceFPGA_TxTlp(ctxLC, ctx, (PBYTE)tx, f32 ? 12 : 16, FALSE, FALSE);
 }
 
-VOID DeviceFPGA_Async2_Read_TxTlpSingle(_In_ PLC_CONTEXT ctxLC, _In_ PDEVICE_CONTEXT_FPGA ctx, _In_ PFPGA_NEWASYNC2_MEM_CONTEXT pTX)
+/*
+* Size of the tiny read sub-range starting at offset o of a MEM. The first
+* sub-range ends at the first 128-byte boundary, the following are 128 bytes.
+* -- pMEM
+* -- o
+* -- return
+*/
+__forceinline DWORD DeviceFPGA_Async2_Read_TinySize(_In_ PMEM_SCATTER pMEM, _In_ DWORD o)
+{
+    return o ? min(0x80, pMEM->cb - o) : min(pMEM->cb, 0x80 - (DWORD)(pMEM->qwA & 0x7f));
+}
+
+/*
+* Transmit a read of a MEM sub-range on a newly allocated tag. The sub-range
+* is the whole 4K MEM or the tiny sub-range at offset o. The caller must have
+* ensured that a tag and byte credits are available.
+* -- ctxLC
+* -- ctx
+* -- pTX
+* -- pMEM
+* -- tp
+* -- o = tiny only: sub-range offset in MEM.
+* -- cReissue = number of times the sub-range has been issued before.
+*/
+VOID DeviceFPGA_Async2_Read_TxTag(_In_ PLC_CONTEXT ctxLC, _In_ PDEVICE_CONTEXT_FPGA ctx, _In_ PFPGA_NEWASYNC2_MEM_CONTEXT pTX, _In_ PMEM_SCATTER pMEM, _In_ FPGA_NEWASYNC2_TAG_TYPE tp, _In_ DWORD o, _In_ DWORD cReissue)
 {
     BYTE iTag;
-    DWORD o, cb, cdw;
+    DWORD cb, cdw;
     PFPGA_NEWASYNC2_TAG_ENTRY pTag;
-    PMEM_SCATTER pMEM = pTX->ppMEMs[pTX->iMem];
-    // 4K READ:
-    if((pMEM->cb == 0x1000) && !ctx->fAlgorithmReadTiny && !(pMEM->qwA & 0xfff)) {
-        iTag = DeviceFPGA_Async2_Read_TxTlp_NextTag(ctx);
-        pTag = &ctx->async2.Tags[iTag];
-        pTag->tp = FPGA_NEWASYNC2_TAG_TYPE_4K;
-        pTag->pMemContext = pTX;
-        pTag->pMEM = pMEM;
-        pTag->oMEM = 0;
+    iTag = DeviceFPGA_Async2_Read_TxTlp_NextTag(ctx);
+    pTag = &ctx->async2.Tags[iTag];
+    pTag->tp = tp;
+    pTag->tmIssue = ctx->async2.tmTx;
+    pTag->cReissue = cReissue;
+    pTag->pMemContext = pTX;
+    pTag->pMEM = pMEM;
+    pTag->oMEM = (WORD)o;
+    ctx->async2.cAvailTags--;
+    if(tp == FPGA_NEWASYNC2_TAG_TYPE_4K) {
         ctx->async2.cbAvailCredits -= 0x1000;
-        ctx->async2.cAvailTags--;
         DeviceFPGA_Async2_Read_TxTlpSingle_MrdTlp(ctxLC, ctx, 0, iTag, pMEM->qwA);
         return;
     }
+    cb = DeviceFPGA_Async2_Read_TinySize(pMEM, o);
+    cdw = (cb + (o ? 0 : (pMEM->qwA & 3)) + 3) >> 2;                      // 1st packet unaligned start, last packet unaligned end (extra bytes discarded)
+    pTag->cbTag = (WORD)cb;
+    ctx->async2.cbAvailCredits -= 0x80;
+    DeviceFPGA_Async2_Read_TxTlpSingle_MrdTlp(ctxLC, ctx, (WORD)cdw, iTag, pMEM->qwA + o);
+}
+
+/*
+* Decide whether a MEM is read with the tiny algorithm: if it is used for all
+* reads, if the MEM is not a whole page, if requested for the MEM or if the MEM
+* is in a range of the tiny map. The decision is recorded in the MEM.
+* CALLER must hold ctx->Lock.
+* -- ctx
+* -- pMEM
+* -- return
+*/
+__forceinline BOOL DeviceFPGA_Async2_Read_IsTiny(_In_ PDEVICE_CONTEXT_FPGA ctx, _In_ PMEM_SCATTER pMEM)
+{
+    if(ctx->fAlgorithmReadTiny || (pMEM->cb != 0x1000) || (pMEM->qwA & 0xfff) || (MEM_SCATTER_STACK_PEEK(pMEM, 1) & FPGA_NEWASYNC2_MEM_F_TINY)) {
+        return TRUE;
+    }
+    if(ctx->tinymap.c && DeviceFPGA_TinyMap_Contains(ctx, pMEM->qwA)) {
+        MEM_SCATTER_STACK_ADD(pMEM, 1, FPGA_NEWASYNC2_MEM_F_TINY);
+        return TRUE;
+    }
+    return FALSE;
+}
+
+VOID DeviceFPGA_Async2_Read_TxTlpSingle(_In_ PLC_CONTEXT ctxLC, _In_ PDEVICE_CONTEXT_FPGA ctx, _In_ PFPGA_NEWASYNC2_MEM_CONTEXT pTX, _In_ BOOL fTiny)
+{
+    DWORD o;
+    PMEM_SCATTER pMEM = pTX->ppMEMs[pTX->iMem];
+    // 4K READ:
+    if(!fTiny) {
+        DeviceFPGA_Async2_Read_TxTag(ctxLC, ctx, pTX, pMEM, FPGA_NEWASYNC2_TAG_TYPE_4K, 0, 0);
+        return;
+    }
     // TINY READ: VALIDITY CHECKS:
     if(!pMEM->cb) { goto fail; }                                            // bad size
     if((pMEM->qwA & 0xfff) + pMEM->cb > 0x1000) { goto fail; }              // page traverse
     // TINY READ LOOP:
-    o = 0;
-    while(o < pMEM->cb) {
-        if(o == 0) {
-            cb = min(pMEM->cb, 0x80 - (DWORD)(pMEM->qwA & 0x7f));           // 1st packet, make sure to align to 128-byte boundary:
-            cdw = (cb + (pMEM->qwA & 3) + 3) >> 2;
-        } else {
-            cb = min(0x80, pMEM->cb - o);
-            cdw = cb >> 2;
-        }
-        iTag = DeviceFPGA_Async2_Read_TxTlp_NextTag(ctx);
-        pTag = &ctx->async2.Tags[iTag];
-        pTag->tp = FPGA_NEWASYNC2_TAG_TYPE_TINY;
-        pTag->pMemContext = pTX;
-        pTag->pMEM = pMEM;
-        pTag->oMEM = (WORD)o;
-        pTag->cbTag = (WORD)cb;
-        ctx->async2.cbAvailCredits -= 0x80;
-        ctx->async2.cAvailTags--;
-        DeviceFPGA_Async2_Read_TxTlpSingle_MrdTlp(ctxLC, ctx, (WORD)cdw, iTag, pMEM->qwA + o);
-        o += cb;
+    for(o = 0; o < pMEM->cb; o += DeviceFPGA_Async2_Read_TinySize(pMEM, o)) {
+        DeviceFPGA_Async2_Read_TxTag(ctxLC, ctx, pTX, pMEM, FPGA_NEWASYNC2_TAG_TYPE_TINY, o, 0);
     }
     return;
 fail:
     pTX->cMemCpl++;
 }
 
-PFPGA_NEWASYNC2_MEM_CONTEXT DeviceFPGA_Async2_Read_TxTlp(_In_ PLC_CONTEXT ctxLC, _In_ PDEVICE_CONTEXT_FPGA ctx, _In_ PFPGA_NEWASYNC2_MEM_CONTEXT pTX, _In_ BOOL fPrimary)
+/*
+* Recycle outstanding read tags individually. The read sub-range of a recycled
+* tag (whole 4K MEM or tiny sub-range) is reissued on a new tag if retry on
+* error is enabled and it has not been reissued too many times yet.
+* Otherwise its MEM is failed. Bytes already received for a reissued tiny
+* sub-range are discounted, a reissued 4K MEM is read again in full.
+* -- ctxLC
+* -- ctx
+* -- pMemCtx = recycle only tags of this MEM context, NULL = any MEM context.
+* -- tmIssuedBefore = recycle only tags issued before this QueryPerformanceCounter() time.
+* -- return = number of sub-ranges reissued.
+*/
+DWORD DeviceFPGA_Async2_Read_TagRecycle(_In_ PLC_CONTEXT ctxLC, _In_ PDEVICE_CONTEXT_FPGA ctx, _In_opt_ PFPGA_NEWASYNC2_MEM_CONTEXT pMemCtx, _In_ QWORD tmIssuedBefore)
 {
-    DWORD i = 0;
-    BOOL fTX = FALSE;
+    FPGA_NEWASYNC2_TAG_ENTRY e;
+    DWORD iw, iBit, cb, cReissue = 0, dwUsed[8];
+    DWORD cReissueMax = ctx->perf.RETRY_ON_ERROR ? FPGA_NEWASYNC2_TAG_REISSUE : 0;
+    PFPGA_NEWASYNC2_TAG_ENTRY pTag;
+    QueryPerformanceCounter((PLARGE_INTEGER)&ctx->async2.tmTx);
+    // snapshot allocated tags - reissued sub-ranges must not be recycled again:
+    for(iw = 0; iw < 8; iw++) {
+        dwUsed[iw] = FPGA_NEWASYNC2_TAG_VALID(iw) & ~ctx->async2.dwTagFree[iw];
+    }
+    for(iw = 0; iw < 8; iw++) {
+        while(_BitScanForward(&iBit, dwUsed[iw])) {
+            dwUsed[iw] &= dwUsed[iw] - 1;
+            pTag = ctx->async2.Tags + (iw << 5) + iBit;
+            if((pTag->tp == FPGA_NEWASYNC2_TAG_TYPE_NONE) || (pTag->tmIssue >= tmIssuedBefore)) { continue; }
+            if(pMemCtx && (pTag->pMemContext != pMemCtx)) { continue; }
+            ctx->async2.cTagStale++;
+            if(pTag->cReissue >= cReissueMax) {
+                DeviceFPGA_Async2_Read_TagFail(ctx, pTag);
+                continue;
+            }
+            // reissue: discount bytes received so far and transmit on a new tag:
+            e = *pTag;
+            if(e.tp == FPGA_NEWASYNC2_TAG_TYPE_4K) {
+                cb = 0x1000;
+                MEM_SCATTER_STACK_SET(e.pMEM, 1, 0);
+            } else {
+                cb = DeviceFPGA_Async2_Read_TinySize(e.pMEM, e.oMEM);
+                MEM_SCATTER_STACK_SET(e.pMEM, 1, MEM_SCATTER_STACK_PEEK(e.pMEM, 1) - (cb - e.cbTag));
+            }
+            DeviceFPGA_Async2_Read_TagFree(ctx, pTag);
+            DeviceFPGA_Async2_Read_TxTag(ctxLC, ctx, e.pMemContext, e.pMEM, e.tp, e.oMEM, e.cReissue + 1);
+            ctx->async2.cReissue++;
+            ctx->async2.cbReissue += cb;
+            cReissue++;
+        }
+    }
+    if(cReissue) {
+        DeviceFPGA_TxTlp(ctxLC, ctx, NULL, 0, TRUE, TRUE);
+    }
+    return cReissue;
+}
+
+/*
+* Complete a request and wake its submitter. The request context belongs to
+* the submitter and must not be touched once signaled (waking a stale address
+* is harmless - waiters always re-check their own completion flag).
+* -- pMemCtx
+*/
+__forceinline VOID DeviceFPGA_Async2_Read_Signal(_In_ PFPGA_NEWASYNC2_MEM_CONTEXT pMemCtx)
+{
+    InterlockedIncrement((volatile LONG*)&pMemCtx->fDone);
+    WakeByAddressAll((PVOID)&pMemCtx->fDone);
+}
+
+/*
+* Move requests submitted by any thread into the active list in submission
+* order. Writes are performed right away. CALLER must hold ctx->Lock.
+* -- ctxLC
+* -- ctx
+* -- pMemCtxOwn = the request of the calling thread (if any) - for statistics.
+*/
+VOID DeviceFPGA_Async2_Read_Drain(_In_ PLC_CONTEXT ctxLC, _In_ PDEVICE_CONTEXT_FPGA ctx, _In_opt_ PFPGA_NEWASYNC2_MEM_CONTEXT pMemCtxOwn)
+{
+    PFPGA_NEWASYNC2_MEM_CONTEXT pe, peNext, peFIFO = NULL;
+    if(!ctx->async2.pSubmit) { return; }
+    pe = (PFPGA_NEWASYNC2_MEM_CONTEXT)InterlockedExchangePointer((PVOID volatile*)&ctx->async2.pSubmit, NULL);
+    // LIFO -> FIFO:
+    while(pe) {
+        peNext = pe->FLink;
+        pe->FLink = peFIFO;
+        peFIFO = pe;
+        pe = peNext;
+    }
+    while((pe = peFIFO)) {
+        peFIFO = pe->FLink;
+        pe->FLink = NULL;
+        if(pe != pMemCtxOwn) {
+            ctx->async2.cCombine++;
+        }
+        if(pe->fWrite) {
+            DeviceFPGA_WriteScatter(ctxLC, pe->cMEM, pe->ppMEMs);
+            DeviceFPGA_Async2_Read_Signal(pe);
+            continue;
+        }
+        if(ctx->async2.pActive) {
+            ctx->async2.pActiveTail->FLink = pe;
+        } else {
+            ctx->async2.pActive = pe;
+        }
+        ctx->async2.pActiveTail = pe;
+        if(!ctx->async2.pTX) {
+            ctx->async2.pTX = pe;
+        }
+    }
+}
+
+/*
+* Advance a read chain request once its node has been read: the node is
+* recorded and the MEM is re-armed to read the next node (if any).
+* CALLER must hold ctx->Lock.
+* -- ctx
+* -- pe
+* -- return = TRUE if re-armed, FALSE if the read chain is completed.
+*/
+BOOL DeviceFPGA_Async2_Read_ChainStep(_In_ PDEVICE_CONTEXT_FPGA ctx, _In_ PFPGA_NEWASYNC2_MEM_CONTEXT pe)
+{
+    PLC_READCHAIN pChain = pe->pChain;
+    PMEM_SCATTER pMEM = pe->ppMEMs[0];
+    QWORD qwNext;
+    if(pMEM->cb != (MEM_SCATTER_STACK_PEEK(pMEM, 1) & FPGA_NEWASYNC2_MEM_CB_MASK)) {
+        pChain->dwStop = LC_READCHAIN_STOP_FAIL;
+        return FALSE;
+    }
+    if(pChain->pqwA) {
+        pChain->pqwA[pChain->cNode] = pe->qwAChain;
+    }
+    pChain->cNode++;
+    if((pChain->dwStop = LcReadChain_Next(pChain, pMEM->pb, &qwNext))) {
+        return FALSE;
+    }
+    pMEM->qwA = qwNext;
+    LcMemMap_TranslateMEMs(ctx->ctxLC, 1, &pMEM);
+    if(MEM_SCATTER_ADDR_ISINVALID(pMEM)) {
+        pChain->dwStop = LC_READCHAIN_STOP_FAIL;
+        return FALSE;
+    }
+    pe->qwAChain = qwNext;
+    pMEM->pb += pChain->cbNode;
+    MEM_SCATTER_STACK_SET(pMEM, 1, 0);
+    pe->iMem = 0;
+    pe->cMemCpl = 0;
+    return TRUE;
+}
+
+/*
+* Unlink and signal completed requests from the active list. Read chain
+* requests re-armed for their next node are moved to the tail of the active
+* list to be transmitted again. CALLER must hold ctx->Lock.
+* -- ctx
+* -- fAll = unlink and signal all requests (no read tag may be outstanding).
+*/
+VOID DeviceFPGA_Async2_Read_Retire(_In_ PDEVICE_CONTEXT_FPGA ctx, _In_ BOOL fAll)
+{
+    PFPGA_NEWASYNC2_MEM_CONTEXT pe, pePrev = NULL, peChain = NULL, peChainTail = NULL, *ppe = &ctx->async2.pActive;
+    while((pe = *ppe)) {
+        if(!fAll && (pe->cMemCpl < pe->cMEM)) {
+            pePrev = pe;
+            ppe = &pe->FLink;
+            continue;
+        }
+        *ppe = pe->FLink;
+        if(ctx->async2.pTX == pe) {
+            ctx->async2.pTX = pe->FLink;
+        }
+        if(!fAll && pe->pChain && DeviceFPGA_Async2_Read_ChainStep(ctx, pe)) {
+            pe->FLink = NULL;
+            if(peChainTail) {
+                peChainTail->FLink = pe;
+            } else {
+                peChain = pe;
+            }
+            peChainTail = pe;
+            continue;
+        }
+        DeviceFPGA_Async2_Read_Signal(pe);
+    }
+    ctx->async2.pActiveTail = pePrev;
+    if(peChain) {
+        *ppe = peChain;
+        ctx->async2.pActiveTail = peChainTail;
+        if(!ctx->async2.pTX) {
+            ctx->async2.pTX = peChain;
+        }
+    }
+}
+
+/*
+* Give up all active requests: outstanding read tags are failed and all active
+* requests are completed - MEMs not yet read are failed. CALLER must hold ctx->Lock.
+* -- ctx
+*/
+VOID DeviceFPGA_Async2_Read_Abort(_In_ PDEVICE_CONTEXT_FPGA ctx)
+{
+    DWORD i;
+    for(i = 0; i < 0x100; i++) {
+        if(ctx->async2.Tags[i].tp != FPGA_NEWASYNC2_TAG_TYPE_NONE) {
+            DeviceFPGA_Async2_Read_TagFail(ctx, ctx->async2.Tags + i);
+        }
+    }
+    DeviceFPGA_Async2_Read_Retire(ctx, TRUE);
+}
+
+/*
+* Wake one thread waiting for a submitted (or active) request so that it may
+* take over the device. Called after releasing ctx->Lock. The request pointers
+* are only used as wake addresses - never dereferenced.
+* -- ctx
+*/
+VOID DeviceFPGA_Async2_Read_Handoff(_In_ PDEVICE_CONTEXT_FPGA ctx)
+{
+    PFPGA_NEWASYNC2_MEM_CONTEXT pe;
+    if((pe = ctx->async2.pSubmit) || (pe = ctx->async2.pActive)) {
+        WakeByAddressAll((PVOID)&pe->fDone);
+    }
+}
+
+/*
+* Transmit read TLPs of the active requests in order as one continuous TX
+* stream until tags or byte credits are exhausted. CALLER must hold ctx->Lock.
+* -- ctxLC
+* -- ctx
+*/
+VOID DeviceFPGA_Async2_Read_TxTlp(_In_ PLC_CONTEXT ctxLC, _In_ PDEVICE_CONTEXT_FPGA ctx)
+{
+    BOOL fTX = FALSE, fTiny;
     PMEM_SCATTER pMEM;
+    PFPGA_NEWASYNC2_MEM_CONTEXT pTX;
     SIZE_T cbTlpRaw;
     BYTE pbTlpRaw[TLP_RX_MAX_SIZE];
     // TX queued RAW TLPs (if any) from other threads and flush:
@@ -2893,106 +4685,113 @@ PFPGA_NEWASYNC2_MEM_CONTEXT DeviceFPGA_Async2_Read_TxTlp(_In_ PLC_CONTEXT ctxLC,
         }
         DeviceFPGA_TxTlp(ctxLC, ctx, NULL, 0, TRUE, TRUE);
     }
-    // Fetch new from queue (if required):
-    if(!pTX) {
-        while((pTX = ObMap_GetByIndex(ctx->async2.pmQueue, i))) {
-            if(pTX->iMem < pTX->cMEM) { break; }
-            i++;
-        }
-        if(!pTX) { return NULL; }
-        if(pTX->fWrite) {
-            // WriteTX: Dequeue and transmit:
-            ObMap_Remove(ctx->async2.pmQueue, pTX);
-            DeviceFPGA_WriteScatter(ctxLC, pTX->cMEM, pTX->ppMEMs);
-            return NULL;
-        }
-    }
-    // TX TLPs per MEM:
-    while(pTX->iMem < pTX->cMEM) {
-        // Skip already completed/invalid MEMs:
-        pMEM = pTX->ppMEMs[pTX->iMem];
-        if(pMEM->f || MEM_SCATTER_ADDR_ISINVALID(pMEM)) {
-            pTX->cMemCpl++;
-            pTX->iMem++;
-            continue;
-        }
-        // Ensure enough tags and byte credits are available:
-        if(fPrimary) {
-            if(ctx->async2.cbAvailCredits < 0x1000) { break; }
-            if(ctx->fAlgorithmReadTiny || (pMEM->cb != 0x1000)) {
-                if(ctx->async2.cAvailTags < 32) { break; }
+    // TX TLPs per MEM of all active requests:
+    QueryPerformanceCounter((PLARGE_INTEGER)&ctx->async2.tmTx);
+    while((pTX = ctx->async2.pTX)) {
+        while(pTX->iMem < pTX->cMEM) {
+            // Skip already completed/invalid MEMs:
+            pMEM = pTX->ppMEMs[pTX->iMem];
+            if(pMEM->f || MEM_SCATTER_ADDR_ISINVALID(pMEM)) {
+                pTX->cMemCpl++;
+                pTX->iMem++;
+                continue;
+            }
+            // Ensure enough tags and byte credits are available:
+            if(ctx->async2.cbAvailCredits < 0x1000) { goto flush; }
+            if((fTiny = DeviceFPGA_Async2_Read_IsTiny(ctx, pMEM))) {
+                if(ctx->async2.cAvailTags < 32) { goto flush; }
             } else {
-                if(ctx->async2.cAvailTags == 0) { break; }
+                if(ctx->async2.cAvailTags == 0) { goto flush; }
             }
-        } else {
-            if(ctx->async2.cbAvailCredits < 0x2000) { break; }
-            if(ctx->async2.cAvailTags < 64) { break; }
+            // TX single TLP:
+            DeviceFPGA_Async2_Read_TxTlpSingle(ctxLC, ctx, pTX, fTiny);
+            pTX->iMem++;
+            fTX = TRUE;
         }
-        // TX single TLP:
-        DeviceFPGA_Async2_Read_TxTlpSingle(ctxLC, ctx, pTX);
-        pTX->iMem++;
-        fTX = TRUE;
+        ctx->async2.pTX = pTX->FLink;
     }
+flush:
     if(fTX) {
         // Flush TLPs to FPGA device:
         DeviceFPGA_TxTlp(ctxLC, ctx, NULL, 0, TRUE, TRUE);
     }
-    if(pTX->iMem < pTX->cMEM) {
-        return pTX;
-    }
-    // All MEMs completed -> remove from queue and return.
-    ObMap_Remove(ctx->async2.pmQueue, pTX);
-    return NULL;
 }
 
-VOID DeviceFPGA_Async2_ReadScatter_DoWork(_In_ PLC_CONTEXT ctxLC, _In_ PDEVICE_CONTEXT_FPGA ctx, _In_ PFPGA_NEWASYNC2_MEM_CONTEXT pMemCtxPrimary)
+/*
+* Work combining read worker. All submitted requests - of any thread - are
+* transmitted as one continuous TX stream while the RX stream is processed.
+* Requests are signaled as they complete. New requests are admitted until the
+* request of the calling thread has completed, the worker then returns once
+* the admitted requests have completed. CALLER must hold ctx->Lock.
+* -- ctxLC
+* -- ctx
+* -- pMemCtxOwn = the request of the calling thread.
+*/
+VOID DeviceFPGA_Async2_ReadScatter_DoWork(_In_ PLC_CONTEXT ctxLC, _In_ PDEVICE_CONTEXT_FPGA ctx, _In_ PFPGA_NEWASYNC2_MEM_CONTEXT pMemCtxOwn)
 {
     BOOL fAsync;
-    DWORD i, status, cEmptyRead = 0, cbRead = 0, cbReadInitialMax, cbMAX_READSIZE = ctx->perf.ASYNC_MAX_READSIZE;
-    PFPGA_NEWASYNC2_MEM_CONTEXT pMemCtxTX = pMemCtxPrimary;
-    PFPGA_NEWASYNC2_TAG_ENTRY pTag;
+    DWORD status, cEmptyRead = 0, cbRead = 0, cbReadInitialMax, cbMAX_READSIZE = ctx->perf.ASYNC_MAX_READSIZE;
+    QWORD tmNow, cTagStale;
     fAsync = !ctx->dev.f2232h;
-    // TX PRIMARY and start OVERLAPPED read:
-    pMemCtxTX = DeviceFPGA_Async2_Read_TxTlp(ctxLC, ctx, pMemCtxPrimary, TRUE);
+    DeviceFPGA_Async2_Read_Drain(ctxLC, ctx, pMemCtxOwn);
+    if(!ctx->async2.pActive) {
+        return;
+    }
+    // TX and start OVERLAPPED read:
+    DeviceFPGA_Async2_Read_TxTlp(ctxLC, ctx);
     // RX INITIAL / (LATENCY OPTIMIZED FOR SMALLER READS):
-    BusySleep(ctx->perf.ASYNC_DELAY_1);
-    cbReadInitialMax = min(cbMAX_READSIZE, pMemCtxPrimary->cMEM * 0x1800);
+    DeviceFPGA_Wait_Delay(ctx, ctx->perf.ASYNC_DELAY_1);
+    cbReadInitialMax = min(cbMAX_READSIZE, ctx->async2.pActive->cMEM * 0x1800);
     status = ctx->dev.pfnFT_ReadPipe(ctx->dev.hFTDI, 0x82, ctx->rxbuf.pb + ctx->rxbuf.cb, cbReadInitialMax, &cbRead, NULL);
     if(status && (status != FT_IO_PENDING)) {
-        return;
+        goto fail;
     }
     ctx->rxbuf.cb += cbRead;
     DeviceFPGA_Async2_Read_RxTlpFromBuffer(ctxLC, ctx);
     // MAIN READ LOOP:
     while(TRUE) {
-        // REALIGN 16MB BUFFER IF REQUIRED:
-        if(ctx->rxbuf.cb + cbMAX_READSIZE > ctx->rxbuf.cbMax) {
-            memcpy(ctx->rxbuf.pb, ctx->rxbuf.pb + ctx->rxbuf.o, ctx->rxbuf.cb - ctx->rxbuf.o);
-            ctx->rxbuf.cb -= ctx->rxbuf.o;
-            ctx->rxbuf.o = 0;
-        }
-        // EXIT CRITERIA: PRIMARY READ&PROCESSING COMPLETED:
-        if(pMemCtxPrimary->cMEM == pMemCtxPrimary->cMemCpl) {
+        // REALIGN 16MB RING BUFFER IF REQUIRED (NO COPY IF MIRRORED):
+        Util_RingBuf_Realign(&ctx->rxbuf, cbMAX_READSIZE);
+        // SIGNAL COMPLETED REQUESTS / ADMIT NEW REQUESTS (UNTIL OWN REQUEST COMPLETED):
+        DeviceFPGA_Async2_Read_Retire(ctx, FALSE);
+        if(!pMemCtxOwn->fDone) {
+            DeviceFPGA_Async2_Read_Drain(ctxLC, ctx, pMemCtxOwn);
+        }
+        // EXIT CRITERIA: ALL ACTIVE REQUESTS COMPLETED:
+        if(!ctx->async2.pActive) {
             return;
         }
-        // SLEEP(EXIT) ON EMPTY OVERLAPPED READ:
+        // SLEEP(EXIT) ON EMPTY OVERLAPPED READ (AND RECYCLE STALE TAGS):
         if(cEmptyRead > 1) {
             if(cEmptyRead >= 0x30) {
-                goto fail_timeout;
+                // LOST COMPLETIONS: REISSUE OUTSTANDING SUB-RANGES (OR GIVE UP):
+                if(!DeviceFPGA_Async2_Read_TagRecycle(ctxLC, ctx, NULL, (QWORD)-1)) {
+                    goto fail;
+                }
+                cEmptyRead = 0;
+                continue;
             }
-            BusySleep(ctx->perf.ASYNC_DELAY_2);
+            QueryPerformanceCounter((PLARGE_INTEGER)&tmNow);
+            cTagStale = ctx->async2.cTagStale;
+            if(DeviceFPGA_Async2_Read_TagRecycle(ctxLC, ctx, NULL, tmNow - ctx->async2.tmTagStale)) {
+                cEmptyRead = 0;
+            }
+            if(cTagStale != ctx->async2.cTagStale) { continue; }
+            DeviceFPGA_Wait_Delay(ctx, ctx->perf.ASYNC_DELAY_2);
         }
         // START OVERLAPPED READ:
         if(fAsync) {
             status = ctx->dev.pfnFT_ReadPipe(ctx->dev.hFTDI, 0x82, ctx->rxbuf.pb + ctx->rxbuf.cb, cbMAX_READSIZE, &cbRead, &ctx->async2.oOverlapped);
             if(status && (status != FT_IO_PENDING)) {
-                goto fail_overlapped;
+                goto fail;
             }
         }
         // PROCESS RESULT:
         cEmptyRead = DeviceFPGA_Async2_Read_RxTlpFromBuffer(ctxLC, ctx) ? 0 : cEmptyRead + 1;
+        // SIGNAL COMPLETED REQUESTS / RE-ARM READ CHAINS FOR THEIR NEXT NODE:
+        DeviceFPGA_Async2_Read_Retire(ctx, FALSE);
         // TX:
-        pMemCtxTX = DeviceFPGA_Async2_Read_TxTlp(ctxLC, ctx, pMemCtxTX, (pMemCtxTX == pMemCtxPrimary));
+        DeviceFPGA_Async2_Read_TxTlp(ctxLC, ctx);
         // READ OVERLAPPED RESULT:
         if(fAsync) {
             status = ctx->dev.pfnFT_GetOverlappedResult(ctx->dev.hFTDI, &ctx->async2.oOverlapped, &cbRead, TRUE);
@@ -3000,87 +4799,225 @@ VOID DeviceFPGA_Async2_ReadScatter_DoWork(_In_ PLC_CONTEXT ctxLC, _In_ PDEVICE_C
             status = ctx->dev.pfnFT_ReadPipe(ctx->dev.hFTDI, 0x82, ctx->rxbuf.pb + ctx->rxbuf.cb, cbReadInitialMax, &cbRead, NULL);
         }
         if(status) {
-            goto fail_overlapped;
+            goto fail;
         }
         ctx->rxbuf.cb += cbRead;
     }
-fail_timeout:
-    // CLEAR ANY TAGS RESERVED FOR PRIMARY MEM CTX ON TIMEOUT FAILURE:
-    for(i = 0; i < 0x100; i++) {
-        pTag = ctx->async2.Tags + i;
-        if(pTag->pMemContext == pMemCtxPrimary) {
-            if(pTag->tp == FPGA_NEWASYNC2_TAG_TYPE_4K) {
-                ctx->async2.cbAvailCredits += 0x1000;
-            } else if(pTag->tp == FPGA_NEWASYNC2_TAG_TYPE_TINY) {
-                ctx->async2.cbAvailCredits += 0x80;
+fail:
+    DeviceFPGA_Async2_Read_Abort(ctx);
+}
+
+/*
+* Fast read-only implementation used by separate raw thread monitoring raw TLPs
+* for the purpose of forwarding to user in form of raw TLPs or BAR accesses.
+*/
+VOID DeviceFPGA_Async2_ReadOnlyFast_DoWork(_In_ PLC_CONTEXT ctxLC, _In_ PDEVICE_CONTEXT_FPGA ctx)
+{
+    BOOL fAsync = !ctx->dev.f2232h;
+    DWORD status, cbRead = 0;
+    // RX INITIAL / (LATENCY OPTIMIZED FOR SMALLER READS):
+    status = ctx->dev.pfnFT_ReadPipe(ctx->dev.hFTDI, 0x82, ctx->rxbuf.pb + ctx->rxbuf.cb, ctx->perf.ASYNC_MAX_READSIZE, &cbRead, NULL);
+    if(status && (status != FT_IO_PENDING)) {
+        return;
+    }
+    ctx->rxbuf.cb += cbRead;
+    if(!DeviceFPGA_Async2_Read_RxTlpFromBuffer(ctxLC, ctx)) {
+        return;
+    }
+    // MAIN READ LOOP:
+    while(TRUE) {
+        // REALIGN 16MB RING BUFFER IF REQUIRED (NO COPY IF MIRRORED):
+        Util_RingBuf_Realign(&ctx->rxbuf, ctx->perf.ASYNC_MAX_READSIZE);
+        // SLEEP(EXIT) ON EMPTY OVERLAPPED READ:
+        if((cbRead == 0) || (cbRead == 0x14)) {
+            return;
+        }
+        // START OVERLAPPED READ:
+        if(fAsync) {
+            status = ctx->dev.pfnFT_ReadPipe(ctx->dev.hFTDI, 0x82, ctx->rxbuf.pb + ctx->rxbuf.cb, ctx->perf.ASYNC_MAX_READSIZE, &cbRead, &ctx->async2.oOverlapped);
+            if(status && (status != FT_IO_PENDING)) {
+                return;
+            }
+        }
+        // PROCESS RESULT:
+        DeviceFPGA_Async2_Read_RxTlpFromBuffer(ctxLC, ctx);
+        // READ OVERLAPPED RESULT:
+        if(fAsync) {
+            status = ctx->dev.pfnFT_GetOverlappedResult(ctx->dev.hFTDI, &ctx->async2.oOverlapped, &cbRead, TRUE);
+        } else {
+            status = ctx->dev.pfnFT_ReadPipe(ctx->dev.hFTDI, 0x82, ctx->rxbuf.pb + ctx->rxbuf.cb, ctx->perf.ASYNC_MAX_READSIZE, &cbRead, NULL);
+        }
+        if(status) { return; }
+        ctx->rxbuf.cb += cbRead;
+    }
+}
+
+/*
+* Transmit FPGA command packets through the TX buffer shared with TLPs. Any
+* TLPs already buffered are sent in the same write as the command packets.
+* -- ctxLC
+* -- ctx
+* -- pbTx = command packets (8 bytes each).
+* -- cbTx
+* -- return
+*/
+_Success_(return)
+BOOL DeviceFPGA_Async2_TxCmd(_In_ PLC_CONTEXT ctxLC, _In_ PDEVICE_CONTEXT_FPGA ctx, _In_reads_(cbTx) PBYTE pbTx, _In_ DWORD cbTx)
+{
+    DWORD o, cb;
+    for(o = 0; o < cbTx; o += cb) {
+        cb = min(cbTx - o, FPGA_CMD_TX_CHUNK_SIZE);
+        if((ctx->txbuf.cb + cb > ctx->perf.MAX_SIZE_TX) && !DeviceFPGA_TxTlp(ctxLC, ctx, NULL, 0, FALSE, TRUE)) {
+            return FALSE;
+        }
+        memcpy(ctx->txbuf.pb + ctx->txbuf.cb, pbTx + o, cb);
+        ctx->txbuf.cb += cb;
+        if(!DeviceFPGA_TxTlp(ctxLC, ctx, NULL, 0, FALSE, TRUE)) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/*
+* Async2 command transaction. Command packets are sent through the shared TLP
+* TX buffer and the RX stream is processed by the normal async2 TLP parser,
+* which demultiplexes the command replies. TLPs received meanwhile are not
+* lost and requests submitted by other threads are progressed while waiting.
+* CALLER must hold ctx->Lock.
+* -- ctxLC
+* -- ctx
+* -- pbTx = command packets (8 bytes each).
+* -- cbTx
+* -- cReplyExpected = number of replies required to complete the transaction.
+* -- pfnReplyCB = callback function receiving all non-TLP replies.
+* -- ctxReplyCB = user context passed to pfnReplyCB.
+* -- tmDeadline = QueryPerformanceCounter() deadline.
+* -- return = TRUE if all expected replies were received before the deadline.
+*/
+_Success_(return)
+BOOL DeviceFPGA_Async2_CmdTransaction(_In_ PLC_CONTEXT ctxLC, _In_ PDEVICE_CONTEXT_FPGA ctx, _In_reads_(cbTx) PBYTE pbTx, _In_ DWORD cbTx, _In_ DWORD cReplyExpected, _In_ PFN_FPGA_CMD_REPLY_CB pfnReplyCB, _Inout_opt_ PVOID ctxReplyCB, _In_ QWORD tmDeadline)
+{
+    BOOL fReturn = FALSE;
+    DWORD status, cbRead = 0;
+    QWORD tmNow;
+    FPGA_NEWASYNC2_CMD_CONTEXT Cmd = { 0 };
+    Cmd.cReplyExpected = cReplyExpected;
+    Cmd.pfnReplyCB = pfnReplyCB;
+    Cmd.ctxReplyCB = ctxReplyCB;
+    ctx->async2.pCmd = &Cmd;
+    // TX command packets (together with any buffered TLPs):
+    if(!DeviceFPGA_Async2_TxCmd(ctxLC, ctx, pbTx, cbTx)) { goto fail; }
+    // RX and process TLPs / command replies until complete or deadline:
+    while(TRUE) {
+        // REALIGN 16MB RING BUFFER IF REQUIRED (NO COPY IF MIRRORED):
+        Util_RingBuf_Realign(&ctx->rxbuf, ctx->perf.ASYNC_MAX_READSIZE);
+        status = ctx->dev.pfnFT_ReadPipe(ctx->dev.hFTDI, 0x82, ctx->rxbuf.pb + ctx->rxbuf.cb, ctx->perf.ASYNC_MAX_READSIZE, &cbRead, NULL);
+        if(status) { goto fail; }
+        ctx->rxbuf.cb += cbRead;
+        DeviceFPGA_Async2_Read_RxTlpFromBuffer(ctxLC, ctx);
+        DeviceFPGA_Async2_Read_Retire(ctx, FALSE);
+        if(Cmd.cReply >= Cmd.cReplyExpected) { break; }
+        QueryPerformanceCounter((PLARGE_INTEGER)&tmNow);
+        if(tmNow > tmDeadline) {
+            ctx->cmd.cTimeout++;
+            goto fail;
+        }
+        // TX requests submitted by other threads while waiting:
+        DeviceFPGA_Async2_Read_Drain(ctxLC, ctx, NULL);
+        DeviceFPGA_Async2_Read_TxTlp(ctxLC, ctx);
+    }
+    fReturn = TRUE;
+fail:
+    ctx->async2.pCmd = NULL;
+    return fReturn;
+}
+
+
+/*
+* Submit a request to the lock-free request queue and wait for its completion.
+* Requests are processed by whichever thread holds the device - if the device
+* is idle the calling thread takes it over and processes all submitted
+* requests (of any thread) in one continuous TX stream. Waiting threads sleep
+* on their own completion flag and do not serialize on ctx->Lock.
+* -- ctxLC
+* -- ctx
+* -- pMemCtx
+*/
+VOID DeviceFPGA_Async2_SubmitWait(_In_ PLC_CONTEXT ctxLC, _In_ PDEVICE_CONTEXT_FPGA ctx, _Inout_ PFPGA_NEWASYNC2_MEM_CONTEXT pMemCtx)
+{
+    DWORD dwZero = 0;
+    PFPGA_NEWASYNC2_MEM_CONTEXT pe;
+    // 1: lock-free push to the submit queue:
+    do {
+        pe = ctx->async2.pSubmit;
+        pMemCtx->FLink = pe;
+    } while(InterlockedCompareExchangePointer((PVOID volatile*)&ctx->async2.pSubmit, pMemCtx, pe) != pe);
+    // 2: wait for completion (take over the device if idle):
+    while(!pMemCtx->fDone) {
+        if(TryEnterCriticalSection(&ctx->Lock)) {
+            if(ctx->async2.fEnabled) {
+                DeviceFPGA_Async2_ReadScatter_DoWork(ctxLC, ctx, pMemCtx);
+            } else {
+                // async disabled after submit -> fail all:
+                DeviceFPGA_Async2_Read_Drain(ctxLC, ctx, pMemCtx);
+                DeviceFPGA_Async2_Read_Abort(ctx);
             }
-            ctx->async2.cAvailTags++;
-            pTag->tp = FPGA_NEWASYNC2_TAG_TYPE_NONE;
-            pTag->oMEM = 0;
-            pTag->pMEM = NULL;
-            pTag->pMemContext = NULL;
+            LeaveCriticalSection(&ctx->Lock);
+            DeviceFPGA_Async2_Read_Handoff(ctx);
+            continue;
         }
+        WaitOnAddress(&pMemCtx->fDone, &dwZero, sizeof(DWORD), FPGA_NEWASYNC2_WAIT_MS);
     }
-    return;
-fail_overlapped:
-    return;
+    MemoryBarrier();
 }
 
 /*
-* Fast read-only implementation used by separate raw thread monitoring raw TLPs
-* for the purpose of forwarding to user in form of raw TLPs or BAR accesses.
+* Learn the tiny map: whole page MEMs failing as 4K reads are read again as
+* tiny reads. Pages read successfully are added to the tiny map (by the worker)
+* and are read with the tiny algorithm right away by later reads. Pages also
+* failing as tiny reads (e.g. not backed by memory) are not added.
+* -- ctxLC
+* -- ctx
+* -- cMEMs
+* -- ppMEMs = MEMs of a completed async2 read (MEM stack not yet restored).
 */
-VOID DeviceFPGA_Async2_ReadOnlyFast_DoWork(_In_ PLC_CONTEXT ctxLC, _In_ PDEVICE_CONTEXT_FPGA ctx)
+VOID DeviceFPGA_Async2_TinyMap_Learn(_In_ PLC_CONTEXT ctxLC, _In_ PDEVICE_CONTEXT_FPGA ctx, _In_ DWORD cMEMs, _Inout_ PPMEM_SCATTER ppMEMs)
 {
-    BOOL fAsync = !ctx->dev.f2232h;
-    DWORD status, cbRead = 0;
-    // RX INITIAL / (LATENCY OPTIMIZED FOR SMALLER READS):
-    status = ctx->dev.pfnFT_ReadPipe(ctx->dev.hFTDI, 0x82, ctx->rxbuf.pb + ctx->rxbuf.cb, ctx->perf.ASYNC_MAX_READSIZE, &cbRead, NULL);
-    if(status && (status != FT_IO_PENDING)) {
-        return;
-    }
-    ctx->rxbuf.cb += cbRead;
-    if(!DeviceFPGA_Async2_Read_RxTlpFromBuffer(ctxLC, ctx)) {
-        return;
-    }
-    // MAIN READ LOOP:
-    while(TRUE) {
-        // REALIGN 16MB BUFFER IF REQUIRED:
-        if(ctx->rxbuf.cb + ctx->perf.ASYNC_MAX_READSIZE > ctx->rxbuf.cbMax) {
-            memcpy(ctx->rxbuf.pb, ctx->rxbuf.pb + ctx->rxbuf.o, ctx->rxbuf.cb - ctx->rxbuf.o);
-            ctx->rxbuf.cb -= ctx->rxbuf.o;
-            ctx->rxbuf.o = 0;
-        }
-        // SLEEP(EXIT) ON EMPTY OVERLAPPED READ:
-        if((cbRead == 0) || (cbRead == 0x14)) {
-            return;
-        }
-        // START OVERLAPPED READ:
-        if(fAsync) {
-            status = ctx->dev.pfnFT_ReadPipe(ctx->dev.hFTDI, 0x82, ctx->rxbuf.pb + ctx->rxbuf.cb, ctx->perf.ASYNC_MAX_READSIZE, &cbRead, &ctx->async2.oOverlapped);
-            if(status && (status != FT_IO_PENDING)) {
-                return;
-            }
-        }
-        // PROCESS RESULT:
-        DeviceFPGA_Async2_Read_RxTlpFromBuffer(ctxLC, ctx);
-        // READ OVERLAPPED RESULT:
-        if(fAsync) {
-            status = ctx->dev.pfnFT_GetOverlappedResult(ctx->dev.hFTDI, &ctx->async2.oOverlapped, &cbRead, TRUE);
-        } else {
-            status = ctx->dev.pfnFT_ReadPipe(ctx->dev.hFTDI, 0x82, ctx->rxbuf.pb + ctx->rxbuf.cb, ctx->perf.ASYNC_MAX_READSIZE, &cbRead, NULL);
-        }
-        if(status) { return; }
-        ctx->rxbuf.cb += cbRead;
-    }
+    FPGA_NEWASYNC2_MEM_CONTEXT MemCtx = { 0 };
+    PPMEM_SCATTER ppMEMsRetry = NULL;
+    PMEM_SCATTER pMEM;
+    QWORD v;
+    DWORD i, c = 0;
+    if(ctx->fAlgorithmReadTiny) { return; }
+    for(i = 0; i < cMEMs; i++) {
+        pMEM = ppMEMs[i];
+        if(pMEM->f || MEM_SCATTER_ADDR_ISINVALID(pMEM) || (pMEM->cb != 0x1000) || (pMEM->qwA & 0xfff)) { continue; }
+        v = MEM_SCATTER_STACK_PEEK(pMEM, 1);
+        if((v & FPGA_NEWASYNC2_MEM_F_TINY) || (v == 0x1000)) { continue; }
+        if(!ppMEMsRetry && !(ppMEMsRetry = LocalAlloc(0, (cMEMs - i) * sizeof(PMEM_SCATTER)))) { return; }
+        MEM_SCATTER_STACK_SET(pMEM, 1, FPGA_NEWASYNC2_MEM_F_TINY | FPGA_NEWASYNC2_MEM_F_LEARN);
+        ppMEMsRetry[c++] = pMEM;
+    }
+    if(!c) { return; }
+    MemCtx.cMEM = c;
+    MemCtx.ppMEMs = ppMEMsRetry;
+    DeviceFPGA_Async2_SubmitWait(ctxLC, ctx, &MemCtx);
+    LocalFree(ppMEMsRetry);
 }
 
-
-VOID DeviceFPGA_Async2_ReadScatter(_In_ PLC_CONTEXT ctxLC, _In_ DWORD cMEMs, _Inout_ PPMEM_SCATTER ppMEMs, _In_ BOOL fRetry)
+/*
+* Read a request of MEMs with the async2 worker. Lost completions are reissued
+* per read sub-range by the worker (if retry on error) - there is no whole
+* request retry.
+* -- ctxLC
+* -- ctx
+* -- cMEMs
+* -- ppMEMs
+*/
+VOID DeviceFPGA_Async2_ReadScatter_Request(_In_ PLC_CONTEXT ctxLC, _In_ PDEVICE_CONTEXT_FPGA ctx, _In_ DWORD cMEMs, _Inout_ PPMEM_SCATTER ppMEMs)
 {
-    PDEVICE_CONTEXT_FPGA ctx = (PDEVICE_CONTEXT_FPGA)ctxLC->hDevice;
     FPGA_NEWASYNC2_MEM_CONTEXT MemCtx = { 0 };
-    BOOL fFail = FALSE;
     DWORD i;
     PMEM_SCATTER pMEM;
     // 1: Prepare MEMs and MemContext:
@@ -3092,38 +5029,205 @@ VOID DeviceFPGA_Async2_ReadScatter(_In_ PLC_CONTEXT ctxLC, _In_ DWORD cMEMs, _In
     }
     MemCtx.cMEM = cMEMs;
     MemCtx.ppMEMs = ppMEMs;
-    // 2: Dispatch to worker function (behind lock):
-    if(TryEnterCriticalSection(&ctx->Lock)) {
-        // lock aquired without blocking -> do work without queuing:
-        DeviceFPGA_Async2_ReadScatter_DoWork(ctxLC, ctx, &MemCtx);
-        LeaveCriticalSection(&ctx->Lock);
-    } else {
-        // lock not aquired -> queue work:
-        ObMap_Push(ctx->async2.pmQueue, 0, &MemCtx);
-        EnterCriticalSection(&ctx->Lock);
-        ObMap_Remove(ctx->async2.pmQueue, &MemCtx);
-        if(MemCtx.cMemCpl < MemCtx.cMEM) {
-            DeviceFPGA_Async2_ReadScatter_DoWork(ctxLC, ctx, &MemCtx);
+    // 2: Submit to worker and wait for completion:
+    DeviceFPGA_Async2_SubmitWait(ctxLC, ctx, &MemCtx);
+    // 3: Retry failed 4K reads as tiny reads (if learning the tiny map):
+    if(ctx->tinymap.fLearn) {
+        DeviceFPGA_Async2_TinyMap_Learn(ctxLC, ctx, cMEMs, ppMEMs);
+    }
+    // 4: Restore MEMs:
+    for(i = 0; i < cMEMs; i++) {
+        pMEM = ppMEMs[i];
+        if(!pMEM->f && MEM_SCATTER_ADDR_ISVALID(pMEM)) {
+            pMEM->f = pMEM->cb == (MEM_SCATTER_STACK_POP(pMEM) & FPGA_NEWASYNC2_MEM_CB_MASK);
+        }
+    }
+}
+
+/*
+* qsort compare function for sorting sub-page MEMs by address.
+*/
+int DeviceFPGA_Async2_ReadScatter_CoalesceCmp(_In_ const void *pv1, _In_ const void *pv2)
+{
+    QWORD qwA1 = (*(PPMEM_SCATTER)pv1)->qwA;
+    QWORD qwA2 = (*(PPMEM_SCATTER)pv2)->qwA;
+    return (qwA1 < qwA2) ? -1 : ((qwA1 > qwA2) ? 1 : 0);
+}
+
+/*
+* Retrieve the span of sorted sub-page MEMs read by one covering read: MEMs in
+* the same page as the first MEM which start less than the coalesce gap after
+* the end of the MEMs before them.
+* -- ppSub = sub-page MEMs sorted by address.
+* -- cSub
+* -- i = first MEM of the span.
+* -- pqwEnd = receives the end address of the span.
+* -- return = index after the last MEM of the span.
+*/
+DWORD DeviceFPGA_Async2_ReadScatter_CoalesceSpan(_In_reads_(cSub) PPMEM_SCATTER ppSub, _In_ DWORD cSub, _In_ DWORD i, _Out_ PQWORD pqwEnd)
+{
+    QWORD qwPage = ppSub[i]->qwA & ~0xfffULL;
+    QWORD qwEnd = ppSub[i]->qwA + ppSub[i]->cb;
+    for(i++; i < cSub; i++) {
+        if(((ppSub[i]->qwA & ~0xfffULL) != qwPage) || (ppSub[i]->qwA >= qwEnd + FPGA_NEWASYNC2_COALESCE_GAP)) { break; }
+        qwEnd = max(qwEnd, ppSub[i]->qwA + ppSub[i]->cb);
+    }
+    *pqwEnd = qwEnd;
+    return i;
+}
+
+/*
+* Coalesce sub-page MEMs in the same page into covering reads and read them
+* together with the remaining MEMs as one request. Covering read data is copied
+* to its MEMs on completion. MEMs of a failed covering read are read again
+* individually. The member span of a covering MEM is kept on its MEM stack.
+* -- ctxLC
+* -- ctx
+* -- cMEMs
+* -- ppMEMs
+* -- return = TRUE if read, FALSE if nothing to coalesce (nothing read).
+*/
+_Success_(return)
+BOOL DeviceFPGA_Async2_ReadScatter_Coalesce(_In_ PLC_CONTEXT ctxLC, _In_ PDEVICE_CONTEXT_FPGA ctx, _In_ DWORD cMEMs, _Inout_ PPMEM_SCATTER ppMEMs)
+{
+    PBYTE pbBuffer = NULL, pb;
+    PPMEM_SCATTER ppSub = NULL, ppReq;
+    PMEM_SCATTER pMEM, pCover, pCovers;
+    QWORD qwEnd;
+    DWORD i, j, c, cSub = 0, cCover = 0, cMember = 0, cbCover = 0, cReq = 0, cFail = 0;
+    // 1: collect sub-page MEMs and sort them by address:
+    for(i = 0; i < cMEMs; i++) {
+        pMEM = ppMEMs[i];
+        if(pMEM->f || MEM_SCATTER_ADDR_ISINVALID(pMEM) || !pMEM->cb || (pMEM->cb >= 0x1000) || ((pMEM->qwA & 0xfff) + pMEM->cb > 0x1000)) { continue; }
+        if(!ppSub && !(ppSub = LocalAlloc(0, (cMEMs - i) * sizeof(PMEM_SCATTER)))) { return FALSE; }
+        ppSub[cSub++] = pMEM;
+    }
+    if(cSub < 2) { goto fail; }
+    qsort(ppSub, cSub, sizeof(PMEM_SCATTER), DeviceFPGA_Async2_ReadScatter_CoalesceCmp);
+    // 2: count covering reads (spans of at least two MEMs):
+    for(i = 0; i < cSub; i = j) {
+        j = DeviceFPGA_Async2_ReadScatter_CoalesceSpan(ppSub, cSub, i, &qwEnd);
+        if(j - i > 1) {
+            cCover++;
+            cMember += j - i;
+            cbCover += ((DWORD)(qwEnd - ppSub[i]->qwA) + 7) & ~7;
+        }
+    }
+    if(!cCover) { goto fail; }
+    // 3: set up covering MEMs (members are marked as read to exclude them from the request):
+    c = cMEMs - cMember + cCover;
+    if(!(pbBuffer = LocalAlloc(0, cCover * sizeof(MEM_SCATTER) + c * sizeof(PMEM_SCATTER) + cbCover))) { goto fail; }
+    pCovers = (PMEM_SCATTER)pbBuffer;
+    ppReq = (PPMEM_SCATTER)(pCovers + cCover);
+    pb = (PBYTE)(ppReq + c);
+    for(i = 0, c = 0; i < cSub; i = j) {
+        j = DeviceFPGA_Async2_ReadScatter_CoalesceSpan(ppSub, cSub, i, &qwEnd);
+        if(j - i < 2) { continue; }
+        pCover = pCovers + c++;
+        ZeroMemory(pCover, sizeof(MEM_SCATTER));
+        pCover->version = MEM_SCATTER_VERSION;
+        pCover->qwA = ppSub[i]->qwA;
+        pCover->cb = (DWORD)(qwEnd - pCover->qwA);
+        pCover->pb = pb;
+        pb += (pCover->cb + 7) & ~7;
+        MEM_SCATTER_STACK_PUSH(pCover, i);
+        MEM_SCATTER_STACK_PUSH(pCover, j - i);
+        for(; i < j; i++) {
+            ppSub[i]->f = TRUE;
         }
-        LeaveCriticalSection(&ctx->Lock);
     }
-    // 3: Restore MEMs (and retry if required):
     for(i = 0; i < cMEMs; i++) {
         pMEM = ppMEMs[i];
         if(!pMEM->f && MEM_SCATTER_ADDR_ISVALID(pMEM)) {
-            pMEM->f = pMEM->cb == MEM_SCATTER_STACK_POP(pMEM);
-            fFail = fFail || !pMEM->f;
+            ppReq[cReq++] = pMEM;
+        }
+    }
+    for(i = 0; i < cCover; i++) {
+        ppReq[cReq++] = pCovers + i;
+    }
+    // 4: read:
+    DeviceFPGA_Async2_ReadScatter_Request(ctxLC, ctx, cReq, ppReq);
+    // 5: copy covering reads to their MEMs (collect MEMs of failed covering reads):
+    for(c = 0; c < cCover; c++) {
+        pCover = pCovers + c;
+        j = (DWORD)MEM_SCATTER_STACK_POP(pCover);
+        i = (DWORD)MEM_SCATTER_STACK_POP(pCover);
+        for(j += i; i < j; i++) {
+            pMEM = ppSub[i];
+            if((pMEM->f = pCover->f)) {
+                memcpy(pMEM->pb, pCover->pb + (pMEM->qwA - pCover->qwA), pMEM->cb);
+            } else {
+                ppSub[cFail++] = pMEM;
+            }
         }
     }
-    if(fFail && fRetry) {
-        DeviceFPGA_Async2_ReadScatter(ctxLC, cMEMs, ppMEMs, FALSE);
+    InterlockedAdd64(&ctx->async2.cCoalesce, cMember);
+    // 6: read MEMs of failed covering reads individually:
+    if(cFail) {
+        DeviceFPGA_Async2_ReadScatter_Request(ctxLC, ctx, cFail, ppSub);
+    }
+    LocalFree(pbBuffer);
+    LocalFree(ppSub);
+    return TRUE;
+fail:
+    LocalFree(ppSub);
+    return FALSE;
+}
+
+/*
+* Async2 read scatter implementation. Sub-page MEMs in the same page are read
+* by covering reads (if coalescing is enabled) to save tags and TLPs.
+*/
+VOID DeviceFPGA_Async2_ReadScatter(_In_ PLC_CONTEXT ctxLC, _In_ DWORD cMEMs, _Inout_ PPMEM_SCATTER ppMEMs)
+{
+    PDEVICE_CONTEXT_FPGA ctx = (PDEVICE_CONTEXT_FPGA)ctxLC->hDevice;
+    if(ctx->async2.fCoalesce && (cMEMs > 1) && DeviceFPGA_Async2_ReadScatter_Coalesce(ctxLC, ctx, cMEMs, ppMEMs)) {
+        return;
+    }
+    DeviceFPGA_Async2_ReadScatter_Request(ctxLC, ctx, cMEMs, ppMEMs);
+}
+
+/*
+* Read a chain of dependent nodes (LcReadChain) with the async2 worker. The
+* worker transmits the read of the next node as soon as the previous node is
+* received - the chain is walked without returning to the caller.
+* -- ctxLC
+* -- pChain
+* -- return = FALSE if not supported (async2 not in use).
+*/
+_Success_(return)
+BOOL DeviceFPGA_ReadChain_DoLock(_In_ PLC_CONTEXT ctxLC, _Inout_ PLC_READCHAIN pChain)
+{
+    PDEVICE_CONTEXT_FPGA ctx = (PDEVICE_CONTEXT_FPGA)ctxLC->hDevice;
+    FPGA_NEWASYNC2_MEM_CONTEXT MemCtx = { 0 };
+    MEM_SCATTER MEM = { 0 };
+    PMEM_SCATTER pMEM = &MEM;
+    if(!ctx->wDeviceId || !ctx->async2.fEnabled || !ctx->async2.fNewAsync) { return FALSE; }
+    MEM.version = MEM_SCATTER_VERSION;
+    MEM.qwA = pChain->qwA;
+    MEM.cb = pChain->cbNode;
+    MEM.pb = pChain->pb;
+    LcMemMap_TranslateMEMs(ctxLC, 1, &pMEM);
+    if(MEM_SCATTER_ADDR_ISINVALID(pMEM)) {
+        pChain->dwStop = LC_READCHAIN_STOP_FAIL;
+        return TRUE;
+    }
+    MEM_SCATTER_STACK_PUSH(pMEM, 0);
+    MemCtx.cMEM = 1;
+    MemCtx.ppMEMs = &pMEM;
+    MemCtx.pChain = pChain;
+    MemCtx.qwAChain = pChain->qwA;
+    DeviceFPGA_Async2_SubmitWait(ctxLC, ctx, &MemCtx);
+    if(!pChain->dwStop) {
+        pChain->dwStop = LC_READCHAIN_STOP_FAIL;
     }
+    return TRUE;
 }
 
 /*
 * Async2 write scatter implementation. This will in the normal case just call
-* the normal write scatter implementation. If the device is busy, it will queue
-* the write request and wait for the device to become available.
+* the normal write scatter implementation. If the device is busy, the write is
+* submitted to the request queue and performed by the thread holding the device.
 */
 VOID DeviceFPGA_Async2_WriteScatter(_In_ PLC_CONTEXT ctxLC, _In_ DWORD cpMEMs, _Inout_ PPMEM_SCATTER ppMEMs)
 {
@@ -3133,19 +5237,14 @@ VOID DeviceFPGA_Async2_WriteScatter(_In_ PLC_CONTEXT ctxLC, _In_ DWORD cpMEMs, _
     if(TryEnterCriticalSection(&ctx->Lock)) {
         DeviceFPGA_WriteScatter(ctxLC, cpMEMs, ppMEMs);
         LeaveCriticalSection(&ctx->Lock);
+        DeviceFPGA_Async2_Read_Handoff(ctx);
         return;
     }
-    // 2: try lock failed -> queue and wait for lock:
+    // 2: try lock failed -> submit and wait for completion:
     MemCtx.fWrite = TRUE;
     MemCtx.cMEM = cpMEMs;
     MemCtx.ppMEMs = ppMEMs;
-    ObMap_Push(ctx->async2.pmQueue, 0, &MemCtx);
-    EnterCriticalSection(&ctx->Lock);
-    if(ObMap_Remove(ctx->async2.pmQueue, &MemCtx)) {
-        // if object is still in the queue, it means it was not processed yet.
-        DeviceFPGA_WriteScatter(ctxLC, cpMEMs, ppMEMs);
-    }
-    LeaveCriticalSection(&ctx->Lock);
+    DeviceFPGA_Async2_SubmitWait(ctxLC, ctx, &MemCtx);
 }
 
 
@@ -3234,7 +5333,7 @@ VOID DeviceFPGA_SynchOldAsync_RxTlpAsynchronous(_In_ PLC_CONTEXT ctxLC, _In_ PDE
         cbReadMax = 0x00103000; // "fake" async buffer magic value in FT2232H mode
         fAsync = FALSE;
     }
-    BusySleep(25);
+    DeviceFPGA_Wait_Delay(ctx, 25);
     status = ctx->dev.pfnFT_ReadPipe(ctx->dev.hFTDI, 0x82, pbBuffer, cbReadMax, &cbRead, NULL);
     if(status && (status != FT_IO_PENDING)) { return; }
     while(TRUE) {
@@ -3297,17 +5396,19 @@ DWORD DeviceFPGA_Tlp_Callback_ThreadProc(_In_ PLC_CONTEXT ctxLC)
 {
     PDEVICE_CONTEXT_FPGA ctx = (PDEVICE_CONTEXT_FPGA)ctxLC->hDevice;
     BOOL fActiveRun;
+    DWORD dwSeq;
     BYTE pbTlp[TLP_RX_MAX_SIZE];
     SIZE_T cbTlp;
-    QWORD tcInactivity = GetTickCount64();
     POB_BYTEQUEUE pObBqRx_Terminate = NULL, pObBqTx_Terminate = NULL;
     if(ctx->tlp_callback.fThread) { return 1; }
     ctx->tlp_callback.fThread = TRUE;
     InterlockedIncrement(&ctxLC->dwHandleCount);    // increment device handle count
     if(!(ctx->tlp_callback.pBqRx = ObByteQueue_New(NULL, 0x01000000))) { goto fail; }   // 16MB
     if(!(ctx->tlp_callback.pBqTx = ObByteQueue_New(NULL, 0x00100000))) { goto fail; }   //  1MB
+    DeviceFPGA_Wait_Idle(ctxLC, ctx, TRUE, 0);
     while(TRUE) {
         fActiveRun = FALSE;
+        dwSeq = ctx->wait.dwSeq;
         // Exit criteria?:
         if((ctxLC->dwHandleCount <= 1) || !ctx->tlp_callback.fThread || (!ctx->tlp_callback.pfnTlpCB && !ctx->tlp_callback.pfnBarCB)) {
             goto fail;
@@ -3347,6 +5448,7 @@ DWORD DeviceFPGA_Tlp_Callback_ThreadProc(_In_ PLC_CONTEXT ctxLC)
                     DeviceFPGA_Synch_RxTlpSynchronous(ctxLC, ctx, 0x00100000);
                 }
                 LeaveCriticalSection(&ctx->Lock);
+                DeviceFPGA_Async2_Read_Handoff(ctx);
             }
         }
         // PROCESS RECEIVED TLPs:
@@ -3363,16 +5465,8 @@ DWORD DeviceFPGA_Tlp_Callback_ThreadProc(_In_ PLC_CONTEXT ctxLC)
                 DeviceFPGA_Bar_RxTlp(ctxLC, ctx, pbTlp, (DWORD)cbTlp);
             }
         }
-        // SLEEP (if inactive):
-        if(fActiveRun) {
-            tcInactivity = GetTickCount64();
-        } else if((GetTickCount64() - tcInactivity) < 1000) {   // 1s inactivity
-            BusySleep(5);       // 5uS "sleep"
-        } else if((GetTickCount64() - tcInactivity) < 15000) {  // 15s inactivity
-            BusySleep(50);      // 50uS "sleep"
-        } else {
-            Sleep(16);          // 16ms sleep
-        }
+        // WAIT (spin / park if inactive):
+        DeviceFPGA_Wait_Idle(ctxLC, ctx, fActiveRun, dwSeq);
     }
 fail:
     pObBqRx_Terminate = ctx->tlp_callback.pBqRx; ctx->tlp_callback.pBqRx = NULL;
@@ -3392,14 +5486,27 @@ fail:
 VOID DeviceFPGA_ReadScatter_DoLock(_In_ PLC_CONTEXT ctxLC, _In_ DWORD cMEMs, _Inout_ PPMEM_SCATTER ppMEMs)
 {
     PDEVICE_CONTEXT_FPGA ctx = (PDEVICE_CONTEXT_FPGA)ctxLC->hDevice;
+    DWORD i;
+    BOOL fStatCpu = ctx->wait.fStatCpu;
+    QWORD cb = 0, cusCpu = 0;
     if(!ctx->wDeviceId) { return; }
+    if(fStatCpu) {
+        cusCpu = DeviceFPGA_Wait_ThreadCpuTime();
+    }
     if(ctx->async2.fEnabled) {
-        DeviceFPGA_Async2_ReadScatter(ctxLC, cMEMs, ppMEMs, ctx->perf.RETRY_ON_ERROR);
+        DeviceFPGA_Async2_ReadScatter(ctxLC, cMEMs, ppMEMs);
     } else {
         EnterCriticalSection(&ctx->Lock);
         DeviceFPGA_Synch_ReadScatter(ctxLC, cMEMs, ppMEMs);
         LeaveCriticalSection(&ctx->Lock);
     }
+    // read cpu time statistics (if enabled):
+    if(!fStatCpu) { return; }
+    for(i = 0; i < cMEMs; i++) {
+        if(ppMEMs[i]->f) { cb += ppMEMs[i]->cb; }
+    }
+    InterlockedAdd64(&ctx->wait.cusCpuRead, DeviceFPGA_Wait_ThreadCpuTime() - cusCpu);
+    InterlockedAdd64(&ctx->wait.cbRead, cb);
 }
 
 VOID DeviceFPGA_ProbeMEM_Impl(_In_ PLC_CONTEXT ctxLC, _In_ QWORD qwAddr, _In_ DWORD cPages, _Inout_updates_bytes_(cPages) PBYTE pbResultMap)
@@ -3454,13 +5561,13 @@ VOID DeviceFPGA_ProbeMEM_Impl(_In_ PLC_CONTEXT ctxLC, _In_ QWORD qwAddr, _In_ DW
         isFlush = (++cTxTlp % 24 == 0);
         if(isFlush) {
             DeviceFPGA_TxTlp(ctxLC, ctx, (PBYTE)tx, is32 ? 12 : 16, FALSE, TRUE);
-            BusySleep(ctx->perf.DELAY_PROBE_WRITE);
+            DeviceFPGA_Wait_Delay(ctx, ctx->perf.DELAY_PROBE_WRITE);
         } else {
             DeviceFPGA_TxTlp(ctxLC, ctx, (PBYTE)tx, is32 ? 12 : 16, FALSE, FALSE);
         }
     }
     DeviceFPGA_TxTlp(ctxLC, ctx, NULL, 0, TRUE, TRUE);
-    BusySleep(ctx->perf.DELAY_PROBE_READ);
+    DeviceFPGA_Wait_Delay(ctx, ctx->perf.DELAY_PROBE_READ);
     DeviceFPGA_Synch_RxTlpSynchronous(ctxLC, ctx, 0);
     ctx->hRxTlpCallbackFn = NULL;
     ctx->pMRdBufferX = NULL;
@@ -3599,6 +5706,32 @@ BOOL DeviceFPGA_WriteTlp(_In_ PLC_CONTEXT ctxLC, _In_ PBYTE pbTlp, _In_ DWORD cb
     return DeviceFPGA_TxTlp(ctxLC, ctx, pbTlp, cbTlp, FALSE, TRUE);
 }
 
+/*
+* Retrieve a custom register list from LcCommand input. The list is either a
+* BYTE[] of register numbers in pbDataIn or a range in the low option bits
+* as given by LC_CMD_FPGA_CUSTOM_READ_BULK_RANGE().
+* -- qwOptionLo
+* -- cbDataIn
+* -- pbDataIn
+* -- pbRegs = buffer to receive the register numbers.
+* -- return = number of registers, 0 on invalid input.
+*/
+DWORD DeviceFPGA_Command_CustomRegList(_In_ QWORD qwOptionLo, _In_ DWORD cbDataIn, _In_reads_opt_(cbDataIn) PBYTE pbDataIn, _Out_writes_(FPGA_CUSTOM_REG_MAX) PBYTE pbRegs)
+{
+    DWORD i, cReg;
+    if(pbDataIn) {
+        if(!cbDataIn || (cbDataIn > FPGA_CUSTOM_REG_MAX)) { return 0; }
+        memcpy(pbRegs, pbDataIn, cbDataIn);
+        return cbDataIn;
+    }
+    cReg = (qwOptionLo >> 8) & 0xFF;
+    if(!cReg || ((qwOptionLo & 0xFF) + cReg > FPGA_CUSTOM_REG_MAX)) { return 0; }
+    for(i = 0; i < cReg; i++) {
+        pbRegs[i] = (BYTE)((qwOptionLo & 0xFF) + i);
+    }
+    return cReg;
+}
+
 _Success_(return)
 BOOL DeviceFPGA_Command(
     _In_ PLC_CONTEXT ctxLC,
@@ -3778,6 +5911,74 @@ BOOL DeviceFPGA_Command(
                 DEBUG_PRINT("DeviceFPGA_Command: fOption=0x%016llX, extracted regNum=%d\n", fOption, regNum);
                 return DeviceFPGA_CustomWrite(ctx, regNum, *(PDWORD)pbDataIn);
             }
+        case LC_CMD_FPGA_CUSTOM_WRITE_VECTOR:
+            if(!pbDataIn || !cbDataIn || (cbDataIn % sizeof(FPGA_CUSTOM_WRITE_ENTRY))) { return FALSE; }
+            return DeviceFPGA_CustomWriteVector(ctx, cbDataIn / sizeof(FPGA_CUSTOM_WRITE_ENTRY), (PFPGA_CUSTOM_WRITE_ENTRY)pbDataIn, (qwOptionLo & LC_CMD_FPGA_CUSTOM_WRITE_VECTOR_BARRIER) ? TRUE : FALSE);
+        case LC_CMD_FPGA_CUSTOM_READ_BULK:
+            if(!ppbDataOut) { return FALSE; }
+            {
+                BYTE pbRegs[FPGA_CUSTOM_REG_MAX];
+                DWORD cReg;
+                if(!(cReg = DeviceFPGA_Command_CustomRegList(qwOptionLo, cbDataIn, pbDataIn, pbRegs))) { return FALSE; }
+                if(!(*ppbDataOut = LocalAlloc(LMEM_ZEROINIT, cReg * sizeof(DWORD)))) { return FALSE; }
+                if(DeviceFPGA_CustomShadow_Read(ctx, cReg, pbRegs, (PDWORD)*ppbDataOut)) {
+                    if(pcbDataOut) { *pcbDataOut = cReg * sizeof(DWORD); }
+                    return TRUE;
+                }
+            }
+            LocalFree(*ppbDataOut);
+            *ppbDataOut = NULL;
+            return FALSE;
+        case LC_CMD_FPGA_CUSTOM_SHADOW_INVALIDATE:
+        case LC_CMD_FPGA_CUSTOM_SHADOW_REFRESH:
+            {
+                BYTE pbRegs[FPGA_CUSTOM_REG_MAX];
+                DWORD cReg = 0;
+                if((pbDataIn || qwOptionLo) && !(cReg = DeviceFPGA_Command_CustomRegList(qwOptionLo, cbDataIn, pbDataIn, pbRegs))) { return FALSE; }
+                return DeviceFPGA_CustomShadow_Invalidate(ctx, cReg, pbRegs, (qwOptionHi == LC_CMD_FPGA_CUSTOM_SHADOW_REFRESH));
+            }
+        case LC_CMD_FPGA_CUSTOM_SHADOW_POLICY:
+            if(ppbDataOut) {
+                if(!(*ppbDataOut = LocalAlloc(0, sizeof(ctx->shadow.bPolicy)))) { return FALSE; }
+                memcpy(*ppbDataOut, ctx->shadow.bPolicy, sizeof(ctx->shadow.bPolicy));
+                if(pcbDataOut) { *pcbDataOut = sizeof(ctx->shadow.bPolicy); }
+                return TRUE;
+            }
+            if(((qwOptionLo & 0xff) >= FPGA_CUSTOM_REG_MAX) || (((qwOptionLo >> 8) & 0xff) > FPGA_CUSTOM_REG_POLICY_IMMUTABLE)) { return FALSE; }
+            ctx->shadow.bPolicy[qwOptionLo & 0xff] = (BYTE)(qwOptionLo >> 8);
+            ctx->shadow.fValid[qwOptionLo & 0xff] = 0;
+            return TRUE;
+        case LC_CMD_FPGA_CUSTOM_WATCH:
+            if(pbDataIn && (cbDataIn != sizeof(FPGA_CUSTOM_WATCH))) { return FALSE; }
+            return DeviceFPGA_CustomWatch(ctxLC, ctx, (PFPGA_CUSTOM_WATCH)pbDataIn);
+        case LC_CMD_FPGA_MAILBOX_READ:
+            if(!ppbDataOut) { return FALSE; }
+            {
+                DWORD o = qwOptionLo & 0xffff;
+                DWORD cb = qwOptionLo ? ((qwOptionLo >> 16) & 0xffff) : FPGA_MAILBOX_SIZE;
+                if(!cb || (o + cb > FPGA_MAILBOX_SIZE)) { return FALSE; }
+                if(!(*ppbDataOut = LocalAlloc(LMEM_ZEROINIT, cb))) { return FALSE; }
+                if(DeviceFPGA_MailboxRead(ctx, o, cb, *ppbDataOut)) {
+                    if(pcbDataOut) { *pcbDataOut = cb; }
+                    return TRUE;
+                }
+            }
+            LocalFree(*ppbDataOut);
+            *ppbDataOut = NULL;
+            return FALSE;
+        case LC_CMD_FPGA_MAILBOX_WRITE:
+            if(!pbDataIn || !cbDataIn) { return FALSE; }
+            return DeviceFPGA_MailboxWrite(ctx, qwOptionLo & 0xffff, cbDataIn, pbDataIn);
+        case LC_CMD_FPGA_PERF_COUNTERS:
+            if(!ppbDataOut) { return FALSE; }
+            if(!(*ppbDataOut = LocalAlloc(LMEM_ZEROINIT, sizeof(FPGA_PERF_COUNTERS)))) { return FALSE; }
+            if(DeviceFPGA_PerfCounters(ctx, (qwOptionLo & LC_CMD_FPGA_PERF_COUNTERS_CLEAR) ? TRUE : FALSE, (PFPGA_PERF_COUNTERS)*ppbDataOut)) {
+                if(pcbDataOut) { *pcbDataOut = sizeof(FPGA_PERF_COUNTERS); }
+                return TRUE;
+            }
+            LocalFree(*ppbDataOut);
+            *ppbDataOut = NULL;
+            return FALSE;
     }
     return FALSE;
 }
@@ -3801,6 +6002,7 @@ BOOL DeviceFPGA_Command_DoLock(_In_ PLC_CONTEXT ctxLC, _In_ QWORD fOption, _In_
                     } else {
                         ObByteQueue_Push(ctx->tlp_callback.pBqTx, 0, cbDataIn, pbDataIn);
                     }
+                    DeviceFPGA_Wait_Wake(ctx);
                     if(ppbDataOut) { *ppbDataOut = NULL; }
                     if(pcbDataOut) { *pcbDataOut = 0; }
                     return TRUE;
@@ -3825,6 +6027,7 @@ BOOL DeviceFPGA_Command_DoLock(_In_ PLC_CONTEXT ctxLC, _In_ QWORD fOption, _In_
                             }
                         }
                     }
+                    DeviceFPGA_Wait_Wake(ctx);
                     if(ppbDataOut) { *ppbDataOut = NULL; }
                     if(pcbDataOut) { *pcbDataOut = 0; }
                     return TRUE;
@@ -3887,6 +6090,15 @@ BOOL DeviceFPGA_GetOption(_In_ PLC_CONTEXT ctxLC, _In_ QWORD fOption, _Out_ PQWO
         case LC_OPT_FPGA_ALGO_TINY:
             *pqwValue = ctx->fAlgorithmReadTiny ? 1 : 0;
             return TRUE;
+        case LC_OPT_FPGA_ALGO_TINY_AUTO:
+            *pqwValue = ctx->tinymap.fLearn ? 1 : 0;
+            return TRUE;
+        case LC_OPT_FPGA_ALGO_TINY_RANGES:
+            *pqwValue = ctx->tinymap.c;
+            return TRUE;
+        case LC_OPT_FPGA_READ_COALESCE:
+            *pqwValue = ctx->async2.fCoalesce ? 1 : 0;
+            return TRUE;
         case LC_OPT_FPGA_ALGO_SYNCHRONOUS:
             *pqwValue = ctx->async2.fEnabled ? 1 : 0;
             return TRUE;
@@ -3899,6 +6111,48 @@ BOOL DeviceFPGA_GetOption(_In_ PLC_CONTEXT ctxLC, _In_ QWORD fOption, _Out_ PQWO
         case LC_OPT_FPGA_TLP_READ_CB_FILTERCPL:
             *pqwValue = ctx->tlp_callback.fNoCpl ? 1 : 0;
             return TRUE;
+        case LC_OPT_FPGA_CMD_TIMEOUT:
+            *pqwValue = ctx->cmd.dwTimeoutUs;
+            return TRUE;
+        case LC_OPT_FPGA_WAIT_SPIN:
+            *pqwValue = ctx->wait.cusSpinMax;
+            return TRUE;
+        case LC_OPT_FPGA_CMD_STAT_COUNT:
+            *pqwValue = ctx->cmd.c;
+            return TRUE;
+        case LC_OPT_FPGA_CMD_STAT_TIMEOUTS:
+            *pqwValue = ctx->cmd.cTimeout;
+            return TRUE;
+        case LC_OPT_FPGA_CMD_STAT_TIME:
+            *pqwValue = ctx->cmd.qwLatencyTotalUs;
+            return TRUE;
+        case LC_OPT_FPGA_CMD_STAT_TIME_MAX:
+            *pqwValue = ctx->cmd.qwLatencyMaxUs;
+            return TRUE;
+        case LC_OPT_FPGA_READ_STAT_STALE_TAGS:
+            *pqwValue = ctx->async2.cTagStale;
+            return TRUE;
+        case LC_OPT_FPGA_READ_STAT_REISSUES:
+            *pqwValue = ctx->async2.cReissue;
+            return TRUE;
+        case LC_OPT_FPGA_READ_STAT_REISSUE_BYTES:
+            *pqwValue = ctx->async2.cbReissue;
+            return TRUE;
+        case LC_OPT_FPGA_READ_STAT_COMBINED:
+            *pqwValue = ctx->async2.cCombine;
+            return TRUE;
+        case LC_OPT_FPGA_READ_STAT_CPU_TIME:
+            *pqwValue = ctx->wait.cusCpuRead;
+            return TRUE;
+        case LC_OPT_FPGA_READ_STAT_CPU_TIME_PER_MB:
+            *pqwValue = ctx->wait.cbRead ? (ctx->wait.cusCpuRead * 0x00100000 / ctx->wait.cbRead) : 0;
+            return TRUE;
+        case LC_OPT_FPGA_WAIT_STAT_PARKED:
+            *pqwValue = ctx->wait.cPark;
+            return TRUE;
+        case LC_OPT_FPGA_READ_STAT_COALESCED:
+            *pqwValue = ctx->async2.cCoalesce;
+            return TRUE;
     }
     return FALSE;
 }
@@ -3950,6 +6204,11 @@ BOOL DeviceFPGA_SetOption(_In_ PLC_CONTEXT ctxLC, _In_ QWORD fOption, _In_ QWORD
         case LC_OPT_FPGA_ALGO_TINY:
             ctx->fAlgorithmReadTiny = qwValue ? TRUE : FALSE;
             return TRUE;
+        case LC_OPT_FPGA_ALGO_TINY_AUTO:
+            return DeviceFPGA_TinyMap_SetLearn(ctxLC, ctx, qwValue ? TRUE : FALSE);
+        case LC_OPT_FPGA_READ_COALESCE:
+            ctx->async2.fCoalesce = qwValue ? TRUE : FALSE;
+            return TRUE;
         case LC_OPT_FPGA_ALGO_SYNCHRONOUS:
             ctx->async2.fEnabled =  (qwValue && ctx->dev.pfnFT_ReleaseOverlapped) ? TRUE : FALSE;
             return TRUE;
@@ -3961,6 +6220,15 @@ BOOL DeviceFPGA_SetOption(_In_ PLC_CONTEXT ctxLC, _In_ QWORD fOption, _In_ QWORD
         case LC_OPT_FPGA_TLP_READ_CB_FILTERCPL:
             ctx->tlp_callback.fNoCpl = qwValue ? TRUE : FALSE;
             return TRUE;
+        case LC_OPT_FPGA_CMD_TIMEOUT:
+            ctx->cmd.dwTimeoutUs = (DWORD)qwValue;
+            return TRUE;
+        case LC_OPT_FPGA_WAIT_SPIN:
+            ctx->wait.cusSpinMax = (DWORD)qwValue;
+            return TRUE;
+        case LC_OPT_FPGA_READ_STAT_CPU_TIME:
+            ctx->wait.fStatCpu = qwValue ? TRUE : FALSE;
+            return TRUE;
     }
     return FALSE;
 }
@@ -3992,16 +6260,278 @@ BOOL DeviceFPGA_SetOption_DoLock(_In_ PLC_CONTEXT ctxLC, _In_ QWORD fOption, _In
 #define FPGA_PARAMETER_DEVICE_ID       "bdf"
 #define FPGA_PARAMETER_DRIVER          "driver"
 #define FPGA_PARAMETER_FT601           "ft601"
+#define FPGA_PARAMETER_SIM             "sim"
+#define FPGA_PARAMETER_RX_RECORD       "rxrecord"
+#define FPGA_PARAMETER_CALIBRATE       "calibrate"
+#define FPGA_PARAMETER_PROFILE         "profile"
+#define FPGA_PARAMETER_WAIT_SPIN       "waitspin"
 
 #define FPGA_PARAMETER_ALGO_TINY                0x01
 #define FPGA_PARAMETER_ALGO_SYNCHRONOUS         0x02
 #define FPGA_PARAMETER_ALGO_OLDASYNCHRONOUS     0x04
+#define FPGA_PARAMETER_ALGO_TINY_AUTO           0x08
+
+// Performance profile calibration functionality below:
+
+#define FPGA_CALIBRATE_PROFILE_FILE     "leechcore_fpga_profile.txt"
+#define FPGA_CALIBRATE_PA               0x01000000  // calibration read start address
+#define FPGA_CALIBRATE_CPAGES           0x1000      // pages read per calibration run (16MB)
+#define FPGA_CALIBRATE_CRUN             3           // runs per calibration trial (fastest counts)
+#define FPGA_CALIBRATE_MODE_SYNC        0x01
+#define FPGA_CALIBRATE_MODE_ASYNC       0x02
+
+/*
+* Performance profile value swept by the calibration. The profile file keys
+* are the same as the device parameter names (if a parameter exists). Values
+* may be swept above the built-in profile value unless fLimit is set.
+*/
+typedef struct tdFPGA_CALIBRATE_KNOB {
+    LPSTR szName;
+    LONG oPerf;                 // offset in DEVICE_PERFORMANCE
+    DWORD dwMode;               // FPGA_CALIBRATE_MODE_* the value is calibrated in
+    BOOL fLimit;                // built-in profile value is a device maximum
+    DWORD cValue;
+    DWORD dwValue[6];
+} FPGA_CALIBRATE_KNOB, *PFPGA_CALIBRATE_KNOB;
+
+static const FPGA_CALIBRATE_KNOB FPGA_CALIBRATE_KNOBS[] = {
+    { FPGA_PARAMETER_READ_SIZE,  FIELD_OFFSET(DEVICE_PERFORMANCE, MAX_SIZE_RX),        FPGA_CALIBRATE_MODE_SYNC | FPGA_CALIBRATE_MODE_ASYNC, TRUE,  4, { 0x10000, 0x14000, 0x1c000, 0x30000 } },
+    { FPGA_PARAMETER_DELAY_READ, FIELD_OFFSET(DEVICE_PERFORMANCE, DELAY_READ),         FPGA_CALIBRATE_MODE_SYNC,                             FALSE, 6, { 0, 100, 200, 300, 400, 500 } },
+    { "asyncsize",               FIELD_OFFSET(DEVICE_PERFORMANCE, ASYNC_MAX_READSIZE), FPGA_CALIBRATE_MODE_ASYNC,                            FALSE, 4, { 0x8000, 0x10000, 0x20000, 0x40000 } },
+    { "asyncdelay1",             FIELD_OFFSET(DEVICE_PERFORMANCE, ASYNC_DELAY_1),      FPGA_CALIBRATE_MODE_ASYNC,                            FALSE, 4, { 0, 5, 10, 25 } },
+    { "asyncdelay2",             FIELD_OFFSET(DEVICE_PERFORMANCE, ASYNC_DELAY_2),      FPGA_CALIBRATE_MODE_ASYNC,                            FALSE, 4, { 0, 5, 10, 25 } },
+};
+
+#define FPGA_CALIBRATE_KNOB_VALUE(ctx, pk)  (*(PDWORD)((PBYTE)&(ctx)->perf + (pk)->oPerf))
+
+/*
+* Retrieve the profile file path and the profile key (FPGA ID and host name).
+* -- ctxLC
+* -- ctx
+* -- szFile
+* -- szKey
+*/
+VOID DeviceFPGA_Calibrate_ProfileKey(_In_ PLC_CONTEXT ctxLC, _In_ PDEVICE_CONTEXT_FPGA ctx, _Out_writes_(MAX_PATH) LPSTR szFile, _Out_writes_(MAX_PATH) LPSTR szKey)
+{
+    CHAR szHost[MAX_PATH] = { 0 };
+    DWORD cchHost = MAX_PATH - 1;
+    PLC_DEVICE_PARAMETER_ENTRY pParam;
+    if((pParam = LcDeviceParameterGet(ctxLC, FPGA_PARAMETER_PROFILE)) && pParam->szValue[0]) {
+        strncpy_s(szFile, MAX_PATH, pParam->szValue, _TRUNCATE);
+    } else {
+        Util_GetPathLib(szFile);
+        strcat_s(szFile, MAX_PATH - 1, FPGA_CALIBRATE_PROFILE_FILE);
+    }
+    if(!GetComputerNameA(szHost, &cchHost) || !szHost[0]) {
+        strcpy_s(szHost, MAX_PATH, "localhost");
+    }
+    _snprintf_s(szKey, MAX_PATH, _TRUNCATE, "fpga=0x%02x host=%.200s", ctx->wFpgaID, szHost);
+}
+
+/*
+* Load a calibrated performance profile for this FPGA and host from the profile
+* file (if any). Calibrated values replace the built-in profile values. Device
+* parameters given by the user are applied on top of the calibrated profile.
+* -- ctxLC
+* -- ctx
+* -- return = TRUE if a calibrated profile was loaded.
+*/
+_Success_(return)
+BOOL DeviceFPGA_Calibrate_ProfileLoad(_In_ PLC_CONTEXT ctxLC, _Inout_ PDEVICE_CONTEXT_FPGA ctx)
+{
+    FILE *hFile = NULL;
+    BOOL fResult = FALSE;
+    DWORD i, j, cchKey;
+    CHAR szFile[MAX_PATH], szKey[MAX_PATH], szLine[MAX_PATH], _szBuf[MAX_PATH], _szBuf2[MAX_PATH];
+    LPSTR psz[16], szName, szValue;
+    PFPGA_CALIBRATE_KNOB pk;
+    DeviceFPGA_Calibrate_ProfileKey(ctxLC, ctx, szFile, szKey);
+    cchKey = (DWORD)strlen(szKey);
+    if(fopen_s(&hFile, szFile, "r") || !hFile) { return FALSE; }
+    while(fgets(szLine, sizeof(szLine), hFile)) {
+        szLine[strcspn(szLine, "\r\n")] = 0;
+        if(strncmp(szLine, szKey, cchKey) || (szLine[cchKey] != ' ')) { continue; }
+        Util_SplitN(szLine + cchKey + 1, ' ', _countof(psz), _szBuf, psz);
+        for(i = 0; i < _countof(psz); i++) {
+            Util_Split2(psz[i], '=', _szBuf2, &szName, &szValue);
+            for(j = 0; j < _countof(FPGA_CALIBRATE_KNOBS); j++) {
+                pk = (PFPGA_CALIBRATE_KNOB)&FPGA_CALIBRATE_KNOBS[j];
+                if(szValue[0] && !strcmp(szName, pk->szName)) {
+                    FPGA_CALIBRATE_KNOB_VALUE(ctx, pk) = (DWORD)Util_GetNumericA(szValue);
+                }
+            }
+        }
+        fResult = TRUE;
+    }
+    fclose(hFile);
+    if(fResult) {
+        lcprintfv(ctxLC, "DEVICE: FPGA: Calibrated performance profile loaded from '%s'.\n", szFile);
+    }
+    return fResult;
+}
+
+/*
+* Save the current performance profile for this FPGA and host to the profile
+* file. Profiles of other FPGAs/hosts in the file are kept.
+* -- ctxLC
+* -- ctx
+* -- return
+*/
+_Success_(return)
+BOOL DeviceFPGA_Calibrate_ProfileSave(_In_ PLC_CONTEXT ctxLC, _In_ PDEVICE_CONTEXT_FPGA ctx)
+{
+    FILE *hFile = NULL;
+    PBYTE pbFile = NULL;
+    DWORD i, o = 0, cb = 0, cbFile = 0x00100000, cchKey;
+    CHAR szFile[MAX_PATH], szKey[MAX_PATH], szLine[MAX_PATH];
+    PFPGA_CALIBRATE_KNOB pk;
+    DeviceFPGA_Calibrate_ProfileKey(ctxLC, ctx, szFile, szKey);
+    cchKey = (DWORD)strlen(szKey);
+    if(!(pbFile = LocalAlloc(0, cbFile))) { return FALSE; }
+    // keep profiles of other FPGAs/hosts:
+    if(!fopen_s(&hFile, szFile, "r") && hFile) {
+        while(fgets(szLine, sizeof(szLine), hFile)) {
+            szLine[strcspn(szLine, "\r\n")] = 0;
+            if(!szLine[0] || (!strncmp(szLine, szKey, cchKey) && (szLine[cchKey] == ' '))) { continue; }
+            cb = (DWORD)strlen(szLine);
+            if(o + cb + 2 > cbFile) { break; }
+            memcpy(pbFile + o, szLine, cb);
+            o += cb;
+            pbFile[o++] = '\n';
+        }
+        fclose(hFile);
+        hFile = NULL;
+    }
+    // append this profile:
+    o += _snprintf_s((LPSTR)pbFile + o, cbFile - o, _TRUNCATE, "%s", szKey);
+    for(i = 0; i < _countof(FPGA_CALIBRATE_KNOBS); i++) {
+        pk = (PFPGA_CALIBRATE_KNOB)&FPGA_CALIBRATE_KNOBS[i];
+        o += _snprintf_s((LPSTR)pbFile + o, cbFile - o, _TRUNCATE, " %s=0x%x", pk->szName, FPGA_CALIBRATE_KNOB_VALUE(ctx, pk));
+    }
+    pbFile[o++] = '\n';
+    if(fopen_s(&hFile, szFile, "wb") || !hFile) {
+        lcprintf(ctxLC, "Device Info: FPGA: Unable to save calibrated performance profile to '%s'.\n", szFile);
+        LocalFree(pbFile);
+        return FALSE;
+    }
+    cb = (DWORD)fwrite(pbFile, 1, o, hFile);
+    fclose(hFile);
+    LocalFree(pbFile);
+    lcprintfv(ctxLC, "DEVICE: FPGA: Calibrated performance profile saved to '%s'.\n", szFile);
+    return cb == o;
+}
+
+/*
+* Set a performance profile value. The async read credits and the sync read rx
+* buffer limit follow the max read size. CALLER must ensure no read is ongoing.
+* -- ctx
+* -- pk
+* -- dwValue
+*/
+VOID DeviceFPGA_Calibrate_KnobSet(_Inout_ PDEVICE_CONTEXT_FPGA ctx, _In_ PFPGA_CALIBRATE_KNOB pk, _In_ DWORD dwValue)
+{
+    if(pk->oPerf == FIELD_OFFSET(DEVICE_PERFORMANCE, MAX_SIZE_RX)) {
+        if(ctx->async2.fNewAsync) {
+            ctx->async2.cbAvailCredits = ctx->async2.cbAvailCredits + dwValue - ctx->perf.MAX_SIZE_RX;
+        } else if(!ctx->dev.f2232h) {
+            ctx->rxbuf.cbMax = (DWORD)(1.30 * dwValue + 0x2000);
+        }
+    }
+    FPGA_CALIBRATE_KNOB_VALUE(ctx, pk) = dwValue;
+}
+
+/*
+* Calibration trial: read the calibration range with the current performance
+* profile a number of times.
+* -- ctxLC
+* -- ctx
+* -- ppMEMs = FPGA_CALIBRATE_CPAGES MEMs.
+* -- return = throughput (bytes/s) of the fastest run, or 0 on any read error
+*             or lost completion.
+*/
+QWORD DeviceFPGA_Calibrate_Trial(_In_ PLC_CONTEXT ctxLC, _In_ PDEVICE_CONTEXT_FPGA ctx, _Inout_ PPMEM_SCATTER ppMEMs)
+{
+    DWORD i, iRun;
+    QWORD qwFreq, tmStart, tmEnd, tmBest = (QWORD)-1, cTagStale;
+    QueryPerformanceFrequency((PLARGE_INTEGER)&qwFreq);
+    for(iRun = 0; iRun < FPGA_CALIBRATE_CRUN; iRun++) {
+        for(i = 0; i < FPGA_CALIBRATE_CPAGES; i++) {
+            ppMEMs[i]->qwA = FPGA_CALIBRATE_PA + ((QWORD)i << 12);
+            ppMEMs[i]->f = FALSE;
+        }
+        cTagStale = ctx->async2.cTagStale;
+        QueryPerformanceCounter((PLARGE_INTEGER)&tmStart);
+        DeviceFPGA_ReadScatter_DoLock(ctxLC, FPGA_CALIBRATE_CPAGES, ppMEMs);
+        QueryPerformanceCounter((PLARGE_INTEGER)&tmEnd);
+        if(cTagStale != ctx->async2.cTagStale) { return 0; }
+        for(i = 0; i < FPGA_CALIBRATE_CPAGES; i++) {
+            if(!ppMEMs[i]->f) { return 0; }
+        }
+        tmBest = min(tmBest, max(1, tmEnd - tmStart));
+    }
+    return (qwFreq * FPGA_CALIBRATE_CPAGES * 0x1000) / tmBest;
+}
+
+/*
+* Calibrate the performance profile values of the active read mode by short
+* read benchmarks. Each value is swept in turn (keeping the best value of the
+* previous ones) and the fastest value without read errors is kept - the
+* current value unless another is at least 2% faster. Values given as device
+* parameters by the user are not swept. The result is saved to the profile
+* file and is loaded automatically when the device is opened later on.
+* Calibration memory is read only - never written.
+* -- ctxLC
+* -- ctx
+* -- return
+*/
+_Success_(return)
+BOOL DeviceFPGA_Calibrate(_In_ PLC_CONTEXT ctxLC, _Inout_ PDEVICE_CONTEXT_FPGA ctx)
+{
+    DWORD i, j, dwMode, dwValue, dwValueBest, dwValueMax;
+    QWORD qwBps, qwBpsBest;
+    PPMEM_SCATTER ppMEMs = NULL;
+    PFPGA_CALIBRATE_KNOB pk;
+    dwMode = ctx->async2.fEnabled ? FPGA_CALIBRATE_MODE_ASYNC : FPGA_CALIBRATE_MODE_SYNC;
+    if(!LcAllocScatter1(FPGA_CALIBRATE_CPAGES, &ppMEMs)) { return FALSE; }
+    if(!(qwBpsBest = DeviceFPGA_Calibrate_Trial(ctxLC, ctx, ppMEMs))) {
+        lcprintf(ctxLC, "Device Info: FPGA: Calibration failed - unable to read calibration memory at 0x%llx.\n", (QWORD)FPGA_CALIBRATE_PA);
+        LcMemFree(ppMEMs);
+        return FALSE;
+    }
+    for(i = 0; i < _countof(FPGA_CALIBRATE_KNOBS); i++) {
+        pk = (PFPGA_CALIBRATE_KNOB)&FPGA_CALIBRATE_KNOBS[i];
+        if(!(pk->dwMode & dwMode) || LcDeviceParameterGetNumeric(ctxLC, pk->szName)) { continue; }
+        dwValueBest = dwValueMax = FPGA_CALIBRATE_KNOB_VALUE(ctx, pk);
+        for(j = 0; j < pk->cValue; j++) {
+            dwValue = pk->dwValue[j];
+            if((dwValue == dwValueBest) || (pk->fLimit && (dwValue > dwValueMax))) { continue; }
+            DeviceFPGA_Calibrate_KnobSet(ctx, pk, dwValue);
+            qwBps = DeviceFPGA_Calibrate_Trial(ctxLC, ctx, ppMEMs);
+            lcprintfvv(ctxLC, "DEVICE: FPGA: Calibrate: %s=0x%x -> %lli MB/s\n", pk->szName, dwValue, qwBps >> 20);
+            if(qwBps > qwBpsBest + qwBpsBest / 50) {
+                qwBpsBest = qwBps;
+                dwValueBest = dwValue;
+            }
+        }
+        DeviceFPGA_Calibrate_KnobSet(ctx, pk, dwValueBest);
+    }
+    LcMemFree(ppMEMs);
+    lcprintfv(ctxLC, "DEVICE: FPGA: Calibrated: %lli MB/s [readsize=0x%x,tmread=%i,asyncsize=0x%x,asyncdelay=%i,%i]\n",
+        qwBpsBest >> 20,
+        ctx->perf.MAX_SIZE_RX,
+        ctx->perf.DELAY_READ,
+        ctx->perf.ASYNC_MAX_READSIZE,
+        ctx->perf.ASYNC_DELAY_1,
+        ctx->perf.ASYNC_DELAY_2
+    );
+    return DeviceFPGA_Calibrate_ProfileSave(ctxLC, ctx);
+}
 
 _Success_(return)
 BOOL DeviceFPGA_Open(_Inout_ PLC_CONTEXT ctxLC, _Out_opt_ PPLC_CONFIG_ERRORINFO ppLcCreateErrorInfo)
 {
-    DWORD dwIpAddr;
-    QWORD v;
+    DWORD i, dwIpAddr;
+    QWORD v, qwFreq;
     LPSTR szDeviceError = NULL;
     PDEVICE_CONTEXT_FPGA ctx;
     PLC_DEVICE_PARAMETER_ENTRY pParam;
@@ -4012,9 +6542,18 @@ BOOL DeviceFPGA_Open(_Inout_ PLC_CONTEXT ctxLC, _Out_opt_ PPLC_CONFIG_ERRORINFO
     ctx = LocalAlloc(LMEM_ZEROINIT, sizeof(DEVICE_CONTEXT_FPGA));
     if(!ctx) { return FALSE; }
     InitializeCriticalSection(&ctx->Lock);
+    ctx->cmd.dwTimeoutUs = FPGA_CMD_TIMEOUT_DEFAULT_US;
+    ctx->wait.cusSpinMax = FPGA_WAIT_SPIN_DEFAULT_US;
+    if((pParam = LcDeviceParameterGet(ctxLC, FPGA_PARAMETER_WAIT_SPIN)) && pParam->szValue[0]) {
+        ctx->wait.cusSpinMax = (DWORD)Util_GetNumericA(pParam->szValue);
+    }
+    DeviceFPGA_CustomShadow_Initialize(ctx);
     ctxLC->hDevice = (HANDLE)ctx;
+    ctx->ctxLC = ctxLC;
     ctx->qwDeviceIndex = LcDeviceParameterGetNumeric(ctxLC, FPGA_PARAMETER_DEVICE_INDEX);
-    if((pParam = LcDeviceParameterGet(ctxLC, FPGA_PARAMETER_UDP_ADDRESS)) && pParam->szValue[0]) {
+    if(LcDeviceParameterGetNumeric(ctxLC, FPGA_PARAMETER_SIM)) {
+        szDeviceError = DeviceFPGA_InitializeSIM(ctx);
+    } else if((pParam = LcDeviceParameterGet(ctxLC, FPGA_PARAMETER_UDP_ADDRESS)) && pParam->szValue[0]) {
         dwIpAddr = inet_addr(pParam->szValue);
         szDeviceError = ((dwIpAddr == 0) || (dwIpAddr == (DWORD)-1)) ?
             "Bad IPv4 address" :
@@ -4042,9 +6581,9 @@ BOOL DeviceFPGA_Open(_Inout_ PLC_CONTEXT ctxLC, _Out_opt_ PPLC_CONFIG_ERRORINFO
         goto fail;
     }
     DeviceFPGA_SetPerformanceProfile(ctx);
+    DeviceFPGA_Calibrate_ProfileLoad(ctxLC, ctx);
+    if(!Util_RingBuf_Initialize(&ctx->rxbuf, 0x01000000)) { goto fail; }
     ctx->rxbuf.cbMax = ctx->dev.f2232h ? 0x01000000 : (DWORD)(1.30 * ctx->perf.MAX_SIZE_RX + 0x2000);  // buffer size tuned to lowest possible (+margin) for performance (FT601).
-    ctx->rxbuf.pb = LocalAlloc(0, 0x01000000);
-    if(!ctx->rxbuf.pb) { goto fail; }
     ctx->txbuf.cbMax = ctx->perf.MAX_SIZE_TX + 0x10000;
     ctx->txbuf.pb = LocalAlloc(0, ctx->txbuf.cbMax);
     if(!ctx->txbuf.pb) { goto fail; }
@@ -4056,6 +6595,7 @@ BOOL DeviceFPGA_Open(_Inout_ PLC_CONTEXT ctxLC, _Out_opt_ PPLC_CONFIG_ERRORINFO
     ctxLC->Config.fVolatile = TRUE;
     ctxLC->pfnClose = DeviceFPGA_Close;
     ctxLC->pfnReadScatter = DeviceFPGA_ReadScatter_DoLock;
+    ctxLC->pfnReadChain = DeviceFPGA_ReadChain_DoLock;
     ctxLC->pfnWriteScatter = DeviceFPGA_WriteScatter_DoLock;
     ctxLC->pfnGetOption = DeviceFPGA_GetOption_DoLock;
     ctxLC->pfnSetOption = DeviceFPGA_SetOption_DoLock;
@@ -4075,12 +6615,35 @@ BOOL DeviceFPGA_Open(_Inout_ PLC_CONTEXT ctxLC, _Out_opt_ PPLC_CONFIG_ERRORINFO
             ctx->async2.fEnabled = FALSE;
         } else {
             // new async (algo=0, 1):
-            if(!(ctx->async2.pmQueue = ObMap_New(NULL, OB_MAP_FLAGS_NOKEY))) { goto fail; }
+            ctx->async2.fNewAsync = TRUE;
+            ctx->async2.fCoalesce = TRUE;
             ctx->async2.cbAvailCredits = ctx->perf.MAX_SIZE_RX;
             ctx->async2.cAvailTags = 0xe0;
+            for(i = 0; i < 8; i++) {
+                ctx->async2.dwTagFree[i] = FPGA_NEWASYNC2_TAG_VALID(i);
+            }
+            QueryPerformanceFrequency((PLARGE_INTEGER)&qwFreq);
+            ctx->async2.tmTagStale = (qwFreq * FPGA_NEWASYNC2_TAG_STALE_US) / 1000000;
             ctx->rxbuf.cbMax = 0x01000000;
         }
     }
+    // async2 rx stream parser (and optional raw rx stream recording):
+    if(!(ctx->async2.pRxParse = LocalAlloc(0, sizeof(FPGA_RXPARSE_CONTEXT)))) { goto fail; }
+    FpgaRxParse_Initialize(ctx->async2.pRxParse, FPGA_RXPARSE_ISA_AVX2);
+    if((pParam = LcDeviceParameterGet(ctxLC, FPGA_PARAMETER_RX_RECORD)) && pParam->szValue[0]) {
+        if(fopen_s(&ctx->async2.hRxRecord, pParam->szValue, "wb") || !ctx->async2.hRxRecord) {
+            ctx->async2.hRxRecord = NULL;
+            lcprintf(ctxLC, "Device Info: FPGA: Unable to open rx stream recording file '%s'.\n", pParam->szValue);
+        }
+    }
+    // learn address ranges requiring the tiny read algorithm (algo=8):
+    if(LcDeviceParameterGetNumeric(ctxLC, FPGA_PARAMETER_READ_ALGORITHM) & FPGA_PARAMETER_ALGO_TINY_AUTO) {
+        DeviceFPGA_TinyMap_SetLearn(ctxLC, ctx, TRUE);
+    }
+    // opt-in performance profile calibration (persisted to the profile file):
+    if(LcDeviceParameterGetNumeric(ctxLC, FPGA_PARAMETER_CALIBRATE) && ctx->wDeviceId) {
+        DeviceFPGA_Calibrate(ctxLC, ctx);
+    }
     // return
     if(ctxLC->fPrintf[LC_PRINTF_V]) {
         *(PDWORD)pb200 = 0;
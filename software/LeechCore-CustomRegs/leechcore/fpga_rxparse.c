@@ -0,0 +1,585 @@
+// fpga_rxparse.c : implementation of the FPGA rx stream parser.
+//
+// (c) LeechCore contributors, 2025
+//
+#include "fpga_rxparse.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define FPGA_RXPARSE_X64
+#ifdef _WIN32
+#include <intrin.h>
+#define FPGA_RXPARSE_TARGET(isa)
+#else /* _WIN32 */
+#include <immintrin.h>
+#define FPGA_RXPARSE_TARGET(isa)        __attribute__((target(isa)))
+#endif /* _WIN32 */
+#endif /* _M_X64 || __x86_64__ */
+
+#define FPGA_RXPARSE_STATUS_VALID(dw)   (((dw) & 0xf0000000) == 0xe0000000)
+
+// popcount and index of lowest set bit of 7-bit block masks:
+static BYTE g_FpgaRxParse_Popcnt[0x80];
+static BYTE g_FpgaRxParse_Ctz[0x80];
+#ifdef FPGA_RXPARSE_X64
+// left-pack lookup tables: pshufb control per 4-bit mask and vpermd index per 7-bit mask:
+static BYTE g_FpgaRxParse_Shuffle4[0x10][16];
+static DWORD g_FpgaRxParse_Permute7[0x80][8];
+#endif /* FPGA_RXPARSE_X64 */
+// the lookup tables above are shared by all contexts and built once:
+static volatile DWORD g_FpgaRxParse_cTablesInit = 0;
+static volatile DWORD g_FpgaRxParse_fTablesReady = 0;
+
+
+
+// Common functionality below:
+
+/*
+* Compress the bits at nibble positions 0, 4, .., 24 to bits 0-6.
+*/
+static __forceinline DWORD FpgaRxParse_Compress(_In_ DWORD x)
+{
+    x = (x | (x >> 3)) & 0x03030303;
+    x = (x | (x >> 6)) & 0x000f000f;
+    return (x | (x >> 12)) & 0x7f;
+}
+
+/*
+* Classify the seven data DWORDs of a block from its status DWORD.
+* -- dwStatus
+* -- return = bits[6:0] TLP, bits[14:8] last DWORD of TLP, bits[22:16] reply (nibble 0x1, 0x3, 0x7).
+*/
+static __forceinline DWORD FpgaRxParse_Classify(_In_ DWORD dwStatus)
+{
+    DWORD t, l, c;
+    t = ~(dwStatus | (dwStatus >> 1)) & 0x01111111;
+    l = t & (dwStatus >> 2);
+    c = dwStatus & ~(dwStatus >> 3) & ~(~(dwStatus >> 1) & (dwStatus >> 2)) & 0x01111111;
+    return FpgaRxParse_Compress(t) | (FpgaRxParse_Compress(l) << 8) | (FpgaRxParse_Compress(c) << 16);
+}
+
+static __forceinline BOOL FpgaRxParse_BatchFull(_In_ PFPGA_RXPARSE_CONTEXT ctx)
+{
+    // a block may complete at most three valid TLPs (min TLP size is 3 DWORDs).
+    return (ctx->cdwArena >= FPGA_RXPARSE_ARENA_DW) || (ctx->cTlpBatch > FPGA_RXPARSE_BATCH_MAX - 4);
+}
+
+/*
+* Forward the replies of a block to the reply callback.
+*/
+VOID FpgaRxParse_Reply(_Inout_ PFPGA_RXPARSE_CONTEXT ctx, _In_ DWORD cm, _In_reads_(8) PDWORD pdwBlock, _In_opt_ PFN_FPGA_RXPARSE_REPLY_CB pfnReplyCB, _Inout_opt_ PVOID ctxReplyCB)
+{
+    DWORD k;
+    for(; cm; cm &= cm - 1) {
+        k = g_FpgaRxParse_Ctz[cm];
+        ctx->cReply++;
+        if(pfnReplyCB) {
+            pfnReplyCB(ctxReplyCB, (BYTE)((pdwBlock[0] >> (k << 2)) & 0x0f), pdwBlock[1 + k]);
+        }
+    }
+}
+
+/*
+* Skip the DWORDs of an oversized TLP until (and including) its last DWORD.
+* The TLP and last masks of the block are adjusted to the DWORDs remaining.
+*/
+VOID FpgaRxParse_Drop(_Inout_ PFPGA_RXPARSE_CONTEXT ctx, _Inout_ PDWORD ptm, _Inout_ PDWORD plm)
+{
+    DWORD k;
+    if(!*plm) {
+        *ptm = 0;
+        return;
+    }
+    k = g_FpgaRxParse_Ctz[*plm];
+    *ptm &= (0xfe << k) & 0x7f;
+    *plm &= *plm - 1;
+    ctx->fTlpDrop = FALSE;
+    ctx->cTlpBad++;
+}
+
+/*
+* Prepare a block for packing: forward replies and apply any ongoing drop.
+*/
+static __forceinline VOID FpgaRxParse_BlockBegin(_Inout_ PFPGA_RXPARSE_CONTEXT ctx, _In_ DWORD m, _In_reads_(8) PDWORD pdwBlock, _In_opt_ PFN_FPGA_RXPARSE_REPLY_CB pfnReplyCB, _Inout_opt_ PVOID ctxReplyCB, _Out_ PDWORD ptm, _Out_ PDWORD plm)
+{
+    *ptm = m & 0x7f;
+    *plm = (m >> 8) & 0x7f;
+    if(m >> 16) {
+        FpgaRxParse_Reply(ctx, m >> 16, pdwBlock, pfnReplyCB, ctxReplyCB);
+    }
+    if(ctx->fTlpDrop) {
+        FpgaRxParse_Drop(ctx, ptm, plm);
+    }
+}
+
+/*
+* Write payload DWORDs of the placed TLP to its destination. DWORDs exceeding
+* the destination size are discarded. While the destination has room for a
+* block a fixed size copy is used; bytes written beyond cdw DWORDs are within
+* the destination of this TLP and overwritten by its subsequent DWORDs.
+* -- ctx
+* -- pdw = DWORDs to write, 7 DWORDs must be readable.
+* -- cdw
+*/
+static __forceinline VOID FpgaRxParse_PlaceWrite(_Inout_ PFPGA_RXPARSE_CONTEXT ctx, _In_reads_(7) PDWORD pdw, _In_ DWORD cdw)
+{
+    DWORD i, cb;
+    if(ctx->cbPlace >= 7 * sizeof(DWORD)) {
+        memcpy(ctx->pbPlace, pdw, 7 * sizeof(DWORD));
+        cb = cdw << 2;
+    } else {
+        for(i = 0, cb = 0; (i < cdw) && (cb + sizeof(DWORD) <= ctx->cbPlace); i++, cb += sizeof(DWORD)) {
+            memcpy(ctx->pbPlace + cb, pdw + i, sizeof(DWORD));
+        }
+        for(; (i < cdw) && (cb < ctx->cbPlace); cb++) {
+            ctx->pbPlace[cb] = ((PBYTE)(pdw + i))[cb & 3];
+        }
+    }
+    ctx->pbPlace += cb;
+    ctx->cbPlace -= cb;
+    ctx->cdwPlace += cdw;
+}
+
+/*
+* Complete the placed TLP. Its header remains in the arena.
+*/
+static __forceinline VOID FpgaRxParse_PlaceEnd(_Inout_ PFPGA_RXPARSE_CONTEXT ctx)
+{
+    if(3 + ctx->cdwPlace > FPGA_RXPARSE_TLP_MAX_DW) {
+        ctx->cTlpBad++;
+        ctx->cdwArena = ctx->oTlp;
+    } else {
+        ctx->Tlp[ctx->cTlpBatch].o = ctx->oTlp;
+        ctx->Tlp[ctx->cTlpBatch].cdw = 3 + ctx->cdwPlace;
+        ctx->Tlp[ctx->cTlpBatch].pbPlaced = ctx->pbPlaceBase;
+        ctx->cTlpBatch++;
+        ctx->cTlp++;
+    }
+    ctx->oTlp = ctx->cdwArena;
+    ctx->pbPlaceBase = NULL;
+    ctx->pbPlace = NULL;
+    ctx->cbPlace = 0;
+    ctx->cdwPlace = 0;
+}
+
+/*
+* Write the DWORDs of the placed TLP in a block (up to and including its last
+* DWORD) to its destination. The TLP and last masks of the block are adjusted
+* to the DWORDs remaining.
+*/
+static __forceinline VOID FpgaRxParse_PlaceBlock(_Inout_ PFPGA_RXPARSE_CONTEXT ctx, _In_reads_(8) PDWORD pdwBlock, _Inout_ PDWORD ptm, _Inout_ PDWORD plm)
+{
+    DWORD i, k, mm, dw[7];
+    mm = *plm ? (*ptm & ((2 << g_FpgaRxParse_Ctz[*plm]) - 1)) : *ptm;
+    if(!(mm & (mm + 1))) {
+        FpgaRxParse_PlaceWrite(ctx, pdwBlock + 1, g_FpgaRxParse_Popcnt[mm]);
+    } else {
+        for(i = 0, k = mm; k; k &= k - 1) {
+            dw[i++] = pdwBlock[1 + g_FpgaRxParse_Ctz[k]];
+        }
+        FpgaRxParse_PlaceWrite(ctx, dw, i);
+    }
+    *ptm &= ~mm;
+    if(*plm) {
+        *plm &= *plm - 1;
+        FpgaRxParse_PlaceEnd(ctx);
+    }
+}
+
+/*
+* Ask the place callback for the payload destination of the TLP whose header
+* has just been received. Payload DWORDs already packed after the header are
+* moved to the destination.
+*/
+VOID FpgaRxParse_PlaceBegin(_Inout_ PFPGA_RXPARSE_CONTEXT ctx, _In_ PFN_FPGA_RXPARSE_PLACE_CB pfnPlaceCB, _Inout_opt_ PVOID ctxPlaceCB)
+{
+    PBYTE pb;
+    DWORD cb;
+    if(!pfnPlaceCB(ctxPlaceCB, ctx->dwArena + ctx->oTlp, &pb, &cb) || !pb) { return; }
+    ctx->pbPlaceBase = pb;
+    ctx->pbPlace = pb;
+    ctx->cbPlace = cb;
+    ctx->cdwPlace = 0;
+    FpgaRxParse_PlaceWrite(ctx, ctx->dwArena + ctx->oTlp + 3, ctx->cdwArena - ctx->oTlp - 3);
+    ctx->cdwArena = ctx->oTlp + 3;
+}
+
+/*
+* Emit the TLPs ending in a block once its TLP DWORDs are packed at cdwArena.
+* TLPs exceeding the max size are dropped. If the header of a new TLP is
+* completed by the block its payload placement is decided.
+*/
+static __forceinline VOID FpgaRxParse_BlockEnd(_Inout_ PFPGA_RXPARSE_CONTEXT ctx, _In_ DWORD tm, _In_ DWORD lm, _In_opt_ PFN_FPGA_RXPARSE_PLACE_CB pfnPlaceCB, _Inout_opt_ PVOID ctxPlaceCB)
+{
+    DWORD o, cdw, cdwBase = ctx->cdwArena, cdwHdr = lm ? 0 : ctx->cdwArena - ctx->oTlp;
+    for(; lm; lm &= lm - 1) {
+        o = cdwBase + g_FpgaRxParse_Popcnt[tm & ((2 << g_FpgaRxParse_Ctz[lm]) - 1)];
+        cdw = o - ctx->oTlp;
+        if((cdw < 3) || (cdw > FPGA_RXPARSE_TLP_MAX_DW)) {
+            ctx->cTlpBad++;
+        } else {
+            ctx->Tlp[ctx->cTlpBatch].o = ctx->oTlp;
+            ctx->Tlp[ctx->cTlpBatch].cdw = cdw;
+            ctx->Tlp[ctx->cTlpBatch].pbPlaced = NULL;
+            ctx->cTlpBatch++;
+            ctx->cTlp++;
+        }
+        ctx->oTlp = o;
+    }
+    ctx->cdwArena = cdwBase + g_FpgaRxParse_Popcnt[tm];
+    if(ctx->cdwArena - ctx->oTlp > FPGA_RXPARSE_TLP_MAX_DW) {
+        ctx->fTlpDrop = TRUE;
+        ctx->cdwArena = ctx->oTlp;
+    } else if(pfnPlaceCB && (cdwHdr < 3) && (ctx->cdwArena - ctx->oTlp >= 3)) {
+        FpgaRxParse_PlaceBegin(ctx, pfnPlaceCB, ctxPlaceCB);
+    }
+}
+
+
+
+// Scalar implementation below:
+
+/*
+* Process consecutive valid blocks.
+* -- return = number of blocks processed.
+*/
+DWORD FpgaRxParse_Blocks_Scalar(_Inout_ PFPGA_RXPARSE_CONTEXT ctx, _In_ DWORD cBlock, _In_reads_(cBlock * 8) PDWORD pdw, _In_opt_ PFN_FPGA_RXPARSE_REPLY_CB pfnReplyCB, _Inout_opt_ PVOID ctxReplyCB, _In_opt_ PFN_FPGA_RXPARSE_PLACE_CB pfnPlaceCB, _Inout_opt_ PVOID ctxPlaceCB)
+{
+    DWORD iBlock, i, k, tm, lm;
+    PDWORD pdwBlock, pdwDst;
+    for(iBlock = 0; iBlock < cBlock; iBlock++) {
+        pdwBlock = pdw + (iBlock << 3);
+        if(!FPGA_RXPARSE_STATUS_VALID(pdwBlock[0]) || FpgaRxParse_BatchFull(ctx)) { break; }
+        FpgaRxParse_BlockBegin(ctx, FpgaRxParse_Classify(pdwBlock[0]), pdwBlock, pfnReplyCB, ctxReplyCB, &tm, &lm);
+        if(ctx->pbPlaceBase && tm) {
+            FpgaRxParse_PlaceBlock(ctx, pdwBlock, &tm, &lm);
+        }
+        if(!tm) { continue; }
+        pdwDst = ctx->dwArena + ctx->cdwArena;
+        if(tm == 0x7f) {
+            memcpy(pdwDst, pdwBlock + 1, 7 * sizeof(DWORD));
+        } else {
+            for(i = 0, k = tm; k; k &= k - 1) {
+                pdwDst[i++] = pdwBlock[1 + g_FpgaRxParse_Ctz[k]];
+            }
+        }
+        FpgaRxParse_BlockEnd(ctx, tm, lm, pfnPlaceCB, ctxPlaceCB);
+    }
+    return iBlock;
+}
+
+/*
+* Retrieve the number of leading DWORDs which are not a valid status DWORD.
+*/
+DWORD FpgaRxParse_SkipInvalid(_In_ DWORD cdw, _In_reads_(cdw) PDWORD pdw)
+{
+    DWORD i = 0;
+#ifdef FPGA_RXPARSE_X64
+    DWORD m;
+    const __m128i vMask = _mm_set1_epi32((int)0xf0000000), vValid = _mm_set1_epi32((int)0xe0000000);
+    for(; i + 4 <= cdw; i += 4) {
+        m = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(_mm_loadu_si128((__m128i*)(pdw + i)), vMask), vValid)));
+        if(m) { return i + g_FpgaRxParse_Ctz[m]; }
+    }
+#endif /* FPGA_RXPARSE_X64 */
+    while((i < cdw) && !FPGA_RXPARSE_STATUS_VALID(pdw[i])) {
+        i++;
+    }
+    return i;
+}
+
+
+
+// SSSE3 / AVX2 implementation below:
+
+#ifdef FPGA_RXPARSE_X64
+
+FPGA_RXPARSE_TARGET("ssse3")
+static __forceinline __m128i FpgaRxParse_Compress_SSSE3(_In_ __m128i x)
+{
+    x = _mm_and_si128(_mm_or_si128(x, _mm_srli_epi32(x, 3)), _mm_set1_epi32(0x03030303));
+    x = _mm_and_si128(_mm_or_si128(x, _mm_srli_epi32(x, 6)), _mm_set1_epi32(0x000f000f));
+    return _mm_and_si128(_mm_or_si128(x, _mm_srli_epi32(x, 12)), _mm_set1_epi32(0x7f));
+}
+
+/*
+* Process consecutive valid blocks. Four status DWORDs are classified at a time
+* and TLP DWORDs are left-packed with pshufb (four + three DWORDs per block).
+* -- return = number of blocks processed.
+*/
+FPGA_RXPARSE_TARGET("ssse3")
+DWORD FpgaRxParse_Blocks_SSSE3(_Inout_ PFPGA_RXPARSE_CONTEXT ctx, _In_ DWORD cBlock, _In_reads_(cBlock * 8) PDWORD pdw, _In_opt_ PFN_FPGA_RXPARSE_REPLY_CB pfnReplyCB, _Inout_opt_ PVOID ctxReplyCB, _In_opt_ PFN_FPGA_RXPARSE_PLACE_CB pfnPlaceCB, _Inout_opt_ PVOID ctxPlaceCB)
+{
+    DWORD iBlock = 0, j, cGroup, tm, lm, m[4];
+    PDWORD pdwBlock, pdwDst;
+    __m128i vs, vt, vl, vc, v5;
+    const __m128i vK = _mm_set1_epi32(0x01111111);
+    const __m128i vMask = _mm_set1_epi32((int)0xf0000000), vValid = _mm_set1_epi32((int)0xe0000000);
+    while(iBlock < cBlock) {
+        pdwBlock = pdw + (iBlock << 3);
+        cGroup = min(4, cBlock - iBlock);
+        vs = _mm_setzero_si128();
+        if(cGroup == 4) {
+            vs = _mm_setr_epi32(pdwBlock[0], pdwBlock[8], pdwBlock[16], pdwBlock[24]);
+        }
+        if((cGroup == 4) && (0x0f == _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(vs, vMask), vValid))))) {
+            vt = _mm_andnot_si128(_mm_or_si128(vs, _mm_srli_epi32(vs, 1)), vK);
+            vl = _mm_and_si128(vt, _mm_srli_epi32(vs, 2));
+            v5 = _mm_andnot_si128(_mm_srli_epi32(vs, 1), _mm_srli_epi32(vs, 2));
+            vc = _mm_and_si128(_mm_andnot_si128(v5, _mm_andnot_si128(_mm_srli_epi32(vs, 3), vs)), vK);
+            vt = _mm_or_si128(FpgaRxParse_Compress_SSSE3(vt), _mm_slli_epi32(FpgaRxParse_Compress_SSSE3(vl), 8));
+            vt = _mm_or_si128(vt, _mm_slli_epi32(FpgaRxParse_Compress_SSSE3(vc), 16));
+            _mm_storeu_si128((__m128i*)m, vt);
+        } else {
+            for(j = 0; j < cGroup; j++) {
+                if(!FPGA_RXPARSE_STATUS_VALID(pdwBlock[j << 3])) { break; }
+                m[j] = FpgaRxParse_Classify(pdwBlock[j << 3]);
+            }
+            cBlock = iBlock + j;
+            cGroup = j;
+        }
+        for(j = 0; j < cGroup; j++, iBlock++) {
+            if(FpgaRxParse_BatchFull(ctx)) { return iBlock; }
+            pdwBlock = pdw + (iBlock << 3);
+            FpgaRxParse_BlockBegin(ctx, m[j], pdwBlock, pfnReplyCB, ctxReplyCB, &tm, &lm);
+            if(ctx->pbPlaceBase && tm) {
+                FpgaRxParse_PlaceBlock(ctx, pdwBlock, &tm, &lm);
+            }
+            if(!tm) { continue; }
+            pdwDst = ctx->dwArena + ctx->cdwArena;
+            _mm_storeu_si128((__m128i*)pdwDst, _mm_shuffle_epi8(_mm_loadu_si128((__m128i*)(pdwBlock + 1)), _mm_loadu_si128((__m128i*)g_FpgaRxParse_Shuffle4[tm & 0x0f])));
+            _mm_storeu_si128((__m128i*)(pdwDst + g_FpgaRxParse_Popcnt[tm & 0x0f]), _mm_shuffle_epi8(_mm_loadu_si128((__m128i*)(pdwBlock + 4)), _mm_loadu_si128((__m128i*)g_FpgaRxParse_Shuffle4[(tm >> 4) << 1])));
+            FpgaRxParse_BlockEnd(ctx, tm, lm, pfnPlaceCB, ctxPlaceCB);
+        }
+    }
+    return iBlock;
+}
+
+FPGA_RXPARSE_TARGET("avx2")
+static __forceinline __m256i FpgaRxParse_Compress_AVX2(_In_ __m256i x)
+{
+    x = _mm256_and_si256(_mm256_or_si256(x, _mm256_srli_epi32(x, 3)), _mm256_set1_epi32(0x03030303));
+    x = _mm256_and_si256(_mm256_or_si256(x, _mm256_srli_epi32(x, 6)), _mm256_set1_epi32(0x000f000f));
+    return _mm256_and_si256(_mm256_or_si256(x, _mm256_srli_epi32(x, 12)), _mm256_set1_epi32(0x7f));
+}
+
+/*
+* Process consecutive valid blocks. Eight status DWORDs are loaded and
+* classified at a time and the TLP DWORDs of each block are left-packed with a
+* single vpermd.
+* -- return = number of blocks processed.
+*/
+FPGA_RXPARSE_TARGET("avx2")
+DWORD FpgaRxParse_Blocks_AVX2(_Inout_ PFPGA_RXPARSE_CONTEXT ctx, _In_ DWORD cBlock, _In_reads_(cBlock * 8) PDWORD pdw, _In_opt_ PFN_FPGA_RXPARSE_REPLY_CB pfnReplyCB, _Inout_opt_ PVOID ctxReplyCB, _In_opt_ PFN_FPGA_RXPARSE_PLACE_CB pfnPlaceCB, _Inout_opt_ PVOID ctxPlaceCB)
+{
+    DWORD iBlock = 0, j, cGroup, tm, lm, m[8];
+    PDWORD pdwBlock;
+    __m256i vs, vt, vl, vc, v5;
+    const __m256i vK = _mm256_set1_epi32(0x01111111);
+    const __m256i vMask = _mm256_set1_epi32((int)0xf0000000), vValid = _mm256_set1_epi32((int)0xe0000000);
+    while(iBlock < cBlock) {
+        pdwBlock = pdw + (iBlock << 3);
+        cGroup = min(8, cBlock - iBlock);
+        vs = _mm256_setzero_si256();
+        if(cGroup == 8) {
+            vs = _mm256_setr_epi32(pdwBlock[0], pdwBlock[8], pdwBlock[16], pdwBlock[24], pdwBlock[32], pdwBlock[40], pdwBlock[48], pdwBlock[56]);
+        }
+        if((cGroup == 8) && (0xff == _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(vs, vMask), vValid))))) {
+            vt = _mm256_andnot_si256(_mm256_or_si256(vs, _mm256_srli_epi32(vs, 1)), vK);
+            vl = _mm256_and_si256(vt, _mm256_srli_epi32(vs, 2));
+            v5 = _mm256_andnot_si256(_mm256_srli_epi32(vs, 1), _mm256_srli_epi32(vs, 2));
+            vc = _mm256_and_si256(_mm256_andnot_si256(v5, _mm256_andnot_si256(_mm256_srli_epi32(vs, 3), vs)), vK);
+            vt = _mm256_or_si256(FpgaRxParse_Compress_AVX2(vt), _mm256_slli_epi32(FpgaRxParse_Compress_AVX2(vl), 8));
+            vt = _mm256_or_si256(vt, _mm256_slli_epi32(FpgaRxParse_Compress_AVX2(vc), 16));
+            _mm256_storeu_si256((__m256i*)m, vt);
+        } else {
+            for(j = 0; j < cGroup; j++) {
+                if(!FPGA_RXPARSE_STATUS_VALID(pdwBlock[j << 3])) { break; }
+                m[j] = FpgaRxParse_Classify(pdwBlock[j << 3]);
+            }
+            cBlock = iBlock + j;
+            cGroup = j;
+        }
+        for(j = 0; j < cGroup; j++, iBlock++) {
+            if(FpgaRxParse_BatchFull(ctx)) { return iBlock; }
+            pdwBlock = pdw + (iBlock << 3);
+            FpgaRxParse_BlockBegin(ctx, m[j], pdwBlock, pfnReplyCB, ctxReplyCB, &tm, &lm);
+            if(ctx->pbPlaceBase && tm) {
+                FpgaRxParse_PlaceBlock(ctx, pdwBlock, &tm, &lm);
+            }
+            if(!tm) { continue; }
+            _mm256_storeu_si256(
+                (__m256i*)(ctx->dwArena + ctx->cdwArena),
+                _mm256_permutevar8x32_epi32(_mm256_loadu_si256((__m256i*)pdwBlock), _mm256_loadu_si256((__m256i*)g_FpgaRxParse_Permute7[tm]))
+            );
+            FpgaRxParse_BlockEnd(ctx, tm, lm, pfnPlaceCB, ctxPlaceCB);
+        }
+    }
+    return iBlock;
+}
+
+/*
+* Retrieve the fastest implementation supported by the CPU and OS.
+*/
+DWORD FpgaRxParse_CpuIsa()
+{
+#ifdef _WIN32
+    int r[4];
+    BOOL fOsAvx;
+    __cpuid(r, 0);
+    if(r[0] < 7) { return FPGA_RXPARSE_ISA_SCALAR; }
+    __cpuid(r, 1);
+    if(!(r[2] & (1 << 9))) { return FPGA_RXPARSE_ISA_SCALAR; }
+    fOsAvx = (r[2] & (1 << 27)) && (r[2] & (1 << 28)) && ((_xgetbv(0) & 6) == 6);
+    __cpuidex(r, 7, 0);
+    return (fOsAvx && (r[1] & (1 << 5))) ? FPGA_RXPARSE_ISA_AVX2 : FPGA_RXPARSE_ISA_SSSE3;
+#else /* _WIN32 */
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")) { return FPGA_RXPARSE_ISA_AVX2; }
+    if(__builtin_cpu_supports("ssse3")) { return FPGA_RXPARSE_ISA_SSSE3; }
+    return FPGA_RXPARSE_ISA_SCALAR;
+#endif /* _WIN32 */
+}
+
+#endif /* FPGA_RXPARSE_X64 */
+
+
+
+// General functionality below:
+
+/*
+* Build the shared lookup tables. The first caller builds them, any concurrent
+* caller waits until they are ready so that no parser sees partial tables.
+*/
+static VOID FpgaRxParse_InitializeTables()
+{
+    DWORD m, j, k;
+    if(g_FpgaRxParse_fTablesReady) { return; }
+    if(InterlockedIncrement((volatile LONG*)&g_FpgaRxParse_cTablesInit) != 1) {
+        while(!g_FpgaRxParse_fTablesReady) {
+            SwitchToThread();
+        }
+        return;
+    }
+    for(m = 0; m < 0x80; m++) {
+        for(j = 0, k = 0; j < 7; j++) {
+            if((m >> j) & 1) {
+                if(!k) { g_FpgaRxParse_Ctz[m] = (BYTE)j; }
+                k++;
+            }
+        }
+        g_FpgaRxParse_Popcnt[m] = (BYTE)k;
+    }
+#ifdef FPGA_RXPARSE_X64
+    for(m = 0; m < 0x10; m++) {
+        memset(g_FpgaRxParse_Shuffle4[m], 0x80, 16);
+        for(j = 0, k = 0; j < 4; j++) {
+            if((m >> j) & 1) {
+                g_FpgaRxParse_Shuffle4[m][4 * k + 0] = (BYTE)(4 * j + 0);
+                g_FpgaRxParse_Shuffle4[m][4 * k + 1] = (BYTE)(4 * j + 1);
+                g_FpgaRxParse_Shuffle4[m][4 * k + 2] = (BYTE)(4 * j + 2);
+                g_FpgaRxParse_Shuffle4[m][4 * k + 3] = (BYTE)(4 * j + 3);
+                k++;
+            }
+        }
+    }
+    for(m = 0; m < 0x80; m++) {
+        ZeroMemory(g_FpgaRxParse_Permute7[m], sizeof(g_FpgaRxParse_Permute7[m]));
+        for(j = 0, k = 0; j < 7; j++) {
+            if((m >> j) & 1) {
+                g_FpgaRxParse_Permute7[m][k++] = 1 + j;
+            }
+        }
+    }
+#endif /* FPGA_RXPARSE_X64 */
+    InterlockedIncrement((volatile LONG*)&g_FpgaRxParse_fTablesReady);
+}
+
+VOID FpgaRxParse_Initialize(_Out_ PFPGA_RXPARSE_CONTEXT ctx, _In_ DWORD dwIsaMax)
+{
+    ZeroMemory(ctx, sizeof(FPGA_RXPARSE_CONTEXT));
+    FpgaRxParse_InitializeTables();
+#ifdef FPGA_RXPARSE_X64
+    ctx->dwIsa = min(dwIsaMax, FpgaRxParse_CpuIsa());
+#else /* FPGA_RXPARSE_X64 */
+    ctx->dwIsa = FPGA_RXPARSE_ISA_SCALAR;
+#endif /* FPGA_RXPARSE_X64 */
+}
+
+VOID FpgaRxParse_Reset(_Inout_ PFPGA_RXPARSE_CONTEXT ctx)
+{
+    ctx->fTlpDrop = FALSE;
+    ctx->oTlp = 0;
+    ctx->cdwArena = 0;
+    ctx->cTlpBatch = 0;
+    ctx->pbPlaceBase = NULL;
+    ctx->pbPlace = NULL;
+    ctx->cbPlace = 0;
+    ctx->cdwPlace = 0;
+}
+
+VOID FpgaRxParse_Unplace(_Inout_ PFPGA_RXPARSE_CONTEXT ctx)
+{
+    DWORD cb;
+    if(!ctx->pbPlaceBase) { return; }
+    // move the header of the TLP to the start of the arena:
+    memmove(ctx->dwArena, ctx->dwArena + ctx->oTlp, 3 * sizeof(DWORD));
+    ctx->oTlp = 0;
+    if(3 + ctx->cdwPlace > FPGA_RXPARSE_TLP_MAX_DW) {
+        ctx->fTlpDrop = TRUE;
+        ctx->cdwArena = 0;
+    } else {
+        // payload beyond the destination size was discarded - zero fill:
+        cb = (DWORD)(ctx->pbPlace - ctx->pbPlaceBase);
+        memcpy(ctx->dwArena + 3, ctx->pbPlaceBase, cb);
+        ZeroMemory((PBYTE)(ctx->dwArena + 3) + cb, (ctx->cdwPlace << 2) - cb);
+        ctx->cdwArena = 3 + ctx->cdwPlace;
+    }
+    ctx->pbPlaceBase = NULL;
+    ctx->pbPlace = NULL;
+    ctx->cbPlace = 0;
+    ctx->cdwPlace = 0;
+}
+
+DWORD FpgaRxParse_Parse(
+    _Inout_ PFPGA_RXPARSE_CONTEXT ctx,
+    _In_ DWORD cdwData,
+    _In_reads_(cdwData) PDWORD pdwData,
+    _In_opt_ PFN_FPGA_RXPARSE_REPLY_CB pfnReplyCB,
+    _Inout_opt_ PVOID ctxReplyCB,
+    _In_opt_ PFN_FPGA_RXPARSE_PLACE_CB pfnPlaceCB,
+    _Inout_opt_ PVOID ctxPlaceCB
+) {
+    DWORD i = 0, c, cBlock;
+    // move any partially received TLP to the start of the arena:
+    if(ctx->oTlp) {
+        memmove(ctx->dwArena, ctx->dwArena + ctx->oTlp, (ctx->cdwArena - ctx->oTlp) * sizeof(DWORD));
+        ctx->cdwArena -= ctx->oTlp;
+        ctx->oTlp = 0;
+    }
+    ctx->cTlpBatch = 0;
+    while(i + 8 <= cdwData) {
+        // skip over ftdi workaround dummy fillers / non valid DWORDs:
+        c = FpgaRxParse_SkipInvalid(cdwData - i, pdwData + i);
+        ctx->cdwFiller += c;
+        i += c;
+        if(i + 8 > cdwData) { break; }
+        // process run of valid blocks:
+        switch(ctx->dwIsa) {
+#ifdef FPGA_RXPARSE_X64
+            case FPGA_RXPARSE_ISA_AVX2:
+                cBlock = FpgaRxParse_Blocks_AVX2(ctx, (cdwData - i) >> 3, pdwData + i, pfnReplyCB, ctxReplyCB, pfnPlaceCB, ctxPlaceCB);
+                break;
+            case FPGA_RXPARSE_ISA_SSSE3:
+                cBlock = FpgaRxParse_Blocks_SSSE3(ctx, (cdwData - i) >> 3, pdwData + i, pfnReplyCB, ctxReplyCB, pfnPlaceCB, ctxPlaceCB);
+                break;
+#endif /* FPGA_RXPARSE_X64 */
+            default:
+                cBlock = FpgaRxParse_Blocks_Scalar(ctx, (cdwData - i) >> 3, pdwData + i, pfnReplyCB, ctxReplyCB, pfnPlaceCB, ctxPlaceCB);
+                break;
+        }
+        ctx->cBlock += cBlock;
+        i += cBlock << 3;
+        if(FpgaRxParse_BatchFull(ctx)) { break; }
+    }
+    return i;
+}
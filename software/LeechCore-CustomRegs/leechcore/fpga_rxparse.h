@@ -0,0 +1,130 @@
+// fpga_rxparse.h : definitions related to the FPGA rx stream parser.
+//
+// Data from the FPGA arrives in 32-byte blocks: one status DWORD (top nibble
+// 0xE) followed by seven data DWORDs. Nibble j of the status DWORD describes
+// data DWORD j: bits[1:0] = 00 PCIe TLP (bit[2] = last DWORD of the TLP),
+// 01 PCIe config reply, 11 command reply. Nibble 0xF marks unused slots.
+// Blocks may be separated by 0x55556666 ftdi workaround fillers.
+//
+// The parser classifies blocks in bulk, left-packs the TLP DWORDs of all
+// blocks into a contiguous arena and locates the TLP boundaries from the
+// status masks. Each call emits a batch of TLP descriptors into the arena.
+// SSSE3 and AVX2 implementations are selected at runtime (x64 only).
+//
+// Optionally the payload of a TLP may be placed directly at a destination
+// chosen by the caller once its header is received (e.g. a memory read
+// completion into its MEM buffer). Only the header is then kept in the arena.
+//
+// (c) LeechCore contributors, 2025
+//
+#ifndef __FPGA_RXPARSE_H__
+#define __FPGA_RXPARSE_H__
+#include "oscompatibility.h"
+
+#define FPGA_RXPARSE_TLP_MAX_DW         260         // (16+1024) / sizeof(DWORD)
+#define FPGA_RXPARSE_BATCH_MAX          0x100       // max TLP descriptors per batch
+#define FPGA_RXPARSE_ARENA_DW           0x4000      // arena size (DWORDs) before a batch is ended
+
+#define FPGA_RXPARSE_ISA_SCALAR         0
+#define FPGA_RXPARSE_ISA_SSSE3          1
+#define FPGA_RXPARSE_ISA_AVX2           2
+
+/*
+* Callback function receiving non-TLP replies (status nibble 0x1, 0x3, 0x7).
+* -- ctxReplyCB
+* -- bSrc = status nibble.
+* -- dwData = data DWORD as received.
+*/
+typedef VOID(*PFN_FPGA_RXPARSE_REPLY_CB)(_Inout_opt_ PVOID ctxReplyCB, _In_ BYTE bSrc, _In_ DWORD dwData);
+
+/*
+* Callback function deciding the payload placement of a TLP once its header
+* has been received. Called while parsing; the header must not be modified.
+* -- ctxPlaceCB
+* -- pdwHdr = the three first DWORDs of the TLP as received.
+* -- ppb = destination of the payload.
+* -- pcb = destination size. Payload bytes beyond it are discarded. The whole
+*          destination may be written if the TLP is shorter than it.
+* -- return = TRUE to place the payload, FALSE to keep the TLP in the arena.
+*/
+typedef BOOL(*PFN_FPGA_RXPARSE_PLACE_CB)(_Inout_opt_ PVOID ctxPlaceCB, _In_reads_(3) PDWORD pdwHdr, _Out_ PBYTE *ppb, _Out_ PDWORD pcb);
+
+typedef struct tdFPGA_RXPARSE_TLP {
+    DWORD o;                    // TLP offset in dwArena (in DWORDs)
+    DWORD cdw;                  // TLP length (in DWORDs)
+    PBYTE pbPlaced;             // payload destination if placed (only header in dwArena), otherwise NULL
+} FPGA_RXPARSE_TLP, *PFPGA_RXPARSE_TLP;
+
+typedef struct tdFPGA_RXPARSE_CONTEXT {
+    DWORD dwIsa;                // FPGA_RXPARSE_ISA_* in use
+    // statistics:
+    QWORD cBlock;
+    QWORD cTlp;
+    QWORD cTlpBad;
+    QWORD cReply;
+    QWORD cdwFiller;
+    // state carried between calls:
+    BOOL fTlpDrop;              // oversized TLP - drop DWORDs until its last DWORD
+    DWORD oTlp;                 // arena offset of the TLP currently being received
+    DWORD cdwArena;
+    // payload placement of the TLP currently being received (if any):
+    PBYTE pbPlaceBase;          // destination start (NULL if not placed)
+    PBYTE pbPlace;              // destination of next payload byte
+    DWORD cbPlace;              // destination bytes remaining
+    DWORD cdwPlace;             // payload DWORDs received
+    // batch result (valid until next call):
+    DWORD cTlpBatch;
+    FPGA_RXPARSE_TLP Tlp[FPGA_RXPARSE_BATCH_MAX];
+    DWORD dwArena[FPGA_RXPARSE_ARENA_DW + 16];
+} FPGA_RXPARSE_CONTEXT, *PFPGA_RXPARSE_CONTEXT;
+
+/*
+* Initialize a parser context. The fastest implementation supported by the CPU
+* (but not above dwIsaMax) is selected.
+* -- ctx
+* -- dwIsaMax = FPGA_RXPARSE_ISA_*
+*/
+VOID FpgaRxParse_Initialize(_Out_ PFPGA_RXPARSE_CONTEXT ctx, _In_ DWORD dwIsaMax);
+
+/*
+* Discard any partially received TLP. Must be called if the rx stream is
+* discarded without being parsed.
+* -- ctx
+*/
+VOID FpgaRxParse_Reset(_Inout_ PFPGA_RXPARSE_CONTEXT ctx);
+
+/*
+* Parse FPGA rx data. Complete blocks are consumed and their TLPs emitted as a
+* batch of descriptors in ctx->Tlp / ctx->cTlpBatch. A TLP spanning the end of
+* the data is kept in the context and completed by a subsequent call. Command
+* replies are forwarded to pfnReplyCB while parsing. Parsing stops early when
+* the batch is full; call until no more data is consumed.
+* -- ctx
+* -- cdwData = number of DWORDs in pdwData.
+* -- pdwData = FPGA data.
+* -- pfnReplyCB = optional callback receiving non-TLP replies.
+* -- ctxReplyCB
+* -- pfnPlaceCB = optional callback deciding payload placement of TLPs.
+* -- ctxPlaceCB
+* -- return = number of DWORDs consumed.
+*/
+DWORD FpgaRxParse_Parse(
+    _Inout_ PFPGA_RXPARSE_CONTEXT ctx,
+    _In_ DWORD cdwData,
+    _In_reads_(cdwData) PDWORD pdwData,
+    _In_opt_ PFN_FPGA_RXPARSE_REPLY_CB pfnReplyCB,
+    _Inout_opt_ PVOID ctxReplyCB,
+    _In_opt_ PFN_FPGA_RXPARSE_PLACE_CB pfnPlaceCB,
+    _Inout_opt_ PVOID ctxPlaceCB
+);
+
+/*
+* Revert the payload placement of a partially received TLP (if any). The
+* payload placed so far is copied back into the arena and the remainder of the
+* TLP is received into the arena. Must be called before a destination handed
+* out by the place callback becomes invalid.
+* -- ctx
+*/
+VOID FpgaRxParse_Unplace(_Inout_ PFPGA_RXPARSE_CONTEXT ctx);
+
+#endif /* __FPGA_RXPARSE_H__ */
@@ -35,6 +35,9 @@ _Success_(return) BOOL LeechRpc_Open(_Inout_ PLC_CONTEXT ctxLC, _Out_opt_ PPLC_C
 VOID LcCloseAll();
 _Success_(return) BOOL LcReadContigious_Initialize(_In_ PLC_CONTEXT ctxLC);
 VOID LcReadContigious_Close(_In_ PLC_CONTEXT ctxLC);
+VOID LcReadAhead_Close(_In_ PLC_CONTEXT ctxLC);
+VOID LcTranslate_Invalidate(_In_ PLC_CONTEXT ctxLC, _In_ QWORD paDTB);
+VOID LcReadScatter_Fetch(_In_ PLC_CONTEXT ctxLC, _In_ DWORD cMEMs, _Inout_ PPMEM_SCATTER ppMEMs);
 
 #ifdef _WIN32
 BOOL WINAPI DllMain(_In_ HINSTANCE hinstDLL, _In_ DWORD fdwReason, _In_ PVOID lpvReserved)
@@ -120,12 +123,17 @@ EXPORTED_FUNCTION VOID LcClose(_In_opt_ _Post_ptr_invalid_ HANDLE hLC)
                 ctxParent = (PLC_CONTEXT)ctxParent->FLink;
             }
         }
+        LcReadAhead_Close(ctxLC);
+        LcTranslate_Invalidate(ctxLC, 0);
         LcLockAcquire(ctxLC);
         LcReadContigious_Close(ctxLC);
         if(ctxLC->pfnClose) { ctxLC->pfnClose(ctxLC); }
         LcLockRelease(ctxLC);
         ctxLC->version = 0;
         DeleteCriticalSection(&ctxLC->Lock);
+        DeleteCriticalSection(&ctxLC->InFlight.Lock);
+        DeleteCriticalSection(&ctxLC->ReadAhead.Lock);
+        DeleteCriticalSection(&ctxLC->Translate.Lock);
         if(ctxLC->hDeviceModule) { FreeLibrary(ctxLC->hDeviceModule); }
         LocalFree(ctxLC->pMemMap);
         LocalFree(ctxLC);
@@ -399,8 +407,16 @@ VOID LcCreate_MemMapInitAddressDetect(_Inout_ PLC_CONTEXT ctxLC)
             }
         }
         if(fCheckTiny && !ppMEMs[ADDRDETECT_MAX]->f) {
-            ctxLC->pfnSetOption(ctxLC, LC_OPT_FPGA_ALGO_TINY, 1);
-            lcprintfv(ctxLC, "FPGA: TINY PCIe TLP algrithm auto-selected!\n");
+            // prefer tiny reads only in address ranges failing 4K reads (learned by
+            // the device - starting with the probe page), otherwise use tiny reads
+            // for all reads:
+            if(ctxLC->pfnSetOption(ctxLC, LC_OPT_FPGA_ALGO_TINY_AUTO, 1)) {
+                LcReadScatter(ctxLC, 1, ppMEMs + ADDRDETECT_MAX);
+                lcprintfv(ctxLC, "FPGA: TINY PCIe TLP algorithm auto-selected for failing address ranges!\n");
+            } else {
+                ctxLC->pfnSetOption(ctxLC, LC_OPT_FPGA_ALGO_TINY, 1);
+                lcprintfv(ctxLC, "FPGA: TINY PCIe TLP algrithm auto-selected!\n");
+            }
         }
     }
     // 3: finish
@@ -450,6 +466,9 @@ EXPORTED_FUNCTION HANDLE LcCreateEx(_Inout_ PLC_CONFIG pLcCreateConfig, _Out_opt
     pLcCreateConfig->fRemote = FALSE;
     memcpy(&ctxLC->Config, pLcCreateConfig, sizeof(LC_CONFIG));
     InitializeCriticalSection(&ctxLC->Lock);
+    InitializeCriticalSection(&ctxLC->InFlight.Lock);
+    InitializeCriticalSection(&ctxLC->ReadAhead.Lock);
+    InitializeCriticalSection(&ctxLC->Translate.Lock);
     ctxLC->version = LC_CONTEXT_VERSION;
     ctxLC->dwHandleCount = 1;
     ctxLC->cMemMapMax = 0x20;
@@ -796,10 +815,534 @@ fail:
 
 
 
+// ----------------------------------------------------------------------------
+// READ IN-FLIGHT (DUPLICATE PAGE SUPPRESSION) FUNCTIONALITY BELOW:
+// ----------------------------------------------------------------------------
+
+/*
+* In-flight table entry - one per MEM of a LcReadScatter() call. A page read
+* by a call is owned by it while in flight. Other calls requesting the same
+* page attach to the owner and receive a copy of the result.
+*/
+typedef struct tdLC_INFLIGHT_ENTRY {
+    struct tdLC_INFLIGHT_ENTRY *FLink;      // owner: hash bucket link, attached: next attached entry
+    struct tdLC_INFLIGHT_ENTRY *pAttach;    // owner: entries attached to this page
+    QWORD pa;
+    PMEM_SCATTER pMEM;                      // NULL if not in the in-flight table
+    volatile DWORD *pcPending;              // attached: pending counter of the attached call, owner: NULL
+} LC_INFLIGHT_ENTRY, *PLC_INFLIGHT_ENTRY;
+
+/*
+* A read started while no other read is active (solo read) does not register
+* its MEMs. They are published to the in-flight table by the next read that
+* starts while the solo read is still in progress.
+*/
+typedef struct tdLC_INFLIGHT_SOLO {
+    DWORD cMEMs;
+    PPMEM_SCATTER ppMEMs;
+    PLC_INFLIGHT_ENTRY pEntries;            // set if published by another read
+} LC_INFLIGHT_SOLO, *PLC_INFLIGHT_SOLO;
+
+#define LC_INFLIGHT_HASH(pa)                ((DWORD)((pa) >> 12) & (LC_INFLIGHT_BUCKETS - 1))
+
+/*
+* Publish the MEMs of an in-progress solo read (if any) to the in-flight table
+* as owned by the solo read. Only the address/size of the MEMs are inspected
+* since the solo read may be completing them concurrently.
+* CALLER must hold ctxLC->InFlight.Lock.
+* -- ctxLC
+*/
+VOID LcInFlight_PublishSolo(_In_ PLC_CONTEXT ctxLC)
+{
+    DWORD i, iBucket;
+    PMEM_SCATTER pMEM;
+    PLC_INFLIGHT_ENTRY pe;
+    PLC_INFLIGHT_SOLO pSolo;
+    if(!(pSolo = (PLC_INFLIGHT_SOLO)InterlockedExchangePointer(&ctxLC->InFlight.pSolo, NULL))) { return; }
+    if(!(pSolo->pEntries = LocalAlloc(0, pSolo->cMEMs * sizeof(LC_INFLIGHT_ENTRY)))) { return; }
+    for(i = 0; i < pSolo->cMEMs; i++) {
+        pe = pSolo->pEntries + i;
+        pMEM = pSolo->ppMEMs[i];
+        pe->pMEM = NULL;
+        if(MEM_SCATTER_ADDR_ISINVALID(pMEM) || (pMEM->cb != 0x1000) || (pMEM->qwA & 0xfff)) {
+            continue;
+        }
+        iBucket = LC_INFLIGHT_HASH(pMEM->qwA);
+        pe->pa = pMEM->qwA;
+        pe->pMEM = pMEM;
+        pe->pcPending = NULL;
+        pe->pAttach = NULL;
+        pe->FLink = (PLC_INFLIGHT_ENTRY)ctxLC->InFlight.pBucket[iBucket];
+        ctxLC->InFlight.pBucket[iBucket] = pe;
+    }
+}
+
+/*
+* Start a solo read - i.e. a read started while no other read is active. The
+* MEMs are fetched in full without taking the in-flight lock.
+* CALLER must call LcInFlight_EndSolo() and LcInFlight_End().
+* -- ctxLC
+* -- pSolo = caller allocated solo read context.
+* -- cMEMs
+* -- ppMEMs
+*/
+VOID LcInFlight_BeginSolo(_In_ PLC_CONTEXT ctxLC, _Out_ PLC_INFLIGHT_SOLO pSolo, _In_ DWORD cMEMs, _In_ PPMEM_SCATTER ppMEMs)
+{
+    pSolo->cMEMs = cMEMs;
+    pSolo->ppMEMs = ppMEMs;
+    pSolo->pEntries = NULL;
+    if(cMEMs) {
+        InterlockedExchangePointer(&ctxLC->InFlight.pSolo, pSolo);
+    }
+}
+
+/*
+* Complete a solo read started by LcInFlight_BeginSolo().
+* -- ctxLC
+* -- pSolo
+* -- return = in-flight entries to pass to LcInFlight_End() if the MEMs were
+*             published by another read, otherwise NULL.
+*/
+PLC_INFLIGHT_ENTRY LcInFlight_EndSolo(_In_ PLC_CONTEXT ctxLC, _In_ PLC_INFLIGHT_SOLO pSolo)
+{
+    if(!pSolo->cMEMs) { return NULL; }
+    if(InterlockedCompareExchangePointer(&ctxLC->InFlight.pSolo, NULL, pSolo) == pSolo) {
+        return NULL;
+    }
+    // published by another read - wait until publishing is completed:
+    EnterCriticalSection(&ctxLC->InFlight.Lock);
+    LeaveCriticalSection(&ctxLC->InFlight.Lock);
+    return pSolo->pEntries;
+}
+
+/*
+* Register the MEMs of a read in the in-flight table. Pages already in flight
+* are attached to their owner and removed from the MEMs to fetch from the
+* device. Other pages are registered as owned by this read, since a read
+* starting later may attach to them. An in-progress solo read is published
+* first so that this read may attach to its pages.
+* CALLER must call LcInFlight_End() regardless of the result.
+* -- ctxLC
+* -- cMEMs
+* -- ppMEMs
+* -- pcPending = receives the number of attached MEMs.
+* -- pcMEMsFetch = receives the number of MEMs to fetch from the device.
+* -- pppMEMsFetch = receives the MEMs to fetch from the device.
+* -- return = in-flight entries (LocalFree'd by LcInFlight_End), or NULL if
+*             no MEM was registered - all MEMs should be fetched.
+*/
+PLC_INFLIGHT_ENTRY LcInFlight_Begin(_In_ PLC_CONTEXT ctxLC, _In_ DWORD cMEMs, _In_ PPMEM_SCATTER ppMEMs, _Out_ volatile DWORD *pcPending, _Out_ PDWORD pcMEMsFetch, _Out_ PPMEM_SCATTER *pppMEMsFetch)
+{
+    DWORD i, iBucket, cFetch = 0;
+    PMEM_SCATTER pMEM;
+    PPMEM_SCATTER ppMEMsFetch;
+    PLC_INFLIGHT_ENTRY pe, peOwner, pEntries;
+    *pcPending = 0;
+    *pcMEMsFetch = cMEMs;
+    *pppMEMsFetch = ppMEMs;
+    if(!cMEMs) { return NULL; }
+    if(!(pEntries = LocalAlloc(0, cMEMs * (sizeof(LC_INFLIGHT_ENTRY) + sizeof(PMEM_SCATTER))))) { return NULL; }
+    ppMEMsFetch = (PPMEM_SCATTER)(pEntries + cMEMs);
+    EnterCriticalSection(&ctxLC->InFlight.Lock);
+    LcInFlight_PublishSolo(ctxLC);
+    for(i = 0; i < cMEMs; i++) {
+        pe = pEntries + i;
+        pMEM = ppMEMs[i];
+        pe->pMEM = NULL;
+        if(pMEM->f || MEM_SCATTER_ADDR_ISINVALID(pMEM) || (pMEM->cb != 0x1000) || (pMEM->qwA & 0xfff)) {
+            ppMEMsFetch[cFetch++] = pMEM;
+            continue;
+        }
+        iBucket = LC_INFLIGHT_HASH(pMEM->qwA);
+        peOwner = (PLC_INFLIGHT_ENTRY)ctxLC->InFlight.pBucket[iBucket];
+        while(peOwner && (peOwner->pa != pMEM->qwA)) {
+            peOwner = peOwner->FLink;
+        }
+        pe->pa = pMEM->qwA;
+        pe->pMEM = pMEM;
+        if(peOwner) {
+            // page already in flight -> attach:
+            pe->pcPending = pcPending;
+            pe->FLink = peOwner->pAttach;
+            peOwner->pAttach = pe;
+            (*pcPending)++;
+            ctxLC->InFlight.cHit++;
+        } else {
+            // page not in flight -> register as owner and fetch:
+            pe->pcPending = NULL;
+            pe->pAttach = NULL;
+            pe->FLink = (PLC_INFLIGHT_ENTRY)ctxLC->InFlight.pBucket[iBucket];
+            ctxLC->InFlight.pBucket[iBucket] = pe;
+            ppMEMsFetch[cFetch++] = pMEM;
+        }
+    }
+    LeaveCriticalSection(&ctxLC->InFlight.Lock);
+    *pcMEMsFetch = cFetch;
+    *pppMEMsFetch = ppMEMsFetch;
+    return pEntries;
+}
+
+/*
+* Complete a read registered by LcInFlight_Begin(). Owned pages are removed
+* from the in-flight table and their result is copied to attached MEMs (of
+* any read). Then wait for the pages this read is attached to.
+* -- ctxLC
+* -- cMEMs
+* -- pEntries
+* -- pcPending
+*/
+VOID LcInFlight_End(_In_ PLC_CONTEXT ctxLC, _In_ DWORD cMEMs, _In_opt_ _Post_ptr_invalid_ PLC_INFLIGHT_ENTRY pEntries, _Inout_ volatile DWORD *pcPending)
+{
+    DWORD i, cPending;
+    PLC_INFLIGHT_ENTRY pe, peAttach, peNext, *ppe;
+    volatile DWORD *pcPendingAttach;
+    if(pEntries) {
+        EnterCriticalSection(&ctxLC->InFlight.Lock);
+        for(i = 0; i < cMEMs; i++) {
+            pe = pEntries + i;
+            if(!pe->pMEM || pe->pcPending) { continue; }
+            // unlink owned page from the in-flight table:
+            ppe = (PLC_INFLIGHT_ENTRY*)&ctxLC->InFlight.pBucket[LC_INFLIGHT_HASH(pe->pa)];
+            while(*ppe != pe) {
+                ppe = &(*ppe)->FLink;
+            }
+            *ppe = pe->FLink;
+            // complete attached MEMs (the attached call may return once its pending counter reaches zero):
+            for(peAttach = pe->pAttach; peAttach; peAttach = peNext) {
+                peNext = peAttach->FLink;
+                if(pe->pMEM->f) {
+                    memcpy(peAttach->pMEM->pb, pe->pMEM->pb, 0x1000);
+                    peAttach->pMEM->f = TRUE;
+                }
+                pcPendingAttach = peAttach->pcPending;
+                if(!InterlockedDecrement(pcPendingAttach)) {
+                    WakeByAddressAll((PVOID)pcPendingAttach);
+                }
+            }
+        }
+        LeaveCriticalSection(&ctxLC->InFlight.Lock);
+        // wait for attached pages owned by other reads:
+        while((cPending = *pcPending)) {
+            WaitOnAddress(pcPending, &cPending, sizeof(DWORD), INFINITE);
+        }
+        MemoryBarrier();
+        LocalFree(pEntries);
+    }
+}
+
+
+
+// ----------------------------------------------------------------------------
+// READ-AHEAD (SEQUENTIAL STREAM PREFETCH) FUNCTIONALITY BELOW:
+// ----------------------------------------------------------------------------
+
+#define LC_READAHEAD_PAGES_MAX              0x1000      // max prefetch window: 16MB
+#define LC_READAHEAD_SEQ_MIN                2           // number of reads continuing a run before prefetch starts
+#define LC_READAHEAD_EXPIRE_MS              1000        // prefetched pages older than this are not served
+
+/*
+* Drop the first pages from the prefetch buffer. Pages read successfully but
+* never served are counted as waste. Remaining pages are moved to the front.
+* CALLER must hold ReadAhead.Lock and no fill may be in progress.
+* -- ctxLC
+* -- c = number of pages to drop.
+*/
+VOID LcReadAhead_Drop(_In_ PLC_CONTEXT ctxLC, _In_ DWORD c)
+{
+    DWORD i, cWindow = ctxLC->ReadAhead.cPageWindow;
+    PPMEM_SCATTER ppMEMs = ctxLC->ReadAhead.ppMEMs;
+    c = min(c, ctxLC->ReadAhead.cPage);
+    if(!c) { return; }
+    for(i = 0; i < c; i++) {
+        if(ppMEMs[i]->f && !ctxLC->ReadAhead.pbUsed[i]) {
+            ctxLC->ReadAhead.cWaste++;
+        }
+    }
+    memcpy(ctxLC->ReadAhead.ppMEMsSwap, ppMEMs, c * sizeof(PMEM_SCATTER));
+    memmove(ppMEMs, ppMEMs + c, (cWindow - c) * sizeof(PMEM_SCATTER));
+    memcpy(ppMEMs + cWindow - c, ctxLC->ReadAhead.ppMEMsSwap, c * sizeof(PMEM_SCATTER));
+    memmove(ctxLC->ReadAhead.pbUsed, ctxLC->ReadAhead.pbUsed + c, cWindow - c);
+    ctxLC->ReadAhead.cPage -= c;
+    ctxLC->ReadAhead.paBase += (QWORD)c << 12;
+}
+
+/*
+* Serve MEMs from the prefetch buffer. If a page is currently being prefetched
+* the fill is waited for. MEMs are assumed to not yet be translated by the
+* memory map.
+* -- ctxLC
+* -- cMEMs
+* -- ppMEMs
+*/
+VOID LcReadAhead_Serve(_In_ PLC_CONTEXT ctxLC, _In_ DWORD cMEMs, _Inout_ PPMEM_SCATTER ppMEMs)
+{
+    DWORD i = 0, iPage, fFill;
+    PMEM_SCATTER pMEM, pMEMBuffer;
+    if(!ctxLC->ReadAhead.fActive) { return; }
+    EnterCriticalSection(&ctxLC->ReadAhead.Lock);
+    if(!ctxLC->ReadAhead.fFill && (GetTickCount64() - ctxLC->ReadAhead.tcFill > LC_READAHEAD_EXPIRE_MS)) {
+        LcReadAhead_Drop(ctxLC, ctxLC->ReadAhead.cPage);
+    }
+    while(ctxLC->ReadAhead.fActive && (i < cMEMs)) {
+        pMEM = ppMEMs[i];
+        if(pMEM->f || (pMEM->cb != 0x1000) || (pMEM->qwA & 0xfff) || (pMEM->qwA < ctxLC->ReadAhead.paBase) || (pMEM->qwA - ctxLC->ReadAhead.paBase >= ((QWORD)ctxLC->ReadAhead.cPage << 12))) {
+            i++;
+            continue;
+        }
+        iPage = (DWORD)((pMEM->qwA - ctxLC->ReadAhead.paBase) >> 12);
+        if(ctxLC->ReadAhead.fFill && (iPage >= ctxLC->ReadAhead.iFill)) {
+            // page is being prefetched - wait for the fill and re-evaluate:
+            LeaveCriticalSection(&ctxLC->ReadAhead.Lock);
+            while((fFill = ctxLC->ReadAhead.fFill)) {
+                WaitOnAddress(&ctxLC->ReadAhead.fFill, &fFill, sizeof(DWORD), INFINITE);
+            }
+            EnterCriticalSection(&ctxLC->ReadAhead.Lock);
+            continue;
+        }
+        pMEMBuffer = ctxLC->ReadAhead.ppMEMs[iPage];
+        if(pMEMBuffer->f) {
+            memcpy(pMEM->pb, pMEMBuffer->pb, 0x1000);
+            pMEM->f = TRUE;
+            ctxLC->ReadAhead.pbUsed[iPage] = 1;
+            ctxLC->ReadAhead.cHit++;
+        }
+        i++;
+    }
+    LeaveCriticalSection(&ctxLC->ReadAhead.Lock);
+}
+
+/*
+* Feed a completed read to the stream detector. A read starting where the
+* ascending page run of the previous read ended continues the stream. Once a
+* stream is detected the pages following it are prefetched in the background
+* whenever less than half a window is buffered ahead of the stream.
+* -- ctxLC
+* -- cMEMs
+* -- ppMEMs
+*/
+VOID LcReadAhead_Detect(_In_ PLC_CONTEXT ctxLC, _In_ DWORD cMEMs, _In_ PPMEM_SCATTER ppMEMs)
+{
+    DWORD i, iShift, cWindow;
+    QWORD paRun = 0, cbRun = 0, paNext;
+    PMEM_SCATTER pMEM;
+    if(!ctxLC->ReadAhead.fActive) { return; }
+    // locate the leading ascending page run of the read:
+    for(i = 0; i < cMEMs; i++) {
+        pMEM = ppMEMs[i];
+        if((pMEM->cb != 0x1000) || (pMEM->qwA & 0xfff) || (cbRun && (paRun + cbRun != pMEM->qwA))) { break; }
+        if(!cbRun) { paRun = pMEM->qwA; }
+        cbRun += 0x1000;
+    }
+    if(!cbRun) { return; }
+    EnterCriticalSection(&ctxLC->ReadAhead.Lock);
+    if(!ctxLC->ReadAhead.fActive) { goto finish; }
+    ctxLC->ReadAhead.cSeq = (paRun == ctxLC->ReadAhead.paNext) ? (ctxLC->ReadAhead.cSeq + 1) : 1;
+    paNext = ctxLC->ReadAhead.paNext = paRun + cbRun;
+    if((ctxLC->ReadAhead.cSeq < LC_READAHEAD_SEQ_MIN) || ctxLC->ReadAhead.fFill) { goto finish; }
+    cWindow = ctxLC->ReadAhead.cPageWindow;
+    if(ctxLC->Config.paMax) {
+        if(paNext > ctxLC->Config.paMax) { goto finish; }
+        cWindow = (DWORD)min(cWindow, ((ctxLC->Config.paMax - paNext) >> 12) + 1);
+    }
+    // keep buffered pages ahead of the stream:
+    iShift = ctxLC->ReadAhead.cPage;
+    if((paNext >= ctxLC->ReadAhead.paBase) && (paNext - ctxLC->ReadAhead.paBase < ((QWORD)ctxLC->ReadAhead.cPage << 12))) {
+        iShift = (DWORD)((paNext - ctxLC->ReadAhead.paBase) >> 12);
+    }
+    if(ctxLC->ReadAhead.cPage - iShift >= (cWindow + 1) / 2) { goto finish; }
+    LcReadAhead_Drop(ctxLC, iShift);
+    if(!ctxLC->ReadAhead.cPage) { ctxLC->ReadAhead.paBase = paNext; }
+    // schedule a fill of the remainder of the window:
+    ctxLC->ReadAhead.iFill = ctxLC->ReadAhead.cPage;
+    for(i = ctxLC->ReadAhead.cPage; i < cWindow; i++) {
+        pMEM = ctxLC->ReadAhead.ppMEMs[i];
+        pMEM->qwA = ctxLC->ReadAhead.paBase + ((QWORD)i << 12);
+        pMEM->f = FALSE;
+        ctxLC->ReadAhead.pbUsed[i] = 0;
+    }
+    ctxLC->ReadAhead.cPage = cWindow;
+    ctxLC->ReadAhead.fFill = TRUE;
+    SetEvent(ctxLC->ReadAhead.hEventWakeup);
+finish:
+    LeaveCriticalSection(&ctxLC->ReadAhead.Lock);
+}
+
+/*
+* Discard the prefetch buffer after a write so that stale pages are not served.
+* A fill in progress is waited for since it may have read the old contents.
+* -- ctxLC
+*/
+VOID LcReadAhead_Invalidate(_In_ PLC_CONTEXT ctxLC)
+{
+    DWORD fFill;
+    if(!ctxLC->ReadAhead.fActive) { return; }
+    EnterCriticalSection(&ctxLC->ReadAhead.Lock);
+    while((fFill = ctxLC->ReadAhead.fFill)) {
+        LeaveCriticalSection(&ctxLC->ReadAhead.Lock);
+        WaitOnAddress(&ctxLC->ReadAhead.fFill, &fFill, sizeof(DWORD), INFINITE);
+        EnterCriticalSection(&ctxLC->ReadAhead.Lock);
+    }
+    if(ctxLC->ReadAhead.fActive) {
+        LcReadAhead_Drop(ctxLC, ctxLC->ReadAhead.cPage);
+    }
+    LeaveCriticalSection(&ctxLC->ReadAhead.Lock);
+}
+
+/*
+* Main thread loop of the prefetch thread. A scheduled fill is read through
+* the memory map and the in-flight table just like an ordinary read.
+* -- ctxLC
+* -- return
+*/
+DWORD LcReadAhead_ThreadProc(_In_ PLC_CONTEXT ctxLC)
+{
+    DWORD i, c;
+    PPMEM_SCATTER ppMEMs;
+    while(ctxLC->ReadAhead.fActive) {
+        WaitForSingleObject(ctxLC->ReadAhead.hEventWakeup, INFINITE);
+        if(!ctxLC->ReadAhead.fActive) { break; }
+        if(!ctxLC->ReadAhead.fFill) { continue; }
+        // the pages being filled are not touched by other threads until the fill completes:
+        EnterCriticalSection(&ctxLC->ReadAhead.Lock);
+        c = ctxLC->ReadAhead.cPage - ctxLC->ReadAhead.iFill;
+        ppMEMs = ctxLC->ReadAhead.ppMEMs + ctxLC->ReadAhead.iFill;
+        LeaveCriticalSection(&ctxLC->ReadAhead.Lock);
+        for(i = 0; i < c; i++) {
+            MEM_SCATTER_STACK_PUSH(ppMEMs[i], ppMEMs[i]->qwA);
+        }
+        LcMemMap_TranslateMEMs(ctxLC, c, ppMEMs);
+        LcReadScatter_Fetch(ctxLC, c, ppMEMs);
+        for(i = 0; i < c; i++) {
+            ppMEMs[i]->qwA = MEM_SCATTER_STACK_POP(ppMEMs[i]);
+        }
+        EnterCriticalSection(&ctxLC->ReadAhead.Lock);
+        for(i = 0; i < c; i++) {
+            if(ppMEMs[i]->f) { ctxLC->ReadAhead.cPrefetch++; }
+        }
+        ctxLC->ReadAhead.tcFill = GetTickCount64();
+        ctxLC->ReadAhead.fFill = FALSE;
+        LeaveCriticalSection(&ctxLC->ReadAhead.Lock);
+        WakeByAddressAll((PVOID)&ctxLC->ReadAhead.fFill);
+    }
+    SetEvent(ctxLC->ReadAhead.hEventFinish);
+    return 0;
+}
+
+/*
+* Close the read-ahead sub-system for a specific device instance. The prefetch
+* thread is stopped and the buffer is freed. Statistics are kept.
+* NB! must not be called with the device lock held (the prefetch thread may wait for it).
+* -- ctxLC
+*/
+VOID LcReadAhead_Close(_In_ PLC_CONTEXT ctxLC)
+{
+    EnterCriticalSection(&ctxLC->ReadAhead.Lock);
+    ctxLC->ReadAhead.fActive = FALSE;
+    LeaveCriticalSection(&ctxLC->ReadAhead.Lock);
+    if(ctxLC->ReadAhead.hThread) {
+        SetEvent(ctxLC->ReadAhead.hEventWakeup);
+        WaitForSingleObject(ctxLC->ReadAhead.hEventFinish, INFINITE);
+    }
+    EnterCriticalSection(&ctxLC->ReadAhead.Lock);
+    ctxLC->ReadAhead.fFill = FALSE;
+    if(ctxLC->ReadAhead.ppMEMs && ctxLC->ReadAhead.ppMEMsSwap) {
+        LcReadAhead_Drop(ctxLC, ctxLC->ReadAhead.cPage);
+    }
+    if(ctxLC->ReadAhead.hThread) { CloseHandle(ctxLC->ReadAhead.hThread); }
+    if(ctxLC->ReadAhead.hEventWakeup) { CloseHandle(ctxLC->ReadAhead.hEventWakeup); }
+    if(ctxLC->ReadAhead.hEventFinish) { CloseHandle(ctxLC->ReadAhead.hEventFinish); }
+    LcMemFree(ctxLC->ReadAhead.ppMEMs);
+    LocalFree(ctxLC->ReadAhead.ppMEMsSwap);
+    ctxLC->ReadAhead.hThread = NULL;
+    ctxLC->ReadAhead.hEventWakeup = NULL;
+    ctxLC->ReadAhead.hEventFinish = NULL;
+    ctxLC->ReadAhead.ppMEMs = NULL;
+    ctxLC->ReadAhead.ppMEMsSwap = NULL;
+    ctxLC->ReadAhead.pbUsed = NULL;
+    ctxLC->ReadAhead.cPageWindow = 0;
+    ctxLC->ReadAhead.cPage = 0;
+    ctxLC->ReadAhead.cSeq = 0;
+    LeaveCriticalSection(&ctxLC->ReadAhead.Lock);
+    WakeByAddressAll((PVOID)&ctxLC->ReadAhead.fFill);
+}
+
+/*
+* (Re-)initialize the read-ahead sub-system for a specific device instance.
+* Any existing prefetch buffer is discarded.
+* NB! must not be called with the device lock held (the prefetch thread may wait for it).
+* -- ctxLC
+* -- cPageWindow = prefetch window in pages, 0 = disable read-ahead.
+* -- return
+*/
+_Success_(return)
+BOOL LcReadAhead_Initialize(_In_ PLC_CONTEXT ctxLC, _In_ QWORD cPageWindow)
+{
+    LcReadAhead_Close(ctxLC);
+    if(!cPageWindow) { return TRUE; }
+    cPageWindow = min(LC_READAHEAD_PAGES_MAX, cPageWindow);
+    EnterCriticalSection(&ctxLC->ReadAhead.Lock);
+    ctxLC->ReadAhead.cPageWindow = (DWORD)cPageWindow;
+    if(!LcAllocScatter1((DWORD)cPageWindow, &ctxLC->ReadAhead.ppMEMs)) { goto fail; }
+    if(!(ctxLC->ReadAhead.ppMEMsSwap = LocalAlloc(LMEM_ZEROINIT, (SIZE_T)cPageWindow * (sizeof(PMEM_SCATTER) + 1)))) { goto fail; }
+    ctxLC->ReadAhead.pbUsed = (PBYTE)(ctxLC->ReadAhead.ppMEMsSwap + cPageWindow);
+    if(!(ctxLC->ReadAhead.hEventWakeup = CreateEvent(NULL, FALSE, FALSE, FALSE))) { goto fail; }
+    if(!(ctxLC->ReadAhead.hEventFinish = CreateEvent(NULL, TRUE, FALSE, FALSE))) { goto fail; }
+    ctxLC->ReadAhead.fActive = TRUE;
+    if(!(ctxLC->ReadAhead.hThread = CreateThread(NULL, 0, (LPTHREAD_START_ROUTINE)LcReadAhead_ThreadProc, ctxLC, 0, NULL))) { goto fail; }
+    LeaveCriticalSection(&ctxLC->ReadAhead.Lock);
+    return TRUE;
+fail:
+    LeaveCriticalSection(&ctxLC->ReadAhead.Lock);
+    LcReadAhead_Close(ctxLC);
+    return FALSE;
+}
+
+
+
 // ----------------------------------------------------------------------------
 // READ / WRITE FUNCTIONALITY BELOW:
 // ----------------------------------------------------------------------------
 
+/*
+* Fetch memory map translated MEMs from the device. Pages already in flight by
+* a concurrent read are not fetched twice. A read without concurrent reads
+* skips the in-flight table unless another read starts while it is active.
+* -- ctxLC
+* -- cMEMs
+* -- ppMEMs
+*/
+VOID LcReadScatter_Fetch(_In_ PLC_CONTEXT ctxLC, _In_ DWORD cMEMs, _Inout_ PPMEM_SCATTER ppMEMs)
+{
+    BOOL fSolo;
+    DWORD cMEMsFetch;
+    PPMEM_SCATTER ppMEMsFetch;
+    PLC_INFLIGHT_ENTRY pInFlight = NULL;
+    LC_INFLIGHT_SOLO Solo;
+    volatile DWORD cInFlightPending = 0;
+    fSolo = (InterlockedIncrement((volatile LONG*)&ctxLC->InFlight.cReader) == 1);
+    if(fSolo) {
+        LcInFlight_BeginSolo(ctxLC, &Solo, cMEMs, ppMEMs);
+        cMEMsFetch = cMEMs;
+        ppMEMsFetch = ppMEMs;
+    } else {
+        pInFlight = LcInFlight_Begin(ctxLC, cMEMs, ppMEMs, &cInFlightPending, &cMEMsFetch, &ppMEMsFetch);
+    }
+    if(cMEMsFetch) {
+        LcLockAcquire(ctxLC);
+        if(ctxLC->pfnReadScatter) {
+            ctxLC->pfnReadScatter(ctxLC, cMEMsFetch, ppMEMsFetch);
+        } else if(ctxLC->RC.fActive) {
+            LcReadContigious_ReadScatterGather(ctxLC, cMEMsFetch, ppMEMsFetch);
+        }
+        LcLockRelease(ctxLC);
+    }
+    if(fSolo) {
+        pInFlight = LcInFlight_EndSolo(ctxLC, &Solo);
+    }
+    LcInFlight_End(ctxLC, cMEMs, pInFlight, &cInFlightPending);
+    InterlockedDecrement((volatile LONG*)&ctxLC->InFlight.cReader);
+}
+
 /*
 * Read memory in a scattered non-contiguous way. This is recommended for reads.
 * -- hLC
@@ -816,23 +1359,21 @@ EXPORTED_FUNCTION VOID LcReadScatter(_In_ HANDLE hLC, _In_ DWORD cMEMs, _Inout_
         ctxLC->pfnReadScatter(ctxLC, cMEMs, ppMEMs);
     } else {
         // LOCAL LEECHCORE
-        // 1: TRANSLATE
+        // 1: SERVE FROM READ-AHEAD PREFETCH BUFFER
+        LcReadAhead_Serve(ctxLC, cMEMs, ppMEMs);
+        // 2: TRANSLATE
         for(i = 0; i < cMEMs; i++) {
             MEM_SCATTER_STACK_PUSH(ppMEMs[i], ppMEMs[i]->qwA);
         }
         LcMemMap_TranslateMEMs(ctxLC, cMEMs, ppMEMs);
-        // 2: FETCH
-        LcLockAcquire(ctxLC);
-        if(ctxLC->pfnReadScatter) {
-            ctxLC->pfnReadScatter(ctxLC, cMEMs, ppMEMs);
-        } else if(ctxLC->RC.fActive) {
-            LcReadContigious_ReadScatterGather(ctxLC, cMEMs, ppMEMs);
-        }
-        LcLockRelease(ctxLC);
-        // 3: RESTORE
+        // 3: FETCH (SUPPRESS DUPLICATE PAGES ALREADY IN FLIGHT BY CONCURRENT READS)
+        LcReadScatter_Fetch(ctxLC, cMEMs, ppMEMs);
+        // 4: RESTORE
         for(i = 0; i < cMEMs; i++) {
             ppMEMs[i]->qwA = MEM_SCATTER_STACK_POP(ppMEMs[i]);
         }
+        // 5: DETECT SEQUENTIAL STREAM AND SCHEDULE READ-AHEAD
+        LcReadAhead_Detect(ctxLC, cMEMs, ppMEMs);
     }
     LcCallEnd(ctxLC, LC_STATISTICS_ID_READSCATTER, tmStart);
 }
@@ -893,6 +1434,91 @@ fail:
     return fResult;
 }
 
+/*
+* Retrieve the address of the next node of a read chain from a node read.
+* pChain->cNode must include the node.
+* -- pChain
+* -- pbNode = the node data (pChain->cbNode bytes).
+* -- pqwNext = receives the address of the next node.
+* -- return = 0 to continue with the next node, otherwise LC_READCHAIN_STOP_*.
+*/
+DWORD LcReadChain_Next(_In_ PLC_READCHAIN pChain, _In_ PBYTE pbNode, _Out_ PQWORD pqwNext)
+{
+    QWORD qwNext;
+    *pqwNext = 0;
+    qwNext = (pChain->cbNext == 4) ? *(PDWORD)(pbNode + pChain->oNext) : *(PQWORD)(pbNode + pChain->oNext);
+    qwNext &= pChain->qwMaskNext;
+    if(!qwNext) { return LC_READCHAIN_STOP_NULL; }
+    qwNext += pChain->qwAddNext;
+    if(qwNext == pChain->qwA) { return LC_READCHAIN_STOP_LOOP; }
+    if(pChain->cNode >= pChain->cNodeMax) { return LC_READCHAIN_STOP_MAX; }
+    if((qwNext & 0xfff) + pChain->cbNode > 0x1000) { return LC_READCHAIN_STOP_FAIL; }
+    *pqwNext = qwNext;
+    return 0;
+}
+
+/*
+* Read a chain of dependent nodes - generic implementation with one read per node.
+* -- ctxLC
+* -- pChain
+*/
+VOID LcReadChain_Generic(_In_ PLC_CONTEXT ctxLC, _Inout_ PLC_READCHAIN pChain)
+{
+    MEM_SCATTER MEM = { 0 };
+    PMEM_SCATTER pMEM = &MEM;
+    QWORD qwA = pChain->qwA;
+    MEM.version = MEM_SCATTER_VERSION;
+    MEM.cb = pChain->cbNode;
+    while(TRUE) {
+        MEM.f = FALSE;
+        MEM.qwA = qwA;
+        MEM.pb = pChain->pb + (SIZE_T)pChain->cNode * pChain->cbNode;
+        LcReadScatter(ctxLC, 1, &pMEM);
+        if(!MEM.f) {
+            pChain->dwStop = LC_READCHAIN_STOP_FAIL;
+            return;
+        }
+        if(pChain->pqwA) {
+            pChain->pqwA[pChain->cNode] = qwA;
+        }
+        pChain->cNode++;
+        if((pChain->dwStop = LcReadChain_Next(pChain, MEM.pb, &qwA))) {
+            return;
+        }
+    }
+}
+
+/*
+* Read a chain of dependent nodes. The nodes are read into pChain->pb in order
+* until a stop condition is reached (pChain->dwStop).
+* -- hLC
+* -- pChain
+* -- return = TRUE if at least one node is read.
+*/
+_Success_(return)
+EXPORTED_FUNCTION BOOL LcReadChain(_In_ HANDLE hLC, _Inout_ PLC_READCHAIN pChain)
+{
+    PLC_CONTEXT ctxLC = (PLC_CONTEXT)hLC;
+    BOOL fDevice = FALSE;
+    if(!ctxLC || ctxLC->version != LC_CONTEXT_VERSION) { return FALSE; }
+    if(!pChain || (pChain->dwVersion != LC_READCHAIN_VERSION) || !pChain->pb || !pChain->cNodeMax) { return FALSE; }
+    if(!pChain->cbNode || ((pChain->qwA & 0xfff) + pChain->cbNode > 0x1000)) { return FALSE; }
+    if(((pChain->cbNext != 4) && (pChain->cbNext != 8)) || (pChain->oNext + pChain->cbNext > pChain->cbNode)) { return FALSE; }
+    pChain->cNode = 0;
+    pChain->dwStop = 0;
+    if(!ctxLC->Config.fRemote && ctxLC->pfnReadChain) {
+        LcLockAcquire(ctxLC);
+        fDevice = ctxLC->pfnReadChain(ctxLC, pChain);
+        LcLockRelease(ctxLC);
+    }
+    if(!fDevice) {
+        pChain->cNode = 0;
+        pChain->dwStop = 0;
+        LcReadChain_Generic(ctxLC, pChain);
+    }
+    return pChain->cNode ? TRUE : FALSE;
+}
+
 /*
 * Write scatter memory in a contigious way - helper function for LcWriteScatter_GatherContigious().
 * -- ctxLC
@@ -980,6 +1606,9 @@ EXPORTED_FUNCTION VOID LcWriteScatter(_In_ HANDLE hLC, _In_ DWORD cMEMs, _Inout_
         for(i = 0; i < cMEMs; i++) {
             ppMEMs[i]->qwA = MEM_SCATTER_STACK_POP(ppMEMs[i]);
         }
+        // 4: DISCARD READ-AHEAD PREFETCH BUFFER AND TRANSLATION CACHE (page tables may be written)
+        LcReadAhead_Invalidate(ctxLC);
+        LcTranslate_Invalidate(ctxLC, 0);
     }
     LcCallEnd(ctxLC, LC_STATISTICS_ID_WRITESCATTER, tmStart);
 }
@@ -1035,6 +1664,242 @@ fail:
 
 
 
+// ----------------------------------------------------------------------------
+// VIRTUAL ADDRESS TRANSLATION FUNCTIONALITY BELOW:
+// ----------------------------------------------------------------------------
+
+#define LC_TRANSLATE_CACHE_ENTRIES          0x2000      // entries per DTB (direct mapped)
+#define LC_TRANSLATE_PTE_PRESENT            0x0000000000000001
+#define LC_TRANSLATE_PTE_PS                 0x0000000000000080
+#define LC_TRANSLATE_PTE_PFN                0x000ffffffffff000
+#define LC_TRANSLATE_SHIFT(iLevel)          (12 + 9 * ((iLevel) - 1))
+#define LC_TRANSLATE_HASH(qwTag)            ((DWORD)(((qwTag) * 0x9e3779b97f4a7c15) >> 51) & (LC_TRANSLATE_CACHE_ENTRIES - 1))
+
+typedef struct tdLC_TRANSLATE_CACHE {
+    QWORD paDTB;
+    DWORD dwFlags;                      // LC_TRANSLATE_FLAG_PAGING5 (if set)
+    struct {
+        QWORD qwTag;                    // ((va & mask) >> LC_TRANSLATE_SHIFT(level)) << 3 | level (0 = unused)
+        QWORD pte;
+    } e[LC_TRANSLATE_CACHE_ENTRIES];
+} LC_TRANSLATE_CACHE, *PLC_TRANSLATE_CACHE;
+
+typedef struct tdLC_TRANSLATE_VA {
+    QWORD va;
+    QWORD paTable;                      // page table of the next level to read
+    QWORD paEntry;                      // page table entry read in the current level
+    DWORD iLevel;                       // next level to read (0 = translated or failed)
+    DWORD iMEM;
+    DWORD iVA;
+} LC_TRANSLATE_VA, *PLC_TRANSLATE_VA, **PPLC_TRANSLATE_VA;
+
+/*
+* Invalidate the translation cache.
+* -- ctxLC
+* -- paDTB = the DTB to invalidate, 0 = all DTBs.
+*/
+VOID LcTranslate_Invalidate(_In_ PLC_CONTEXT ctxLC, _In_ QWORD paDTB)
+{
+    DWORD i;
+    PLC_TRANSLATE_CACHE pc;
+    paDTB &= LC_TRANSLATE_PTE_PFN;
+    EnterCriticalSection(&ctxLC->Translate.Lock);
+    for(i = 0; i < LC_TRANSLATE_DTB_MAX; i++) {
+        pc = (PLC_TRANSLATE_CACHE)ctxLC->Translate.pDtb[i];
+        if(pc && (!paDTB || (pc->paDTB == paDTB))) {
+            LocalFree(pc);
+            ctxLC->Translate.pDtb[i] = NULL;
+        }
+    }
+    LeaveCriticalSection(&ctxLC->Translate.Lock);
+}
+
+/*
+* Retrieve the translation cache of a DTB. If not existing the least recently
+* created cache is replaced. CALLER must hold Translate.Lock.
+* -- ctxLC
+* -- paDTB
+* -- dwFlags
+* -- return = the cache, or NULL on allocation failure.
+*/
+PLC_TRANSLATE_CACHE LcTranslate_CacheGet(_In_ PLC_CONTEXT ctxLC, _In_ QWORD paDTB, _In_ DWORD dwFlags)
+{
+    DWORD i;
+    PLC_TRANSLATE_CACHE pc;
+    for(i = 0; i < LC_TRANSLATE_DTB_MAX; i++) {
+        pc = (PLC_TRANSLATE_CACHE)ctxLC->Translate.pDtb[i];
+        if(pc && (pc->paDTB == paDTB) && (pc->dwFlags == dwFlags)) {
+            return pc;
+        }
+    }
+    i = ctxLC->Translate.iDtbNext++ % LC_TRANSLATE_DTB_MAX;
+    LocalFree(ctxLC->Translate.pDtb[i]);
+    if((pc = LocalAlloc(LMEM_ZEROINIT, sizeof(LC_TRANSLATE_CACHE)))) {
+        pc->paDTB = paDTB;
+        pc->dwFlags = dwFlags;
+    }
+    ctxLC->Translate.pDtb[i] = pc;
+    return pc;
+}
+
+/*
+* qsort compare function - sort virtual addresses by page table entry address.
+*/
+int LcTranslate_CmpEntry(_In_ const void *pv1, _In_ const void *pv2)
+{
+    PLC_TRANSLATE_VA p1 = *(PPLC_TRANSLATE_VA)pv1;
+    PLC_TRANSLATE_VA p2 = *(PPLC_TRANSLATE_VA)pv2;
+    return (p1->paEntry < p2->paEntry) ? -1 : ((p1->paEntry > p2->paEntry) ? 1 : 0);
+}
+
+/*
+* Translate virtual addresses into physical addresses. Virtual addresses not
+* possible to translate (not present / read failure) receives the physical
+* address MEM_SCATTER_ADDR_INVALID. Only hardware page table entries are
+* evaluated - operating system specific (ex: transition) entries are not.
+* The page tables are walked breadth-first: all entries of one level (for all
+* virtual addresses) are read in one scatter read. Upper level entries are
+* cached per DTB; a cached entry allows the walk to start at a lower level.
+* -- hLC
+* -- paDTB = the physical address of the top level page table (ex: CR3).
+* -- dwFlags = LC_TRANSLATE_FLAG_*
+* -- cVA
+* -- pqwVA = the virtual addresses to translate.
+* -- pqwPA = buffer to receive the physical addresses (may be pqwVA).
+* -- return = TRUE if all virtual addresses are translated.
+*/
+_Success_(return)
+EXPORTED_FUNCTION BOOL LcTranslateScatter(_In_ HANDLE hLC, _In_ QWORD paDTB, _In_ DWORD dwFlags, _In_ DWORD cVA, _In_reads_(cVA) PQWORD pqwVA, _Out_writes_(cVA) PQWORD pqwPA)
+{
+    PLC_CONTEXT ctxLC = (PLC_CONTEXT)hLC;
+    BOOL fCache, fResult = TRUE;
+    DWORD i, j, cLevel, iLevel, cWalk, cMEM, cHit = 0;
+    QWORD qwMaskVA, qwMaskPage, qwTag, pte;
+    PBYTE pbBuffer = NULL;
+    PLC_TRANSLATE_VA pVAs, pVA;
+    PPLC_TRANSLATE_VA ppVAs;
+    PMEM_SCATTER pMEMs, pMEM, *ppMEMs;
+    PQWORD pqwPTE;
+    PLC_TRANSLATE_CACHE pc = NULL;
+    if(!ctxLC || ctxLC->version != LC_CONTEXT_VERSION) { return FALSE; }
+    if(!cVA) { return TRUE; }
+    dwFlags &= LC_TRANSLATE_FLAG_PAGING5 | LC_TRANSLATE_FLAG_NOCACHE;
+    fCache = !(dwFlags & LC_TRANSLATE_FLAG_NOCACHE);
+    cLevel = (dwFlags & LC_TRANSLATE_FLAG_PAGING5) ? 5 : 4;
+    qwMaskVA = (dwFlags & LC_TRANSLATE_FLAG_PAGING5) ? 0x01ffffffffffffff : 0x0000ffffffffffff;
+    paDTB &= LC_TRANSLATE_PTE_PFN;
+    // allocate:
+    if(!(pbBuffer = LocalAlloc(0, (SIZE_T)cVA * (sizeof(LC_TRANSLATE_VA) + sizeof(PLC_TRANSLATE_VA) + sizeof(MEM_SCATTER) + sizeof(PMEM_SCATTER) + sizeof(QWORD))))) {
+        return FALSE;
+    }
+    pVAs = (PLC_TRANSLATE_VA)pbBuffer;
+    pMEMs = (PMEM_SCATTER)(pVAs + cVA);
+    ppVAs = (PPLC_TRANSLATE_VA)(pMEMs + cVA);
+    ppMEMs = (PPMEM_SCATTER)(ppVAs + cVA);
+    pqwPTE = (PQWORD)(ppMEMs + cVA);
+    for(i = 0; i < cVA; i++) {
+        pVA = pVAs + i;
+        pVA->va = pqwVA[i] & qwMaskVA;
+        pVA->paTable = paDTB;
+        pVA->iLevel = cLevel;
+        pVA->iVA = i;
+        pqwPA[i] = MEM_SCATTER_ADDR_INVALID;
+    }
+    // start the walks at the lowest cached level (if any):
+    if(fCache) {
+        EnterCriticalSection(&ctxLC->Translate.Lock);
+        pc = LcTranslate_CacheGet(ctxLC, paDTB, dwFlags & LC_TRANSLATE_FLAG_PAGING5);
+        for(i = 0; pc && (i < cVA); i++) {
+            pVA = pVAs + i;
+            for(iLevel = 2; iLevel <= cLevel; iLevel++) {
+                qwTag = ((pVA->va >> LC_TRANSLATE_SHIFT(iLevel)) << 3) | iLevel;
+                j = LC_TRANSLATE_HASH(qwTag);
+                if(pc->e[j].qwTag != qwTag) { continue; }
+                pte = pc->e[j].pte;
+                if(pte & LC_TRANSLATE_PTE_PS) {
+                    qwMaskPage = (1ULL << LC_TRANSLATE_SHIFT(iLevel)) - 1;
+                    pqwPA[pVA->iVA] = (pte & LC_TRANSLATE_PTE_PFN & ~qwMaskPage) + (pVA->va & qwMaskPage);
+                    pVA->iLevel = 0;
+                } else {
+                    pVA->paTable = pte & LC_TRANSLATE_PTE_PFN;
+                    pVA->iLevel = iLevel - 1;
+                }
+                cHit++;
+                break;
+            }
+        }
+        ctxLC->Translate.cHit += cHit;
+        LeaveCriticalSection(&ctxLC->Translate.Lock);
+    }
+    // walk the page tables one level at a time (top-down):
+    for(iLevel = cLevel; iLevel; iLevel--) {
+        // 1: collect the walks at this level sorted by page table entry address:
+        for(i = 0, cWalk = 0; i < cVA; i++) {
+            pVA = pVAs + i;
+            if(pVA->iLevel != iLevel) { continue; }
+            pVA->paEntry = pVA->paTable + ((pVA->va >> LC_TRANSLATE_SHIFT(iLevel)) & 0x1ff) * sizeof(QWORD);
+            ppVAs[cWalk++] = pVA;
+        }
+        if(!cWalk) { continue; }
+        qsort(ppVAs, cWalk, sizeof(PLC_TRANSLATE_VA), LcTranslate_CmpEntry);
+        // 2: read each unique page table entry once:
+        for(i = 0, cMEM = 0; i < cWalk; i++) {
+            pVA = ppVAs[i];
+            if(!cMEM || (ppMEMs[cMEM - 1]->qwA != pVA->paEntry)) {
+                ppMEMs[cMEM] = pMEM = pMEMs + cMEM;
+                ZeroMemory(pMEM, sizeof(MEM_SCATTER));
+                pMEM->version = MEM_SCATTER_VERSION;
+                pMEM->qwA = pVA->paEntry;
+                pMEM->cb = sizeof(QWORD);
+                pMEM->pb = (PBYTE)(pqwPTE + cMEM);
+                cMEM++;
+            }
+            pVA->iMEM = cMEM - 1;
+        }
+        LcReadScatter(ctxLC, cMEM, ppMEMs);
+        // 3: evaluate the page table entries:
+        if(fCache) {
+            EnterCriticalSection(&ctxLC->Translate.Lock);
+            ctxLC->Translate.cRead += cMEM;
+            pc = (iLevel >= 2) ? LcTranslate_CacheGet(ctxLC, paDTB, dwFlags & LC_TRANSLATE_FLAG_PAGING5) : NULL;
+        }
+        for(i = 0; i < cWalk; i++) {
+            pVA = ppVAs[i];
+            pVA->iLevel = 0;
+            pMEM = pMEMs + pVA->iMEM;
+            pte = pqwPTE[pVA->iMEM];
+            if(!pMEM->f || !(pte & LC_TRANSLATE_PTE_PRESENT)) { continue; }
+            if((iLevel == 1) || (((iLevel == 2) || (iLevel == 3)) && (pte & LC_TRANSLATE_PTE_PS))) {
+                qwMaskPage = (1ULL << LC_TRANSLATE_SHIFT(iLevel)) - 1;
+                pqwPA[pVA->iVA] = (pte & LC_TRANSLATE_PTE_PFN & ~qwMaskPage) + (pVA->va & qwMaskPage);
+            } else {
+                pte &= ~LC_TRANSLATE_PTE_PS;
+                pVA->paTable = pte & LC_TRANSLATE_PTE_PFN;
+                pVA->iLevel = iLevel - 1;
+            }
+            if(pc) {
+                qwTag = ((pVA->va >> LC_TRANSLATE_SHIFT(iLevel)) << 3) | iLevel;
+                j = LC_TRANSLATE_HASH(qwTag);
+                pc->e[j].qwTag = qwTag;
+                pc->e[j].pte = pte;
+            }
+        }
+        if(fCache) {
+            LeaveCriticalSection(&ctxLC->Translate.Lock);
+        }
+    }
+    for(i = 0; i < cVA; i++) {
+        if(pqwPA[i] == MEM_SCATTER_ADDR_INVALID) {
+            fResult = FALSE;
+            break;
+        }
+    }
+    LocalFree(pbBuffer);
+    return fResult;
+}
+
+
+
 // ----------------------------------------------------------------------------
 // GET / SET / COMMAND FUNCTIONALITY BELOW:
 // ----------------------------------------------------------------------------
@@ -1085,6 +1950,21 @@ BOOL LcGetOption_DoWork(_In_ PLC_CONTEXT ctxLC, _In_ QWORD fOption, _Out_ PQWORD
         case LC_OPT_CORE_READONLY:
             *pqwValue = ctxLC->Config.fWritable ? 0 : 1;
             return TRUE;
+        case LC_OPT_CORE_STATISTICS_READ_INFLIGHT_HITS:
+            *pqwValue = ctxLC->InFlight.cHit;
+            return TRUE;
+        case LC_OPT_CORE_READAHEAD:
+            *pqwValue = ctxLC->ReadAhead.cPageWindow;
+            return TRUE;
+        case LC_OPT_CORE_STATISTICS_READAHEAD_PAGES:
+            *pqwValue = ctxLC->ReadAhead.cPrefetch;
+            return TRUE;
+        case LC_OPT_CORE_STATISTICS_READAHEAD_HITS:
+            *pqwValue = ctxLC->ReadAhead.cHit;
+            return TRUE;
+        case LC_OPT_CORE_STATISTICS_READAHEAD_WASTE:
+            *pqwValue = ctxLC->ReadAhead.cWaste;
+            return TRUE;
     }
     if(ctxLC->pfnGetOption) {
         return ctxLC->pfnGetOption(ctxLC, fOption, pqwValue);
@@ -1107,6 +1987,12 @@ EXPORTED_FUNCTION BOOL LcGetOption(_In_ HANDLE hLC, _In_ QWORD fOption, _Out_ PQ
     QWORD tmStart = LcCallStart();
     BOOL fResult;
     if(!ctxLC || ctxLC->version != LC_CONTEXT_VERSION) { return FALSE; }
+    if((fOption == LC_OPT_CORE_STATISTICS_TRANSLATE_HITS) || (fOption == LC_OPT_CORE_STATISTICS_TRANSLATE_READS)) {
+        // translation is performed by the local leechcore also when remote:
+        *pqwValue = (fOption == LC_OPT_CORE_STATISTICS_TRANSLATE_HITS) ? ctxLC->Translate.cHit : ctxLC->Translate.cRead;
+        LcCallEnd(ctxLC, LC_STATISTICS_ID_GETOPTION, tmStart);
+        return TRUE;
+    }
     LcLockAcquire(ctxLC);
     fResult = ctxLC->Config.fRemote ?
         ctxLC->pfnGetOption(ctxLC, fOption, pqwValue) :
@@ -1156,6 +2042,18 @@ EXPORTED_FUNCTION BOOL LcSetOption(_In_ HANDLE hLC, _In_ QWORD fOption, _In_ QWO
     QWORD tmStart = LcCallStart();
     BOOL fResult;
     if(!ctxLC || ctxLC->version != LC_CONTEXT_VERSION) { return FALSE; }
+    if(!ctxLC->Config.fRemote && (fOption == LC_OPT_CORE_READAHEAD)) {
+        // read-ahead is set up without the device lock - the prefetch thread may be waiting for it:
+        fResult = LcReadAhead_Initialize(ctxLC, qwValue);
+        LcCallEnd(ctxLC, LC_STATISTICS_ID_SETOPTION, tmStart);
+        return fResult;
+    }
+    if(fOption == LC_OPT_CORE_TRANSLATE_INVALIDATE) {
+        // translation is performed by the local leechcore also when remote:
+        LcTranslate_Invalidate(ctxLC, qwValue);
+        LcCallEnd(ctxLC, LC_STATISTICS_ID_SETOPTION, tmStart);
+        return TRUE;
+    }
     LcLockAcquire(ctxLC);
     fResult = ctxLC->Config.fRemote ?
         ctxLC->pfnSetOption(ctxLC, fOption, qwValue) :
@@ -1217,7 +2115,20 @@ EXPORTED_FUNCTION BOOL LcCommand(_In_ HANDLE hLC, _In_ QWORD fCommand, _In_ DWOR
     PLC_CONTEXT ctxLC = (PLC_CONTEXT)hLC;
     QWORD tmStart = LcCallStart();
     BOOL fResult;
+    DWORD cbMemMap = 0;
+    PBYTE pbMemMap = NULL;
     if(!ctxLC || ctxLC->version != LC_CONTEXT_VERSION) { return FALSE; }
+    if(!ctxLC->Config.fRemote && (fCommand == LC_CMD_MEMSCAN)) {
+        // memory scan reads memory - only the memory map is retrieved with the device lock held:
+        if(!ppbDataOut) { return FALSE; }
+        LcLockAcquire(ctxLC);
+        fResult = LcMemMap_GetRangesAsStruct(ctxLC, &pbMemMap, &cbMemMap);
+        LcLockRelease(ctxLC);
+        fResult = fResult && LcMemScan(ctxLC, cbMemMap / sizeof(LC_MEMMAP_ENTRY), (PLC_MEMMAP_ENTRY)pbMemMap, cbDataIn, pbDataIn, ppbDataOut, pcbDataOut);
+        LocalFree(pbMemMap);
+        LcCallEnd(ctxLC, LC_STATISTICS_ID_COMMAND, tmStart);
+        return fResult;
+    }
     LcLockAcquire(ctxLC);
     fResult = ctxLC->Config.fRemote ?
         ctxLC->pfnCommand(ctxLC, fCommand, cbDataIn, pbDataIn, ppbDataOut, pcbDataOut) :
@@ -317,6 +317,96 @@ BOOL LcWrite(
 
 
 
+//-----------------------------------------------------------------------------
+// Read chain functionality may be used to walk dependent reads - such as a
+// linked list - where the address of the next node is loaded from the node
+// read before it. Devices supporting it (FPGA) walk the chain internally and
+// issue the read of the next node as soon as the previous node is received.
+// Other devices walk the chain with one LcReadScatter() per node.
+//
+// The address of the next node is calculated as:
+// ((QWORD/DWORD at oNext in the node) & qwMaskNext) + qwAddNext
+//-----------------------------------------------------------------------------
+
+#define LC_READCHAIN_VERSION                    0xc0fa0001
+
+#define LC_READCHAIN_STOP_MAX                   1   // cNodeMax nodes read.
+#define LC_READCHAIN_STOP_NULL                  2   // next pointer (masked) is zero.
+#define LC_READCHAIN_STOP_LOOP                  3   // next node is the first node (circular list).
+#define LC_READCHAIN_STOP_FAIL                  4   // read of the next node failed (or next node crosses a page boundary).
+
+typedef struct tdLC_READCHAIN {
+    DWORD dwVersion;                        // LC_READCHAIN_VERSION
+    DWORD cNodeMax;                         // max number of nodes to read
+    QWORD qwA;                              // address of the first node
+    DWORD cbNode;                           // bytes to read per node (max 0x1000, node must not cross a page boundary)
+    DWORD oNext;                            // offset of the next pointer in the node
+    DWORD cbNext;                           // size of the next pointer (4 or 8)
+    DWORD _Reserved;
+    QWORD qwMaskNext;                       // mask applied to the next pointer
+    QWORD qwAddNext;                        // value added to the masked next pointer (ex: negative offset of a list entry in the node)
+    PBYTE pb;                               // buffer to receive the nodes (cNodeMax * cbNode bytes)
+    PQWORD pqwA;                            // optional buffer to receive the node addresses (cNodeMax entries)
+    // result:
+    DWORD cNode;                            // number of nodes read
+    DWORD dwStop;                           // LC_READCHAIN_STOP_*
+} LC_READCHAIN, *PLC_READCHAIN;
+
+/*
+* Read a chain of dependent nodes. The nodes are read into pChain->pb in order
+* until a stop condition is reached (pChain->dwStop).
+* -- hLC
+* -- pChain
+* -- return = TRUE if at least one node is read.
+*/
+EXPORTED_FUNCTION _Success_(return)
+BOOL LcReadChain(
+    _In_ HANDLE hLC,
+    _Inout_ PLC_READCHAIN pChain
+);
+
+
+
+//-----------------------------------------------------------------------------
+// Virtual address translation may be used to translate x64 virtual addresses
+// into physical addresses by walking 4-level or 5-level page tables. Virtual
+// addresses are translated as a batch breadth-first - i.e. the PML4 entries of
+// all addresses are read in one scatter read, then all PDPT entries etc.
+//
+// Upper level page table entries (PDPTE and above, PDE) are kept in a per-DTB
+// translation cache. The cache is not coherent with the target system - page
+// tables of a live system may change at any time. Invalidate the cache with
+// LC_OPT_CORE_TRANSLATE_INVALIDATE when required.
+//-----------------------------------------------------------------------------
+
+#define LC_TRANSLATE_FLAG_PAGING5               0x00000001  // 5-level paging (LA57) - otherwise 4-level paging.
+#define LC_TRANSLATE_FLAG_NOCACHE               0x00000002  // do not use (or update) the translation cache.
+
+/*
+* Translate virtual addresses into physical addresses. Virtual addresses not
+* possible to translate (not present / read failure) receives the physical
+* address MEM_SCATTER_ADDR_INVALID. Only hardware page table entries are
+* evaluated - operating system specific (ex: transition) entries are not.
+* -- hLC
+* -- paDTB = the physical address of the top level page table (ex: CR3).
+* -- dwFlags = LC_TRANSLATE_FLAG_*
+* -- cVA
+* -- pqwVA = the virtual addresses to translate.
+* -- pqwPA = buffer to receive the physical addresses (may be pqwVA).
+* -- return = TRUE if all virtual addresses are translated.
+*/
+EXPORTED_FUNCTION _Success_(return)
+BOOL LcTranslateScatter(
+    _In_ HANDLE hLC,
+    _In_ QWORD paDTB,
+    _In_ DWORD dwFlags,
+    _In_ DWORD cVA,
+    _In_reads_(cVA) PQWORD pqwVA,
+    _Out_writes_(cVA) PQWORD pqwPA
+);
+
+
+
 //-----------------------------------------------------------------------------
 // Get/Set/Command functionality may be used to query and/or update LeechCore
 // or its devices in various ways.
@@ -385,6 +475,14 @@ BOOL LcCommand(
 #define LC_OPT_CORE_STATISTICS_CALL_TIME            0x4000000a00000000  // R [lo-dword: LC_STATISTICS_ID_*]
 #define LC_OPT_CORE_VOLATILE                        0x1000000b00000000  // R
 #define LC_OPT_CORE_READONLY                        0x1000000c00000000  // R
+#define LC_OPT_CORE_STATISTICS_READ_INFLIGHT_HITS   0x4000000d00000000  // R - number of pages read by attaching to an identical concurrent read in flight (duplicate suppression).
+#define LC_OPT_CORE_READAHEAD                       0x4000000e00000000  // RW - sequential read-ahead window in pages (0 = disabled, max 0x1000).
+#define LC_OPT_CORE_STATISTICS_READAHEAD_PAGES      0x4000000f00000000  // R - number of pages prefetched by read-ahead.
+#define LC_OPT_CORE_STATISTICS_READAHEAD_HITS       0x4000001000000000  // R - number of pages served from the read-ahead buffer.
+#define LC_OPT_CORE_STATISTICS_READAHEAD_WASTE      0x4000001100000000  // R - number of prefetched pages discarded without being served.
+#define LC_OPT_CORE_TRANSLATE_INVALIDATE            0x4000001200000000  // W - invalidate the translation cache of a DTB (value = DTB, 0 = all DTBs).
+#define LC_OPT_CORE_STATISTICS_TRANSLATE_HITS       0x4000001300000000  // R - number of virtual addresses translated from the translation cache (at least one page table level skipped).
+#define LC_OPT_CORE_STATISTICS_TRANSLATE_READS      0x4000001400000000  // R - number of page table entries read by LcTranslateScatter.
 
 #define LC_OPT_MEMORYINFO_VALID                     0x0200000100000000  // R
 #define LC_OPT_MEMORYINFO_FLAG_32BIT                0x0200000300000000  // R
@@ -412,6 +510,8 @@ BOOL LcCommand(
 #define LC_OPT_FPGA_DELAY_WRITE                     0x0300000700000000  // RW - uS
 #define LC_OPT_FPGA_DELAY_READ                      0x0300000800000000  // RW - uS
 #define LC_OPT_FPGA_RETRY_ON_ERROR                  0x0300000900000000  // RW
+#define LC_OPT_FPGA_CMD_TIMEOUT                     0x0300000a00000000  // RW - uS - command/reply (config/custom register) transaction deadline.
+#define LC_OPT_FPGA_WAIT_SPIN                       0x0300000b00000000  // RW - uS - max time a wait spins before the thread is parked (0 = never spin).
 #define LC_OPT_FPGA_DEVICE_ID                       0x0300008000000000  // RW - bus:dev:fn (ex: 04:00.0 == 0x0400).
 #define LC_OPT_FPGA_FPGA_ID                         0x0300008100000000  // R
 #define LC_OPT_FPGA_VERSION_MAJOR                   0x0300008200000000  // R
@@ -419,8 +519,23 @@ BOOL LcCommand(
 #define LC_OPT_FPGA_ALGO_TINY                       0x0300008400000000  // RW - 1/0 use tiny 128-byte/tlp read algorithm.
 #define LC_OPT_FPGA_ALGO_SYNCHRONOUS                0x0300008500000000  // RW - 1/0 use synchronous (old) read algorithm.
 #define LC_OPT_FPGA_CFGSPACE_XILINX                 0x0300008600000000  // RW - [lo-dword: register address in bytes] [bytes: 0-3: data, 4-7: byte_enable(if wr/set); top bit = cfg_mgmt_wr_rw1c_as_rw]
+#define LC_OPT_FPGA_ALGO_TINY_AUTO                  0x0300008800000000  // RW - 1/0 learn address ranges requiring the tiny algorithm (4K reads fail, tiny reads succeed) and use it only there.
+#define LC_OPT_FPGA_ALGO_TINY_RANGES                0x0300008900000000  // R - number of learned address ranges read with the tiny algorithm.
+#define LC_OPT_FPGA_READ_COALESCE                   0x0300008a00000000  // RW - 1/0 read nearby sub-page MEMs in the same page with one covering read (default: 1).
 #define LC_OPT_FPGA_TLP_READ_CB_WITHINFO            0x0300009000000000  // RW - 1/0 call TLP read callback with additional string info in szInfo
 #define LC_OPT_FPGA_TLP_READ_CB_FILTERCPL           0x0300009100000000  // RW - 1/0 call TLP read callback with memory read completions from read calls filtered
+#define LC_OPT_FPGA_CMD_STAT_COUNT                  0x030000a000000000  // R - number of command/reply transactions.
+#define LC_OPT_FPGA_CMD_STAT_TIMEOUTS               0x030000a100000000  // R - number of command/reply transactions with missing replies at deadline.
+#define LC_OPT_FPGA_CMD_STAT_TIME                   0x030000a200000000  // R - uS - total command/reply transaction latency.
+#define LC_OPT_FPGA_CMD_STAT_TIME_MAX               0x030000a300000000  // R - uS - max command/reply transaction latency.
+#define LC_OPT_FPGA_READ_STAT_STALE_TAGS            0x030000a400000000  // R - number of read tags recycled without a completion (timed out).
+#define LC_OPT_FPGA_READ_STAT_REISSUES              0x030000a500000000  // R - number of lost read sub-ranges (4K page / 128-byte tiny) reissued.
+#define LC_OPT_FPGA_READ_STAT_REISSUE_BYTES         0x030000a600000000  // R - number of bytes reissued.
+#define LC_OPT_FPGA_READ_STAT_COMBINED              0x030000a700000000  // R - number of read/write requests processed by another thread than the requesting thread (work combining).
+#define LC_OPT_FPGA_READ_STAT_CPU_TIME              0x030000a800000000  // RW - uS - cpu time of threads in read calls; set 1/0 to enable/disable sampling (default: 0).
+#define LC_OPT_FPGA_READ_STAT_CPU_TIME_PER_MB       0x030000a900000000  // R - uS - cpu time of threads in read calls per MB successfully read.
+#define LC_OPT_FPGA_WAIT_STAT_PARKED                0x030000aa00000000  // R - number of waits that parked the thread instead of spinning.
+#define LC_OPT_FPGA_READ_STAT_COALESCED             0x030000ab00000000  // R - number of sub-page MEMs read by covering reads.
 
 #define LC_CMD_FPGA_PCIECFGSPACE                    0x0000010300000000  // R
 #define LC_CMD_FPGA_CFGREGPCIE                      0x0000010400000000  // RW - [lo-dword: register address]
@@ -453,6 +568,7 @@ BOOL LcCommand(
 #define LC_CMD_MEMMAP_SET                           0x4000030000000000  // W  - MEMMAP as LPSTR
 #define LC_CMD_MEMMAP_GET_STRUCT                    0x4000040000000000  // R  - MEMMAP as LC_MEMMAP_ENTRY[]
 #define LC_CMD_MEMMAP_SET_STRUCT                    0x4000050000000000  // W  - MEMMAP as LC_MEMMAP_ENTRY[]
+#define LC_CMD_MEMSCAN                              0x4000060000000000  // RW - scan physical memory for patterns (pbDataIn == LC_MEMSCAN_REQ, pbDataOut == LC_MEMSCAN_RSP).
 
 #define LC_CMD_AGENT_EXEC_PYTHON                    0x8000000100000000  // RW - [lo-dword: optional timeout in ms]
 #define LC_CMD_AGENT_EXIT_PROCESS                   0x8000000200000000  //    - [lo-dword: process exit code]
@@ -467,6 +583,12 @@ BOOL LcCommand(
 #define LC_CMD_AGENT_VFS_REQ_VERSION                0xfeed0001
 #define LC_CMD_AGENT_VFS_RSP_VERSION                0xfeee0001
 
+#define LC_MEMSCAN_REQ_VERSION                      0xc0fb0001
+#define LC_MEMSCAN_RSP_VERSION                      0xc0fc0001
+#define LC_MEMSCAN_PATTERN_MAX_CB                   32
+#define LC_MEMSCAN_PATTERN_MAX                      0x400
+#define LC_MEMSCAN_THREAD_MAX                       16
+
 #define LC_STATISTICS_VERSION                       0xe1a10002
 #define LC_STATISTICS_ID_OPEN                       0x00
 #define LC_STATISTICS_ID_READ                       0x01
@@ -500,6 +622,39 @@ typedef struct tdLC_CMD_AGENT_VFS_RSP {
     BYTE pb[0];
 } LC_CMD_AGENT_VFS_RSP, *PLC_CMD_AGENT_VFS_RSP;
 
+typedef struct tdLC_MEMSCAN_PATTERN {
+    DWORD cb;                       // pattern length in bytes (1 - LC_MEMSCAN_PATTERN_MAX_CB)
+    DWORD cbAlign;                  // required physical address alignment of a match (0/1 = none, power of two <= 0x1000)
+    BYTE pb[LC_MEMSCAN_PATTERN_MAX_CB];
+    BYTE pbMask[LC_MEMSCAN_PATTERN_MAX_CB]; // bits to compare (0xff = whole byte, 0x00 = wildcard)
+} LC_MEMSCAN_PATTERN, *PLC_MEMSCAN_PATTERN;
+
+typedef struct tdLC_MEMSCAN_REQ {
+    DWORD dwVersion;                // LC_MEMSCAN_REQ_VERSION
+    DWORD cMatchMax;                // max number of matches (0 = default 0x10000)
+    QWORD paMin;
+    QWORD paMax;                    // scan [paMin, paMax) of the memory map (0 = max address)
+    DWORD cThread;                  // number of matcher threads (0 = default, max LC_MEMSCAN_THREAD_MAX)
+    DWORD cPattern;                 // number of patterns (max LC_MEMSCAN_PATTERN_MAX)
+    LC_MEMSCAN_PATTERN Pattern[0];
+} LC_MEMSCAN_REQ, *PLC_MEMSCAN_REQ;
+
+typedef struct tdLC_MEMSCAN_MATCH {
+    QWORD pa;
+    DWORD iPattern;
+    DWORD _FutureUse;
+} LC_MEMSCAN_MATCH, *PLC_MEMSCAN_MATCH;
+
+typedef struct tdLC_MEMSCAN_RSP {
+    DWORD dwVersion;                // LC_MEMSCAN_RSP_VERSION
+    DWORD fTruncated;               // cMatchMax reached - scan stopped, matches are an arbitrary subset.
+    QWORD cbScan;                   // bytes read and scanned
+    QWORD cbFail;                   // bytes in the memory map failed to read
+    DWORD _FutureUse;
+    DWORD cMatch;
+    LC_MEMSCAN_MATCH Match[0];      // matches sorted by address
+} LC_MEMSCAN_RSP, *PLC_MEMSCAN_RSP;
+
 static LPCSTR LC_STATISTICS_NAME[] = {
     "LcOpen",
     "LcRead",
@@ -43,6 +43,8 @@ typedef struct tdCRITICAL_SECTION {
 
 #define LC_CONTEXT_VERSION                  0xc0e10004
 #define LC_DEVICE_PARAMETER_MAX_ENTRIES     0x10
+#define LC_INFLIGHT_BUCKETS                 0x400
+#define LC_TRANSLATE_DTB_MAX                4
 
 #define LC_MEMMAP_FORCE_OFFSET              0x8000000000000000
 
@@ -121,6 +123,59 @@ typedef struct tdLC_CONTEXT {
         BOOL fCompress;
         DWORD dwRpcClientId;
     } Rpc;
+    // Internal read in-flight table (duplicate page suppression):
+    struct {
+        QWORD cHit;
+        volatile DWORD cReader;     // number of active reads
+        PVOID pSolo;                // unpublished pages of a single active read
+        union {
+            CRITICAL_SECTION Lock;
+            BYTE _PadLinux[48];
+        };
+        PVOID pBucket[LC_INFLIGHT_BUCKETS];
+    } InFlight;
+    // Internal read-ahead (sequential stream prefetch):
+    struct {
+        DWORD cPageWindow;          // prefetch window in pages (0 = disabled)
+        BOOL fActive;
+        union {
+            CRITICAL_SECTION Lock;
+            BYTE _PadLinux[48];
+        };
+        HANDLE hThread;
+        HANDLE hEventWakeup;
+        HANDLE hEventFinish;
+        // stream detector:
+        QWORD paNext;               // address following the last read run
+        DWORD cSeq;                 // number of consecutive calls continuing the run
+        // prefetch buffer - pages [paBase, paBase + cPage * 0x1000):
+        QWORD paBase;
+        DWORD cPage;
+        DWORD iFill;                // pages [iFill, cPage) are fetched by the prefetch thread while fFill
+        volatile DWORD fFill;
+        QWORD tcFill;
+        PBYTE pbUsed;               // per page: served to a caller
+        PPMEM_SCATTER ppMEMs;
+        PPMEM_SCATTER ppMEMsSwap;   // scratch for buffer shifts (pbUsed allocated after)
+        // statistics:
+        QWORD cPrefetch;
+        QWORD cHit;
+        QWORD cWaste;
+    } ReadAhead;
+    // Internal virtual address translation cache (upper level page table entries per DTB):
+    struct {
+        union {
+            CRITICAL_SECTION Lock;
+            BYTE _PadLinux[48];
+        };
+        DWORD iDtbNext;             // next DTB cache to replace (round-robin)
+        PVOID pDtb[LC_TRANSLATE_DTB_MAX];
+        // statistics:
+        QWORD cHit;
+        QWORD cRead;
+    } Translate;
+    // Optional device read chain (dependent reads walked by the device) - return FALSE if not supported:
+    BOOL(*pfnReadChain)(_In_ PLC_CONTEXT ctxLC, _Inout_ PLC_READCHAIN pChain);
 } LC_CONTEXT, *PLC_CONTEXT;
 
 /*
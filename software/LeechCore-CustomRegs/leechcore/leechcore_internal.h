@@ -19,6 +19,17 @@
 */
 VOID LcMemMap_TranslateMEMs(_In_ PLC_CONTEXT ctxLC, _In_ DWORD cMEMs, _Inout_ PPMEM_SCATTER ppMEMs);
 
+/*
+* Retrieve the address of the next node of a read chain from a node read.
+* Shared by the generic read chain implementation and devices walking the
+* chain themselves. pChain->cNode must include the node.
+* -- pChain
+* -- pbNode = the node data (pChain->cbNode bytes).
+* -- pqwNext = receives the address of the next node.
+* -- return = 0 to continue with the next node, otherwise LC_READCHAIN_STOP_*.
+*/
+DWORD LcReadChain_Next(_In_ PLC_READCHAIN pChain, _In_ PBYTE pbNode, _Out_ PQWORD pqwNext);
+
 /*
 * Retrieve the memory ranges as an array of LC_MEMMAP_ENTRY.
 * -- ctxLC
@@ -70,4 +81,21 @@ BOOL LcMemMap_SetRangesFromText(_In_ PLC_CONTEXT ctxLC, _In_ PBYTE pb, _In_ DWOR
 */
 VOID LcCreate_FetchDeviceParameter(_Inout_ PLC_CONTEXT ctxLC);
 
+/*
+* Scan physical memory for patterns (LC_CMD_MEMSCAN). Chunks are read by the
+* calling thread while matcher threads scan the chunks already read.
+* NB! must not be called with the device lock held.
+* CALLER LcMemFree: *ppbDataOut
+* -- ctxLC
+* -- cMemMap = number of memory map ranges (copy taken by caller).
+* -- pMemMap
+* -- cbDataIn
+* -- pbDataIn = LC_MEMSCAN_REQ
+* -- ppbDataOut = receives LC_MEMSCAN_RSP
+* -- pcbDataOut
+* -- return
+*/
+_Success_(return)
+BOOL LcMemScan(_In_ PLC_CONTEXT ctxLC, _In_ DWORD cMemMap, _In_reads_(cMemMap) PLC_MEMMAP_ENTRY pMemMap, _In_ DWORD cbDataIn, _In_reads_(cbDataIn) PBYTE pbDataIn, _Out_ PBYTE *ppbDataOut, _Out_opt_ PDWORD pcbDataOut);
+
 #endif /* __LEECHCORE_INTERNAL_H__ */
@@ -0,0 +1,588 @@
+// memscan.c : implementation of the physical memory pattern scanner (LC_CMD_MEMSCAN).
+//
+// The memory map is split into chunks. The calling thread reads the chunks in
+// order with LcReadScatter() into a ring of buffers while matcher threads scan
+// the chunks already read. Matcher thread N scans chunks N, N + cThread, ...
+// and alternates between buffers N and N + cThread - i.e. the next chunk of a
+// matcher thread is read while it scans its current chunk. Each chunk is read
+// with one extra page (if contiguous) so that matches crossing the end of the
+// chunk are found.
+//
+// Few patterns are matched one pattern at a time by searching for an anchor
+// byte pair (AVX2 if supported, otherwise memchr) followed by a masked verify.
+// Many patterns are matched in a single pass with a table indexed by the
+// 16-bit anchor pair at each position.
+//
+// (c) LeechCore contributors, 2025
+//
+#include "leechcore.h"
+#include "leechcore_device.h"
+#include "leechcore_internal.h"
+#include "oscompatibility.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define LC_MEMSCAN_X64
+#ifdef _WIN32
+#include <intrin.h>
+#define LC_MEMSCAN_TARGET(isa)
+#else /* _WIN32 */
+#include <immintrin.h>
+#define LC_MEMSCAN_TARGET(isa)          __attribute__((target(isa)))
+#endif /* _WIN32 */
+#endif /* _M_X64 || __x86_64__ */
+
+#define LC_MEMSCAN_CHUNK_PAGES          0x100       // pages per chunk (excluding the extra page)
+#define LC_MEMSCAN_BUFFER_SLACK         0x40        // bytes after a buffer which may be loaded (but not matched) by vector compares
+#define LC_MEMSCAN_THREAD_DEFAULT       4
+#define LC_MEMSCAN_MATCH_DEFAULT        0x10000
+#define LC_MEMSCAN_MATCH_FLUSH          0x40        // thread local matches before flushed to the result
+#define LC_MEMSCAN_TABLE_PATTERN_MIN    5           // min number of patterns for the anchor pair table to be used
+
+#define LC_MEMSCAN_BUFFER_FREE          0
+#define LC_MEMSCAN_BUFFER_READY         1
+
+typedef struct tdLC_MEMSCAN_CHUNK {
+    QWORD pa;
+    DWORD cb;                       // bytes in which a match may start
+    DWORD cbRead;                   // bytes read (cb + extra page if contiguous)
+} LC_MEMSCAN_CHUNK, *PLC_MEMSCAN_CHUNK;
+
+typedef struct tdLC_MEMSCAN_PATTERN_INTERNAL {
+    DWORD iPattern;
+    DWORD cb;
+    QWORD qwAlignMask;
+    DWORD oAnchor;                  // offset of the anchor in the pattern
+    DWORD cbAnchor;                 // 2 = byte pair, 1 = single byte, 0 = none (every position is verified)
+    BYTE bAnchor[2];
+    DWORD iNext;                    // next pattern with the same anchor pair in the table (index + 1, 0 = none)
+    BYTE pb[LC_MEMSCAN_PATTERN_MAX_CB];
+    BYTE pbMask[LC_MEMSCAN_PATTERN_MAX_CB];
+} LC_MEMSCAN_PATTERN_INTERNAL, *PLC_MEMSCAN_PATTERN_INTERNAL;
+
+typedef struct tdLC_MEMSCAN_BUFFER {
+    volatile DWORD dwState;         // LC_MEMSCAN_BUFFER_*
+    DWORD iChunk;
+    PBYTE pb;
+    PPMEM_SCATTER ppMEMs;
+} LC_MEMSCAN_BUFFER, *PLC_MEMSCAN_BUFFER;
+
+typedef struct tdLC_MEMSCAN_CONTEXT LC_MEMSCAN_CONTEXT, *PLC_MEMSCAN_CONTEXT;
+
+typedef struct tdLC_MEMSCAN_THREAD {
+    PLC_MEMSCAN_CONTEXT ctx;
+    DWORD iThread;
+    HANDLE hThread;
+    HANDLE hEventFinish;
+    QWORD pa;                       // address of the chunk being scanned
+    DWORD cMatch;
+    LC_MEMSCAN_MATCH Match[LC_MEMSCAN_MATCH_FLUSH];
+} LC_MEMSCAN_THREAD, *PLC_MEMSCAN_THREAD;
+
+struct tdLC_MEMSCAN_CONTEXT {
+    PLC_CONTEXT ctxLC;
+    QWORD paMin;
+    QWORD paMax;
+    BOOL fAvx2;
+    volatile BOOL fAbort;
+    // patterns:
+    DWORD cPattern;
+    PLC_MEMSCAN_PATTERN_INTERNAL pPatterns;
+    PDWORD pdwTable;                // anchor pair -> pattern index + 1 (NULL if not used)
+    // chunks / buffers / threads:
+    DWORD cChunk;
+    PLC_MEMSCAN_CHUNK pChunks;
+    DWORD cThread;
+    DWORD cBuffer;
+    LC_MEMSCAN_BUFFER Buffer[2 * LC_MEMSCAN_THREAD_MAX];
+    LC_MEMSCAN_THREAD Thread[LC_MEMSCAN_THREAD_MAX];
+    // result:
+    union {
+        CRITICAL_SECTION LockMatch;
+        BYTE _PadLinux[48];
+    };
+    BOOL fTruncated;
+    DWORD cMatch;
+    DWORD cMatchMax;
+    PLC_MEMSCAN_MATCH pMatch;
+    QWORD cbScan;
+    QWORD cbFail;
+};
+
+/*
+* Check whether the CPU supports AVX2.
+*/
+BOOL LcMemScan_CpuAvx2()
+{
+#ifdef LC_MEMSCAN_X64
+#ifdef _WIN32
+    int r[4];
+    __cpuid(r, 0);
+    if(r[0] < 7) { return FALSE; }
+    __cpuid(r, 1);
+    if(!(r[2] & (1 << 27)) || !(r[2] & (1 << 28)) || ((_xgetbv(0) & 6) != 6)) { return FALSE; }
+    __cpuidex(r, 7, 0);
+    return (r[1] & (1 << 5)) ? TRUE : FALSE;
+#else /* _WIN32 */
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? TRUE : FALSE;
+#endif /* _WIN32 */
+#else /* LC_MEMSCAN_X64 */
+    return FALSE;
+#endif /* LC_MEMSCAN_X64 */
+}
+
+/*
+* Move the thread local matches to the result. The scan is aborted once the
+* max number of matches is exceeded.
+* -- ctxT
+*/
+VOID LcMemScan_MatchFlush(_In_ PLC_MEMSCAN_THREAD ctxT)
+{
+    DWORD c;
+    PLC_MEMSCAN_CONTEXT ctx = ctxT->ctx;
+    if(!ctxT->cMatch) { return; }
+    EnterCriticalSection(&ctx->LockMatch);
+    c = min(ctxT->cMatch, ctx->cMatchMax - ctx->cMatch);
+    memcpy(ctx->pMatch + ctx->cMatch, ctxT->Match, c * sizeof(LC_MEMSCAN_MATCH));
+    ctx->cMatch += c;
+    if(c < ctxT->cMatch) {
+        ctx->fTruncated = TRUE;
+        ctx->fAbort = TRUE;
+    }
+    LeaveCriticalSection(&ctx->LockMatch);
+    ctxT->cMatch = 0;
+}
+
+/*
+* Verify a candidate match and add it to the thread local matches.
+* -- ctxT
+* -- pP
+* -- pb = chunk buffer.
+* -- o = offset of the candidate in the chunk buffer.
+*/
+static __forceinline VOID LcMemScan_Candidate(_In_ PLC_MEMSCAN_THREAD ctxT, _In_ PLC_MEMSCAN_PATTERN_INTERNAL pP, _In_ PBYTE pb, _In_ DWORD o)
+{
+    DWORD i;
+    QWORD pa = ctxT->pa + o;
+    if((pa & pP->qwAlignMask) || (pa < ctxT->ctx->paMin) || (pa + pP->cb > ctxT->ctx->paMax)) { return; }
+    for(i = 0; i < pP->cb; i++) {
+        if((pb[o + i] ^ pP->pb[i]) & pP->pbMask[i]) { return; }
+    }
+    if(ctxT->cMatch == LC_MEMSCAN_MATCH_FLUSH) {
+        LcMemScan_MatchFlush(ctxT);
+    }
+    ctxT->Match[ctxT->cMatch].pa = pa;
+    ctxT->Match[ctxT->cMatch].iPattern = pP->iPattern;
+    ctxT->Match[ctxT->cMatch]._FutureUse = 0;
+    ctxT->cMatch++;
+}
+
+#ifdef LC_MEMSCAN_X64
+/*
+* Scan candidate offsets [oPos, oPosEnd) for a single pattern by comparing its
+* anchor against 32 offsets at a time.
+*/
+LC_MEMSCAN_TARGET("avx2")
+VOID LcMemScan_ScanPattern_AVX2(_In_ PLC_MEMSCAN_THREAD ctxT, _In_ PLC_MEMSCAN_PATTERN_INTERNAL pP, _In_ PBYTE pb, _In_ DWORD oPos, _In_ DWORD oPosEnd)
+{
+    DWORD iBit, dwMask;
+    PBYTE pbAnchor = pb + pP->oAnchor;
+    __m256i v0 = _mm256_set1_epi8((char)pP->bAnchor[0]);
+    __m256i v1 = _mm256_set1_epi8((char)pP->bAnchor[1]);
+    while(oPos < oPosEnd) {
+        dwMask = (DWORD)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((__m256i*)(pbAnchor + oPos)), v0));
+        if(dwMask && (pP->cbAnchor == 2)) {
+            dwMask &= (DWORD)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((__m256i*)(pbAnchor + oPos + 1)), v1));
+        }
+        if(oPosEnd - oPos < 32) {
+            dwMask &= (1UL << (oPosEnd - oPos)) - 1;
+        }
+        while(_BitScanForward(&iBit, dwMask)) {
+            dwMask &= dwMask - 1;
+            LcMemScan_Candidate(ctxT, pP, pb, oPos + iBit);
+        }
+        oPos += 32;
+    }
+}
+#endif /* LC_MEMSCAN_X64 */
+
+/*
+* Scan a run of successfully read memory for a single pattern.
+* -- ctxT
+* -- pP
+* -- pb = chunk buffer.
+* -- oRun = run start offset.
+* -- oRunEnd = run end offset.
+* -- oLimit = matches must start before this offset.
+*/
+VOID LcMemScan_ScanPattern(_In_ PLC_MEMSCAN_THREAD ctxT, _In_ PLC_MEMSCAN_PATTERN_INTERNAL pP, _In_ PBYTE pb, _In_ DWORD oRun, _In_ DWORD oRunEnd, _In_ DWORD oLimit)
+{
+    DWORD o, oEnd, oPosEnd;
+    PBYTE pbHit;
+    if(oRunEnd - oRun < pP->cb) { return; }
+    oPosEnd = min(oLimit, oRunEnd - pP->cb + 1);
+    if(oRun >= oPosEnd) { return; }
+    if(!pP->cbAnchor) {
+        for(o = oRun; o < oPosEnd; o++) {
+            LcMemScan_Candidate(ctxT, pP, pb, o);
+        }
+        return;
+    }
+#ifdef LC_MEMSCAN_X64
+    if(ctxT->ctx->fAvx2) {
+        LcMemScan_ScanPattern_AVX2(ctxT, pP, pb, oRun, oPosEnd);
+        return;
+    }
+#endif /* LC_MEMSCAN_X64 */
+    o = oRun + pP->oAnchor;
+    oEnd = oPosEnd + pP->oAnchor;
+    while((o < oEnd) && (pbHit = memchr(pb + o, pP->bAnchor[0], oEnd - o))) {
+        o = (DWORD)(pbHit - pb);
+        if((pP->cbAnchor == 1) || (pb[o + 1] == pP->bAnchor[1])) {
+            LcMemScan_Candidate(ctxT, pP, pb, o - pP->oAnchor);
+        }
+        o++;
+    }
+}
+
+/*
+* Scan a run of successfully read memory for all patterns in the anchor pair
+* table in a single pass.
+* -- ctxT
+* -- pb = chunk buffer.
+* -- oRun = run start offset.
+* -- oRunEnd = run end offset.
+* -- oLimit = matches must start before this offset.
+*/
+VOID LcMemScan_ScanTable(_In_ PLC_MEMSCAN_THREAD ctxT, _In_ PBYTE pb, _In_ DWORD oRun, _In_ DWORD oRunEnd, _In_ DWORD oLimit)
+{
+    DWORD o, oEnd, oPos, i;
+    PLC_MEMSCAN_PATTERN_INTERNAL pP;
+    PLC_MEMSCAN_CONTEXT ctx = ctxT->ctx;
+    oEnd = min(oRunEnd - 1, oLimit + LC_MEMSCAN_PATTERN_MAX_CB);
+    for(o = oRun; o < oEnd; o++) {
+        if(!(i = ctx->pdwTable[*(PWORD)(pb + o)])) { continue; }
+        do {
+            pP = ctx->pPatterns + i - 1;
+            i = pP->iNext;
+            if(o < oRun + pP->oAnchor) { continue; }
+            oPos = o - pP->oAnchor;
+            if((oPos < oLimit) && (oPos + pP->cb <= oRunEnd)) {
+                LcMemScan_Candidate(ctxT, pP, pb, oPos);
+            }
+        } while(i);
+    }
+}
+
+/*
+* Scan a chunk read into a buffer. Runs of successfully read pages are scanned
+* separately - a match never spans a page failed to read.
+* -- ctxT
+* -- pChunk
+* -- pBuffer
+*/
+VOID LcMemScan_ScanChunk(_In_ PLC_MEMSCAN_THREAD ctxT, _In_ PLC_MEMSCAN_CHUNK pChunk, _In_ PLC_MEMSCAN_BUFFER pBuffer)
+{
+    DWORD i, iPage = 0, cPage, oRun, oRunEnd;
+    PLC_MEMSCAN_CONTEXT ctx = ctxT->ctx;
+    PLC_MEMSCAN_PATTERN_INTERNAL pP;
+    ctxT->pa = pChunk->pa;
+    cPage = pChunk->cbRead >> 12;
+    while(iPage < cPage) {
+        if(!pBuffer->ppMEMs[iPage]->f) {
+            iPage++;
+            continue;
+        }
+        oRun = iPage << 12;
+        if(oRun >= pChunk->cb) { break; }
+        while((iPage < cPage) && pBuffer->ppMEMs[iPage]->f) {
+            iPage++;
+        }
+        oRunEnd = iPage << 12;
+        if(ctx->pdwTable) {
+            LcMemScan_ScanTable(ctxT, pBuffer->pb, oRun, oRunEnd, pChunk->cb);
+        }
+        for(i = 0; i < ctx->cPattern; i++) {
+            pP = ctx->pPatterns + i;
+            if(!ctx->pdwTable || (pP->cbAnchor != 2)) {
+                LcMemScan_ScanPattern(ctxT, pP, pBuffer->pb, oRun, oRunEnd, pChunk->cb);
+            }
+        }
+    }
+}
+
+/*
+* Matcher thread - scan chunks iThread, iThread + cThread, ... as they are read.
+* -- ctxT
+*/
+DWORD LcMemScan_ThreadProc(_In_ PLC_MEMSCAN_THREAD ctxT)
+{
+    DWORD iChunk, dwState;
+    PLC_MEMSCAN_BUFFER pBuffer;
+    PLC_MEMSCAN_CONTEXT ctx = ctxT->ctx;
+    for(iChunk = ctxT->iThread; iChunk < ctx->cChunk; iChunk += ctx->cThread) {
+        pBuffer = ctx->Buffer + (iChunk % ctx->cBuffer);
+        while((dwState = pBuffer->dwState) != LC_MEMSCAN_BUFFER_READY) {
+            WaitOnAddress(&pBuffer->dwState, &dwState, sizeof(DWORD), INFINITE);
+        }
+        if(!ctx->fAbort) {
+            LcMemScan_ScanChunk(ctxT, ctx->pChunks + iChunk, pBuffer);
+        }
+        pBuffer->dwState = LC_MEMSCAN_BUFFER_FREE;
+        WakeByAddressAll((PVOID)&pBuffer->dwState);
+    }
+    LcMemScan_MatchFlush(ctxT);
+    SetEvent(ctxT->hEventFinish);
+    return 0;
+}
+
+/*
+* Initialize the patterns from the request. An anchor - preferably a pair of
+* whole (unmasked) bytes other than 0x00/0xff - is selected for each pattern.
+* -- ctx
+* -- pReq
+* -- return
+*/
+_Success_(return)
+BOOL LcMemScan_InitializePatterns(_In_ PLC_MEMSCAN_CONTEXT ctx, _In_ PLC_MEMSCAN_REQ pReq)
+{
+    DWORD i, j, w, cTable = 0, dwScore, dwScoreBest;
+    PLC_MEMSCAN_PATTERN pPattern;
+    PLC_MEMSCAN_PATTERN_INTERNAL pP;
+    if(!(ctx->pPatterns = LocalAlloc(LMEM_ZEROINIT, pReq->cPattern * sizeof(LC_MEMSCAN_PATTERN_INTERNAL)))) { return FALSE; }
+    ctx->cPattern = pReq->cPattern;
+    for(i = 0; i < pReq->cPattern; i++) {
+        pPattern = pReq->Pattern + i;
+        pP = ctx->pPatterns + i;
+        if(!pPattern->cb || (pPattern->cb > LC_MEMSCAN_PATTERN_MAX_CB)) { return FALSE; }
+        if((pPattern->cbAlign > 0x1000) || (pPattern->cbAlign & (pPattern->cbAlign - 1))) { return FALSE; }
+        pP->iPattern = i;
+        pP->cb = pPattern->cb;
+        pP->qwAlignMask = pPattern->cbAlign ? (pPattern->cbAlign - 1) : 0;
+        for(j = 0; j < pP->cb; j++) {
+            pP->pbMask[j] = pPattern->pbMask[j];
+            pP->pb[j] = pPattern->pb[j] & pPattern->pbMask[j];
+        }
+        // select anchor: score 4 = rare pair, 3 = pair, 2 = rare byte, 1 = byte.
+        for(j = 0, dwScoreBest = 0; j < pP->cb; j++) {
+            if(pP->pbMask[j] != 0xff) { continue; }
+            dwScore = ((pP->pb[j] == 0x00) || (pP->pb[j] == 0xff)) ? 1 : 2;
+            if((j + 1 < pP->cb) && (pP->pbMask[j + 1] == 0xff)) {
+                dwScore = ((dwScore == 2) && (pP->pb[j + 1] != 0x00) && (pP->pb[j + 1] != 0xff)) ? 4 : 3;
+            }
+            if(dwScore > dwScoreBest) {
+                dwScoreBest = dwScore;
+                pP->oAnchor = j;
+                pP->cbAnchor = (dwScore >= 3) ? 2 : 1;
+            }
+        }
+        pP->bAnchor[0] = pP->pb[pP->oAnchor];
+        pP->bAnchor[1] = (pP->cbAnchor == 2) ? pP->pb[pP->oAnchor + 1] : 0;
+        if(pP->cbAnchor == 2) { cTable++; }
+    }
+    // anchor pair table - if many patterns:
+    if(cTable >= LC_MEMSCAN_TABLE_PATTERN_MIN) {
+        if(!(ctx->pdwTable = LocalAlloc(LMEM_ZEROINIT, 0x10000 * sizeof(DWORD)))) { return FALSE; }
+        for(i = ctx->cPattern; i; i--) {
+            pP = ctx->pPatterns + i - 1;
+            if(pP->cbAnchor != 2) { continue; }
+            w = pP->bAnchor[0] | (pP->bAnchor[1] << 8);
+            pP->iNext = ctx->pdwTable[w];
+            ctx->pdwTable[w] = i;
+        }
+    }
+    return TRUE;
+}
+
+/*
+* Split the memory map ranges within [paMin, paMax) into chunks.
+* -- ctx
+* -- cMemMap
+* -- pMemMap
+* -- paMin
+* -- paMax
+* -- return
+*/
+_Success_(return)
+BOOL LcMemScan_InitializeChunks(_In_ PLC_MEMSCAN_CONTEXT ctx, _In_ DWORD cMemMap, _In_reads_(cMemMap) PLC_MEMMAP_ENTRY pMemMap, _In_ QWORD paMin, _In_ QWORD paMax)
+{
+    DWORD i, cChunkMax = 0;
+    QWORD pa, paEnd, cb;
+    PLC_MEMSCAN_CHUNK pChunk;
+    for(i = 0; i < cMemMap; i++) {
+        pa = max(pMemMap[i].pa, paMin & ~0xfff);
+        paEnd = min(pMemMap[i].pa + pMemMap[i].cb, paMax);
+        if(pa < paEnd) {
+            cChunkMax += (DWORD)((paEnd - pa + (LC_MEMSCAN_CHUNK_PAGES << 12) - 1) / (LC_MEMSCAN_CHUNK_PAGES << 12));
+        }
+    }
+    if(!cChunkMax) { return TRUE; }
+    if(!(ctx->pChunks = LocalAlloc(0, cChunkMax * sizeof(LC_MEMSCAN_CHUNK)))) { return FALSE; }
+    for(i = 0; i < cMemMap; i++) {
+        pa = max(pMemMap[i].pa, paMin & ~0xfff);
+        paEnd = min(pMemMap[i].pa + pMemMap[i].cb, paMax);
+        while(pa < paEnd) {
+            cb = min(LC_MEMSCAN_CHUNK_PAGES << 12, paEnd - pa);
+            pChunk = ctx->pChunks + ctx->cChunk++;
+            pChunk->pa = pa;
+            pChunk->cb = (DWORD)cb;
+            pChunk->cbRead = (DWORD)(((pa + cb + 0xfff) & ~0xfff) - pa);
+            if(pa + pChunk->cbRead < paEnd) {
+                pChunk->cbRead += 0x1000;
+            }
+            pa += cb;
+        }
+    }
+    return TRUE;
+}
+
+/*
+* qsort compare function - sort matches by address and pattern.
+*/
+int LcMemScan_CmpMatch(_In_ const void *pv1, _In_ const void *pv2)
+{
+    PLC_MEMSCAN_MATCH p1 = (PLC_MEMSCAN_MATCH)pv1;
+    PLC_MEMSCAN_MATCH p2 = (PLC_MEMSCAN_MATCH)pv2;
+    if(p1->pa != p2->pa) {
+        return (p1->pa < p2->pa) ? -1 : 1;
+    }
+    return (p1->iPattern < p2->iPattern) ? -1 : ((p1->iPattern > p2->iPattern) ? 1 : 0);
+}
+
+/*
+* Scan physical memory for patterns (LC_CMD_MEMSCAN). Chunks are read by the
+* calling thread while matcher threads scan the chunks already read.
+* NB! must not be called with the device lock held.
+* CALLER LcMemFree: *ppbDataOut
+* -- ctxLC
+* -- cMemMap = number of memory map ranges (copy taken by caller).
+* -- pMemMap
+* -- cbDataIn
+* -- pbDataIn = LC_MEMSCAN_REQ
+* -- ppbDataOut = receives LC_MEMSCAN_RSP
+* -- pcbDataOut
+* -- return
+*/
+_Success_(return)
+BOOL LcMemScan(_In_ PLC_CONTEXT ctxLC, _In_ DWORD cMemMap, _In_reads_(cMemMap) PLC_MEMMAP_ENTRY pMemMap, _In_ DWORD cbDataIn, _In_reads_(cbDataIn) PBYTE pbDataIn, _Out_ PBYTE *ppbDataOut, _Out_opt_ PDWORD pcbDataOut)
+{
+    BOOL fResult = FALSE;
+    DWORD i, iChunk, cPage, cThreadStarted = 0, dwState, cbRsp;
+    LC_MEMMAP_ENTRY MemMapDefault;
+    PLC_MEMSCAN_REQ pReq = (PLC_MEMSCAN_REQ)pbDataIn;
+    PLC_MEMSCAN_RSP pRsp;
+    PLC_MEMSCAN_CONTEXT ctx = NULL;
+    PLC_MEMSCAN_CHUNK pChunk;
+    PLC_MEMSCAN_BUFFER pBuffer;
+    PLC_MEMSCAN_THREAD ctxT;
+    PMEM_SCATTER pMEM;
+    *ppbDataOut = NULL;
+    if(pcbDataOut) { *pcbDataOut = 0; }
+    // validate request:
+    if(!pReq || (cbDataIn < sizeof(LC_MEMSCAN_REQ)) || (pReq->dwVersion != LC_MEMSCAN_REQ_VERSION)) { return FALSE; }
+    if(!pReq->cPattern || (pReq->cPattern > LC_MEMSCAN_PATTERN_MAX)) { return FALSE; }
+    if(cbDataIn < sizeof(LC_MEMSCAN_REQ) + pReq->cPattern * sizeof(LC_MEMSCAN_PATTERN)) { return FALSE; }
+    if(pReq->cThread > LC_MEMSCAN_THREAD_MAX) { return FALSE; }
+    // initialize:
+    if(!(ctx = LocalAlloc(LMEM_ZEROINIT, sizeof(LC_MEMSCAN_CONTEXT)))) { return FALSE; }
+    InitializeCriticalSection(&ctx->LockMatch);
+    ctx->ctxLC = ctxLC;
+    ctx->paMin = pReq->paMin;
+    ctx->fAvx2 = LcMemScan_CpuAvx2();
+    ctx->cMatchMax = pReq->cMatchMax ? pReq->cMatchMax : LC_MEMSCAN_MATCH_DEFAULT;
+    ctx->cThread = pReq->cThread ? pReq->cThread : LC_MEMSCAN_THREAD_DEFAULT;
+    ctx->cBuffer = 2 * ctx->cThread;
+    if(!cMemMap) {
+        MemMapDefault.pa = 0;
+        MemMapDefault.cb = LcMemMap_GetMaxAddress(ctxLC);
+        MemMapDefault.paRemap = 0;
+        cMemMap = 1;
+        pMemMap = &MemMapDefault;
+    }
+    ctx->paMax = pReq->paMax ? pReq->paMax : (QWORD)-1;
+    if(!LcMemScan_InitializePatterns(ctx, pReq)) { goto fail; }
+    if(!LcMemScan_InitializeChunks(ctx, cMemMap, pMemMap, ctx->paMin, ctx->paMax)) { goto fail; }
+    if(!(ctx->pMatch = LocalAlloc(0, (SIZE_T)ctx->cMatchMax * sizeof(LC_MEMSCAN_MATCH)))) { goto fail; }
+    for(i = 0; i < ctx->cBuffer; i++) {
+        pBuffer = ctx->Buffer + i;
+        if(!(pBuffer->pb = LocalAlloc(0, ((LC_MEMSCAN_CHUNK_PAGES + 1) << 12) + LC_MEMSCAN_BUFFER_SLACK))) { goto fail; }
+        if(!LcAllocScatter2((LC_MEMSCAN_CHUNK_PAGES + 1) << 12, pBuffer->pb, LC_MEMSCAN_CHUNK_PAGES + 1, &pBuffer->ppMEMs)) { goto fail; }
+    }
+    for(i = 0; i < ctx->cThread; i++) {
+        ctxT = ctx->Thread + i;
+        ctxT->ctx = ctx;
+        ctxT->iThread = i;
+        if(!(ctxT->hEventFinish = CreateEvent(NULL, TRUE, FALSE, NULL))) { goto fail; }
+    }
+    for(i = 0; i < ctx->cThread; i++) {
+        ctxT = ctx->Thread + i;
+        if(!(ctxT->hThread = CreateThread(NULL, 0, (LPTHREAD_START_ROUTINE)LcMemScan_ThreadProc, ctxT, 0, NULL))) { break; }
+        cThreadStarted++;
+    }
+    if(cThreadStarted < ctx->cThread) {
+        // chunks of threads not started are never scanned - abort (remaining chunks are passed through unread):
+        ctx->fAbort = TRUE;
+    }
+    // read chunks in order - each into the buffer of the matcher thread scanning it:
+    for(iChunk = 0; iChunk < ctx->cChunk; iChunk++) {
+        pChunk = ctx->pChunks + iChunk;
+        pBuffer = ctx->Buffer + (iChunk % ctx->cBuffer);
+        if(iChunk % ctx->cThread >= cThreadStarted) { continue; }
+        while((dwState = pBuffer->dwState) != LC_MEMSCAN_BUFFER_FREE) {
+            WaitOnAddress(&pBuffer->dwState, &dwState, sizeof(DWORD), INFINITE);
+        }
+        cPage = pChunk->cbRead >> 12;
+        for(i = 0; i < cPage; i++) {
+            pMEM = pBuffer->ppMEMs[i];
+            pMEM->qwA = pChunk->pa + ((QWORD)i << 12);
+            pMEM->f = FALSE;
+        }
+        if(!ctx->fAbort) {
+            LcReadScatter(ctxLC, cPage, pBuffer->ppMEMs);
+            for(i = 0; i < (pChunk->cb + 0xfff) >> 12; i++) {
+                if(pBuffer->ppMEMs[i]->f) {
+                    ctx->cbScan += 0x1000;
+                } else {
+                    ctx->cbFail += 0x1000;
+                }
+            }
+        }
+        pBuffer->iChunk = iChunk;
+        pBuffer->dwState = LC_MEMSCAN_BUFFER_READY;
+        WakeByAddressAll((PVOID)&pBuffer->dwState);
+    }
+    for(i = 0; i < cThreadStarted; i++) {
+        WaitForSingleObject(ctx->Thread[i].hEventFinish, INFINITE);
+    }
+    if(cThreadStarted < ctx->cThread) { goto fail; }
+    // result sorted by address:
+    qsort(ctx->pMatch, ctx->cMatch, sizeof(LC_MEMSCAN_MATCH), LcMemScan_CmpMatch);
+    cbRsp = sizeof(LC_MEMSCAN_RSP) + ctx->cMatch * sizeof(LC_MEMSCAN_MATCH);
+    if(!(pRsp = LocalAlloc(0, cbRsp))) { goto fail; }
+    pRsp->dwVersion = LC_MEMSCAN_RSP_VERSION;
+    pRsp->fTruncated = ctx->fTruncated;
+    pRsp->cbScan = ctx->cbScan;
+    pRsp->cbFail = ctx->cbFail;
+    pRsp->_FutureUse = 0;
+    pRsp->cMatch = ctx->cMatch;
+    memcpy(pRsp->Match, ctx->pMatch, ctx->cMatch * sizeof(LC_MEMSCAN_MATCH));
+    *ppbDataOut = (PBYTE)pRsp;
+    if(pcbDataOut) { *pcbDataOut = cbRsp; }
+    fResult = TRUE;
+fail:
+    for(i = 0; i < LC_MEMSCAN_THREAD_MAX; i++) {
+        if(ctx->Thread[i].hThread) { CloseHandle(ctx->Thread[i].hThread); }
+        if(ctx->Thread[i].hEventFinish) { CloseHandle(ctx->Thread[i].hEventFinish); }
+    }
+    for(i = 0; i < 2 * LC_MEMSCAN_THREAD_MAX; i++) {
+        LcMemFree(ctx->Buffer[i].ppMEMs);
+        LocalFree(ctx->Buffer[i].pb);
+    }
+    LocalFree(ctx->pMatch);
+    LocalFree(ctx->pChunks);
+    LocalFree(ctx->pdwTable);
+    LocalFree(ctx->pPatterns);
+    DeleteCriticalSection(&ctx->LockMatch);
+    LocalFree(ctx);
+    return fResult;
+}
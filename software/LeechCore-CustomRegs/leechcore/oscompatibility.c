@@ -131,6 +131,18 @@ BOOL QueryPerformanceCounter(_Out_ LARGE_INTEGER *lpPerformanceCount)
     return TRUE;
 }
 
+// function is limited to the current thread, kernel time is reported as user time.
+BOOL GetThreadTimes(_In_ HANDLE hThread, _Out_ FILETIME *lpCreationTime, _Out_ FILETIME *lpExitTime, _Out_ FILETIME *lpKernelTime, _Out_ FILETIME *lpUserTime)
+{
+    struct timespec ts;
+    if((hThread != GetCurrentThread()) || clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts)) { return FALSE; }
+    *lpCreationTime = 0;
+    *lpExitTime = 0;
+    *lpKernelTime = 0;
+    *lpUserTime = (ts.tv_sec * 10000000ULL) + (ts.tv_nsec / 100);             // 100nS resolution
+    return TRUE;
+}
+
 HANDLE CreateThread(
     PVOID     lpThreadAttributes,
     SIZE_T    dwStackSize,
@@ -485,6 +497,107 @@ VOID ReleaseSRWLockExclusive(_Inout_ PSRWLOCK pSRWLock)
 
 
 
+// ----------------------------------------------------------------------------
+// WaitOnAddress functionality below (DWORD sized addresses only):
+// ----------------------------------------------------------------------------
+
+#ifdef LINUX
+
+BOOL WaitOnAddress(_In_ volatile VOID *Address, _In_ PVOID CompareAddress, _In_ SIZE_T AddressSize, _In_opt_ DWORD dwMilliseconds)
+{
+    struct timespec ts;
+    DWORD dwCompare = *(PDWORD)CompareAddress;
+    if(AddressSize != sizeof(DWORD)) { return FALSE; }
+    if(*(volatile DWORD*)Address != dwCompare) { return TRUE; }
+    ts.tv_sec = dwMilliseconds / 1000;
+    ts.tv_nsec = (dwMilliseconds % 1000) * 1000 * 1000;
+    if((-1 == futex((uint32_t*)Address, FUTEX_WAIT, dwCompare, (dwMilliseconds == INFINITE) ? NULL : &ts, NULL, 0)) && (errno == ETIMEDOUT)) {
+        return FALSE;
+    }
+    return TRUE;
+}
+
+VOID WakeByAddressAll(_In_ PVOID Address)
+{
+    futex((uint32_t*)Address, FUTEX_WAKE, INT32_MAX, NULL, NULL, 0);
+}
+
+#endif /* LINUX */
+
+#ifdef MACOS
+
+// no futex - waiters park on a mutex/condition pair hashed from the address:
+#define WAITONADDRESS_BUCKETS       64
+
+typedef struct tdWAITONADDRESS_BUCKET {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+} WAITONADDRESS_BUCKET, *PWAITONADDRESS_BUCKET;
+
+static pthread_once_t g_WaitOnAddress_Once = PTHREAD_ONCE_INIT;
+static WAITONADDRESS_BUCKET g_WaitOnAddress_Buckets[WAITONADDRESS_BUCKETS];
+
+static VOID WaitOnAddress_InitializeOnce()
+{
+    DWORD i;
+    for(i = 0; i < WAITONADDRESS_BUCKETS; i++) {
+        pthread_mutex_init(&g_WaitOnAddress_Buckets[i].mutex, NULL);
+        pthread_cond_init(&g_WaitOnAddress_Buckets[i].cond, NULL);
+    }
+}
+
+static PWAITONADDRESS_BUCKET WaitOnAddress_Bucket(_In_ volatile VOID *Address)
+{
+    QWORD qw = (QWORD)Address;
+    pthread_once(&g_WaitOnAddress_Once, WaitOnAddress_InitializeOnce);
+    qw = (qw >> 2) ^ (qw >> 8) ^ (qw >> 14);
+    return &g_WaitOnAddress_Buckets[qw % WAITONADDRESS_BUCKETS];
+}
+
+BOOL WaitOnAddress(_In_ volatile VOID *Address, _In_ PVOID CompareAddress, _In_ SIZE_T AddressSize, _In_opt_ DWORD dwMilliseconds)
+{
+    int err = 0;
+    struct timespec ts;
+    PWAITONADDRESS_BUCKET pb;
+    DWORD dwCompare = *(PDWORD)CompareAddress;
+    if(AddressSize != sizeof(DWORD)) { return FALSE; }
+    if(*(volatile DWORD*)Address != dwCompare) { return TRUE; }
+    if(dwMilliseconds != INFINITE) {
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_sec += dwMilliseconds / 1000;
+        ts.tv_nsec += (dwMilliseconds % 1000) * 1000 * 1000;
+        if(ts.tv_nsec >= 1000 * 1000 * 1000) {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000 * 1000 * 1000;
+        }
+    }
+    // the value is re-checked under the bucket lock, which WakeByAddressAll
+    // also takes, so a change + wake between check and wait is never lost.
+    pb = WaitOnAddress_Bucket(Address);
+    pthread_mutex_lock(&pb->mutex);
+    while((*(volatile DWORD*)Address == dwCompare) && (err != ETIMEDOUT)) {
+        if(dwMilliseconds == INFINITE) {
+            pthread_cond_wait(&pb->cond, &pb->mutex);
+        } else {
+            err = pthread_cond_timedwait(&pb->cond, &pb->mutex, &ts);
+        }
+    }
+    pthread_mutex_unlock(&pb->mutex);
+    return (err != ETIMEDOUT);
+}
+
+VOID WakeByAddressAll(_In_ PVOID Address)
+{
+    PWAITONADDRESS_BUCKET pb = WaitOnAddress_Bucket(Address);
+    pthread_mutex_lock(&pb->mutex);
+    pthread_cond_broadcast(&pb->cond);
+    pthread_mutex_unlock(&pb->mutex);
+}
+
+#endif /* MACOS */
+
+
+
 // ----------------------------------------------------------------------------
 // EVENT functionality below:
 // ----------------------------------------------------------------------------
@@ -57,6 +57,7 @@ VOID BusySleep(_In_ DWORD us);
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/select.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 
@@ -153,6 +154,7 @@ typedef int(*_CoreCrtNonSecureSearchSortCompareFunction)(void const *, void cons
 #define _rotr64(v,c)                        ((((QWORD)v) >> ((QWORD)c) | (QWORD)((QWORD)v) << (64 - (QWORD)c)))
 #define _rotl64(v,c)                        ((QWORD)(((QWORD)v) << ((QWORD)c)) | (((QWORD)v) >> (64 - (QWORD)c)))
 #define _countof(_Array)                    (sizeof(_Array) / sizeof(_Array[0]))
+#define _BitScanForward(pi, v)              ((v) ? (*(pi) = (DWORD)__builtin_ctz(v), 1) : 0)
 #define sprintf_s(s, maxcount, ...)         (snprintf(s, maxcount, __VA_ARGS__))
 #define strnlen_s(s, maxcount)              (strnlen(s, maxcount))
 #define strcpy_s(dst, len, src)             (strncpy(dst, src, len))
@@ -171,6 +173,8 @@ typedef int(*_CoreCrtNonSecureSearchSortCompareFunction)(void const *, void cons
 #define Sleep(dwMilliseconds)               (usleep(1000*dwMilliseconds))
 #define fopen_s(ppFile, szFile, szAttr)     ((*ppFile = fopen(szFile, szAttr)) ? 0 : 1)
 #define GetModuleFileNameA(m, f, l)         (readlink("/proc/self/exe", f, l))
+#define GetComputerNameA(sz, pcch)          (0 == gethostname(sz, *(pcch)))
+#define FIELD_OFFSET(type, field)           ((LONG)__builtin_offsetof(type, field))
 #define ZeroMemory(pb, cb)                  (memset(pb, 0, cb))
 #define WinUsb_SetPipePolicy(h, p, t, cb, pb)   // TODO: implement this for better USB2 performance.
 #define WSAGetLastError()                   (WSAEWOULDBLOCK)    // TODO: remove this dummy when possible.
@@ -182,7 +186,11 @@ typedef int(*_CoreCrtNonSecureSearchSortCompareFunction)(void const *, void cons
 #define InterlockedIncrement64(p)           (__sync_add_and_fetch_8(p, 1))
 #define InterlockedIncrement(p)             (__sync_add_and_fetch_4(p, 1))
 #define InterlockedDecrement(p)             (__sync_sub_and_fetch_4(p, 1))
+#define InterlockedExchangePointer(p, v)    (__atomic_exchange_n(p, v, __ATOMIC_SEQ_CST))
+#define InterlockedCompareExchangePointer(p, v, c)  (__sync_val_compare_and_swap(p, c, v))
+#define MemoryBarrier()                     (__sync_synchronize())
 #define GetCurrentProcess()					((HANDLE)-1)
+#define GetCurrentThread()                  ((HANDLE)-2)
 #define closesocket(s)                      close(s)
 
 #ifndef _LINUX_DEF_CRITICAL_SECTION
@@ -224,6 +232,7 @@ VOID LocalFree(HANDLE hMem);
 QWORD GetTickCount64();
 BOOL QueryPerformanceFrequency(_Out_ LARGE_INTEGER *lpFrequency);
 BOOL QueryPerformanceCounter(_Out_ LARGE_INTEGER *lpPerformanceCount);
+BOOL GetThreadTimes(_In_ HANDLE hThread, _Out_ FILETIME *lpCreationTime, _Out_ FILETIME *lpExitTime, _Out_ FILETIME *lpKernelTime, _Out_ FILETIME *lpUserTime);
 VOID GetLocalTime(LPSYSTEMTIME lpSystemTime);
 DWORD InterlockedAdd(DWORD *Addend, DWORD Value);
 BOOL WinUsb_Free(WINUSB_INTERFACE_HANDLE InterfaceHandle);
@@ -259,6 +268,8 @@ BOOL SetEvent(_In_ HANDLE hEvent);
 HANDLE CreateEvent(_In_opt_ PVOID lpEventAttributes, _In_ BOOL bManualReset, _In_ BOOL bInitialState, _In_opt_ PVOID lpName);
 DWORD WaitForMultipleObjects(_In_ DWORD nCount, HANDLE *lpHandles, _In_ BOOL bWaitAll, _In_ DWORD dwMilliseconds);
 DWORD WaitForSingleObject(_In_ HANDLE hHandle, _In_ DWORD dwMilliseconds);
+BOOL WaitOnAddress(_In_ volatile VOID *Address, _In_ PVOID CompareAddress, _In_ SIZE_T AddressSize, _In_opt_ DWORD dwMilliseconds);
+VOID WakeByAddressAll(_In_ PVOID Address);
 
 // SRWLOCK
 #ifdef LINUX
@@ -4,6 +4,9 @@
 // Author: Ulf Frisk, pcileech@frizk.net
 //
 #include "util.h"
+#ifdef LINUX
+#include <sys/mman.h>
+#endif /* LINUX */
 
 /*
 * Retrieve the operating system path of the directory which is containing this:
@@ -205,3 +208,75 @@ BOOL Util_IsProgramBitness64()
 #endif /* _WIN64 */
     return TRUE;
 }
+
+#ifdef LINUX
+/*
+* Map a memfd twice back to back to create a mirrored ring.
+* -- cbRing
+* -- return = the ring memory (2 * cbRing bytes), or NULL on fail.
+*/
+PBYTE Util_RingBuf_MapMirror(_In_ DWORD cbRing)
+{
+    int fd;
+    PBYTE pb = NULL, pbMap;
+    if((fd = memfd_create("leechcore_ringbuf", MFD_CLOEXEC)) < 0) { return NULL; }
+    if(ftruncate(fd, cbRing)) { goto fail; }
+    // reserve address space for both views, then map the views on top of it:
+    pbMap = mmap(NULL, 2 * (SIZE_T)cbRing, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(pbMap == MAP_FAILED) { goto fail; }
+    if((mmap(pbMap, cbRing, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) ||
+        (mmap(pbMap + cbRing, cbRing, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED)) {
+        munmap(pbMap, 2 * (SIZE_T)cbRing);
+        goto fail;
+    }
+    pb = pbMap;
+fail:
+    close(fd);
+    return pb;
+}
+#endif /* LINUX */
+
+_Success_(return)
+BOOL Util_RingBuf_Initialize(_Out_ PUTIL_RINGBUF prb, _In_ DWORD cbRing)
+{
+    ZeroMemory(prb, sizeof(UTIL_RINGBUF));
+    prb->cbRing = prb->cbMax = (cbRing + 0xffff) & ~0xffff;
+#ifdef LINUX
+    if((prb->pb = Util_RingBuf_MapMirror(prb->cbRing))) {
+        prb->fMirror = TRUE;
+        return TRUE;
+    }
+#endif /* LINUX */
+    prb->pb = LocalAlloc(0, prb->cbRing);
+    return prb->pb ? TRUE : FALSE;
+}
+
+VOID Util_RingBuf_Close(_Inout_ PUTIL_RINGBUF prb)
+{
+#ifdef LINUX
+    if(prb->fMirror) {
+        munmap(prb->pb, 2 * (SIZE_T)prb->cbRing);
+        ZeroMemory(prb, sizeof(UTIL_RINGBUF));
+        return;
+    }
+#endif /* LINUX */
+    LocalFree(prb->pb);
+    ZeroMemory(prb, sizeof(UTIL_RINGBUF));
+}
+
+VOID Util_RingBuf_Realign(_Inout_ PUTIL_RINGBUF prb, _In_ DWORD cbWrite)
+{
+    if(prb->fMirror) {
+        // the 2nd view aliases the 1st - wrapping the offsets is free:
+        if(prb->o >= prb->cbRing) {
+            prb->o -= prb->cbRing;
+            prb->cb -= prb->cbRing;
+        }
+        return;
+    }
+    if(prb->cb + cbWrite > prb->cbMax) {
+        memmove(prb->pb, prb->pb + prb->o, prb->cb - prb->o);
+        prb->cb -= prb->o;
+        prb->o = 0;
+    }
+}
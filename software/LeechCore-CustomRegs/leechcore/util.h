@@ -89,6 +89,45 @@ BOOL Util_IsPlatformBitness64();
 */
 BOOL Util_IsProgramBitness64();
 
+/*
+* Byte ring buffer for data streamed from a device. Data is written at offset
+* cb and consumed from offset o. If mirrored (Linux) the ring memory is mapped
+* twice back to back so that data wrapping around the end of the ring is still
+* contiguous; the offsets are wrapped by Util_RingBuf_Realign without copying.
+* Otherwise the unconsumed data is moved to the start of the buffer.
+*/
+typedef struct tdUTIL_RINGBUF {
+    PBYTE pb;
+    DWORD o;                    // offset of first unconsumed byte
+    DWORD cb;                   // offset of end of data
+    DWORD cbMax;                // max unconsumed + write size (<= cbRing)
+    DWORD cbRing;               // ring size
+    BOOL fMirror;               // pb maps 2 * cbRing bytes (ring mirrored)
+} UTIL_RINGBUF, *PUTIL_RINGBUF;
+
+/*
+* Allocate a ring buffer. A mirrored ring is used if supported by the OS.
+* -- prb
+* -- cbRing = ring size, rounded up to a multiple of 64kB.
+* -- return
+*/
+_Success_(return)
+BOOL Util_RingBuf_Initialize(_Out_ PUTIL_RINGBUF prb, _In_ DWORD cbRing);
+
+/*
+* Free a ring buffer allocated by Util_RingBuf_Initialize.
+* -- prb
+*/
+VOID Util_RingBuf_Close(_Inout_ PUTIL_RINGBUF prb);
+
+/*
+* Ensure cbWrite contiguous bytes are available at prb->pb + prb->cb. The
+* unconsumed data (prb->cb - prb->o) plus cbWrite must not exceed prb->cbMax.
+* -- prb
+* -- cbWrite
+*/
+VOID Util_RingBuf_Realign(_Inout_ PUTIL_RINGBUF prb, _In_ DWORD cbWrite);
+
 #ifdef _WIN32
 
 /*